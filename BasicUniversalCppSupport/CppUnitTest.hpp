@@ -24,9 +24,14 @@
 #ifndef __CPPUNITTEST_HPP__
 #define __CPPUNITTEST_HPP__
 
+#ifdef _WIN32
 #define CPPUNITTEST_WARNINGS_SUPRESSED 26429 26432 26433 26440 26455 26461 26466 26485 26490 26496 
 #pragma warning(disable: CPPUNITTEST_WARNINGS_SUPRESSED)
 #include <CppUnitTest.h>
 #pragma warning(default: CPPUNITTEST_WARNINGS_SUPRESSED)
+#else
+// elsewhere the tests are run by a stand-in (see posix_unit_test_main.cpp)
+#include "posix_unit_test.hpp"
+#endif
 
 #endif // __CPPUNITTEST_HPP__
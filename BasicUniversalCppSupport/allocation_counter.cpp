@@ -0,0 +1,72 @@
+//
+// allocation_counter.cpp : counts the heap allocations made by one thread
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include "allocation_counter.hpp"
+
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+
+// per thread state (so only allocations made by the counting thread are seen)
+static thread_local bool counting = false;
+static thread_local int allocation_count = 0;
+
+#ifdef _DEBUG
+static _CRT_ALLOC_HOOK previous_hook = nullptr;
+
+// the debug CRT reports every allocation (including those made by other modules) here
+static int __cdecl count_allocations(int allocType, void*, size_t, int blockType, long, const unsigned char*, int) noexcept
+{
+   if (((allocType == _HOOK_ALLOC) || (allocType == _HOOK_REALLOC)) && (blockType != _CRT_BLOCK))
+   {
+      allocation_counter::record();
+   }
+   return TRUE;
+}
+#else
+// the release CRT has no hook, so this dll's own allocations are counted by replacing operator new
+ALLOCATION_COUNTER_REPLACE_OPERATOR_NEW()
+#endif // _DEBUG
+
+void allocation_counter::begin() noexcept
+{
+   allocation_count = 0;
+   counting = true;
+#ifdef _DEBUG
+   previous_hook = _CrtSetAllocHook(count_allocations);
+#endif // _DEBUG
+}
+
+int allocation_counter::end() noexcept
+{
+#ifdef _DEBUG
+   _CrtSetAllocHook(previous_hook);
+#endif // _DEBUG
+   counting = false;
+   return allocation_count;
+}
+
+void allocation_counter::record() noexcept
+{
+   if (counting)
+   {
+      ++allocation_count;
+   }
+}
@@ -0,0 +1,76 @@
+//
+// allocation_counter.hpp : counts the heap allocations made by one thread (e.g. to prove a hot path doesn't allocate)
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __ALLOCATION_COUNTER_HPP__
+#define __ALLOCATION_COUNTER_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstdlib>
+#include <new>
+
+///<summary> counts the heap allocations made by the calling thread between begin() and end().</summary>
+///<remarks> the debug CRT reports every allocation (from any module) to a hook, and begin() installs one.
+/// The release CRT has no such hook, so there each module that should be counted replaces the global
+/// operator new with ALLOCATION_COUNTER_REPLACE_OPERATOR_NEW() (this dll does so already). Only one thread
+/// should count at a time.</remarks>
+class BASICUNIVERSALCPPSUPPORT_API allocation_counter
+{
+public:
+   ///<summary> start counting the allocations made by the calling thread (from zero).</summary>
+   static void begin() noexcept;
+
+   ///<summary> stop counting.</summary>
+   ///<returns> the number of allocations made by the calling thread since begin().</returns>
+   static int end() noexcept;
+
+   ///<summary> count one allocation (if the calling thread is counting).</summary>
+   ///<remarks> called by the replacement operator new in release builds.</remarks>
+   static void record() noexcept;
+};
+
+#ifdef _DEBUG
+// the debug CRT hook already sees every allocation
+#define ALLOCATION_COUNTER_REPLACE_OPERATOR_NEW()
+#else
+///<summary> replaces the global operator new and delete (in the module using it) with versions that report to allocation_counter.</summary>
+#define ALLOCATION_COUNTER_REPLACE_OPERATOR_NEW() \
+   void* operator new(std::size_t size) \
+   { \
+      allocation_counter::record(); \
+      if (void* p = std::malloc(size ? size : 1)) return p; \
+      throw std::bad_alloc(); \
+   } \
+   void* operator new[](std::size_t size) { return ::operator new(size); } \
+   void* operator new(std::size_t size, const std::nothrow_t&) noexcept { allocation_counter::record(); return std::malloc(size ? size : 1); } \
+   void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { allocation_counter::record(); return std::malloc(size ? size : 1); } \
+   void operator delete(void* p) noexcept { std::free(p); } \
+   void operator delete[](void* p) noexcept { std::free(p); } \
+   void operator delete(void* p, std::size_t) noexcept { std::free(p); } \
+   void operator delete[](void* p, std::size_t) noexcept { std::free(p); } \
+   void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); } \
+   void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#endif // _DEBUG
+
+#endif // __ALLOCATION_COUNTER_HPP__
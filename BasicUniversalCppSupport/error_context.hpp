@@ -21,68 +21,245 @@
 #ifndef __ERROR_CONTEXT_HPP__
 #define __ERROR_CONTEXT_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
 #endif
 
+#include <atomic>
 #include <exception>
+#include <memory>
 #include <sstream>
+#include <string>
 
 #include "logger.hpp"
+#include "stack_trace.hpp"
 #include "system_error.hpp"
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ERROR CONTEXT CONFIGURATION
+//
+// ERROR_CONTEXT_STACK_TRACE - Capture the stack (raw return addresses only, a few hundred nanoseconds) when an error::context 
+//                             is constructed. Symbols are only resolved if the trace is used (E.g. when the exception is logged).
+//                             Off by default, so that a throw pays for no stack capture.
+//
+//#define ERROR_CONTEXT_STACK_TRACE   // uncomment this line if you want a stack trace with every error::context
+
+#ifdef ERROR_CONTEXT_STACK_TRACE
+#define ERROR_CONTEXT_CAPTURE_STACK(_skip_frames) error::stack_trace::capture(_skip_frames)
+#else
+#define ERROR_CONTEXT_CAPTURE_STACK(_skip_frames) error::stack_trace()
+#endif
+
 ///<summary>use the predefined ANSI/ISO C99 C preprocessor macros to inject locus and context details when constructing an error::context</summary>
 #define error_context(_text) error::context(__FILE__, __LINE__, __FUNCTION__, (_text))
 
 namespace error
 {
    ///<summary> an exception subclass for ansi c++17/utf8 code clients with additional diagnostics.</summary>
-   ///<remarks> the macro 'error_context(_text)' will construct one of these for you.</remarks>
+   ///<remarks> the macro 'error_context(_text)' will construct one of these for you.
+   /// Construction (the throw) only captures the system error code and the locus pointers. The full description
+   /// (including the system error text, from a process wide cache) is built when full_what() is first called.
+   /// The stack is captured as raw return addresses (see ERROR_CONTEXT_STACK_TRACE), and symbolized only if it is logged.</remarks>
    class context : public std::exception
    {
    public:
       ///<summary> construct an error::context (an exception type with added locus and context details).</summary>
-      ///<remarks> macro 'error_context(_text)' will construct one in line.</remarks>
-      ///<param name='a_path'> use predefined ANSI/ISO C99 C preprocessor macro __SOURCE__ </param>
+      ///<remarks> macro 'error_context(_text)' will construct one in line. The last system error is captured, and left unchanged.</remarks>
+      ///<param name='a_path'> use predefined ANSI/ISO C99 C preprocessor macro __SOURCE__ (must have static storage duration)</param>
       ///<param name='a_line'> use predefined ANSI/ISO C99 C preprocessor macro __LINE__ </param>
-      ///<param name='a_func'> use predefined ANSI/ISO C99 C preprocessor macro __FUNCTION__ </param>
+      ///<param name='a_func'> use predefined ANSI/ISO C99 C preprocessor macro __FUNCTION__ (must have static storage duration)</param>
       ///<param name='a_what'> a short description of the exception.</param>
-      BASICUNIVERSALCPPSUPPORT_API context(const char* a_path, int a_line, const char* a_func, const char* a_what) :
-         m_file(get_short_file(a_path)),
+      BASICUNIVERSALCPPSUPPORT_API context(const char* a_path, int a_line, const char* a_func, const char* a_what) noexcept :
+#ifdef _MSC_VER
+         std::exception(a_what),    // (microsoft's std::exception keeps its own copy of the text)
+#else
+         m_what(a_what),
+#endif
+         m_path(a_path),
          m_line(a_line),
          m_func(a_func),
-         m_reason(SystemError().get_error_text()),
-         std::exception(a_what)
+         m_error_code(SystemError::get_last_error_code()),
+         m_stack_trace(ERROR_CONTEXT_CAPTURE_STACK(0))
       {
-         m_full_what = logging::decorate_error_context(m_file, m_line, m_func, std::exception::what(), m_reason);
       };
 
+      ///<summary> construct an error::context for a system error code captured earlier (E.g. by an error::code).</summary>
+      ///<param name='a_path'> use predefined ANSI/ISO C99 C preprocessor macro __SOURCE__ (must have static storage duration)</param>
+      ///<param name='a_line'> use predefined ANSI/ISO C99 C preprocessor macro __LINE__ </param>
+      ///<param name='a_func'> use predefined ANSI/ISO C99 C preprocessor macro __FUNCTION__ (must have static storage duration)</param>
+      ///<param name='a_what'> a short description of the exception.</param>
+      ///<param name='an_error_code'> the system error code implicated.</param>
+      BASICUNIVERSALCPPSUPPORT_API context(const char* a_path, int a_line, const char* a_func, const char* a_what, int an_error_code) noexcept :
+#ifdef _MSC_VER
+         std::exception(a_what),
+#else
+         m_what(a_what),
+#endif
+         m_path(a_path),
+         m_line(a_line),
+         m_func(a_func),
+         m_error_code(an_error_code),
+         m_stack_trace(ERROR_CONTEXT_CAPTURE_STACK(0))
+      {
+      };
+
+      ///<summary> construct an error::context for a system error code captured earlier, with a stack captured by the caller.</summary>
+      ///<remarks> E.g. error::code::raise captures the stack from its own caller, so the trace does not start in raise.</remarks>
+      ///<param name='a_path'> use predefined ANSI/ISO C99 C preprocessor macro __SOURCE__ (must have static storage duration)</param>
+      ///<param name='a_line'> use predefined ANSI/ISO C99 C preprocessor macro __LINE__ </param>
+      ///<param name='a_func'> use predefined ANSI/ISO C99 C preprocessor macro __FUNCTION__ (must have static storage duration)</param>
+      ///<param name='a_what'> a short description of the exception.</param>
+      ///<param name='an_error_code'> the system error code implicated.</param>
+      ///<param name='a_stack_trace'> the stack to report (empty if ERROR_CONTEXT_STACK_TRACE is not defined).</param>
+      BASICUNIVERSALCPPSUPPORT_API context(const char* a_path, int a_line, const char* a_func, const char* a_what, int an_error_code, const error::stack_trace& a_stack_trace) noexcept :
+#ifdef _MSC_VER
+         std::exception(a_what),
+#else
+         m_what(a_what),
+#endif
+         m_path(a_path),
+         m_line(a_line),
+         m_func(a_func),
+         m_error_code(an_error_code),
+         m_stack_trace(a_stack_trace)
+      {
+      };
+
+      ///<summary> copy constructor (the copy builds its own full description, when it is first asked for).</summary>
+      BASICUNIVERSALCPPSUPPORT_API context(const context& other) :
+         std::exception(other),
+#ifndef _MSC_VER
+         m_what(other.m_what),
+#endif
+         m_path(other.m_path),
+         m_line(other.m_line),
+         m_func(other.m_func),
+         m_error_code(other.m_error_code),
+         m_full_what(nullptr),
+         m_stack_trace(other.m_stack_trace)
+      {
+      }
+
+      ///<summary> copy assignment (not safe while another thread reads this exception).</summary>
+      BASICUNIVERSALCPPSUPPORT_API context& operator=(const context& other)
+      {
+         if (this != &other)
+         {
+            std::exception::operator=(other);
+#ifndef _MSC_VER
+            m_what = other.m_what;
+#endif
+            m_path = other.m_path;
+            m_line = other.m_line;
+            m_func = other.m_func;
+            m_error_code = other.m_error_code;
+            delete m_full_what.exchange(nullptr);
+            m_stack_trace = other.m_stack_trace;
+         }
+         return *this;
+      }
+
+      ///<summary> destructor releases the full description (if it was built).</summary>
+      BASICUNIVERSALCPPSUPPORT_API ~context() override
+      {
+         delete m_full_what.load();
+      }
+
       ///<summary> get full description of exception.</summary>
       ///<returns> a full description of what went wrong (including details of where in the code and any system error that is implicated).
       /// Note: return value is raw pointer to short lived memory that will be invalidated when the exception destructor is called.</returns>
+      ///<remarks> the description is built on first use. Threads sharing the exception may call this concurrently: if
+      /// several build the description at once, the first one published is kept, and the others are discarded.</remarks>
       BASICUNIVERSALCPPSUPPORT_API const char* full_what() const noexcept
       {
-         return m_full_what.c_str();
+         const std::string* full_what = m_full_what.load(std::memory_order_acquire);
+         if (full_what == nullptr)
+         {
+            try
+            {
+               auto built = std::make_unique<const std::string>(logging::decorate_error_context(get_short_file(m_path), m_line, m_func, context::what(), SystemError::get_cached_error_text(m_error_code)));
+               if (m_full_what.compare_exchange_strong(full_what, built.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+               {
+                  full_what = built.release();
+               }
+               // (otherwise another thread published first, and full_what now points to its description)
+            }
+            catch (...)
+            {
+               return context::what();   // out of memory (the short description is better than nothing)
+            }
+         }
+         return full_what->c_str();
+      }
+
+#ifndef _MSC_VER
+      ///<summary> get the short description of the exception.</summary>
+      const char* what() const noexcept override
+      {
+         return m_what.c_str();
+      }
+#endif
+
+      ///<summary> get the system error code captured when the exception was constructed.</summary>
+      BASICUNIVERSALCPPSUPPORT_API int get_error_code() const noexcept
+      {
+         return m_error_code;
+      }
+
+      ///<summary> get the stack captured when the exception was constructed (empty if ERROR_CONTEXT_STACK_TRACE is not defined).</summary>
+      ///<remarks> use stack_trace::to_string() to resolve symbols (this is only done on demand).</remarks>
+      BASICUNIVERSALCPPSUPPORT_API const error::stack_trace& get_stack_trace() const noexcept
+      {
+         return m_stack_trace;
       }
 
    private:
+#ifndef _MSC_VER
+      ///<summary> the short description (other standard libraries' std::exception can't hold one).</summary>
+      std::string m_what;
+#endif
+
       ///<summary> the source file where the exception is thrown.</summary>
-      const std::string m_file;
+      const char* m_path;
 
       ///<summary> the source code line number where the exception is thrown.</summary>
-      const int m_line;
+      int m_line;
 
       ///<summary> the name of the enclosing function where the exception is thrown.</summary>
-      const std::string m_func;
+      const char* m_func;
+
+      ///<summary> the underlying system error code (if any system error occurred).</summary>
+      int m_error_code;
 
-      ///<summary> the underlying system error message (if any system error occurred).</summary>
-      const std::string m_reason;
+      ///<summary> the full description of what went wrong (built on first use, and published atomically).</summary>
+      mutable std::atomic<const std::string*> m_full_what = nullptr;
 
-      ///<summary> the full description of what went wrong.</summary>
-      std::string m_full_what;
+      ///<summary> the stack where the exception is constructed (raw return addresses).</summary>
+      error::stack_trace m_stack_trace;
    };
+
+   ///<summary> describe an exception for a log.</summary>
+   ///<remarks> an error::context is described by full_what() followed by its stack trace (symbols are resolved here), 
+   /// other exceptions by what().</remarks>
+   inline std::string describe(const std::exception& e)
+   {
+      const auto context = dynamic_cast<const error::context*>(&e);
+      if (context == nullptr)
+      {
+         return e.what();
+      }
+
+      std::string description(context->full_what());
+      if (!context->get_stack_trace().empty())
+      {
+         description.append("\n").append(context->get_stack_trace().to_string());
+      }
+      return description;
+   }
 }
 #endif // __ERROR_CONTEXT_HPP__
 
@@ -0,0 +1,208 @@
+//
+// expected.hpp : implements an exception free result type (a value, or a lightweight error)
+//
+// Use where failure is routine (E.g. polling, retries, choosing a strategy) so that the error path
+// doesn't pay for throwing and unwinding. value() converts an error into an error::context throw,
+// so a throwing API can be a thin wrapper on top of an expected returning one.
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __EXPECTED_HPP__
+#define __EXPECTED_HPP__
+
+#include <optional>
+#include <utility>
+#include <variant>
+
+#include "error_context.hpp"
+
+///<summary>use the predefined ANSI/ISO C99 C preprocessor macros to inject locus details when constructing an error::code</summary>
+#define error_code_context(_text) error::code(__FILE__, __LINE__, __FUNCTION__, (_text))
+
+///<summary> keep a function out of line (so that it is a frame of its own, E.g. one a stack capture can skip).</summary>
+#ifdef _MSC_VER
+#define ERROR_NOINLINE __declspec(noinline)
+#else
+#define ERROR_NOINLINE __attribute__((noinline))
+#endif
+
+namespace error
+{
+   ///<summary> a lightweight error (the same details as an error::context, but nothing is formatted or allocated).</summary>
+   ///<remarks> the macro 'error_code_context(_text)' will construct one of these for you.</remarks>
+   class code
+   {
+   public:
+      ///<summary> construct an error::code (capturing the last system error, which is left unchanged).</summary>
+      ///<param name='a_path'> use predefined ANSI/ISO C99 C preprocessor macro __SOURCE__ (must have static storage duration)</param>
+      ///<param name='a_line'> use predefined ANSI/ISO C99 C preprocessor macro __LINE__ </param>
+      ///<param name='a_func'> use predefined ANSI/ISO C99 C preprocessor macro __FUNCTION__ (must have static storage duration)</param>
+      ///<param name='a_what'> a short description of the error (must have static storage duration).</param>
+      code(const char* a_path, int a_line, const char* a_func, const char* a_what) noexcept :
+         m_path(a_path),
+         m_line(a_line),
+         m_func(a_func),
+         m_what(a_what),
+         m_error_code(SystemError::get_last_error_code())
+      {
+      }
+
+      ///<summary> construct an error::code for a system error code captured earlier (E.g. by an error::context).</summary>
+      ///<param name='a_path'> use predefined ANSI/ISO C99 C preprocessor macro __SOURCE__ (must have static storage duration)</param>
+      ///<param name='a_line'> use predefined ANSI/ISO C99 C preprocessor macro __LINE__ </param>
+      ///<param name='a_func'> use predefined ANSI/ISO C99 C preprocessor macro __FUNCTION__ (must have static storage duration)</param>
+      ///<param name='a_what'> a short description of the error (must have static storage duration).</param>
+      ///<param name='an_error_code'> the system error code implicated.</param>
+      code(const char* a_path, int a_line, const char* a_func, const char* a_what, int an_error_code) noexcept :
+         m_path(a_path),
+         m_line(a_line),
+         m_func(a_func),
+         m_what(a_what),
+         m_error_code(an_error_code)
+      {
+      }
+
+      ///<summary> get the short description of the error.</summary>
+      const char* what() const noexcept
+      {
+         return m_what;
+      }
+
+      ///<summary> get the system error code captured when the error was constructed.</summary>
+      int get_error_code() const noexcept
+      {
+         return m_error_code;
+      }
+
+      ///<summary> get the equivalent error::context (E.g. to log its full_what()).</summary>
+      context to_context() const noexcept
+      {
+         return context(m_path, m_line, m_func, m_what, m_error_code);
+      }
+
+      ///<summary> throw the equivalent error::context.</summary>
+      ///<remarks> any stack trace (see ERROR_CONTEXT_STACK_TRACE) starts at the caller of raise, not in raise.</remarks>
+      ///<exception cref='error::context'> always.</exception>
+      [[noreturn]] ERROR_NOINLINE void raise() const
+      {
+         throw context(m_path, m_line, m_func, m_what, m_error_code, ERROR_CONTEXT_CAPTURE_STACK(1));
+      }
+
+   private:
+      const char* m_path;
+      int m_line;
+      const char* m_func;
+      const char* m_what;
+      int m_error_code;
+   };
+
+   ///<summary> the result of an operation that can fail without throwing: either a value, or an error::code.</summary>
+   template<typename T>
+   class expected
+   {
+   public:
+      ///<summary> construct a successful result.</summary>
+      expected(const T& a_value) : m_state(std::in_place_index<0>, a_value) {}
+
+      ///<summary> construct a successful result.</summary>
+      expected(T&& a_value) noexcept : m_state(std::in_place_index<0>, std::move(a_value)) {}
+
+      ///<summary> construct a failed result.</summary>
+      expected(const code& an_error) noexcept : m_state(std::in_place_index<1>, an_error) {}
+
+      ///<summary> true if the operation succeeded.</summary>
+      bool has_value() const noexcept
+      {
+         return m_state.index() == 0;
+      }
+
+      ///<summary> true if the operation succeeded.</summary>
+      explicit operator bool() const noexcept
+      {
+         return has_value();
+      }
+
+      ///<summary> get the value.</summary>
+      ///<exception cref='error::context'> if the operation failed.</exception>
+      const T& value() const
+      {
+         if (!has_value())
+         {
+            std::get<1>(m_state).raise();
+         }
+         return std::get<0>(m_state);
+      }
+
+      ///<summary> get the value, or a default if the operation failed.</summary>
+      T value_or(const T& a_default) const
+      {
+         return has_value() ? std::get<0>(m_state) : a_default;
+      }
+
+      ///<summary> get the error (only valid if the operation failed).</summary>
+      const code& error() const noexcept
+      {
+         return *std::get_if<1>(&m_state);
+      }
+
+   private:
+      std::variant<T, code> m_state;
+   };
+
+   ///<summary> the result of an operation (that has no value) that can fail without throwing.</summary>
+   template<>
+   class expected<void>
+   {
+   public:
+      ///<summary> construct a successful result.</summary>
+      expected() noexcept = default;
+
+      ///<summary> construct a failed result.</summary>
+      expected(const code& an_error) noexcept : m_error(an_error) {}
+
+      ///<summary> true if the operation succeeded.</summary>
+      bool has_value() const noexcept
+      {
+         return !m_error.has_value();
+      }
+
+      ///<summary> true if the operation succeeded.</summary>
+      explicit operator bool() const noexcept
+      {
+         return has_value();
+      }
+
+      ///<summary> check for success.</summary>
+      ///<exception cref='error::context'> if the operation failed.</exception>
+      void value() const
+      {
+         if (m_error.has_value())
+         {
+            m_error->raise();
+         }
+      }
+
+      ///<summary> get the error (only valid if the operation failed).</summary>
+      const code& error() const noexcept
+      {
+         return *m_error;
+      }
+
+   private:
+      std::optional<code> m_error;
+   };
+}
+#endif // __EXPECTED_HPP__
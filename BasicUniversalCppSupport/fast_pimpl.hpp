@@ -0,0 +1,131 @@
+//
+// fast_pimpl.hpp : in place ("fast pimpl") storage for a private implementation
+//
+// spimpl::impl_ptr heap allocates every impl. fast_impl_ptr keeps the impl inside the owning object instead, in
+// fixed capacity storage declared in the public header. The impl type stays hidden (the header only states a size
+// and alignment), so the ABI hiding benefit of pimpl is kept without the allocation.
+//
+// Usage: declare the owning class's constructors, destructor and (if wanted) copy and move operations in its header,
+// and define them in the .cpp file (E.g. "= default") where impl is complete. The capacity and alignment are checked
+// there, at compile time.
+//
+// Copyright (c) 2019-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __FAST_PIMPL_HPP__
+#define __FAST_PIMPL_HPP__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define FAST_PIMPL_WARNINGS_SUPPRESSED 26490
+#pragma warning(disable: FAST_PIMPL_WARNINGS_SUPPRESSED)
+
+namespace spimpl
+{
+   ///<summary> in place storage for a private implementation (no heap allocation).</summary>
+   ///<remarks> copyable and movable when T is (members are only instantiated if used). Unlike impl_ptr, a moved from
+   /// fast_impl_ptr still holds an (impl defined) moved from T.</remarks>
+   ///<typeparam name='T'> the private implementation type (may be incomplete where the owning class is declared).</typeparam>
+   ///<typeparam name='Capacity'> the storage size in bytes (at least sizeof(T) on every target platform and configuration).</typeparam>
+   ///<typeparam name='Alignment'> the storage alignment (a multiple of alignof(T)).</typeparam>
+   template<class T, std::size_t Capacity, std::size_t Alignment = alignof(void*)>
+   class fast_impl_ptr
+   {
+   public:
+      ///<summary> construct the impl in place.</summary>
+      template<class... Args>
+      explicit fast_impl_ptr(std::in_place_t, Args&&... args)
+      {
+         validate();
+         ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+      }
+
+      ///<summary> copy constructor (copy constructs the impl in place).</summary>
+      fast_impl_ptr(const fast_impl_ptr& other)
+      {
+         ::new (static_cast<void*>(storage)) T(*other);
+      }
+
+      ///<summary> move constructor (move constructs the impl in place).</summary>
+      fast_impl_ptr(fast_impl_ptr&& other) noexcept
+      {
+         static_assert(std::is_nothrow_move_constructible_v<T>, "fast_impl_ptr requires a noexcept impl move constructor");
+         ::new (static_cast<void*>(storage)) T(std::move(*other));
+      }
+
+      ///<summary> copy assignment (copy, then move assign, so that a failed copy leaves this unchanged).</summary>
+      fast_impl_ptr& operator=(const fast_impl_ptr& other)
+      {
+         if (this != &other)
+         {
+            T copy(*other);
+            **this = std::move(copy);
+         }
+         return *this;
+      }
+
+      ///<summary> move assignment.</summary>
+      fast_impl_ptr& operator=(fast_impl_ptr&& other) noexcept
+      {
+         if (this != &other)
+         {
+            **this = std::move(*other);
+         }
+         return *this;
+      }
+
+      ///<summary> destructor (destroys the impl in place).</summary>
+      ~fast_impl_ptr()
+      {
+         validate();
+         get()->~T();
+      }
+
+      ///<summary> get the impl.</summary>
+      T* get() noexcept
+      {
+         return std::launder(reinterpret_cast<T*>(storage));
+      }
+
+      ///<summary> get the impl.</summary>
+      const T* get() const noexcept
+      {
+         return std::launder(reinterpret_cast<const T*>(storage));
+      }
+
+      T& operator*() noexcept { return *get(); }
+      const T& operator*() const noexcept { return *get(); }
+      T* operator->() noexcept { return get(); }
+      const T* operator->() const noexcept { return get(); }
+
+   private:
+      ///<summary> compile time check that T fits (instantiated where T is complete, i.e. in the .cpp file).</summary>
+      static constexpr void validate() noexcept
+      {
+         static_assert(sizeof(T) <= Capacity, "impl is too large for its in place storage (increase the capacity in the public header)");
+         static_assert(Alignment % alignof(T) == 0, "impl alignment is not supported by its in place storage (increase the alignment in the public header)");
+      }
+
+      ///<summary> the in place storage.</summary>
+      alignas(Alignment) std::byte storage[Capacity];
+   };
+}
+
+#pragma warning(default: FAST_PIMPL_WARNINGS_SUPPRESSED)
+
+#endif // __FAST_PIMPL_HPP__
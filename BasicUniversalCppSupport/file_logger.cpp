@@ -144,22 +144,33 @@ public:
    ///<summary> write (text).</summary>
    void write(LogLevel level, const std::string& line) override
    {
+      char timebuf[utc_timestamp_size];
       std::lock_guard<std::mutex> lock(the_mutex);
-      stream << log_level(level) << ": " << utc_timestamp() << " " << line;
+      stream << log_level(level) << ": " << utc_timestamp_to(timebuf) << " " << line;
    }
 
    ///<summary> writeln.</summary>
    void writeln(LogLevel level, const std::string& line) override
    {
+      char timebuf[utc_timestamp_size];
       std::lock_guard<std::mutex> lock(the_mutex);
-      stream << log_level(level) << ": " << utc_timestamp() << " " << line << std::endl;
+      stream << log_level(level) << ": " << utc_timestamp_to(timebuf) << " " << line << std::endl;
+   }
+
+   ///<summary> writeln (prefixed).</summary>
+   ///<remarks> does not allocate (so formatted logging via LOG_*_FMT is allocation free end to end).</remarks>
+   void writeln(LogLevel level, std::string_view prefix, std::string_view line) override
+   {
+      char timebuf[utc_timestamp_size];
+      std::lock_guard<std::mutex> lock(the_mutex);
+      stream << log_level(level) << ": " << utc_timestamp_to(timebuf) << " " << prefix << line << std::endl;
    }
 
    ///<summary> write (exception).</summary>
+   ///<remarks> an error::context is logged with its stack trace (symbols are only resolved here).</remarks>
    void write(LogLevel level, const std::exception& e) override
    {
-      //TODO: stack trace 
-      writeln(level, e.what());
+      writeln(level, error::describe(e));
    }
 
    ///<summary> read_all.</summary>
@@ -233,6 +244,12 @@ void file_logger::writeln(LogLevel level, const std::string& line)
    return pimpl->writeln(level, line);
 }
 
+///<summary> writeln (prefixed).</summary>
+void file_logger::writeln(LogLevel level, std::string_view prefix, std::string_view line)
+{
+   return pimpl->writeln(level, prefix, line);
+}
+
 ///<summary> write (exception).</summary>
 void file_logger::write(LogLevel level, const std::exception& e)
 {
@@ -21,7 +21,9 @@
 #ifndef __FILE_LOGGER_HPP__
 #define __FILE_LOGGER_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -71,6 +73,12 @@ public:
    ///<param name="line"> The message to log.</param>
    BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, const std::string& line) override;
 
+   ///<summary> Write prefixed message to log with newline (prefix and message are streamed, not joined).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="prefix"> text written immediately before the message (E.g. the log site decoration).</param>
+   ///<param name="line"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, std::string_view prefix, std::string_view line) override;
+
    ///<summary> Write exception to log (multi-line).</summary>
    ///<remarks> writeln does nothing if the single bit level parameter is not set in the loggers current LogFilter bitmask.</remarks>
    ///<param name="level"> the LogLevel used to filter log messages.</param>
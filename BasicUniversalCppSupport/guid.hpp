@@ -0,0 +1,286 @@
+//
+// guid.hpp : a portable, constexpr GUID value type (with fast parsing and formatting, and no iostreams)
+//
+// GUIDs can be written as literals ("53f56308-b6bf-11d0-94f2-00a0c91efb8b"_guid) that are parsed by the compiler, so
+// tables of well known GUIDs cost nothing at run time. Both the registry form (with or without braces) and the
+// DEFINE_GUID text style used by utf8::guid_convert ("0x53f56308L, 0xb6bf, 0x11d0, 0x94, ...") are understood.
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __GUID_HPP__
+#define __GUID_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace utf8
+{
+   ///<summary> a GUID (with the same layout as the windows GUID structure).</summary>
+   struct guid
+   {
+      std::uint32_t data1 = 0;
+      std::uint16_t data2 = 0;
+      std::uint16_t data3 = 0;
+      std::array<std::uint8_t, 8> data4 = {};
+
+      ///<summary> the length of the DEFINE_GUID style text ("0xhhhhhhhhL, 0xhhhh, 0xhhhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh").</summary>
+      static constexpr std::size_t text_length = 75;
+
+      ///<summary> the length of the registry form text ("hhhhhhhh-hhhh-hhhh-hhhh-hhhhhhhhhhhh").</summary>
+      static constexpr std::size_t registry_text_length = 36;
+
+      ///<summary> equals comparison operator.</summary>
+      constexpr bool operator==(const guid& other) const noexcept = default;
+
+      ///<summary> parse a GUID.</summary>
+      ///<param name='text'> the registry form (with or without braces), or DEFINE_GUID style text (hex digits in either case).</param>
+      ///<returns> the GUID.</returns>
+      ///<exception cref='std::invalid_argument'> if text is not a GUID (at compile time, a literal that is not a GUID does not compile).</exception>
+      static constexpr guid parse(std::string_view text)
+      {
+         parser reader{ text };
+         guid parsed;
+
+         const bool braced = reader.accept('{');
+         if ((text.size() >= 9 + (braced ? 1 : 0)) && (text[8 + (braced ? 1 : 0)] == '-'))
+         {
+            // registry form: hhhhhhhh-hhhh-hhhh-hhhh-hhhhhhhhhhhh
+            parsed.data1 = static_cast<std::uint32_t>(reader.digits(8));
+            reader.expect('-');
+            parsed.data2 = static_cast<std::uint16_t>(reader.digits(4));
+            reader.expect('-');
+            parsed.data3 = static_cast<std::uint16_t>(reader.digits(4));
+            reader.expect('-');
+            for (std::size_t i = 0; i < parsed.data4.size(); i++)
+            {
+               if (i == 2)
+               {
+                  reader.expect('-');
+               }
+               parsed.data4[i] = static_cast<std::uint8_t>(reader.digits(2));
+            }
+            if (braced)
+            {
+               reader.expect('}');
+            }
+         }
+         else if (!braced)
+         {
+            // DEFINE_GUID style: 0xhhhhhhhhL, 0xhhhh, 0xhhhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh
+            parsed.data1 = static_cast<std::uint32_t>(reader.number(0xFFFFFFFFu));
+            parsed.data2 = static_cast<std::uint16_t>(reader.number(0xFFFFu));
+            parsed.data3 = static_cast<std::uint16_t>(reader.number(0xFFFFu));
+            for (auto& value : parsed.data4)
+            {
+               value = static_cast<std::uint8_t>(reader.number(0xFFu));
+            }
+         }
+         else
+         {
+            throw std::invalid_argument("not a GUID");
+         }
+
+         reader.skip_space();
+         if (!reader.done())
+         {
+            throw std::invalid_argument("unexpected text after GUID");
+         }
+         return parsed;
+      }
+
+      ///<summary> format as DEFINE_GUID style text (lower case, as utf8::guid_convert::from_guid), without allocation.</summary>
+      ///<returns> the (zero terminated) text.</returns>
+      constexpr std::array<char, text_length + 1> to_chars() const noexcept
+      {
+         std::array<char, text_length + 1> text = {};
+         std::size_t at = 0;
+         const auto put = [&text, &at](std::uint32_t value, std::size_t digits, const char* suffix) constexpr noexcept
+         {
+            text[at++] = '0';
+            text[at++] = 'x';
+            at = put_hex(text.data(), at, value, digits);
+            for (; *suffix != '\0'; suffix++)
+            {
+               text[at++] = *suffix;
+            }
+         };
+
+         put(data1, 8, "L, ");
+         put(data2, 4, ", ");
+         put(data3, 4, ", ");
+         for (std::size_t i = 0; i < data4.size(); i++)
+         {
+            put(data4[i], 2, (i + 1 < data4.size()) ? ", " : "");
+         }
+         return text;
+      }
+
+      ///<summary> format in registry form (lower case, without braces), without allocation.</summary>
+      ///<returns> the (zero terminated) text.</returns>
+      constexpr std::array<char, registry_text_length + 1> to_registry_chars() const noexcept
+      {
+         std::array<char, registry_text_length + 1> text = {};
+         std::size_t at = put_hex(text.data(), 0, data1, 8);
+         text[at++] = '-';
+         at = put_hex(text.data(), at, data2, 4);
+         text[at++] = '-';
+         at = put_hex(text.data(), at, data3, 4);
+         text[at++] = '-';
+         for (std::size_t i = 0; i < data4.size(); i++)
+         {
+            if (i == 2)
+            {
+               text[at++] = '-';
+            }
+            at = put_hex(text.data(), at, data4[i], 2);
+         }
+         return text;
+      }
+
+      ///<summary> format as DEFINE_GUID style text (lower case, as utf8::guid_convert::from_guid).</summary>
+      std::string to_string() const
+      {
+         return std::string(to_chars().data(), text_length);
+      }
+
+      ///<summary> format in registry form (lower case, without braces).</summary>
+      std::string to_registry_string() const
+      {
+         return std::string(to_registry_chars().data(), registry_text_length);
+      }
+
+   private:
+      ///<summary> write a value as (lower case) hex digits.</summary>
+      ///<returns> the position after the digits.</returns>
+      static constexpr std::size_t put_hex(char* text, std::size_t at, std::uint32_t value, std::size_t digits) noexcept
+      {
+         constexpr char hex[] = "0123456789abcdef";
+         for (std::size_t i = 0; i < digits; i++)
+         {
+            text[at + i] = hex[(value >> (4 * (digits - 1 - i))) & 0xF];
+         }
+         return at + digits;
+      }
+
+      ///<summary> reads GUID text.</summary>
+      struct parser
+      {
+         std::string_view text;
+         std::size_t at = 0;
+
+         constexpr bool done() const noexcept
+         {
+            return at == text.size();
+         }
+
+         constexpr bool accept(char ch) noexcept
+         {
+            if (!done() && (text[at] == ch))
+            {
+               at++;
+               return true;
+            }
+            return false;
+         }
+
+         constexpr void expect(char ch)
+         {
+            if (!accept(ch))
+            {
+               throw std::invalid_argument("GUID is not well formed");
+            }
+         }
+
+         constexpr void skip_space() noexcept
+         {
+            while (!done() && ((text[at] == ' ') || (text[at] == '\t')))
+            {
+               at++;
+            }
+         }
+
+         static constexpr int digit_value(char ch) noexcept
+         {
+            if ((ch >= '0') && (ch <= '9')) return ch - '0';
+            if ((ch >= 'a') && (ch <= 'f')) return ch - 'a' + 10;
+            if ((ch >= 'A') && (ch <= 'F')) return ch - 'A' + 10;
+            return -1;
+         }
+
+         ///<summary> read exactly count hex digits.</summary>
+         constexpr std::uint32_t digits(std::size_t count)
+         {
+            std::uint32_t value = 0;
+            for (std::size_t i = 0; i < count; i++)
+            {
+               const int digit = done() ? -1 : digit_value(text[at]);
+               if (digit < 0)
+               {
+                  throw std::invalid_argument("GUID has too few hex digits");
+               }
+               value = (value << 4) | static_cast<std::uint32_t>(digit);
+               at++;
+            }
+            return value;
+         }
+
+         ///<summary> read a DEFINE_GUID style number (0x prefix, L suffix and a separating comma are optional).</summary>
+         constexpr std::uint32_t number(std::uint32_t max_value)
+         {
+            skip_space();
+            if (accept('0') && !accept('x') && !accept('X'))
+            {
+               at--;    // a leading zero digit (not a 0x prefix)
+            }
+
+            std::uint64_t value = 0;
+            std::size_t count = 0;
+            for (int digit = 0; !done() && ((digit = digit_value(text[at])) >= 0); at++, count++)
+            {
+               value = (value << 4) | static_cast<std::uint64_t>(digit);
+               if (value > max_value)
+               {
+                  throw std::invalid_argument("GUID field is out of range");
+               }
+            }
+            if (count == 0)
+            {
+               throw std::invalid_argument("GUID field has no hex digits");
+            }
+
+            accept('L');
+            skip_space();
+            accept(',');
+            return static_cast<std::uint32_t>(value);
+         }
+      };
+   };
+
+   namespace literals
+   {
+      ///<summary> a GUID literal, parsed at compile time (E.g. "53f56308-b6bf-11d0-94f2-00a0c91efb8b"_guid).</summary>
+      consteval guid operator""_guid(const char* text, std::size_t length)
+      {
+         return guid::parse(std::string_view(text, length));
+      }
+   }
+}
+
+#endif // __GUID_HPP__
@@ -22,11 +22,27 @@
 #ifndef __LOG_HELPERS_HPP__
 #define __LOG_HELPERS_HPP__
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <version>
+
+#ifdef __cpp_lib_format
+#include <format>
+namespace text_format = std;
+#else
+#include <fmt/format.h>    // (the {fmt} library, where the standard library has no <format> yet, E.g. gcc 12)
+namespace text_format = fmt;
+#endif
 
 #include "gsl.hpp"
 #include "logger.hpp"
@@ -100,6 +116,77 @@ namespace logging
       return logger_factory::getInstance(logType, logFilePath, logFilter);
    };
 
+#define LOG_SITE_WARNINGS_SUPPRESSED 26446 26482
+#pragma warning(disable: LOG_SITE_WARNINGS_SUPPRESSED)
+
+   ///<summary>a log call site. The 'decoration' E.g. "main.cpp(42)                    : " is built once, at compile time.</summary>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_INFO() etc. Each decorated log macro expands
+   /// to a static constexpr log_site, so at run-time decorating a log entry costs no more than passing a pointer.</remarks>
+   class log_site
+   {
+   public:
+      ///<summary>longest decoration kept (longer file names are truncated).</summary>
+      static constexpr std::size_t max_length = 128;
+      static_assert(FILE_DETAIL_WIDTH + 2 <= max_length, "FILE_DETAIL_WIDTH is too wide for log_site");
+
+      ///<summary>build the decoration for a log call site (left aligned in FILE_DETAIL_WIDTH, as file(line)).</summary>
+      ///<param name='file'>the source file name (E.g. __SHORT_FILE__).</param>
+      ///<param name='lineNo'>the source line number (E.g. __LINE__).</param>
+      constexpr log_site(const char* const file, const int lineNo) noexcept :
+         text{},
+         length(0)
+      {
+         constexpr std::size_t line_digits = 10;
+         constexpr std::size_t reserved = line_digits + 4;   // room for "(", ")" and ": " after the file name
+
+         for (const char* pos = file; (*pos != 0x0) && (length < max_length - reserved); ++pos)
+         {
+            text[length++] = *pos;
+         }
+
+         std::array<char, line_digits> digits{};
+         std::size_t count = 0;
+         for (unsigned int value = (lineNo > 0) ? static_cast<unsigned int>(lineNo) : 0u; (count == 0) || (value != 0); value /= 10)
+         {
+            digits[count++] = static_cast<char>('0' + (value % 10));
+         }
+
+         text[length++] = '(';
+         while (count != 0)
+         {
+            text[length++] = digits[--count];
+         }
+         text[length++] = ')';
+
+         while (length < FILE_DETAIL_WIDTH)
+         {
+            text[length++] = ' ';
+         }
+         text[length++] = ':';
+         text[length++] = ' ';
+      }
+
+      ///<summary>the decoration, ready to precede the log text.</summary>
+      constexpr std::string_view prefix() const noexcept
+      {
+         return std::string_view(text.data(), length);
+      }
+
+   private:
+      std::array<char, max_length> text;
+      std::size_t length;
+   };
+
+#pragma warning(default: LOG_SITE_WARNINGS_SUPPRESSED)
+
+   ///<summary>log text together with the (compile time) decoration for its call site.</summary>
+   ///<remarks>Don't use directly, favour logger macros instead. Only lives for the duration of a log macro statement.</remarks>
+   struct decorated_text
+   {
+      const log_site& site;
+      std::string_view text;
+   };
+
    ///<summary>Emit log message</summary>
    ///<param name='level'>value used to filter log entry recording.</param>
    ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_ERROR("there was an error")</remarks>
@@ -115,6 +202,175 @@ namespace logging
       }
    };
 
+   ///<summary>Emit decorated log message</summary>
+   ///<param name='level'>value used to filter log entry recording.</param>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_ERROR("there was an error")</remarks>
+   static void log_it(LogLevel level, const decorated_text& decorated)
+   {
+      try
+      {
+         logger_factory::getInstance()->writeln(level, decorated.site.prefix(), decorated.text);
+      }
+      catch (...)
+      {
+         std::cerr << "logging failed(lvl'" << gsl::narrow_cast<int>(level) << "'): '" << decorated.site.prefix() << decorated.text << "'" << std::endl;
+      }
+   };
+
+   ///<summary>Emit exception (an error::context is logged with its stack trace)</summary>
+   ///<param name='level'>value used to filter log entry recording.</param>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_EXCEPTION(LogLevel::Error, e)</remarks>
+   static void log_exception(LogLevel level, const std::exception& e)
+   {
+      try
+      {
+         logger_factory::getInstance()->write(level, e);
+      }
+      catch (...)
+      {
+         std::cerr << "logging failed(lvl'" << gsl::narrow_cast<int>(level) << "'): '" << e.what() << "'" << std::endl;
+      }
+   };
+
+   ///<summary>per log site state for sampled and rate limited logging. Lock free, so safe (and cheap) in hot paths on any thread.</summary>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_RATE_LIMITED(LogLevel::Warning, 5, "read retry")
+   /// Each macro expansion owns a static log_limiter, so every call site is limited independently.
+   /// Each rule returns the number of occurrences suppressed since the site last logged, or nothing if this occurrence is suppressed.</remarks>
+   class log_limiter
+   {
+   public:
+      ///<summary>log every nth occurrence (the 1st, the n+1th ...).</summary>
+      std::optional<std::uint64_t> every_n(std::uint64_t n) noexcept
+      {
+         const std::uint64_t occurrence = occurrences.fetch_add(1, std::memory_order_relaxed);
+         if ((n <= 1) || (occurrence % n == 0))
+         {
+            return suppressed.exchange(0, std::memory_order_relaxed);
+         }
+         suppressed.fetch_add(1, std::memory_order_relaxed);
+         return std::nullopt;
+      }
+
+      ///<summary>log the first n occurrences, then only every period'th occurrence (reporting how many were suppressed).</summary>
+      std::optional<std::uint64_t> first_n(std::uint64_t n, std::uint64_t period) noexcept
+      {
+         const std::uint64_t occurrence = occurrences.fetch_add(1, std::memory_order_relaxed);
+         if ((occurrence < n) || ((period != 0) && ((occurrence - n + 1) % period == 0)))
+         {
+            return suppressed.exchange(0, std::memory_order_relaxed);
+         }
+         suppressed.fetch_add(1, std::memory_order_relaxed);
+         return std::nullopt;
+      }
+
+      ///<summary>log at most n occurrences in each (whole) second.</summary>
+      ///<remarks>the window reset is not synchronized with counting, so at a window boundary slightly more than n may pass.</remarks>
+      std::optional<std::uint64_t> per_second(std::uint64_t n) noexcept
+      {
+         const std::int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+         std::int64_t start = window_start.load(std::memory_order_relaxed);
+         if ((now != start) && window_start.compare_exchange_strong(start, now, std::memory_order_relaxed))
+         {
+            occurrences.store(0, std::memory_order_relaxed);
+         }
+
+         if (occurrences.fetch_add(1, std::memory_order_relaxed) < n)
+         {
+            return suppressed.exchange(0, std::memory_order_relaxed);
+         }
+         suppressed.fetch_add(1, std::memory_order_relaxed);
+         return std::nullopt;
+      }
+
+   private:
+      std::atomic<std::uint64_t> occurrences = 0;
+      std::atomic<std::uint64_t> suppressed = 0;
+      std::atomic<std::int64_t> window_start = 0;
+   };
+
+   ///<summary>build the note appended to a log entry when earlier occurrences at its log site were suppressed.</summary>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_EVERY_N(LogLevel::Warning, 100, "read retry")</remarks>
+   static const std::string suppressed_note(std::uint64_t suppressed)
+   {
+      return text_format::format(" ({} similar suppressed)", suppressed);
+   };
+
+   ///<summary>Emit log message (noting any similar messages suppressed by a log_limiter)</summary>
+   ///<param name='level'>value used to filter log entry recording.</param>
+   ///<param name='suppressed'>the number of similar messages that were not logged.</param>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_FIRST_N(LogLevel::Warning, 10, 1000, "read retry")</remarks>
+   static void log_it(LogLevel level, const std::string& text, std::uint64_t suppressed)
+   {
+      if (suppressed == 0)
+      {
+         log_it(level, text);
+         return;
+      }
+
+      try
+      {
+         log_it(level, text + suppressed_note(suppressed));
+      }
+      catch (...)
+      {
+         log_it(level, text);
+      }
+   };
+
+   ///<summary>Emit decorated log message (noting any similar messages suppressed by a log_limiter)</summary>
+   ///<param name='level'>value used to filter log entry recording.</param>
+   ///<param name='suppressed'>the number of similar messages that were not logged.</param>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_FIRST_N(LogLevel::Warning, 10, 1000, "read retry")</remarks>
+   static void log_it(LogLevel level, const decorated_text& decorated, std::uint64_t suppressed)
+   {
+      if (suppressed == 0)
+      {
+         log_it(level, decorated);
+         return;
+      }
+
+      try
+      {
+         const std::string text = std::string(decorated.text) + suppressed_note(suppressed);
+         log_it(level, decorated_text{ decorated.site, text });
+      }
+      catch (...)
+      {
+         log_it(level, decorated);
+      }
+   };
+
+   ///<summary>size of the (per thread) buffer that formatted log text is written into. Longer text is truncated.</summary>
+   constexpr std::size_t format_buffer_size = 1024;
+
+   ///<summary>Format and emit log message, without allocating</summary>
+   ///<param name='level'>value used to filter log entry recording.</param>
+   ///<param name='prefix'>the log site decoration (or empty).</param>
+   ///<param name='fmt'>std::format format string (checked against args at compile time).</param>
+   ///<param name='args'>values to format.</param>
+   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_ERROR_FMT("read {} of {} blocks", done, total)
+   /// The text is formatted into a reused per thread buffer and passed to the logger as a view.</remarks>
+   template<typename... Args>
+   static void log_format(LogLevel level, std::string_view prefix, text_format::format_string<Args...> fmt, Args&&... args)
+   {
+      thread_local std::array<char, format_buffer_size> buffer;
+      try
+      {
+         const auto result = text_format::format_to_n(buffer.data(), gsl::narrow_cast<std::ptrdiff_t>(buffer.size()), fmt, std::forward<Args>(args)...);
+         std::string_view text(buffer.data(), gsl::narrow_cast<std::size_t>(std::min<std::ptrdiff_t>(result.size, buffer.size())));
+         if (gsl::narrow_cast<std::size_t>(result.size) > buffer.size())
+         {
+            constexpr std::string_view truncated = "...";
+            std::copy(truncated.begin(), truncated.end(), buffer.end() - truncated.size());
+         }
+         logger_factory::getInstance()->writeln(level, prefix, text);
+      }
+      catch (...)
+      {
+         std::cerr << "logging failed(lvl'" << gsl::narrow_cast<int>(level) << "'): '" << prefix << "(formatted text)'" << std::endl;
+      }
+   };
+
    ///<summary>Query active logging level(s)</summary>
    ///<param name='level'>a log level to test.</param>
    ///<remarks>Don't use directly, favour logger macros instead: TEST_LOG_LEVEL(LogLevel::Debug)</remarks>
@@ -159,15 +415,6 @@ namespace logging
       return std::string(file) + "(" + std::to_string(lineNo) + ")";
    };
 
-   ///<summary>'decorate' log and exception text</summary>
-   ///<remarks>Don't use directly, favour logger macros instead. E.g. LOG_INFO() etc.</remarks>
-   static const std::string decorate_log_text(const std::string& file, int lineNo, const std::string& text)
-   {
-      std::stringstream stream;
-      stream << std::left << std::setw(FILE_DETAIL_WIDTH) << build_file_detail(file, lineNo) << ": " << text;
-      return stream.str();
-   };
-
    ///<summary>'decorate' error context</summary>
    ///<remarks>Don't use directly, favour logger macros instead.E.g. throw error_context("some description of cause");</remarks>
    static const std::string decorate_error_context(const std::string& pathName, int lineNo, const std::string& function, const std::string& text, const std::string& reason)
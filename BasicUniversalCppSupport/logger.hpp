@@ -68,6 +68,10 @@
 
 #include "log_helpers.hpp"
 
+#ifndef _MSC_VER
+#define __pragma(x)     // (the macros below only use microsoft's in-line pragma to suppress code analysis warnings)
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // HELPER ANSI 'C' MACRO CONSTRUCTS TO PROVIDE LOCATION OF A LOG ENTRY LINE IN THE SOURCE CODE 
 // This can be super useful in some situations, E.g. if you need better feedback from the field.
@@ -75,43 +79,60 @@
 // __SHORT_FILE__ is selected because code is compiled with explicit /ZI /FC options (which influence __FILE__ to be full path
 //   if you choose __FILE__ you will also need to widen the log file column (see FILE_DETAIL_WIDTH above)
 //
-#define DECORATED_LOG_TEXT(text)                                        \
-__pragma(warning(push))                                                 \
-__pragma(warning(disable:26444 26447))                                  \
-std::string(logging::decorate_log_text(__SHORT_FILE__, __LINE__, text)) \
+// the site decoration is a static constexpr (built by the compiler), so decorated logging has (almost) no run-time cost
+#define LOG_SITE() ([]() noexcept -> const logging::log_site& { static constexpr logging::log_site site(__SHORT_FILE__, __LINE__); return site; }())
+
+#define DECORATED_LOG_TEXT(text)                \
+__pragma(warning(push))                         \
+__pragma(warning(disable:26444 26447))          \
+logging::decorated_text{ LOG_SITE(), text }     \
 __pragma(warning(pop))
 
+#define DECORATED_LOG_PREFIX() (LOG_SITE().prefix())
+
 #define PLAIN_LOG_TEXT(text)           \
 __pragma(warning(push))                \
 __pragma(warning(disable:26444 26447)) \
 text                                   \
 __pragma(warning(pop))
 
+#define PLAIN_LOG_PREFIX() (std::string_view())
+
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // COMPILE TIME SELECTION - DECORATE THE LOGGING TEXT:  
 // by default here we ADD source file and line number details into debug build log entries, but not in the release builds
+// (decoration is built at compile time, so it is also affordable in release builds if you want it there)
 #ifndef LOG_TEXT
 
 #ifdef _DEBUG
 //* <<< add or delete a second leading '/' on this line to change the global decoration option for DEBUG configuration
 #define LOG_TEXT DECORATED_LOG_TEXT
+#define LOG_PREFIX DECORATED_LOG_PREFIX
 
 /*/
 #define LOG_TEXT PLAIN_LOG_TEXT
+#define LOG_PREFIX PLAIN_LOG_PREFIX
 //*/
 #else
 /* <<< add or delete a second leading '/' on this line to change the global decoration option for RELEASE configuration
 // use this to decorate the log_it text parameter so that location details are included in the logentry
 #define LOG_TEXT DECORATED_LOG_TEXT
+#define LOG_PREFIX DECORATED_LOG_PREFIX
 /*/
 #define LOG_TEXT PLAIN_LOG_TEXT
+#define LOG_PREFIX PLAIN_LOG_PREFIX
 //*/
 #endif
 
 #endif
 
+// formatted logging (LOG_*_FMT) is not decorated if LOG_TEXT was chosen elsewhere (and LOG_PREFIX was not)
+#ifndef LOG_PREFIX
+#define LOG_PREFIX PLAIN_LOG_PREFIX
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // COMPILE TIME SELECTION - DO LOGGING YES/NO:  
 // by default here we ENABLE logging in BOTH the debug build, and the release build
@@ -142,6 +163,24 @@ __pragma(warning(pop))
 #define LOG_INFO(text) if (IS_ENABLED(LogLevel::Info)) { logging::log_it(LogLevel::Info, LOG_TEXT(text)); }
 #define LOG_WARNING(text) if (IS_ENABLED(LogLevel::Warning)) { logging::log_it(LogLevel::Warning, LOG_TEXT(text)); }
 #define LOG_ERROR(text) if (IS_ENABLED(LogLevel::Error)) { logging::log_it(LogLevel::Error, LOG_TEXT(text)); }
+
+// exception logging E.g. LOG_EXCEPTION(LogLevel::Error, e) - an error::context is logged with full_what() and its stack trace
+#define LOG_EXCEPTION(level, e) if (IS_ENABLED(level)) { logging::log_exception(level, e); }
+
+// formatted logging E.g. LOG_INFO_FMT("read {} of {} blocks", done, total) - the format string is checked at compile time, and
+// the text is formatted into a reused per thread buffer, so (with file_logger) a log call that passes the filter does not allocate
+#define LOG_TRACE_FMT(...) if (IS_ENABLED(LogLevel::Trace)) { logging::log_format(LogLevel::Trace, LOG_PREFIX(), __VA_ARGS__); }
+#define LOG_DEBUG_FMT(...) if (IS_ENABLED(LogLevel::Debug)) { logging::log_format(LogLevel::Debug, LOG_PREFIX(), __VA_ARGS__); }
+#define LOG_INFO_FMT(...) if (IS_ENABLED(LogLevel::Info)) { logging::log_format(LogLevel::Info, LOG_PREFIX(), __VA_ARGS__); }
+#define LOG_WARNING_FMT(...) if (IS_ENABLED(LogLevel::Warning)) { logging::log_format(LogLevel::Warning, LOG_PREFIX(), __VA_ARGS__); }
+#define LOG_ERROR_FMT(...) if (IS_ENABLED(LogLevel::Error)) { logging::log_format(LogLevel::Error, LOG_PREFIX(), __VA_ARGS__); }
+
+// sampled and rate limited logging E.g. LOG_RATE_LIMITED(LogLevel::Warning, 5, e.full_what()) - each call site has its own
+// (lock free) counters. When a site logs again after suppressing messages, the entry notes how many were suppressed
+#define LOG_LIMITED(level, rule, text) if (IS_ENABLED(level)) { static logging::log_limiter limiter; if (const auto suppressed = limiter.rule) { logging::log_it(level, LOG_TEXT(text), *suppressed); } }
+#define LOG_EVERY_N(level, n, text) LOG_LIMITED(level, every_n(n), text)                  // the 1st, n+1th, 2n+1th ... occurrence
+#define LOG_FIRST_N(level, n, period, text) LOG_LIMITED(level, first_n(n, period), text)  // the first n, then every period'th occurrence
+#define LOG_RATE_LIMITED(level, n, text) LOG_LIMITED(level, per_second(n), text)          // at most n occurrences each second
 #else
 // INACTIVE LOGGING (all log lines are just passive code comments)
 
@@ -161,6 +200,18 @@ __pragma(warning(pop))
 #define LOG_INFO(text) UNREFERENCED_PARAMETER(text)
 #define LOG_WARNING(text) UNREFERENCED_PARAMETER(text)
 #define LOG_ERROR(text) UNREFERENCED_PARAMETER(text)
+
+#define LOG_EXCEPTION(level, e) UNREFERENCED_PARAMETER(e)
+
+#define LOG_TRACE_FMT(...) {}
+#define LOG_DEBUG_FMT(...) {}
+#define LOG_INFO_FMT(...) {}
+#define LOG_WARNING_FMT(...) {}
+#define LOG_ERROR_FMT(...) {}
+
+#define LOG_EVERY_N(level, n, text) UNREFERENCED_PARAMETER(text)
+#define LOG_FIRST_N(level, n, period, text) UNREFERENCED_PARAMETER(text)
+#define LOG_RATE_LIMITED(level, n, text) UNREFERENCED_PARAMETER(text)
 #endif
 
 #endif // __LOGGER_HPP__
@@ -19,7 +19,9 @@
 #ifndef __LOGGER_FACTORY_HPP__
 #define __LOGGER_FACTORY_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -27,7 +29,9 @@
 
 #include "logger_interface.hpp"
 #include "file_logger.hpp"
+#include "mapped_file_logger.hpp"
 #include "null_logger.hpp"
+#include "shared_file_logger.hpp"
 
 class BASICUNIVERSALCPPSUPPORT_API logger_factory
 {
@@ -37,7 +41,9 @@ public:
    enum class logger_type : int
    {
       null_logger = 0,     // null (do nothing) waste of space
-      file_logger = 1      // a thread-safe file based logger
+      file_logger = 1,     // a thread-safe file based logger
+      mapped_file_logger = 2, // a thread-safe memory mapped file logger (for high rate logging, E.g. bursts of Trace)
+      shared_file_logger = 3  // a thread-safe and multi-process safe file logger (one log file shared by several processes)
    };
    
    ///<summary> getInstance - a static singleton is chosen so that we have exactly one logger.</summary>
@@ -46,9 +52,9 @@ public:
    /// main has created a file logger, then the whole program will fallback to default (null logging).</remarks>
    ///<param name='loggerType'> If this is the first call to getInstance, this type will be used to 
    /// factory construct a logger instance of this type. On subsequent calls the parameter is ignored.</param>
-   ///<param name='filePath'> If this is the first call to getInstance, and type is file_logger, then this 
+   ///<param name='filePath'> If this is the first call to getInstance, and type is a file logger, then this 
    /// string will be used as the name of the log file (otherwise the parameter is ignored).</param>
-   ///<param name='logFilter'> If this is the first call to getInstance, and type is file_logger, then this 
+   ///<param name='logFilter'> If this is the first call to getInstance, and type is a file logger, then this 
    /// value will be used to select which messages will be logged, (otherwise the parameter is ignored).</param>
    ///<returns> a shared pointer to the singleton logger instance.</returns>
    static std::shared_ptr<logger_interface> getInstance(logger_type loggerType=logger_type::null_logger, const std::string& filePath="", LogFilter logFilter = LogFilter::None)
@@ -68,6 +74,18 @@ private:
       {
       case logger_type::file_logger:
          return std::make_shared<file_logger>(filePath, logFilter);
+
+#ifdef _WIN32
+      case logger_type::mapped_file_logger:
+         return std::make_shared<mapped_file_logger>(filePath, logFilter);
+
+      case logger_type::shared_file_logger:
+         return std::make_shared<shared_file_logger>(filePath, logFilter);
+#else
+      case logger_type::mapped_file_logger:     // (these use Windows file mapping and locking, so elsewhere
+      case logger_type::shared_file_logger:     //  a plain file logger stands in)
+         return std::make_shared<file_logger>(filePath, logFilter);
+#endif
          
       case logger_type::null_logger:
       default:
@@ -24,8 +24,11 @@
 
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -62,43 +65,34 @@ class logger_interface
 public:
 
    ///<summary> get a textual description of the log level. Use this when constructing a log entry.</summary>
-   ///<returns> text identifying the LogLevel (extended with whitespace to help log alignment).</returns>
+   ///<returns> text identifying the LogLevel (extended with whitespace to help log alignment). The text is static (no allocation).</returns>
    ///<exception cref='std::invalid_argument'> if LogLevel::none is supplied. Puropse is to comment log entries, and in this context LogLevel::None is never valid.</exception>
    ///<exception cref='std::logic_error'> if (after implementation change) an unexpected LogLevel value is supplied that is not (yet) supported here.</exception>
-   static const std::string log_level(LogLevel level)
+   static constexpr std::string_view log_level(LogLevel level)
    {
-      std::string result;
-
       switch (level)
       {
       case LogLevel::None:
          throw std::invalid_argument("LogLevel::None is invalid in this context (caller should filter this out)");
-         break;
 
       case LogLevel::Trace:
-         result = "Trace   ";
-         break;
+         return "Trace   ";
 
       case LogLevel::Debug:
-         result = "Debug   ";
-         break;
+         return "Debug   ";
 
       case LogLevel::Info:
-         result = "Info    ";
-         break;
+         return "Info    ";
 
       case LogLevel::Warning:
-         result = "Warning ";
-         break;
+         return "Warning ";
 
       case LogLevel::Error:
-         result = "Error   ";
-         break;
+         return "Error   ";
 
       default:
          throw std::logic_error("LogLevel redefined? Review and revise case statements in log_level() implementation");
       }
-      return result;
    }
 
    ///<summary> default constructor.</summary>
@@ -158,6 +152,19 @@ public:
    /// <param name="line">The message to log</param>
    BASICUNIVERSALCPPSUPPORT_API virtual void writeln(LogLevel level, const std::string& line) = 0;
 
+   /// <summary> Write message to log with newline, preceded by a prefix (E.g. the compile time decoration of a log site).</summary>
+   /// <param name="level">the LogLevel used to filter log messages.</param>
+   /// <param name="prefix">text written immediately before the message (E.g. "main.cpp(42)   : ")</param>
+   /// <param name="line">The message to log</param>
+   /// <remarks> the default implementation joins prefix and line in a reused per thread buffer (so, once that buffer has
+   /// grown, it does not allocate). Implementors can override to avoid copying into the joined string.</remarks>
+   BASICUNIVERSALCPPSUPPORT_API virtual void writeln(LogLevel level, std::string_view prefix, std::string_view line)
+   {
+      thread_local std::string decorated;
+      decorated.assign(prefix).append(line);
+      writeln(level, decorated);
+   }
+
    /// <summary> Write exception to log.</summary>
    /// <param name="level">the LogLevel used to filter log messages.
    /// write does nothing if the single bit level parameter is not set in the loggers current LogFilter bitmask</param>
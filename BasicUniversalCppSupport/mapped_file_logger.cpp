@@ -0,0 +1,506 @@
+//
+// mapped_file_logger.cpp : implements memory mapped (append only) file logging
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include "mapped_file_logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#define MAPPED_FILE_LOGGER_WARNINGS_SUPPRESSED 26447 26481 26482 26446
+#pragma warning (disable: MAPPED_FILE_LOGGER_WARNINGS_SUPPRESSED)
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of mapped_file_logger class (Rule of 5)
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of mapped_file_logger.</summary>
+///<remarks> Windows types used internally, adheres to "utf8 everywhere" paradigm at public interface.
+/// The only lock is taken (rarely) when a segment is mapped or retired. Writers reserve their record space with a single
+/// atomic fetch_add on the tail offset, and then copy into the mapped view(s) in parallel.</remarks>
+class mapped_file_logger::impl
+{
+private:
+   ///<summary> maximum number of segments mapped during one logging session.</summary>
+   static constexpr std::size_t max_segments = 1024;
+
+   ///<summary> line ending (matches the on-disk form written by file_logger).</summary>
+   static constexpr char line_end[] = "\r\n";
+
+   ///<summary> state of one mapped segment.</summary>
+   struct segment
+   {
+      ///<summary> base address of the mapped view (nullptr before the segment is mapped, and after it is retired).</summary>
+      std::atomic<char*> view;
+
+      ///<summary> number of bytes copied into the segment. A segment is retired (unmapped) as soon as it is full.</summary>
+      std::atomic<std::uint64_t> filled;
+   };
+
+   LogFilter filter;
+   std::string fileName;
+   HANDLE hFile;
+   std::uint64_t segment_size;
+
+   ///<summary> absolute index (in the file) of the segment in which this session starts appending.</summary>
+   std::uint64_t first_segment;
+
+   ///<summary> absolute file offset of the next unreserved byte.</summary>
+   std::atomic<std::uint64_t> tail;
+
+   ///<summary> number of records dropped because they would not fit in the last segment.</summary>
+   std::atomic<std::uint64_t> dropped;
+
+   std::array<segment, max_segments> segments;
+   std::mutex growth_mutex;
+
+public:
+   ///<summary> normal constructor.</summary>
+   ///<exception cref='std::exception'> if the log file could not be opened and mapped.</exception>
+   impl(const std::string& aFileName, LogFilter aFilter, std::uint64_t aSegmentSize) :
+      filter(aFilter),
+      fileName(aFileName),
+      hFile(INVALID_HANDLE_VALUE),
+      segment_size(round_up_to_allocation_granularity(aSegmentSize)),
+      first_segment(0),
+      tail(0),
+      dropped(0),
+      segments(),
+      growth_mutex()
+   {
+      open_file();
+
+      const std::uint64_t append_start = find_append_start();
+      first_segment = append_start / segment_size;
+      segments[0].filled = append_start % segment_size;
+      tail = append_start;
+
+      // map the first segment and (ahead of demand) the next one
+      ensure_mapped(0);
+      ensure_mapped(1);
+   }
+
+   ///<summary> deleted copy constructor.</summary>
+   impl(const impl& other) = delete;
+
+   ///<summary> deleted move constructor.</summary>
+   impl(impl&& other) = delete;
+
+   ///<summary> deleted copy assignment operator.</summary>
+   impl& operator=(const impl& other) = delete;
+
+   ///<summary> deleted move assignment operator.</summary>
+   impl& operator=(impl&& other) = delete;
+
+   ///<summary> destructor.</summary>
+   ~impl() noexcept
+   {
+      try
+      {
+         if (dropped.load() > 0)
+         {
+            std::cerr << "mapped_file_logger dropped " << dropped.load() << " records (use a larger segment size)" << std::endl;
+         }
+         close();
+      }
+      catch (const std::exception& e)
+      {
+         std::cerr << "mapped_file_logger close failed: " << e.what() << std::endl;   // can't log while the logger is closing
+      }
+   }
+
+   ///<summary> equals comparison operator.</summary>
+   ///<remarks> defines equals to mean identical fileName member content.</remarks>
+   bool operator==(const impl& other) const noexcept
+   {
+      return fileName == other.fileName;
+   }
+
+   ///<summary> set log filter.</summary>
+   void set_log_filter(LogFilter aFilter) noexcept
+   {
+      filter = aFilter;
+   }
+
+   ///<summary> get log filter.</summary>
+   LogFilter get_log_filter() const noexcept
+   {
+      return filter;
+   }
+
+   ///<summary> write (text).</summary>
+   void write(LogLevel level, const std::string& line)
+   {
+      append(build_record(level, line, false));
+   }
+
+   ///<summary> writeln.</summary>
+   void writeln(LogLevel level, const std::string& line)
+   {
+      append(build_record(level, line, true));
+   }
+
+   ///<summary> writeln (prefixed).</summary>
+   ///<remarks> the record is built in a reused per thread buffer, so (once that buffer has grown) this does not allocate.</remarks>
+   void writeln(LogLevel level, std::string_view prefix, std::string_view line)
+   {
+      thread_local std::string record;
+      char timebuf[utc_timestamp_size];
+      record.assign(logger_interface::log_level(level)).append(": ").append(utc_timestamp_to(timebuf)).append(" ");
+      record.append(prefix).append(line).append(line_end);
+      append(record);
+   }
+
+   ///<summary> write (exception).</summary>
+   ///<remarks> an error::context is logged with its stack trace (symbols are only resolved here).</remarks>
+   void write(LogLevel level, const std::exception& e)
+   {
+      writeln(level, error::describe(e));
+   }
+
+   ///<summary> read_all.</summary>
+   ///<remarks> the preallocated (not yet written) remainder of the current segment is excluded.</remarks>
+   std::string read_all() const
+   {
+      std::ifstream t = std::ifstream(fileName);
+      std::string str((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+      str.erase(str.find_last_not_of('\0') + 1);
+      return str;
+   }
+
+   ///<summary> get the number of records dropped.</summary>
+   std::uint64_t get_dropped_records() const noexcept
+   {
+      return dropped.load(std::memory_order_relaxed);
+   }
+
+   ///<summary> clear.</summary>
+   void clear() noexcept
+   {
+      // nothing to do (there is no stream state to reset)
+   }
+
+private:
+   ///<summary> round a requested segment size up to a whole number of allocation granules (the unit of file mapping offsets).</summary>
+   static std::uint64_t round_up_to_allocation_granularity(std::uint64_t size) noexcept
+   {
+      SYSTEM_INFO system_info;
+      GetSystemInfo(&system_info);
+      const std::uint64_t granularity = system_info.dwAllocationGranularity;
+      return std::max(granularity, ((size + granularity - 1) / granularity) * granularity);
+   }
+
+   ///<summary> open (or create) the log file.</summary>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   void open_file()
+   {
+      hFile = CreateFile(utf8::convert::to_small_utf16(fileName).c_str(),
+         GENERIC_READ | GENERIC_WRITE,
+         FILE_SHARE_READ | FILE_SHARE_WRITE,
+         nullptr,
+         OPEN_ALWAYS,
+         FILE_ATTRIBUTE_NORMAL,
+         nullptr
+      );
+
+      if (hFile == INVALID_HANDLE_VALUE)
+      {
+         std::stringstream create_file_failed; create_file_failed << "CreateFile(\"" << fileName << "\", ...) failed";
+         throw error_context(create_file_failed.str().c_str());
+      }
+   }
+
+   ///<summary> find the offset at which to start appending.</summary>
+   ///<remarks> this is normally the file size, but if a previous session ended without closing (E.g. a crash) the
+   /// preallocated remainder of its last segment is still zero filled, and so is the whole of the segment it mapped
+   /// ahead of demand. The file is scanned backwards (a segment at a time) to the last written byte, and we append
+   /// over the zeros after it.</remarks>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   std::uint64_t find_append_start() const
+   {
+      LARGE_INTEGER file_size;
+      if (!GetFileSizeEx(hFile, &file_size))
+      {
+         throw error_context("GetFileSizeEx failed");
+      }
+
+      std::uint64_t end = gsl::narrow<std::uint64_t>(file_size.QuadPart);
+      std::vector<char> chunk;
+      while (end > 0)
+      {
+         chunk.resize(gsl::narrow<std::size_t>(std::min(end, segment_size)));   // (only the chunk at the start of the file is shorter)
+         LARGE_INTEGER chunk_start;
+         chunk_start.QuadPart = gsl::narrow<LONGLONG>(end - chunk.size());
+         if (!SetFilePointerEx(hFile, chunk_start, nullptr, FILE_BEGIN))
+         {
+            throw error_context("SetFilePointerEx failed");
+         }
+
+         DWORD bytes_read = 0;
+         if (!ReadFile(hFile, chunk.data(), gsl::narrow<DWORD>(chunk.size()), &bytes_read, nullptr) || (bytes_read != chunk.size()))
+         {
+            throw error_context("ReadFile failed");
+         }
+
+         const auto last_written = std::find_if(chunk.rbegin(), chunk.rend(), [](char ch) noexcept { return ch != '\0'; });
+         if (last_written != chunk.rend())
+         {
+            return end - gsl::narrow<std::uint64_t>(std::distance(chunk.rbegin(), last_written));
+         }
+         end -= chunk.size();     // (the chunk is wholly unwritten, so keep looking before it)
+      }
+      return 0;
+   }
+
+   ///<summary> format a complete log record (one contiguous block, so it can be reserved and copied in one step).</summary>
+   static std::string build_record(LogLevel level, const std::string& line, bool newline)
+   {
+      std::string record(logger_interface::log_level(level));
+      record.append(": ").append(utc_timestamp()).append(" ").append(line);
+      if (newline)
+      {
+         record.append(line_end);
+      }
+      return record;
+   }
+
+   ///<summary> reserve space for a record and copy it into the mapped segment(s).</summary>
+   ///<remarks> a record may straddle a segment boundary (it is then copied in two parts). A record that would pass the
+   /// end of the last segment is dropped (and counted), so the tail never moves past it and later records still fit.</remarks>
+   void append(std::string_view record)
+   {
+      const std::uint64_t limit = (first_segment + max_segments) * segment_size;
+      std::uint64_t offset = tail.load(std::memory_order_relaxed);
+      do
+      {
+         if (record.size() > limit - offset)
+         {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+         }
+      } while (!tail.compare_exchange_weak(offset, offset + record.size(), std::memory_order_relaxed));
+
+      const char* data = record.data();
+      std::size_t remaining = record.size();
+
+      while (remaining > 0)
+      {
+         const std::uint64_t within = offset % segment_size;
+         const std::size_t index = gsl::narrow<std::size_t>(offset / segment_size - first_segment);
+         const std::size_t chunk = gsl::narrow_cast<std::size_t>(std::min<std::uint64_t>(remaining, segment_size - within));
+
+         char* view = ensure_mapped(index);
+         memcpy(view + within, data, chunk);
+
+         if ((within == 0) && (index + 1 < max_segments))
+         {
+            // exactly one writer starts each segment, and it grows the log (ahead of demand) for the others
+            ensure_mapped(index + 1);
+         }
+
+         if (segments[index].filled.fetch_add(chunk, std::memory_order_acq_rel) + chunk == segment_size)
+         {
+            retire(index);
+         }
+
+         offset += chunk;
+         data += chunk;
+         remaining -= chunk;
+      }
+   }
+
+   ///<summary> get the view of a segment, mapping it first if necessary.</summary>
+   ///<remarks> append never reserves space beyond the last segment, so the limit check here only guards against misuse.</remarks>
+   ///<returns> the base address of the segment view (or nullptr if a map ahead request found the segment already full).</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   char* ensure_mapped(std::size_t index)
+   {
+      if (index >= max_segments)
+      {
+         throw error_context("mapped_file_logger segment limit exceeded (use a larger segment size)");
+      }
+
+      char* view = segments[index].view.load(std::memory_order_acquire);
+      if (view != nullptr)
+      {
+         return view;
+      }
+
+      std::lock_guard<std::mutex> lock(growth_mutex);
+
+      view = segments[index].view.load(std::memory_order_acquire);
+      if ((view == nullptr) && (segments[index].filled.load(std::memory_order_acquire) < segment_size))
+      {
+         ULARGE_INTEGER offset;
+         offset.QuadPart = (first_segment + index) * segment_size;
+         ULARGE_INTEGER end;
+         end.QuadPart = offset.QuadPart + segment_size;
+
+         // mapping beyond the end of the file extends the file (preallocates the segment)
+         HANDLE hFileMap = CreateFileMapping(hFile, nullptr, PAGE_READWRITE, end.HighPart, end.LowPart, nullptr);
+         if (hFileMap == nullptr)
+         {
+            throw error_context("CreateFileMapping failed");
+         }
+
+         view = static_cast<char*>(MapViewOfFile(hFileMap, FILE_MAP_WRITE, offset.HighPart, offset.LowPart, gsl::narrow<SIZE_T>(segment_size)));
+         if (view == nullptr)
+         {
+            const DWORD error_code = GetLastError();
+            CloseHandle(hFileMap);
+            SetLastError(error_code);
+            throw error_context("MapViewOfFile failed");
+         }
+
+         CloseHandle(hFileMap);   // the view holds its own reference to the mapping
+         segments[index].view.store(view, std::memory_order_release);
+      }
+      return view;
+   }
+
+   ///<summary> unmap a full segment.</summary>
+   void retire(std::size_t index) noexcept
+   {
+      std::lock_guard<std::mutex> lock(growth_mutex);
+
+      char* view = segments[index].view.exchange(nullptr, std::memory_order_acq_rel);
+      if (view != nullptr)
+      {
+         UnmapViewOfFile(view);
+      }
+   }
+
+   ///<summary> unmap all segments, and trim the preallocated (unwritten) remainder from the log file.</summary>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   void close()
+   {
+      for (segment& each : segments)
+      {
+         char* view = each.view.exchange(nullptr, std::memory_order_acq_rel);
+         if (view != nullptr)
+         {
+            UnmapViewOfFile(view);
+         }
+      }
+
+      if (hFile != INVALID_HANDLE_VALUE)
+      {
+         LARGE_INTEGER end;
+         end.QuadPart = gsl::narrow<LONGLONG>(tail.load());
+
+         const bool trimmed = SetFilePointerEx(hFile, end, nullptr, FILE_BEGIN) && SetEndOfFile(hFile);
+         const DWORD error_code = GetLastError();
+
+         CloseHandle(hFile);
+         hFile = INVALID_HANDLE_VALUE;
+
+         if (!trimmed)
+         {
+            SetLastError(error_code);
+            throw error_context("trimming mapped log file failed");
+         }
+      }
+   }
+};
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for mapped_file_logger implementation (Rule of 0)
+* ***************************************************************************
+*/
+
+///<summary> normal constructor for a mapped_file_logger.</summary>
+mapped_file_logger::mapped_file_logger(const std::string& fileName, LogFilter filter, std::uint64_t segment_size) :
+   pimpl(spimpl::make_unique_impl<impl>(fileName, filter, segment_size))
+{
+}
+
+///<summary> equals comparison operator.</summary>
+///<remarks> defines equals to mean identical fileName members.</remarks>
+bool mapped_file_logger::operator==(const mapped_file_logger& other) const noexcept
+{
+   return *pimpl.get() == *other.pimpl.get();
+}
+
+///<summary> not equals comparison operator.</summary>
+///<remarks> defines not equals to mean differing fileName members.</remarks>
+bool mapped_file_logger::operator!=(const mapped_file_logger& other) const noexcept
+{
+   return !(*this == other);
+}
+
+///<summary> set log filter.</summary>
+void mapped_file_logger::set_log_filter(LogFilter filter) noexcept
+{
+   pimpl->set_log_filter(filter);
+}
+
+///<summary> get log filter.</summary>
+LogFilter mapped_file_logger::get_log_filter() const noexcept
+{
+   return pimpl->get_log_filter();
+}
+
+///<summary> write (text).</summary>
+void mapped_file_logger::write(LogLevel level, const std::string& line)
+{
+   pimpl->write(level, line);
+}
+
+///<summary> writeln.</summary>
+void mapped_file_logger::writeln(LogLevel level, const std::string& line)
+{
+   pimpl->writeln(level, line);
+}
+
+///<summary> writeln (prefixed).</summary>
+void mapped_file_logger::writeln(LogLevel level, std::string_view prefix, std::string_view line)
+{
+   pimpl->writeln(level, prefix, line);
+}
+
+///<summary> write (exception).</summary>
+void mapped_file_logger::write(LogLevel level, const std::exception& e)
+{
+   pimpl->write(level, e);
+}
+
+///<summary> get dropped records.</summary>
+std::uint64_t mapped_file_logger::get_dropped_records() const noexcept
+{
+   return pimpl->get_dropped_records();
+}
+
+///<summary> read all.</summary>
+std::string mapped_file_logger::read_all() const
+{
+   return pimpl->read_all();
+}
+
+///<summary> clear.</summary>
+void mapped_file_logger::clear()
+{
+   pimpl->clear();
+}
+
+#pragma warning (default: MAPPED_FILE_LOGGER_WARNINGS_SUPPRESSED)
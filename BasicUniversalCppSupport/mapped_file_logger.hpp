@@ -0,0 +1,113 @@
+//
+// mapped_file_logger.hpp : implements memory mapped (append only) file logging
+//
+// Intended for high rate (E.g. burst Trace) logging. Records are copied into a preallocated memory
+// mapped region. Threads reserve space atomically and copy in parallel (no mutex and no flush per line).
+// The log file grows by mapping the next segment, and is trimmed to the logged content when closed.
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __MAPPED_FILE_LOGGER_HPP__
+#define __MAPPED_FILE_LOGGER_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstdint>
+
+#include "logger_interface.hpp"
+#include "spimpl.hpp"
+
+///<summary>memory mapped file logger for ansi c++17/utf8 code clients</summary>
+///<remarks> not copyable (a log file segment is mapped by exactly one logger), but movable.
+/// Only one mapped_file_logger (in one process) should append to any given log file.</remarks>
+class mapped_file_logger : public logger_interface
+{
+public:
+   ///<summary> default size of each mapped segment (the log file grows in steps of this size).</summary>
+   static constexpr std::uint64_t default_segment_size = 4 * 1024 * 1024;
+
+   ///<summary>normal mapped file logger constuctor.</summary>
+   ///<param name='fileName'>path and name of the log file. Existing content is preserved (new records are appended).</param>
+   ///<param name='filter'>bitmask used to filter log write events.</param>
+   ///<param name='segment_size'>size in bytes of each mapped segment (rounded up to the system allocation granularity).</param>
+   ///<exception cref='std::exception'> if the log file could not be opened and mapped.</exception>
+   BASICUNIVERSALCPPSUPPORT_API mapped_file_logger(const std::string& fileName, LogFilter filter, std::uint64_t segment_size = default_segment_size);
+
+   ///<summary> equals comparison operator.</summary>
+   ///<remarks> defines equals to mean same log file.</remarks>
+   BASICUNIVERSALCPPSUPPORT_API bool operator==(const mapped_file_logger& other) const noexcept;
+
+   ///<summary> not equals comparison operator.</summary>
+   ///<remarks> defines not equals to mean differing log files.</remarks>
+   BASICUNIVERSALCPPSUPPORT_API bool operator!=(const mapped_file_logger& other) const noexcept;
+
+   ///<summary> used to determine which messages get logged. loggers compare the filter bitmask supplied
+   /// here (or at construction time) with the single bit level supplied as parameter to write operations.</summary>
+   ///<param name='filter'>bitmask used to filter log write events.</param>
+   BASICUNIVERSALCPPSUPPORT_API void set_log_filter(LogFilter filter) noexcept override;
+
+   ///<summary> get log filter.</summary>
+   ///<returns>the current filter.</returns>
+   BASICUNIVERSALCPPSUPPORT_API LogFilter get_log_filter() const noexcept override;
+
+   ///<summary> Write message to log without newline.</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="text"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void write(LogLevel level, const std::string& line) override;
+
+   ///<summary> Write message to log with newline.</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="line"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, const std::string& line) override;
+
+   ///<summary> Write prefixed message to log with newline (built in a reused per thread buffer, so it does not allocate).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="prefix"> text written immediately before the message (E.g. the log site decoration).</param>
+   ///<param name="line"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, std::string_view prefix, std::string_view line) override;
+
+   ///<summary> Write exception to log (multi-line).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="line">The message to log</param>
+   BASICUNIVERSALCPPSUPPORT_API void write(LogLevel level, const std::exception& e) override;
+
+   ///<summary> get the number of records dropped because the log ran out of segments (see segment_size).</summary>
+   ///<remarks> a session maps at most 1024 segments. Once they are full, records are dropped rather than thrown on.</remarks>
+   BASICUNIVERSALCPPSUPPORT_API std::uint64_t get_dropped_records() const noexcept;
+
+   ///<summary>Read the complete log file. </summary>
+   ///<returns>The log file contents in raw bytes (up to and including the last reserved record)</returns>
+   BASICUNIVERSALCPPSUPPORT_API std::string read_all() const override;
+
+   ///<summary>Clear log file.</summary>
+   BASICUNIVERSALCPPSUPPORT_API void clear() override;
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default move support.</remarks>
+   spimpl::unique_impl_ptr<impl> pimpl;
+};
+
+#endif // __MAPPED_FILE_LOGGER_HPP__
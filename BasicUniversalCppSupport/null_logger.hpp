@@ -19,7 +19,9 @@
 #ifndef __NULL_LOGGER_HPP__
 #define __NULL_LOGGER_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -72,6 +74,12 @@ public:
    ///<param name="line"> The message to log.</param>
    BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, const std::string& line) noexcept override {}
 
+   ///<summary> Write prefixed message to log with newline.</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="prefix"> text written immediately before the message.</param>
+   ///<param name="line"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, std::string_view prefix, std::string_view line) noexcept override {}
+
    ///<summary> Write exception to log (multi-line).</summary>
    ///<remarks> writeln does nothing if the single bit level parameter is not set in the loggers current LogFilter bitmask.</remarks>
    ///<param name="level"> the LogLevel used to filter log messages.</param>
@@ -0,0 +1,221 @@
+//
+// posix_unit_test.hpp : a stand-in for Microsoft's CppUnitTest framework, so that the unit tests also build and run elsewhere
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __POSIX_UNIT_TEST_HPP__
+#define __POSIX_UNIT_TEST_HPP__
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include <cxxabi.h>
+
+///<summary> the part of the Microsoft::VisualStudio::CppUnitTestFramework interface that the unit tests use.</summary>
+///<remarks> test classes register their methods as they are constructed (at static initialization), and
+/// posix_unit_test_main.cpp runs them (each method on a new instance of its class, after the class initializer).</remarks>
+namespace posix_unit_test
+{
+   ///<summary> thrown by a failed assertion (not a std::exception, so that it passes through a test's own handlers).</summary>
+   struct failure
+   {
+      std::string message;
+   };
+
+   ///<summary> a registered test method.</summary>
+   struct method
+   {
+      std::string name;
+      std::function<void()> run;
+      bool ignored = false;
+   };
+
+   ///<summary> a registered test class.</summary>
+   struct test_class
+   {
+      std::string name;
+      std::function<void()> initialize;
+      std::vector<method> methods;
+   };
+
+   ///<summary> the registered test classes, in registration order.</summary>
+   inline std::vector<test_class>& get_test_classes()
+   {
+      static std::vector<test_class> test_classes;
+      return test_classes;
+   }
+
+   ///<summary> get (registering if necessary) a test class.</summary>
+   inline test_class& get_test_class(const std::string& name)
+   {
+      auto& test_classes = get_test_classes();
+      for (auto& registered : test_classes)
+      {
+         if (registered.name == name)
+         {
+            return registered;
+         }
+      }
+      test_classes.push_back(test_class{ name, nullptr, {} });
+      return test_classes.back();
+   }
+
+   ///<summary> the attributes given to a test method (see BEGIN_TEST_METHOD_ATTRIBUTE).</summary>
+   struct attributes
+   {
+      bool ignored = false;
+   };
+
+   ///<summary> the base of each test class (names the class for the registration macros).</summary>
+   template<typename T> class test_class_base
+   {
+   protected:
+      using self_type = T;
+
+      ///<summary> the test class name (without namespaces).</summary>
+      static std::string class_name()
+      {
+         int status = 0;
+         char* demangled = abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status);
+         const std::string qualified((status == 0) ? demangled : typeid(T).name());
+         std::free(demangled);
+         const auto separator = qualified.rfind("::");
+         return (separator == std::string::npos) ? qualified : qualified.substr(separator + 2);
+      }
+   };
+
+   ///<summary> fail the running test.</summary>
+   [[noreturn]] inline void fail(const char* message, const char* reason)
+   {
+      throw failure{ std::string(reason).append((message != nullptr) ? std::string(": ").append(message) : std::string()) };
+   }
+}
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework
+{
+   ///<summary> source line details (unused here).</summary>
+   struct __LineInfo
+   {
+   };
+
+   ///<summary> the assertions (messages are utf8).</summary>
+   class Assert
+   {
+   public:
+      template<typename T> static void AreEqual(const T& expected, const T& actual, const char* message = nullptr, const __LineInfo* = nullptr)
+      {
+         if (!(expected == actual))
+         {
+            posix_unit_test::fail(message, "AreEqual failed");
+         }
+      }
+
+      static void AreEqual(double expected, double actual, double tolerance, const char* message = nullptr, const __LineInfo* = nullptr)
+      {
+         if (std::fabs(expected - actual) > tolerance)
+         {
+            posix_unit_test::fail(message, "AreEqual failed");
+         }
+      }
+
+      static void AreEqual(const char* expected, const char* actual, const char* message, const __LineInfo* = nullptr)
+      {
+         if (std::strcmp(expected, actual) != 0)
+         {
+            posix_unit_test::fail(message, "AreEqual failed");
+         }
+      }
+
+      template<typename T> static void AreNotEqual(const T& notExpected, const T& actual, const char* message = nullptr, const __LineInfo* = nullptr)
+      {
+         if (notExpected == actual)
+         {
+            posix_unit_test::fail(message, "AreNotEqual failed");
+         }
+      }
+
+      static void IsTrue(bool condition, const char* message = nullptr, const __LineInfo* = nullptr)
+      {
+         if (!condition)
+         {
+            posix_unit_test::fail(message, "IsTrue failed");
+         }
+      }
+
+      static void IsFalse(bool condition, const char* message = nullptr, const __LineInfo* = nullptr)
+      {
+         if (condition)
+         {
+            posix_unit_test::fail(message, "IsFalse failed");
+         }
+      }
+
+      [[noreturn]] static void Fail(const char* message = nullptr, const __LineInfo* = nullptr)
+      {
+         posix_unit_test::fail(message, "Fail");
+      }
+   };
+}}}
+
+///<summary> declare a test class.</summary>
+#define TEST_CLASS(className) class className : public ::posix_unit_test::test_class_base<className>
+
+///<summary> declare a test method (registered as the program starts).</summary>
+#define TEST_METHOD(methodName)                                                                                \
+   struct methodName##_registration                                                                            \
+   {                                                                                                           \
+      methodName##_registration()                                                                              \
+      {                                                                                                        \
+         ::posix_unit_test::attributes attributes;                                                             \
+         [&attributes](auto* test)                                                                             \
+         {                                                                                                     \
+            using test_type = std::remove_pointer_t<decltype(test)>;                                           \
+            if constexpr (requires { test_type::methodName##_attributes(attributes); })                        \
+            {                                                                                                  \
+               test_type::methodName##_attributes(attributes);                                                 \
+            }                                                                                                  \
+         }(static_cast<self_type*>(nullptr));                                                                  \
+         ::posix_unit_test::get_test_class(class_name()).methods.push_back(            \
+            { #methodName, []() { self_type test; test.methodName(); }, attributes.ignored });                 \
+      }                                                                                                        \
+   };                                                                                                          \
+   static inline const methodName##_registration methodName##_registered;                                     \
+   void methodName()
+
+///<summary> declare the test class initializer (run once, before the first of its methods).</summary>
+#define TEST_CLASS_INITIALIZE(methodName)                                                                      \
+   struct methodName##_registration                                                                            \
+   {                                                                                                           \
+      methodName##_registration()                                                                              \
+      {                                                                                                        \
+         ::posix_unit_test::get_test_class(class_name()).initialize = &self_type::methodName; \
+      }                                                                                                        \
+   };                                                                                                          \
+   static inline const methodName##_registration methodName##_registered;                                     \
+   static void methodName()
+
+///<summary> give a test method attributes (only TEST_IGNORE is supported).</summary>
+#define BEGIN_TEST_METHOD_ATTRIBUTE(methodName) static void methodName##_attributes(::posix_unit_test::attributes& attributes) {
+#define TEST_IGNORE() attributes.ignored = true;
+#define END_TEST_METHOD_ATTRIBUTE() }
+
+#endif // __POSIX_UNIT_TEST_HPP__
@@ -0,0 +1,122 @@
+//
+// posix_unit_test_main.cpp : runs the unit tests registered with the CppUnitTest stand-in (see posix_unit_test.hpp)
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+// Usage: <test program> [TestClass | TestClass.TestMethod]...
+// With no arguments every test is run. The exit code is nonzero if a test failed (or none was selected).
+//
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "posix_unit_test.hpp"
+
+///<summary> check whether a test was selected (by its class, or by its full name).</summary>
+static bool is_selected(const std::vector<std::string>& selection, const std::string& class_name, const std::string& method_name)
+{
+   return selection.empty() ||
+      std::any_of(selection.begin(), selection.end(), [&](const std::string& selected)
+         {
+            return (selected == class_name) || (selected == class_name + "." + method_name);
+         });
+}
+
+///<summary> run a test (or class initializer).</summary>
+///<returns> an empty string on success, otherwise the reason for failure.</returns>
+static std::string run(const std::function<void()>& test)
+{
+   try
+   {
+      test();
+      return std::string();
+   }
+   catch (const posix_unit_test::failure& f)
+   {
+      return f.message;
+   }
+   catch (const std::exception& e)
+   {
+      return std::string("unexpected exception: ").append(e.what());
+   }
+   catch (...)
+   {
+      return "unexpected exception";
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   const std::vector<std::string> selection(argv + 1, argv + argc);
+   int passed = 0;
+   int failed = 0;
+   int ignored = 0;
+
+   for (const auto& test_class : posix_unit_test::get_test_classes())
+   {
+      bool initialized = false;
+      std::string initialize_failure;
+
+      for (const auto& method : test_class.methods)
+      {
+         if (!is_selected(selection, test_class.name, method.name))
+         {
+            continue;
+         }
+
+         const std::string name = test_class.name + "." + method.name;
+         if (method.ignored)
+         {
+            std::cout << "[ IGNORED ] " << name << std::endl;
+            ignored++;
+            continue;
+         }
+
+         // the class initializer runs once, before the first of its tests
+         if (!initialized)
+         {
+            initialized = true;
+            if (test_class.initialize)
+            {
+               initialize_failure = run(test_class.initialize);
+            }
+         }
+
+         std::cout << "[ RUN     ] " << name << std::endl;
+         const std::string failure = initialize_failure.empty() ? run(method.run) : "class initialize failed: " + initialize_failure;
+         if (failure.empty())
+         {
+            std::cout << "[      OK ] " << name << std::endl;
+            passed++;
+         }
+         else
+         {
+            std::cout << "[  FAILED ] " << name << " - " << failure << std::endl;
+            failed++;
+         }
+      }
+   }
+
+   std::cout << passed << " passed, " << failed << " failed, " << ignored << " ignored" << std::endl;
+   if ((passed + failed + ignored) == 0)
+   {
+      std::cout << "no tests were selected" << std::endl;
+      return 1;
+   }
+   return (failed == 0) ? 0 : 1;
+}
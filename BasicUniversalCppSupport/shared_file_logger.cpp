@@ -0,0 +1,434 @@
+//
+// shared_file_logger.cpp : implements file logging to a log file shared by several processes
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include "shared_file_logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <fstream>
+#include <tuple>
+
+#define SHARED_FILE_LOGGER_WARNINGS_SUPPRESSED 26447
+#pragma warning (disable: SHARED_FILE_LOGGER_WARNINGS_SUPPRESSED)
+
+///<summary> per-process record sequence number (shared by all shared_file_logger instances in this process).</summary>
+static std::atomic<std::uint64_t> process_sequence_number = 0;
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of shared_file_logger class (Rule of 5)
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of shared_file_logger.</summary>
+///<remarks> Windows types used internally, adheres to "utf8 everywhere" paradigm at public interface.
+/// The file is opened with FILE_APPEND_DATA access only, so every WriteFile is an atomic append at end of file
+/// (also with respect to other processes). One record is always written with exactly one WriteFile.</remarks>
+class shared_file_logger::impl
+{
+private:
+   ///<summary> line ending (matches the on-disk form written by file_logger).</summary>
+   static constexpr char line_end[] = "\r\n";
+
+   LogFilter filter;
+   std::string fileName;
+   HANDLE hFile;
+
+public:
+   ///<summary> normal constructor.</summary>
+   ///<exception cref='std::exception'> if the log file could not be opened.</exception>
+   impl(const std::string& aFileName, LogFilter aFilter) :
+      filter(aFilter),
+      fileName(aFileName),
+      hFile(INVALID_HANDLE_VALUE)
+   {
+      open_file();
+   }
+
+   ///<summary> copy constructor.</summary>
+   ///<exception cref='std::exception'> if the log file could not be opened.</exception>
+   impl(const impl& other) :
+      filter(other.filter),
+      fileName(other.fileName),
+      hFile(INVALID_HANDLE_VALUE)
+   {
+      open_file();
+   }
+
+   ///<summary> move constructor.</summary>
+   impl(impl&& other) noexcept :
+      filter(other.filter),
+      fileName(std::move(other.fileName)),
+      hFile(std::exchange(other.hFile, INVALID_HANDLE_VALUE))
+   {
+   }
+
+   ///<summary> copy assignment operator.</summary>
+   ///<exception cref='std::exception'> if the log file could not be opened.</exception>
+   impl& operator=(const impl& other)
+   {
+      if (this != &other)
+      {
+         close_file();
+         filter = other.filter;
+         fileName = other.fileName;
+         open_file();
+      }
+      return (*this);
+   }
+
+   ///<summary> move assignment operator.</summary>
+   impl& operator=(impl&& other) noexcept
+   {
+      if (this != &other)
+      {
+         close_file();
+         filter = other.filter;
+         fileName = std::move(other.fileName);
+         hFile = std::exchange(other.hFile, INVALID_HANDLE_VALUE);
+      }
+      return (*this);
+   }
+
+   ///<summary> destructor.</summary>
+   ~impl() noexcept
+   {
+      close_file();
+   }
+
+   ///<summary> equals comparison operator.</summary>
+   ///<remarks> defines equals to mean identical fileName member content.</remarks>
+   bool operator==(const impl& other) const noexcept
+   {
+      return fileName == other.fileName;
+   }
+
+   ///<summary> set log filter.</summary>
+   void set_log_filter(LogFilter aFilter) noexcept
+   {
+      filter = aFilter;
+   }
+
+   ///<summary> get log filter.</summary>
+   LogFilter get_log_filter() const noexcept
+   {
+      return filter;
+   }
+
+   ///<summary> write (text).</summary>
+   void write(LogLevel level, const std::string& line)
+   {
+      append(build_record(level, {}, line, false));
+   }
+
+   ///<summary> writeln.</summary>
+   void writeln(LogLevel level, const std::string& line)
+   {
+      append(build_record(level, {}, line, true));
+   }
+
+   ///<summary> writeln (prefixed).</summary>
+   void writeln(LogLevel level, std::string_view prefix, std::string_view line)
+   {
+      append(build_record(level, prefix, line, true));
+   }
+
+   ///<summary> write (exception).</summary>
+   ///<remarks> an error::context is logged with its stack trace (symbols are only resolved here).</remarks>
+   void write(LogLevel level, const std::exception& e)
+   {
+      writeln(level, error::describe(e));
+   }
+
+   ///<summary> read_all.</summary>
+   std::string read_all() const
+   {
+      std::ifstream t = std::ifstream(fileName);
+      std::string str((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+      return str;
+   }
+
+   ///<summary> clear.</summary>
+   void clear() noexcept
+   {
+      // nothing to do (there is no stream state to reset)
+   }
+
+private:
+   ///<summary> open (or create) the log file for atomic appends.</summary>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   void open_file()
+   {
+      hFile = CreateFile(utf8::convert::to_small_utf16(fileName).c_str(),
+         FILE_APPEND_DATA,                                     // NOT FILE_WRITE_DATA (so writes can only append)
+         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+         nullptr,
+         OPEN_ALWAYS,
+         FILE_ATTRIBUTE_NORMAL,
+         nullptr
+      );
+
+      if (hFile == INVALID_HANDLE_VALUE)
+      {
+         std::stringstream create_file_failed; create_file_failed << "CreateFile(\"" << fileName << "\", ...) failed";
+         throw error_context(create_file_failed.str().c_str());
+      }
+   }
+
+   ///<summary> close the log file.</summary>
+   void close_file() noexcept
+   {
+      if (hFile != INVALID_HANDLE_VALUE)
+      {
+         CloseHandle(hFile);
+         hFile = INVALID_HANDLE_VALUE;
+      }
+   }
+
+   ///<summary> format a complete log record E.g. "Trace   : 2023-12-04T09:15:02.1234567Z [4242:17] text".</summary>
+   ///<remarks> the record is built in a reused per thread buffer, so (once that buffer has grown) this does not allocate.</remarks>
+   ///<returns> the record (valid until the next record is built on this thread).</returns>
+   static const std::string& build_record(LogLevel level, std::string_view prefix, std::string_view line, bool newline)
+   {
+      thread_local std::string record;
+      char timebuf[utc_timestamp_precise_size];
+      char key[48];
+      char* key_end = std::to_chars(key, key + sizeof(key), static_cast<unsigned long>(GetCurrentProcessId())).ptr;
+      *key_end++ = ':';
+      key_end = std::to_chars(key_end, key + sizeof(key), ++process_sequence_number).ptr;
+
+      record.assign(logger_interface::log_level(level)).append(": ").append(utc_timestamp_precise_to(timebuf));
+      record.append(" [").append(key, key_end).append("] ");
+      record.append(prefix).append(line);
+      if (newline)
+      {
+         record.append(line_end);
+      }
+      return record;
+   }
+
+   ///<summary> append a complete record with a single (atomic) write.</summary>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   void append(const std::string& record)
+   {
+      DWORD bytes_written = 0;
+      if (!WriteFile(hFile, record.data(), gsl::narrow<DWORD>(record.size()), &bytes_written, nullptr) || (bytes_written != record.size()))
+      {
+         throw error_context("WriteFile (append) failed");
+      }
+   }
+};
+
+/*
+* ***************************************************************************
+* Merge support (offline, E.g. used by the LogMerge tool)
+* ***************************************************************************
+*/
+
+///<summary> a shared log record, as parsed for merging.</summary>
+struct shared_log_record
+{
+   std::string timestamp;           // empty only if a whole file had no record header (sorts first)
+   unsigned long process_id = 0;
+   std::uint64_t sequence_number = 0;
+   std::string text;                // the complete record (all of its lines)
+};
+
+///<summary> parse a record header "Level   : timestamp [pid:seq] ...".</summary>
+///<returns> true if line starts a record (in which case the key fields of record are assigned).</returns>
+static bool parse_record_header(const std::string& line, shared_log_record& record)
+{
+   const std::size_t level_end = line.find(": ");
+   if ((level_end == std::string::npos) || (level_end > 8))
+   {
+      return false;
+   }
+
+   const std::string level = rtrim_copy(line.substr(0, level_end));
+   if ((level != "Trace") && (level != "Debug") && (level != "Info") && (level != "Warning") && (level != "Error"))
+   {
+      return false;
+   }
+
+   const std::size_t timestamp_start = level_end + 2;
+   const std::size_t timestamp_end = line.find(" [", timestamp_start);
+   const std::size_t separator = line.find(':', timestamp_end);
+   const std::size_t key_end = line.find(']', timestamp_end);
+   if ((timestamp_end == std::string::npos) || (separator == std::string::npos) || (key_end == std::string::npos) || (separator > key_end)
+      || (line[timestamp_end - 1] != 'Z'))
+   {
+      return false;
+   }
+
+   try
+   {
+      record.process_id = std::stoul(line.substr(timestamp_end + 2, separator - timestamp_end - 2));
+      record.sequence_number = std::stoull(line.substr(separator + 1, key_end - separator - 1));
+   }
+   catch (const std::logic_error&)
+   {
+      return false;  // not numeric, so not a record header
+   }
+
+   record.timestamp = line.substr(timestamp_start, timestamp_end - timestamp_start);
+   return true;
+}
+
+///<summary> merge shared log files into one log, with records in timestamp order.</summary>
+std::size_t shared_file_logger::merge(const std::vector<std::string>& input_paths, const std::string& output_path)
+{
+   std::vector<shared_log_record> records;
+
+   for (const auto& input_path : input_paths)
+   {
+      std::ifstream input(utf8::convert::to_utf16(input_path));
+      if (!input)
+      {
+         std::stringstream open_failed; open_failed << "opening \"" << input_path << "\" failed";
+         throw error_context(open_failed.str().c_str());
+      }
+
+      // (lines before the first header of a file go with that first record, rather than continue the previous file)
+      const std::size_t first_record = records.size();
+      std::string leading_lines;
+      std::string line;
+      while (std::getline(input, line))
+      {
+         shared_log_record header;
+         if (parse_record_header(line, header))
+         {
+            header.text = (records.size() == first_record) ? leading_lines + line : line;
+            records.push_back(std::move(header));
+         }
+         else if (records.size() == first_record)
+         {
+            leading_lines.append(line).append("\n");
+         }
+         else
+         {
+            records.back().text.append("\n").append(line);  // continuation line (stays with its record)
+         }
+      }
+
+      if ((records.size() == first_record) && !leading_lines.empty())
+      {
+         leading_lines.pop_back();
+         shared_log_record headerless;
+         headerless.text = std::move(leading_lines);
+         records.push_back(std::move(headerless));    // (a file without any record header is kept whole)
+      }
+   }
+
+   std::stable_sort(records.begin(), records.end(), [](const shared_log_record& a, const shared_log_record& b)
+   {
+      return std::tie(a.timestamp, a.process_id, a.sequence_number) < std::tie(b.timestamp, b.process_id, b.sequence_number);
+   });
+
+   std::ofstream output(utf8::convert::to_utf16(output_path), std::ofstream::out | std::ofstream::trunc);
+   for (const auto& record : records)
+   {
+      output << record.text << "\n";
+   }
+
+   output.close();
+   if (!output)
+   {
+      std::stringstream write_failed; write_failed << "writing \"" << output_path << "\" failed";
+      throw error_context(write_failed.str().c_str());
+   }
+
+   return records.size();
+}
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for shared_file_logger implementation (Rule of 0)
+* ***************************************************************************
+*/
+
+///<summary> normal constructor for a shared_file_logger.</summary>
+shared_file_logger::shared_file_logger(const std::string& fileName, LogFilter filter) :
+   pimpl(spimpl::make_impl<impl>(fileName, filter))
+{
+}
+
+///<summary> equals comparison operator.</summary>
+///<remarks> defines equals to mean identical fileName members.</remarks>
+bool shared_file_logger::operator==(const shared_file_logger& other) const noexcept
+{
+   return *pimpl.get() == *other.pimpl.get();
+}
+
+///<summary> not equals comparison operator.</summary>
+///<remarks> defines not equals to mean differing fileName members.</remarks>
+bool shared_file_logger::operator!=(const shared_file_logger& other) const noexcept
+{
+   return !(*this == other);
+}
+
+///<summary> set log filter.</summary>
+void shared_file_logger::set_log_filter(LogFilter filter) noexcept
+{
+   pimpl->set_log_filter(filter);
+}
+
+///<summary> get log filter.</summary>
+LogFilter shared_file_logger::get_log_filter() const noexcept
+{
+   return pimpl->get_log_filter();
+}
+
+///<summary> write (text).</summary>
+void shared_file_logger::write(LogLevel level, const std::string& line)
+{
+   pimpl->write(level, line);
+}
+
+///<summary> writeln.</summary>
+void shared_file_logger::writeln(LogLevel level, const std::string& line)
+{
+   pimpl->writeln(level, line);
+}
+
+///<summary> writeln (prefixed).</summary>
+void shared_file_logger::writeln(LogLevel level, std::string_view prefix, std::string_view line)
+{
+   pimpl->writeln(level, prefix, line);
+}
+
+///<summary> write (exception).</summary>
+void shared_file_logger::write(LogLevel level, const std::exception& e)
+{
+   pimpl->write(level, e);
+}
+
+///<summary> read all.</summary>
+std::string shared_file_logger::read_all() const
+{
+   return pimpl->read_all();
+}
+
+///<summary> clear.</summary>
+void shared_file_logger::clear()
+{
+   pimpl->clear();
+}
+
+#pragma warning (default: SHARED_FILE_LOGGER_WARNINGS_SUPPRESSED)
@@ -0,0 +1,115 @@
+//
+// shared_file_logger.hpp : implements file logging to a log file shared by several processes
+//
+// Each record is written with a single atomic append (the file is opened for append data only), so records
+// from different processes never interleave or tear, and no cross-process lock is needed. Records carry a
+// precise UTC timestamp plus the process id and a per-process sequence number: [pid:seq].
+// Use merge (or the LogMerge tool) to produce a single log in timestamp order.
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __SHARED_FILE_LOGGER_HPP__
+#define __SHARED_FILE_LOGGER_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstddef>
+#include <vector>
+
+#include "logger_interface.hpp"
+#include "spimpl.hpp"
+
+///<summary>multi-process safe file logger for ansi c++17/utf8 code clients</summary>
+class shared_file_logger : public logger_interface
+{
+public:
+   ///<summary>normal shared file logger constuctor.</summary>
+   ///<param name='fileName'>path and name of the log file (may be shared with other processes).</param>
+   ///<param name='filter'>bitmask used to filter log write events.</param>
+   ///<exception cref='std::exception'> if the log file could not be opened.</exception>
+   BASICUNIVERSALCPPSUPPORT_API shared_file_logger(const std::string& fileName, LogFilter filter);
+
+   ///<summary> equals comparison operator.</summary>
+   ///<remarks> defines equals to mean same log file.</remarks>
+   BASICUNIVERSALCPPSUPPORT_API bool operator==(const shared_file_logger& other) const noexcept;
+
+   ///<summary> not equals comparison operator.</summary>
+   ///<remarks> defines not equals to mean differing log files.</remarks>
+   BASICUNIVERSALCPPSUPPORT_API bool operator!=(const shared_file_logger& other) const noexcept;
+
+   ///<summary> used to determine which messages get logged. loggers compare the filter bitmask supplied
+   /// here (or at construction time) with the single bit level supplied as parameter to write operations.</summary>
+   ///<param name='filter'>bitmask used to filter log write events.</param>
+   BASICUNIVERSALCPPSUPPORT_API void set_log_filter(LogFilter filter) noexcept override;
+
+   ///<summary> get log filter.</summary>
+   ///<returns>the current filter.</returns>
+   BASICUNIVERSALCPPSUPPORT_API LogFilter get_log_filter() const noexcept override;
+
+   ///<summary> Write message to log without newline (as one atomic append).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="text"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void write(LogLevel level, const std::string& line) override;
+
+   ///<summary> Write message to log with newline (as one atomic append).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="line"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, const std::string& line) override;
+
+   ///<summary> Write prefixed message to log with newline (built in a reused per thread buffer, so it does not allocate).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="prefix"> text written immediately before the message (E.g. the log site decoration).</param>
+   ///<param name="line"> The message to log.</param>
+   BASICUNIVERSALCPPSUPPORT_API void writeln(LogLevel level, std::string_view prefix, std::string_view line) override;
+
+   ///<summary> Write exception to log (multi-line, as one atomic append).</summary>
+   ///<param name="level"> the LogLevel used to filter log messages.</param>
+   ///<param name="line">The message to log</param>
+   BASICUNIVERSALCPPSUPPORT_API void write(LogLevel level, const std::exception& e) override;
+
+   ///<summary>Read the complete log file. </summary>
+   ///<returns>The log file contents in raw bytes</returns>
+   BASICUNIVERSALCPPSUPPORT_API std::string read_all() const override;
+
+   ///<summary>Clear log file.</summary>
+   BASICUNIVERSALCPPSUPPORT_API void clear() override;
+
+   ///<summary> merge shared log files into one log, with records in timestamp order.</summary>
+   ///<remarks> records with equal timestamps keep process (sequence number) order. Lines that do not start a record
+   /// (E.g. the continuation lines of a multi-line record) stay with the record they follow, and any lines before the
+   /// first record of a file stay with that first record.</remarks>
+   ///<param name='input_paths'> the shared log files to merge (records from several processes may already be interleaved in each).</param>
+   ///<param name='output_path'> the merged log file to write (replaced if it exists).</param>
+   ///<returns> the number of records merged.</returns>
+   ///<exception cref='std::exception'> if an input could not be read, or the output could not be written.</exception>
+   BASICUNIVERSALCPPSUPPORT_API static std::size_t merge(const std::vector<std::string>& input_paths, const std::string& output_path);
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default copy, move and compare support.</remarks>
+   spimpl::impl_ptr<impl> pimpl;
+};
+
+#endif // __SHARED_FILE_LOGGER_HPP__
@@ -0,0 +1,226 @@
+//
+// small_string.hpp : a string with inline (small buffer) storage
+//
+// Short strings (E.g. file and device paths converted for a system call) are held in the object, with no heap
+// allocation. Longer strings fall back to a heap buffer.
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __SMALL_STRING_HPP__
+#define __SMALL_STRING_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace utf8
+{
+   ///<summary> a zero terminated string held inline (no heap allocation) if it has fewer than N characters.</summary>
+   ///<typeparam name='CharT'> the character type.</typeparam>
+   ///<typeparam name='N'> the inline storage size in characters (including the terminator).</typeparam>
+   template<typename CharT, std::size_t N>
+   class basic_small_string
+   {
+      static_assert(N > 0, "basic_small_string needs room for a terminator");
+
+   public:
+      using view_type = std::basic_string_view<CharT>;
+
+      ///<summary> the longest string held inline.</summary>
+      static constexpr std::size_t inline_capacity = N - 1;
+
+      ///<summary> construct an empty string.</summary>
+      basic_small_string() noexcept :
+         m_size(0)
+      {
+         m_inline[0] = CharT();
+      }
+
+      ///<summary> construct from a string view.</summary>
+      basic_small_string(view_type text) :
+         basic_small_string()
+      {
+         assign(text);
+      }
+
+      ///<summary> copy constructor.</summary>
+      basic_small_string(const basic_small_string& other) :
+         basic_small_string()
+      {
+         assign(other.view());
+      }
+
+      ///<summary> move constructor (a heap buffer is transferred, inline content is copied).</summary>
+      basic_small_string(basic_small_string&& other) noexcept :
+         basic_small_string()
+      {
+         *this = std::move(other);
+      }
+
+      ///<summary> copy assignment operator.</summary>
+      basic_small_string& operator=(const basic_small_string& other)
+      {
+         if (this != &other)
+         {
+            assign(other.view());
+         }
+         return (*this);
+      }
+
+      ///<summary> move assignment operator (a heap buffer is transferred, inline content is copied).</summary>
+      basic_small_string& operator=(basic_small_string&& other) noexcept
+      {
+         if (this != &other)
+         {
+            m_heap = std::move(other.m_heap);
+            m_size = other.m_size;
+            if (!m_heap)
+            {
+               std::char_traits<CharT>::copy(m_inline, other.m_inline, m_size + 1);
+            }
+            other.clear();
+         }
+         return (*this);
+      }
+
+      ///<summary> destructor.</summary>
+      ~basic_small_string() = default;
+
+      ///<summary> replace the content.</summary>
+      void assign(view_type text)
+      {
+         resize_and_overwrite(text.size(), [text](CharT* buffer, std::size_t) noexcept
+         {
+            std::char_traits<CharT>::copy(buffer, text.data(), text.size());
+            return text.size();
+         });
+      }
+
+      ///<summary> replace the content with characters written by an operation (E.g. a conversion).</summary>
+      ///<remarks> as std::basic_string::resize_and_overwrite (C++23). If the operation throws, the string is left empty.</remarks>
+      ///<param name='count'> the most characters the operation may write.</param>
+      ///<param name='operation'> called as operation(buffer, count), returns the number of characters written.</param>
+      template<typename Operation>
+      void resize_and_overwrite(std::size_t count, Operation operation)
+      {
+         std::unique_ptr<CharT[]> heap;
+         if (count > inline_capacity)
+         {
+            heap = std::make_unique_for_overwrite<CharT[]>(count + 1);
+         }
+
+         CharT* buffer = heap ? heap.get() : m_inline;
+         try
+         {
+            m_size = operation(buffer, count);
+         }
+         catch (...)
+         {
+            clear();
+            throw;
+         }
+         buffer[m_size] = CharT();
+         m_heap = std::move(heap);
+      }
+
+      ///<summary> make the string empty (and release any heap buffer).</summary>
+      void clear() noexcept
+      {
+         m_heap.reset();
+         m_size = 0;
+         m_inline[0] = CharT();
+      }
+
+      ///<summary> get the (zero terminated) characters.</summary>
+      const CharT* c_str() const noexcept
+      {
+         return data();
+      }
+
+      ///<summary> get the (zero terminated) characters.</summary>
+      const CharT* data() const noexcept
+      {
+         return m_heap ? m_heap.get() : m_inline;
+      }
+
+      ///<summary> get the length in characters (excluding the terminator).</summary>
+      std::size_t size() const noexcept
+      {
+         return m_size;
+      }
+
+      ///<summary> get the length in characters (excluding the terminator).</summary>
+      std::size_t length() const noexcept
+      {
+         return m_size;
+      }
+
+      ///<summary> test for an empty string.</summary>
+      bool empty() const noexcept
+      {
+         return m_size == 0;
+      }
+
+      ///<summary> test whether the string is held inline (not on the heap).</summary>
+      bool is_inline() const noexcept
+      {
+         return !m_heap;
+      }
+
+      ///<summary> get a view of the string.</summary>
+      view_type view() const noexcept
+      {
+         return view_type(data(), m_size);
+      }
+
+      ///<summary> get a view of the string.</summary>
+      operator view_type() const noexcept
+      {
+         return view();
+      }
+
+      ///<summary> equals comparison operator.</summary>
+      bool operator==(view_type other) const noexcept
+      {
+         return view() == other;
+      }
+
+   private:
+      ///<summary> the heap buffer (only used if the string is too long for inline storage).</summary>
+      std::unique_ptr<CharT[]> m_heap;
+
+      ///<summary> the string length.</summary>
+      std::size_t m_size;
+
+      ///<summary> inline storage.</summary>
+      CharT m_inline[N];
+   };
+
+   ///<summary> the default inline capacity (MAX_PATH, so that file and device paths are normally held inline).</summary>
+   constexpr std::size_t small_path_length = 260;
+
+   ///<summary> a utf8 string held inline if it is short.</summary>
+   template<std::size_t N = small_path_length>
+   using small_string = basic_small_string<char, N>;
+
+   ///<summary> a utf16 string held inline if it is short.</summary>
+   template<std::size_t N = small_path_length>
+   using small_wstring = basic_small_string<wchar_t, N>;
+}
+
+#endif // __SMALL_STRING_HPP__
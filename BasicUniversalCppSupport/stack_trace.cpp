@@ -0,0 +1,152 @@
+//
+// stack_trace.cpp : implements cheap stack capture with deferred symbolization (using DbgHelp on Windows)
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include "stack_trace.hpp"
+
+#ifdef _WIN32
+#include <DbgHelp.h>
+#else
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+#define STACK_TRACE_WARNINGS_SUPPRESSED 26490
+#pragma warning (disable: STACK_TRACE_WARNINGS_SUPPRESSED)
+
+///<summary> the process wide symbol resolver (DbgHelp is single threaded, so all use is serialized here).</summary>
+struct symbol_resolver
+{
+   std::mutex mutex;
+   bool initialized = false;
+   std::unordered_map<const void*, std::string> resolved;
+};
+
+///<summary> get the process wide symbol resolver.</summary>
+static symbol_resolver& get_symbol_resolver()
+{
+   static symbol_resolver resolver;
+   return resolver;
+}
+
+///<summary> capture the calling thread's stack.</summary>
+error::stack_trace error::stack_trace::capture(unsigned long skip_frames) noexcept
+{
+   stack_trace trace;
+#ifdef _WIN32
+   trace.m_size = CaptureStackBackTrace(skip_frames + 1, gsl::narrow_cast<DWORD>(max_frames), trace.m_frames.data(), nullptr);
+#else
+   // (backtrace has no skip parameter, so the frames are captured into a larger buffer, and the innermost dropped)
+   std::array<void*, max_frames + 8> frames {};
+   const std::size_t skipped = std::min<std::size_t>(skip_frames + 1, 8);
+   const int captured = ::backtrace(frames.data(), gsl::narrow_cast<int>(frames.size()));
+   for (std::size_t i = skipped; (i < gsl::narrow_cast<std::size_t>(std::max(captured, 0))) && (trace.m_size < max_frames); i++)
+   {
+      trace.m_frames[trace.m_size++] = frames[i];
+   }
+#endif
+   return trace;
+}
+
+///<summary> resolve the frames to text, one frame per line.</summary>
+std::string error::stack_trace::to_string() const
+{
+   std::string text;
+   for (std::size_t i = 0; i < m_size; i++)
+   {
+      if (i != 0)
+      {
+         text.append("\n");
+      }
+      text.append("   at ").append(resolve(m_frames[i]));
+   }
+   return text;
+}
+
+///<summary> resolve one return address to text (cached).</summary>
+std::string error::stack_trace::resolve(const void* address)
+{
+   auto& resolver = get_symbol_resolver();
+   std::lock_guard<std::mutex> lock(resolver.mutex);
+
+   if (const auto found = resolver.resolved.find(address); found != resolver.resolved.end())
+   {
+      return found->second;
+   }
+
+#ifdef _WIN32
+   const HANDLE process = GetCurrentProcess();
+   if (!resolver.initialized)
+   {
+      SymSetOptions(SymGetOptions() | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+      resolver.initialized = (SymInitialize(process, nullptr, TRUE) != FALSE);
+   }
+
+   const DWORD64 address64 = reinterpret_cast<DWORD64>(address);
+   const DWORD64 call_site = address64 - 1;     // (a return address can be just past the end of a caller that ends in a call to a [[noreturn]] function)
+   std::stringstream text;
+
+   alignas(SYMBOL_INFO) char symbol_buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME] {};
+   SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(symbol_buffer);
+   symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+   symbol->MaxNameLen = MAX_SYM_NAME;
+
+   DWORD64 displacement = 0;
+   if (resolver.initialized && SymFromAddr(process, call_site, &displacement, symbol))
+   {
+      text << symbol->Name << " + 0x" << std::hex << (displacement + 1);
+   }
+   else
+   {
+      text << "0x" << std::hex << address64;   // no symbols available (the address is still useful with a map file)
+   }
+
+   IMAGEHLP_LINE64 line {};
+   line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+   DWORD line_displacement = 0;
+   if (resolver.initialized && SymGetLineFromAddr64(process, call_site, &line_displacement, &line))
+   {
+      text << std::dec << " (" << get_short_file(line.FileName) << "(" << line.LineNumber << "))";
+   }
+
+#else
+   std::stringstream text;
+   Dl_info info {};
+   const char* call_site = static_cast<const char*>(address) - 1;   // (as above, the return address may be past the end of the caller)
+   if ((dladdr(call_site, &info) != 0) && (info.dli_sname != nullptr))
+   {
+      int status = -1;
+      char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+      text << ((status == 0) ? demangled : info.dli_sname) << " + 0x" << std::hex << (static_cast<const char*>(address) - static_cast<const char*>(info.dli_saddr));
+      std::free(demangled);
+   }
+   else
+   {
+      text << address;   // no symbols available (E.g. a static function, unless linked with -rdynamic)
+   }
+#endif
+
+   return resolver.resolved.try_emplace(address, text.str()).first->second;
+}
+
+#pragma warning (default: STACK_TRACE_WARNINGS_SUPPRESSED)
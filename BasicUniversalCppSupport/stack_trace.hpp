@@ -0,0 +1,89 @@
+//
+// stack_trace.hpp : implements cheap stack capture with deferred symbolization
+//
+// Capturing a stack_trace only copies the raw return addresses (a few hundred nanoseconds). Symbols (function,
+// file and line) are only resolved when the trace is turned into text, and each address is resolved once per process.
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __STACK_TRACE_HPP__
+#define __STACK_TRACE_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace error
+{
+   ///<summary> the return addresses of a call stack (captured cheaply, symbolized on demand).</summary>
+   class stack_trace
+   {
+   public:
+      ///<summary> the maximum number of frames captured.</summary>
+      static constexpr std::size_t max_frames = 32;
+
+      ///<summary> construct an empty stack trace.</summary>
+      stack_trace() noexcept = default;
+
+      ///<summary> capture the calling thread's stack (no symbols are resolved here).</summary>
+      ///<param name='skip_frames'> the number of innermost frames to omit (capture itself is always omitted).</param>
+      ///<returns> the captured stack trace (empty if the stack could not be captured).</returns>
+      BASICUNIVERSALCPPSUPPORT_API static stack_trace capture(unsigned long skip_frames = 0) noexcept;
+
+      ///<summary> true if no frames were captured.</summary>
+      bool empty() const noexcept
+      {
+         return m_size == 0;
+      }
+
+      ///<summary> the number of frames captured.</summary>
+      std::size_t size() const noexcept
+      {
+         return m_size;
+      }
+
+      ///<summary> the return address of a frame (0 is the innermost frame).</summary>
+      const void* frame(std::size_t index) const noexcept
+      {
+         return (index < m_size) ? m_frames[index] : nullptr;
+      }
+
+      ///<summary> resolve the frames to text, one frame per line E.g. "   at Device::impl::ioctl + 0x5c (device.cpp(123))".</summary>
+      ///<remarks> symbols are resolved once per address, and cached for the life of the process.</remarks>
+      ///<returns> the stack trace text (without a trailing newline), or an empty string if no frames were captured.</returns>
+      BASICUNIVERSALCPPSUPPORT_API std::string to_string() const;
+
+      ///<summary> resolve one return address to text E.g. "Device::impl::ioctl + 0x5c (device.cpp(123))".</summary>
+      ///<remarks> the result is cached (so repeated failures at the same site are only symbolized once).</remarks>
+      BASICUNIVERSALCPPSUPPORT_API static std::string resolve(const void* address);
+
+   private:
+      ///<summary> the captured return addresses.</summary>
+      std::array<void*, max_frames> m_frames {};
+
+      ///<summary> the number of captured return addresses.</summary>
+      std::size_t m_size = 0;
+   };
+}
+#endif // __STACK_TRACE_HPP__
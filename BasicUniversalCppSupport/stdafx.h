@@ -8,12 +8,14 @@
 // add check for tools limitations (clang support) with impact on build preferences
 #include "toolsver.h"
 
+#ifdef _WIN32
 #include "targetver.h"
 
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 // Windows Header Files:
 #define NOMINMAX
 #include <windows.h>
+#endif
 
 #include <fstream>
 #include <sstream>
@@ -25,20 +27,37 @@
 #include <stdint.h>
 
 // Additional headers dll requires are here...
+#ifdef _WIN32
 #include "CppUnitTest.hpp"       
+#endif
+#include "allocation_counter.hpp"
 #include "error_context.hpp"
+#include "expected.hpp"
+#include "fast_pimpl.hpp"
 #include "file_logger.hpp"
 #include "gsl.hpp"
 #include "logger.hpp"
 #include "logger_factory.hpp"
 #include "logger_interface.hpp"
+#include "mapped_file_logger.hpp"
 #include "null_logger.hpp"
+#include "shared_file_logger.hpp"
+#include "small_string.hpp"
 #include "spimpl.hpp"
+#include "stack_trace.hpp"
 #include "system_error.hpp"
 #include "utc_timestamp.hpp"
+#ifdef _WIN32
 #include "utf8_assert.hpp"       
+#endif
 #include "utf8_console.hpp"
 #include "utf8_convert.hpp"
-#include "utf8_guid.hpp"         
+#include "utf8_scan.hpp"
+#include "utf8_stream_convert.hpp"
+#include "utf8_transcode.hpp"
+#include "guid.hpp"
+#ifdef _WIN32
+#include "utf8_guid.hpp"
+#endif
 
 #endif // __STDAFX_H__
@@ -18,12 +18,22 @@
 //
 #include "stdafx.h"
 
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <system_error>
+#endif
+
 /*
 * ***************************************************************************
 * PIMPL idiom - private implementation of SystemError class (Rule of 5)
 * ***************************************************************************
 */
 
+#ifdef _WIN32
 ///<summary> the private implementation of SystemError.</summary>
 ///<remarks> Windows types used internally, adheres to "utf8 everywhere" paradigm at public interface</remarks>
 class SystemError::impl
@@ -160,29 +170,116 @@ public:
       LocalFree(lpBuffer);
    }
 };
+#else
+///<summary> the private implementation of SystemError.</summary>
+///<remarks> POSIX version, the error code is an errno value (and its text is the system message for it).</remarks>
+class SystemError::impl
+{
+private:
+   ///<summary> error code corresponding to a system error.</summary>
+   int error_code;
+
+public:
+   ///<summary> default constructor.</summary>
+   impl() noexcept :
+      error_code(errno)
+   {
+   }
+
+   ///<summary> constructor for specified error.</summary>
+   ///<param name='an_error_code'> the error code to use.</param>
+   impl(int an_error_code) noexcept :
+      error_code(an_error_code)
+   {
+   }
+
+   ///<summary> equals comparison operator.</summary>
+   ///<remarks> defines equals to mean accessible data is identical.</remarks>
+   bool operator==(const impl& other) const
+   {
+      return (error_code == other.error_code);
+   }
+
+   ///<summary> not equals comparison operator.</summary>
+   ///<remarks> defines not equals to mean accessible data differs.</remarks>
+   bool operator!=(const impl& other) const
+   {
+      return !(*this == other);
+   }
+
+   ///<summary> get error text.</summary>
+   const std::string get_error_text() const
+   {
+      return std::error_code(error_code, std::generic_category()).message() + "\r\n";
+   }
+
+   ///<summary> get error code.</summary>
+   const int get_error_code() const noexcept
+   {
+      return error_code;
+   }
+
+   ///<summary> clear error code.</summary>
+   void clear_error_code() const noexcept
+   {
+      errno = 0;
+   }
+};
+#endif
+
+/*
+* ***************************************************************************
+* Process wide cache of system error texts (used by error::context)
+* ***************************************************************************
+*/
+
+///<summary> formatted system error texts, indexed by error code (entries are never removed).</summary>
+struct error_text_cache
+{
+   std::shared_mutex mutex;
+   std::unordered_map<int, std::string> texts;
+};
+
+///<summary> get the process wide error text cache (constructed on first use).</summary>
+static error_text_cache& get_error_text_cache()
+{
+   static error_text_cache cache;
+   return cache;
+}
 
 /*
 * ***************************************************************************
-* PIMPL idiom - public interface for SystemError implementation (Rule of 0)
+* PIMPL idiom - public interface for SystemError implementation (Rule of 5)
 * ***************************************************************************
 */
 
 ///<summary> constructs a system error for the last system error.</summary>
 SystemError::SystemError() noexcept :
-#pragma warning (disable:26447)
-	pimpl(spimpl::make_impl<impl>())
-#pragma warning (default:26447)
+   pimpl(std::in_place)
 {
 }
 
 ///<summary> constructs a system error from an error code.</summary>
 SystemError::SystemError(int errorCode) noexcept :
-#pragma warning (disable:26447)
-   pimpl(spimpl::make_impl<impl>(errorCode))
-#pragma warning (default:26447)
+   pimpl(std::in_place, errorCode)
 {
 }
 
+///<summary> copy constructor (defined here, where impl is complete).</summary>
+SystemError::SystemError(const SystemError& other) noexcept = default;
+
+///<summary> move constructor.</summary>
+SystemError::SystemError(SystemError&& other) noexcept = default;
+
+///<summary> copy assignment operator.</summary>
+SystemError& SystemError::operator=(const SystemError& other) noexcept = default;
+
+///<summary> move assignment operator.</summary>
+SystemError& SystemError::operator=(SystemError&& other) noexcept = default;
+
+///<summary> destructor.</summary>
+SystemError::~SystemError() = default;
+
 ///<summary> equals comparison operator.</summary>
 ///<remarks> objects considered equal if impl's are equal.</remarks>
 bool SystemError::operator==(const SystemError& other) const
@@ -214,3 +311,41 @@ void SystemError::clear_error_code() const noexcept
 {
 	pimpl->clear_error_code();
 }
+
+///<summary> gets the last system error code.</summary>
+int SystemError::get_last_error_code() noexcept
+{
+#ifdef _WIN32
+   return gsl::narrow_cast<int>(GetLastError());
+#else
+   return errno;
+#endif
+}
+
+///<summary> gets the system error text from an error code (formatted once per error code, then cached).</summary>
+const std::string& SystemError::get_cached_error_text(int errorCode)
+{
+   error_text_cache& cache = get_error_text_cache();
+   {
+      std::shared_lock<std::shared_mutex> lock(cache.mutex);
+      const auto found = cache.texts.find(errorCode);
+      if (found != cache.texts.end())
+      {
+         return found->second;
+      }
+   }
+
+   // format outside the lock, and leave the last error as the caller found it
+#ifdef _WIN32
+   const DWORD last_error = GetLastError();
+   std::string text = SystemError(errorCode).get_error_text();
+   SetLastError(last_error);
+#else
+   const int last_error = errno;
+   std::string text = SystemError(errorCode).get_error_text();
+   errno = last_error;
+#endif
+
+   std::unique_lock<std::shared_mutex> lock(cache.mutex);
+   return cache.texts.try_emplace(errorCode, std::move(text)).first->second;
+}
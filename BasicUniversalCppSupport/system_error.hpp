@@ -19,7 +19,9 @@
 #ifndef __SYSTEM_ERROR_HPP__
 #define __SYSTEM_ERROR_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -27,7 +29,7 @@
 
 #include <string>
 
-#include "spimpl.hpp"
+#include "fast_pimpl.hpp"
 
 ///<summary> wraps the system error facility.</summary>
 class SystemError {
@@ -39,6 +41,21 @@ public:
    ///<summary> constructs a system error from an error code.</summary>
    BASICUNIVERSALCPPSUPPORT_API SystemError(int errorCode) noexcept;
 
+   ///<summary> copy constructor.</summary>
+   BASICUNIVERSALCPPSUPPORT_API SystemError(const SystemError& other) noexcept;
+
+   ///<summary> move constructor.</summary>
+   BASICUNIVERSALCPPSUPPORT_API SystemError(SystemError&& other) noexcept;
+
+   ///<summary> copy assignment operator.</summary>
+   BASICUNIVERSALCPPSUPPORT_API SystemError& operator=(const SystemError& other) noexcept;
+
+   ///<summary> move assignment operator.</summary>
+   BASICUNIVERSALCPPSUPPORT_API SystemError& operator=(SystemError&& other) noexcept;
+
+   ///<summary> destructor.</summary>
+   BASICUNIVERSALCPPSUPPORT_API ~SystemError();
+
    ///<summary> equals comparison operator.</summary>
    ///<remarks> defines equals to mean identical error_code content.</remarks>
    BASICUNIVERSALCPPSUPPORT_API bool operator==(const SystemError& other) const;
@@ -56,13 +73,24 @@ public:
    ///<summary> clear the error code.</summary>
    BASICUNIVERSALCPPSUPPORT_API void clear_error_code() const noexcept;
 
+   ///<summary> get the last system error code (without formatting its text, and without changing it).</summary>
+   BASICUNIVERSALCPPSUPPORT_API static int get_last_error_code() noexcept;
+
+   ///<summary> get the system error text corresponding to an error code, from a process wide cache.</summary>
+   ///<remarks> the text for each error code is formatted once, on first use. Safe to call concurrently from any thread.</remarks>
+   ///<returns> the error text (the reference remains valid for the life of the process).</returns>
+   BASICUNIVERSALCPPSUPPORT_API static const std::string& get_cached_error_text(int errorCode);
+
 private:
    ///<summary> forward reference to private implementation.</summary>
    class impl;
 
-   ///<summary> smart unique pointer to private implementation.</summary>
-   ///<remarks> with default copy, move and compare support.</remarks>
-    spimpl::impl_ptr<impl> pimpl;
+   ///<summary> the capacity of the in place storage for the private implementation (an error code and a buffer pointer).</summary>
+   static constexpr std::size_t impl_capacity = 2 * sizeof(void*);
+
+   ///<summary> private implementation, stored in place (no heap allocation).</summary>
+   ///<remarks> the capacity is checked against the implementation at compile time (in system_error.cpp).</remarks>
+   spimpl::fast_impl_ptr<impl, impl_capacity> pimpl;
 };
 
 #endif // __SYSTEM_ERROR_HPP__
@@ -20,8 +20,11 @@
 #define __UTC_TIMESTAMP_HPP__
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <locale>
 #include <string>
+#include <string_view>
 #include <time.h>
 
 // trim from start (in place)
@@ -64,19 +67,82 @@ const auto trim_copy = [](std::string s)
    return s;
 };
 
-///<summary> get current date and time in UTC</summary>
-///<returns> a date time string, the format is system dependent</returns>
-const auto utc_timestamp = []()
+///<summary> size of a buffer that can hold utc_timestamp text (including the terminator).</summary>
+constexpr std::size_t utc_timestamp_size = 26;
+
+///<summary> get current date and time in UTC, into a caller supplied buffer (no allocation)</summary>
+///<param name='timebuf'> receives the (null terminated) date time text.</param>
+///<returns> a view of the date time text in timebuf (identical to the text returned by utc_timestamp)</returns>
+const auto utc_timestamp_to = [](char (&timebuf)[utc_timestamp_size])
 {
    const time_t now = time(nullptr);
    tm gmtm;
+#ifdef _WIN32
    if (gmtime_s(&gmtm, &now) !=0)
       throw std::domain_error("utc timestamp failed");
-   
-   char timebuf[26] = { 0 };
+
+   timebuf[0] = 0;
    asctime_s(timebuf, &gmtm);
-     
-   return trim_copy({ timebuf });
+#else
+   if (gmtime_r(&now, &gmtm) == nullptr)
+      throw std::domain_error("utc timestamp failed");
+
+   timebuf[0] = 0;
+   asctime_r(&gmtm, timebuf);
+#endif
+
+   std::string_view text(timebuf);
+   while (!text.empty() && std::isspace(text.back(), std::locale::classic()))
+   {
+      text.remove_suffix(1);
+   }
+   return text;
+};
+
+///<summary> get current date and time in UTC</summary>
+///<returns> a date time string, the format is system dependent</returns>
+const auto utc_timestamp = []()
+{
+   char timebuf[utc_timestamp_size] = { 0 };
+   return std::string(utc_timestamp_to(timebuf));
+};
+
+///<summary> size of a buffer that can hold utc_timestamp_precise text (including the terminator).</summary>
+constexpr std::size_t utc_timestamp_precise_size = 32;
+
+///<summary> get current date and time in UTC (with 100ns resolution), into a caller supplied buffer (no allocation)</summary>
+///<param name='timebuf'> receives the (null terminated) date time text.</param>
+///<returns> a view of the date time text in timebuf (identical to the text returned by utc_timestamp_precise)</returns>
+const auto utc_timestamp_precise_to = [](char (&timebuf)[utc_timestamp_precise_size])
+{
+   using ticks = std::chrono::duration<long long, std::ratio<1, 10000000>>;
+
+   const auto now = std::chrono::system_clock::now();
+   const time_t seconds = std::chrono::system_clock::to_time_t(now);
+   const long long fraction = std::chrono::duration_cast<ticks>(now.time_since_epoch()).count() % 10000000;
+
+   tm gmtm;
+#ifdef _WIN32
+   if (gmtime_s(&gmtm, &seconds) != 0)
+      throw std::domain_error("utc timestamp failed");
+#else
+   if (gmtime_r(&seconds, &gmtm) == nullptr)
+      throw std::domain_error("utc timestamp failed");
+#endif
+
+   timebuf[0] = 0;
+   snprintf(timebuf, utc_timestamp_precise_size, "%04d-%02d-%02dT%02d:%02d:%02d.%07lldZ",
+      gmtm.tm_year + 1900, gmtm.tm_mon + 1, gmtm.tm_mday, gmtm.tm_hour, gmtm.tm_min, gmtm.tm_sec, fraction);
+
+   return std::string_view(timebuf);
+};
+
+///<summary> get current date and time in UTC (with 100ns resolution)</summary>
+///<returns> an ISO 8601 date time string E.g. "2023-12-04T09:15:02.1234567Z". Text order is time order (it sorts).</returns>
+const auto utc_timestamp_precise = []()
+{
+   char timebuf[utc_timestamp_precise_size] = { 0 };
+   return std::string(utc_timestamp_precise_to(timebuf));
 };
 
 #endif // __UTC_TIMESTAMP_HPP__
@@ -21,13 +21,24 @@
 #ifndef __UTF8_ASSERT_HPP__
 #define __UTF8_ASSERT_HPP__
 
+#ifdef _WIN32
 #include <Windows.h>
 #include <winnt.h>
+#endif
 
 // Headers for CppUnitTest
 #include "CppUnitTest.hpp"
 #include "utf8_convert.hpp"
 
+#ifndef _WIN32
+namespace utf8
+{
+   using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+   // the stand-in framework takes utf8 messages already
+   using Assert = Microsoft::VisualStudio::CppUnitTestFramework::Assert;
+}
+#else
 namespace utf8
 {
    using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -154,5 +165,6 @@ namespace utf8
       }
    };
 }
+#endif // _WIN32
 
 #endif // __UTF8_ASSERT_HPP__
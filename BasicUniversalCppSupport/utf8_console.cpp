@@ -26,6 +26,10 @@ namespace utf8
    ///<remarks>To get extended error information, call GetLastError.</remarks>
    bool console::configure_codepage(void) noexcept
    {
+#ifdef _WIN32
       return SetConsoleOutputCP(CP_UTF8);
+#else
+      return true;   // (posix terminals take utf8 as it is)
+#endif
    }
 }
\ No newline at end of file
@@ -19,14 +19,24 @@
 #ifndef __UTF8_CONVERT_HPP__
 #define __UTF8_CONVERT_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
 #endif
 
 #include <algorithm>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+
+#include "small_string.hpp"
+#include "utf8_scan.hpp"
+#include "utf8_transcode.hpp"
 
 #if defined(__cpp_char8_t)
 template<typename T>
@@ -43,7 +53,42 @@ const char* u8Cpp20(T&& t) noexcept
 
 namespace utf8
 {
+   ///<summary>thrown when a string to convert is not well formed</summary>
+   class conversion_error : public std::range_error
+   {
+   public:
+      ///<summary>construct a conversion error</summary>
+      ///<param name='what'>a description of the error</param>
+      ///<param name='position'>the offset (in code units) of the ill formed sequence</param>
+      conversion_error(const std::string& what, std::size_t position) :
+         std::range_error(what),
+         m_position(position)
+      {
+      }
+
+      ///<summary>construct a conversion error for a transcoding result</summary>
+      ///<param name='encoding'>the input encoding (E.g. "utf8")</param>
+      ///<param name='status'>the transcoding status (invalid or incomplete)</param>
+      ///<param name='position'>the offset (in code units) of the ill formed sequence</param>
+      conversion_error(const char* encoding, transcode_status status, std::size_t position) :
+         conversion_error(std::string(encoding)
+            .append((status == transcode_status::incomplete) ? " input is truncated at offset " : " input is ill formed at offset ")
+            .append(std::to_string(position)), position)
+      {
+      }
+
+      ///<summary>get the offset (in code units) of the ill formed sequence</summary>
+      std::size_t position() const noexcept
+      {
+         return m_position;
+      }
+
+   private:
+      std::size_t m_position;
+   };
+
    ///<summary>convert to and from utf8</summary>
+   ///<remarks>conversion is validating, single pass and vectorized (see utf8_transcode.hpp), and leaves the thread last error unchanged</remarks>
    class convert
    {
    public:
@@ -51,12 +96,61 @@ namespace utf8
       ///<summary>convert utf16 string to utf8 string</summary>
       ///<param name='wstr'>utf16 encoded string</param>
       ///<returns>utf8 encoded string representation of wstr</returns>
-      BASICUNIVERSALCPPSUPPORT_API static std::string from_utf16(const std::wstring& wstr);
+      ///<exception cref='utf8::conversion_error'>if wstr is not well formed utf16 (E.g. has an unpaired surrogate)</exception>
+      BASICUNIVERSALCPPSUPPORT_API static std::string from_utf16(std::wstring_view wstr);
 
       ///<summary>convert utf8 string to utf16 string</summary>
       ///<param name='str'>utf8 encoded string</param>
       ///<returns>utf16 encoded string representation of str</returns>
-      BASICUNIVERSALCPPSUPPORT_API static std::wstring to_utf16(const std::string& str);
+      ///<exception cref='utf8::conversion_error'>if str is not well formed utf8</exception>
+      BASICUNIVERSALCPPSUPPORT_API static std::wstring to_utf16(std::string_view str);
+
+      ///<summary>convert utf16 string to utf8 in a caller supplied buffer (no allocation)</summary>
+      ///<param name='wstr'>utf16 encoded string</param>
+      ///<param name='buffer'>receives the utf8 encoded string (no terminator is written)</param>
+      ///<returns>the number of bytes written</returns>
+      ///<exception cref='utf8::conversion_error'>if wstr is not well formed utf16</exception>
+      ///<exception cref='std::length_error'>if buffer is too small (transcode::max_utf8_length is always sufficient)</exception>
+      BASICUNIVERSALCPPSUPPORT_API static std::size_t from_utf16(std::wstring_view wstr, std::span<char> buffer);
+
+      ///<summary>convert utf8 string to utf16 in a caller supplied buffer (no allocation)</summary>
+      ///<param name='str'>utf8 encoded string</param>
+      ///<param name='buffer'>receives the utf16 encoded string (no terminator is written)</param>
+      ///<returns>the number of utf16 code units written</returns>
+      ///<exception cref='utf8::conversion_error'>if str is not well formed utf8</exception>
+      ///<exception cref='std::length_error'>if buffer is too small (transcode::max_utf16_length is always sufficient)</exception>
+      BASICUNIVERSALCPPSUPPORT_API static std::size_t to_utf16(std::string_view str, std::span<wchar_t> buffer);
+
+      ///<summary>convert utf16 string to a utf8 small_string (held inline, without allocation, if it fits)</summary>
+      ///<param name='wstr'>utf16 encoded string</param>
+      ///<returns>utf8 encoded string representation of wstr</returns>
+      ///<exception cref='utf8::conversion_error'>if wstr is not well formed utf16</exception>
+      template<std::size_t N = small_path_length>
+      static small_string<N> to_small_utf8(std::wstring_view wstr)
+      {
+         small_string<N> utf8;
+         utf8.resize_and_overwrite(transcode::max_utf8_length(wstr.length()), [wstr](char* buffer, std::size_t capacity)
+         {
+            return from_utf16(wstr, std::span<char>(buffer, capacity));
+         });
+         return utf8;
+      }
+
+      ///<summary>convert utf8 string to a utf16 small_wstring (held inline, without allocation, if it fits)</summary>
+      ///<remarks>use for transient conversions (E.g. a path passed to a system call)</remarks>
+      ///<param name='str'>utf8 encoded string</param>
+      ///<returns>utf16 encoded string representation of str</returns>
+      ///<exception cref='utf8::conversion_error'>if str is not well formed utf8</exception>
+      template<std::size_t N = small_path_length>
+      static small_wstring<N> to_small_utf16(std::string_view str)
+      {
+         small_wstring<N> utf16;
+         utf16.resize_and_overwrite(transcode::max_utf16_length(str.length()), [str](wchar_t* buffer, std::size_t capacity)
+         {
+            return to_utf16(str, std::span<wchar_t>(buffer, capacity));
+         });
+         return utf16;
+      }
    };
 
    ///<summary>counts the number of code points in a utf8 encoded string</summary>
@@ -64,10 +158,36 @@ namespace utf8
    ///<returns>a count of the number of code points found in str.</returns>
    ///<remarks> See https://en.wikipedia.org/wiki/Code_point
    /// convenient because individual character representations in utf8 vary in length.
-   /// codepoint_count is always less than or equal to the raw data storage length.</remarks>
-   static size_t count_codepoints(const std::string& str)
+   /// codepoint_count is always less than or equal to the raw data storage length (vectorized, see utf8_scan.hpp).</remarks>
+   static size_t count_codepoints(std::string_view str) noexcept
+   {
+      return scan::count_codepoints(str.data(), str.length());
+   };
+
+   ///<summary>test whether a string is well formed utf8</summary>
+   ///<param name='str'>a (supposedly) utf8 encoded string</param>
+   ///<returns>true if str is well formed (and would convert without a conversion_error).</returns>
+   static bool is_valid(std::string_view str) noexcept
+   {
+      return scan::validate(str.data(), str.length()).status == transcode_status::ok;
+   };
+
+   ///<summary>truncates a utf8 encoded string to at most max_codepoints code points (E.g. to fit a display column)</summary>
+   ///<param name='str'>a utf8 encoded string</param>
+   ///<param name='max_codepoints'>the most code points wanted</param>
+   ///<returns>the leading code points of str.</returns>
+   static std::string_view truncate_codepoints(std::string_view str, size_t max_codepoints) noexcept
+   {
+      return str.substr(0, scan::offset_of_codepoint(str.data(), str.length(), max_codepoints));
+   };
+
+   ///<summary>truncates a utf8 encoded string to at most max_bytes, without splitting a code point (E.g. to fit a file name buffer)</summary>
+   ///<param name='str'>a utf8 encoded string</param>
+   ///<param name='max_bytes'>the most bytes wanted</param>
+   ///<returns>the leading code points of str that fit in max_bytes.</returns>
+   static std::string_view truncate_bytes(std::string_view str, size_t max_bytes) noexcept
    {
-      return std::count_if(str.begin(), str.end(), [](auto ch) { return ((ch & 0xc0) != 0x80); });
+      return str.substr(0, scan::truncate(str.data(), str.length(), max_bytes));
    };
 
 }
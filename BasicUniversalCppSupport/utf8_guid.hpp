@@ -21,7 +21,9 @@
 #ifndef __UTF8_GUID_HPP__
 #define __UTF8_GUID_HPP__
 
-#ifdef BASICUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -31,44 +33,35 @@
 #define NOMINMAX
 #include <windows.h>
 
-#include <iomanip>
-#include <sstream>
 #include <string>
 
-#include <gsl/gsl>
+#include "guid.hpp"
 
 namespace utf8
 {
-   ///<summary>functor supporting stripping all instances of a set of selected characters from a target string. 
-   /// Use object as a predicate for std::remove_if in an erase-remove construct/idiom applied to the target.</summary>
-   ///<remarks> A class offers best readability at point of use, but we might consider a lambda here (current need/usage is very localized)</remarks>
-   class char_stripper
+   ///<summary>convert selected windows types to and from utf8</summary>
+   ///<remarks>parsing and formatting use utf8::guid (guid.hpp): no iostreams, and no allocation except for the returned string</remarks>
+   class guid_convert
    {
-   private:
-      const std::string chars_to_strip;
-
    public:
-      ///<summary>construct the functor</summary>
-      ///<param name='some_chars_to_strip'>specifies a specific set of characters to be stripped</param>
-      ///<remarks>removes all instance of each of the characters specified from the target string</remarks>
-      char_stripper(std::string some_chars_to_strip) :
-         chars_to_strip(some_chars_to_strip)
+
+      ///<summary>convert a portable utf8::guid to a windows GUID</summary>
+      ///<param name='aGuid'>a portable guid (E.g. a "..."_guid literal)</param>
+      ///<returns>the windows GUID</returns>
+      static constexpr GUID to_guid(const guid& aGuid) noexcept
       {
+         return GUID{ aGuid.data1, aGuid.data2, aGuid.data3,
+            { aGuid.data4[0], aGuid.data4[1], aGuid.data4[2], aGuid.data4[3], aGuid.data4[4], aGuid.data4[5], aGuid.data4[6], aGuid.data4[7] } };
       }
 
-      ///<summary> functor acts as predicate for std::remove_if</summary>
-      ///<param name='ch'> a character to be tested for removal</param>
-      ///<returns> true if ch is selected for removal, or false if not.</returns>
-      bool operator()(char ch) noexcept
+      ///<summary>convert a windows GUID to a portable utf8::guid</summary>
+      ///<param name='aGuid'>const GUID (e.g. as supplied in winioctl.h)</param>
+      ///<returns>the portable guid</returns>
+      static constexpr guid to_portable_guid(const GUID& aGuid) noexcept
       {
-         return std::string::npos != chars_to_strip.find_first_of(ch);
+         return guid{ aGuid.Data1, aGuid.Data2, aGuid.Data3,
+            { aGuid.Data4[0], aGuid.Data4[1], aGuid.Data4[2], aGuid.Data4[3], aGuid.Data4[4], aGuid.Data4[5], aGuid.Data4[6], aGuid.Data4[7] } };
       }
-   };
-
-   ///<summary>convert selected windows types to and from utf8</summary>
-   class guid_convert
-   {
-   public:
 
       ///<summary>convert GUID to utf8 std::string</summary>
       ///<param name='aGuid'>const GUID (e.g. as supplied in winioctl.h)</param>
@@ -77,48 +70,18 @@ namespace utf8
       /// where h is any hex digit (lowercase)</returns>
       BASICUNIVERSALCPPSUPPORT_API static inline std::string from_guid(const GUID aGuid)
       {
-         std::stringstream ss;
-         ss << "0x" << std::nouppercase << std::setfill('0') << std::setw(8) << std::hex << aGuid.Data1 <<"L";   
-         ss << ", " << "0x" << std::nouppercase << std::setfill('0') << std::setw(4) << std::hex << aGuid.Data2;
-         ss << ", " << "0x" << std::nouppercase << std::setfill('0') << std::setw(4) << std::hex << aGuid.Data3;
-
-         auto span = gsl::make_span(aGuid.Data4);
-
-         for (auto& elem : span)
-         {
-            ss << ", " << "0x" << std::nouppercase << std::setfill('0') << std::setw(2) << std::hex << (unsigned short)elem;
-         }
-
-         return ss.str();
+         return to_portable_guid(aGuid).to_string();
       }
 
       ///<summary>convert utf8 std::string to GUID</summary>
       ///<param name='aGuidString'>a utf8 encoded string representation of aGuid in the form
       /// "0xhhhhhhhhL, 0xhhhh, 0xhhhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh, 0xhh"
-      /// where h is any hex digit</param>
+      /// where h is any hex digit (or in registry form "hhhhhhhh-hhhh-hhhh-hhhh-hhhhhhhhhhhh", with or without braces)</param>
       ///<returns>const GUID (e.g. as supplied in winioctl.h)</returns>
+      ///<exception cref='std::invalid_argument'>if aGuidString is not a GUID</exception>
       BASICUNIVERSALCPPSUPPORT_API static inline GUID to_guid(const std::string& aGuidString)
       {
-         GUID aGuid;
-         std::stringstream ss;
-         const char_stripper strip("Lx,");      
-         std::string theGuidString(aGuidString);
-
-         theGuidString.erase(remove_if(theGuidString.begin(), theGuidString.end(), strip), theGuidString.end());
-
-         ss << std::hex << theGuidString;
-         ss >> aGuid.Data1 >> aGuid.Data2 >> aGuid.Data3;
-
-         auto span = gsl::make_span(aGuid.Data4);
-
-         for (auto& elem : span)
-         {
-            int value;
-            ss >> value;
-            elem = value;
-         }
-
-         return aGuid;
+         return to_guid(guid::parse(aGuidString));
       }
    };
 }
@@ -0,0 +1,364 @@
+//
+// utf8_scan.cpp : vectorized utf8 scanning (code point counting, validation, indexing and truncation)
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include "utf8_scan.hpp"
+#include "utf8_simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#define UTF8_SCAN_WARNINGS_SUPPRESSED 26481 26490
+#pragma warning(disable: UTF8_SCAN_WARNINGS_SUPPRESSED)
+
+// As in utf8_transcode.cpp nothing here throws: every outcome is reported in the result.
+
+namespace utf8
+{
+   ///<summary> test for a lead byte (ASCII, or the first byte of a multi byte sequence - anything but a continuation byte).</summary>
+   static constexpr bool is_lead(unsigned char byte) noexcept
+   {
+      return (byte & 0xC0) != 0x80;
+   }
+
+   /*
+   * ***************************************************************************
+   * Block scanners (one per instruction set)
+   *
+   * Each processes whole blocks only (the caller finishes the tail a byte at a time):
+   *   count_leads  - counts the lead bytes of input, returning the number of bytes scanned.
+   *   skip_leads   - skips blocks while they hold no more than 'index' lead bytes (reducing index by the leads skipped).
+   *   ascii_prefix - gets the length of the ASCII prefix of input (found a block at a time).
+   * ***************************************************************************
+   */
+
+   ///<summary> portable block scanner (8 bytes at a time).</summary>
+   struct scalar_scan
+   {
+      static constexpr simd_level level = simd_level::scalar;
+      static constexpr std::size_t block = 8;
+
+      ///<summary> get the number of lead bytes in a block.</summary>
+      static int leads_in(const unsigned char* input) noexcept
+      {
+         // a continuation byte has its top bit set and the next bit clear
+         std::uint64_t word = 0;
+         std::memcpy(&word, input, block);
+         const std::uint64_t continuations = word & ~(word << 1) & 0x8080808080808080ull;
+         return static_cast<int>(block) - std::popcount(continuations);
+      }
+
+      static std::size_t count_leads(const unsigned char* input, std::size_t remaining, std::size_t& count) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            count += leads_in(input + done);
+            done += block;
+         }
+         return done;
+      }
+
+      static std::size_t skip_leads(const unsigned char* input, std::size_t remaining, std::size_t& index) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            const std::size_t leads = leads_in(input + done);
+            if (leads > index)
+            {
+               break;
+            }
+            index -= leads;
+            done += block;
+         }
+         return done;
+      }
+
+      static std::size_t ascii_prefix(const unsigned char* input, std::size_t remaining) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            std::uint64_t word = 0;
+            std::memcpy(&word, input + done, block);
+            if ((word & 0x8080808080808080ull) != 0)
+            {
+               break;
+            }
+            done += block;
+         }
+         return done;
+      }
+   };
+
+#ifdef UTF8_TRANSCODE_X86
+   ///<summary> SSE2 block scanner (16 bytes at a time).</summary>
+   struct sse2_scan
+   {
+      static constexpr simd_level level = simd_level::sse2;
+      static constexpr std::size_t block = 16;
+
+      ///<summary> get a mask of the lead bytes in a block (as signed bytes, continuation bytes are -128 to -65).</summary>
+      static __m128i leads_in(const unsigned char* input) noexcept
+      {
+         return _mm_cmpgt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)), _mm_set1_epi8(-65));
+      }
+
+      static std::size_t count_leads(const unsigned char* input, std::size_t remaining, std::size_t& count) noexcept
+      {
+         const __m128i zero = _mm_setzero_si128();
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            // count in byte wide counters (for up to 255 blocks), then sum the counters
+            const std::size_t rounds = std::min<std::size_t>((remaining - done) / block, 255);
+            __m128i counters = zero;
+            for (std::size_t round = 0; round < rounds; round++)
+            {
+               counters = _mm_sub_epi8(counters, leads_in(input + done));
+               done += block;
+            }
+            const __m128i sums = _mm_sad_epu8(counters, zero);
+            count += static_cast<std::size_t>(_mm_cvtsi128_si32(sums)) + static_cast<std::size_t>(_mm_extract_epi16(sums, 4));
+         }
+         return done;
+      }
+
+      static std::size_t skip_leads(const unsigned char* input, std::size_t remaining, std::size_t& index) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            const std::size_t leads = std::popcount(static_cast<unsigned int>(_mm_movemask_epi8(leads_in(input + done))));
+            if (leads > index)
+            {
+               break;
+            }
+            index -= leads;
+            done += block;
+         }
+         return done;
+      }
+
+      static std::size_t ascii_prefix(const unsigned char* input, std::size_t remaining) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            const unsigned int non_ascii = static_cast<unsigned int>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + done))));
+            if (non_ascii != 0)
+            {
+               return done + std::countr_zero(non_ascii);
+            }
+            done += block;
+         }
+         return done;
+      }
+   };
+
+   ///<summary> AVX2 block scanner (32 bytes at a time).</summary>
+   struct avx2_scan
+   {
+      static constexpr simd_level level = simd_level::avx2;
+      static constexpr std::size_t block = 32;
+
+      ///<summary> get a mask of the lead bytes in a block (as signed bytes, continuation bytes are -128 to -65).</summary>
+      UTF8_TARGET_AVX2 static __m256i leads_in(const unsigned char* input) noexcept
+      {
+         return _mm256_cmpgt_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input)), _mm256_set1_epi8(-65));
+      }
+
+      UTF8_TARGET_AVX2 static std::size_t count_leads(const unsigned char* input, std::size_t remaining, std::size_t& count) noexcept
+      {
+         const __m256i zero = _mm256_setzero_si256();
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            // count in byte wide counters (for up to 255 blocks), then sum the counters
+            const std::size_t rounds = std::min<std::size_t>((remaining - done) / block, 255);
+            __m256i counters = zero;
+            for (std::size_t round = 0; round < rounds; round++)
+            {
+               counters = _mm256_sub_epi8(counters, leads_in(input + done));
+               done += block;
+            }
+            const __m256i sums = _mm256_sad_epu8(counters, zero);
+            count += static_cast<std::size_t>(_mm256_extract_epi16(sums, 0)) + static_cast<std::size_t>(_mm256_extract_epi16(sums, 4))
+               + static_cast<std::size_t>(_mm256_extract_epi16(sums, 8)) + static_cast<std::size_t>(_mm256_extract_epi16(sums, 12));
+         }
+         return done;
+      }
+
+      UTF8_TARGET_AVX2 static std::size_t skip_leads(const unsigned char* input, std::size_t remaining, std::size_t& index) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            const std::size_t leads = std::popcount(static_cast<unsigned int>(_mm256_movemask_epi8(leads_in(input + done))));
+            if (leads > index)
+            {
+               break;
+            }
+            index -= leads;
+            done += block;
+         }
+         return done;
+      }
+
+      UTF8_TARGET_AVX2 static std::size_t ascii_prefix(const unsigned char* input, std::size_t remaining) noexcept
+      {
+         std::size_t done = 0;
+         while (remaining - done >= block)
+         {
+            const unsigned int non_ascii = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + done))));
+            if (non_ascii != 0)
+            {
+               return done + std::countr_zero(non_ascii);
+            }
+            done += block;
+         }
+         return done;
+      }
+   };
+#endif
+
+   /*
+   * ***************************************************************************
+   * Scanning loops (whole blocks use the block scanner, the tail is scanned a byte at a time)
+   * ***************************************************************************
+   */
+
+   template<typename Scan>
+   static std::size_t count_codepoints_with(const char* input, std::size_t input_length) noexcept
+   {
+      const auto bytes = reinterpret_cast<const unsigned char*>(input);
+      std::size_t count = 0;
+      for (std::size_t read = Scan::count_leads(bytes, input_length, count); read < input_length; read++)
+      {
+         count += is_lead(bytes[read]) ? 1 : 0;
+      }
+      return count;
+   }
+
+   template<typename Scan>
+   static scan_result validate_with(const char* input, std::size_t input_length) noexcept
+   {
+      const auto bytes = reinterpret_cast<const unsigned char*>(input);
+      std::size_t read = 0;
+      std::size_t code_points = 0;
+
+      while (read < input_length)
+      {
+         if (bytes[read] < 0x80)
+         {
+            const std::size_t run = std::max<std::size_t>(Scan::ascii_prefix(bytes + read, input_length - read), 1);
+            read += run;
+            code_points += run;
+            continue;
+         }
+
+         char32_t code_point = 0;
+         std::size_t length = 0;
+         const transcode_status status = decode_code_point(bytes + read, input_length - read, code_point, length);
+         if (status != transcode_status::ok)
+         {
+            return { status, read, code_points };
+         }
+         read += length;
+         code_points++;
+      }
+      return { transcode_status::ok, read, code_points };
+   }
+
+   template<typename Scan>
+   static std::size_t offset_of_codepoint_with(const char* input, std::size_t input_length, std::size_t index) noexcept
+   {
+      const auto bytes = reinterpret_cast<const unsigned char*>(input);
+      for (std::size_t read = Scan::skip_leads(bytes, input_length, index); read < input_length; read++)
+      {
+         if (is_lead(bytes[read]))
+         {
+            if (index == 0)
+            {
+               return read;
+            }
+            index--;
+         }
+      }
+      return input_length;
+   }
+
+   /*
+   * ***************************************************************************
+   * Run time dispatch (follows the instruction set selected for the transcoder)
+   * ***************************************************************************
+   */
+
+   ///<summary> the scanning kernels for one instruction set.</summary>
+   struct scan_kernels
+   {
+      std::size_t(*count_codepoints)(const char*, std::size_t) noexcept;
+      scan_result(*validate)(const char*, std::size_t) noexcept;
+      std::size_t(*offset_of_codepoint)(const char*, std::size_t, std::size_t) noexcept;
+   };
+
+   template<typename Scan>
+   static constexpr scan_kernels scan_kernels_for = { &count_codepoints_with<Scan>, &validate_with<Scan>, &offset_of_codepoint_with<Scan> };
+
+   ///<summary> get the kernels for the instruction set in use (see transcode::set_simd_level).</summary>
+   static const scan_kernels& active_scan_kernels() noexcept
+   {
+      switch (transcode::get_simd_level())
+      {
+#ifdef UTF8_TRANSCODE_X86
+      case simd_level::avx2:
+         return scan_kernels_for<avx2_scan>;
+      case simd_level::sse2:
+         return scan_kernels_for<sse2_scan>;
+#endif
+      default:
+         return scan_kernels_for<scalar_scan>;
+      }
+   }
+
+   /*
+   * ***************************************************************************
+   * Public interface
+   * ***************************************************************************
+   */
+
+   std::size_t scan::count_codepoints(const char* input, std::size_t input_length) noexcept
+   {
+      return active_scan_kernels().count_codepoints(input, input_length);
+   }
+
+   scan_result scan::validate(const char* input, std::size_t input_length) noexcept
+   {
+      return active_scan_kernels().validate(input, input_length);
+   }
+
+   std::size_t scan::offset_of_codepoint(const char* input, std::size_t input_length, std::size_t index) noexcept
+   {
+      return active_scan_kernels().offset_of_codepoint(input, input_length, index);
+   }
+}
+
+#pragma warning(default: UTF8_SCAN_WARNINGS_SUPPRESSED)
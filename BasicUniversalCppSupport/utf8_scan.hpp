@@ -0,0 +1,101 @@
+//
+// utf8_scan.hpp : vectorized utf8 scanning (code point counting, validation, indexing and truncation)
+//
+// Scans utf8 without converting it, using the same instruction set as the transcoder (AVX2 or SSE2, selected at run
+// time, with a scalar fallback - see transcode::set_simd_level). No system calls are made, and no memory is allocated.
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __UTF8_SCAN_HPP__
+#define __UTF8_SCAN_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstddef>
+
+#include "utf8_transcode.hpp"
+
+namespace utf8
+{
+   ///<summary> the result of validating utf8.</summary>
+   struct scan_result
+   {
+      ///<summary> ok, invalid (ill formed at position 'length') or incomplete (truncated sequence at position 'length').</summary>
+      transcode_status status;
+
+      ///<summary> the length in bytes of the well formed input (if the input is ill formed, the position of the error).</summary>
+      std::size_t length;
+
+      ///<summary> the number of code points in the well formed input.</summary>
+      std::size_t code_points;
+   };
+
+   ///<summary> vectorized utf8 scanning.</summary>
+   ///<remarks> Safe to call concurrently from any thread.</remarks>
+   class scan
+   {
+   public:
+      ///<summary> count the code points in utf8 encoded input.</summary>
+      ///<remarks> counts the bytes that are not continuation bytes (the input is not validated).</remarks>
+      ///<param name='input'> utf8 encoded input.</param>
+      ///<param name='input_length'> the input length in bytes.</param>
+      ///<returns> the number of code points (always less than or equal to input_length).</returns>
+      BASICUNIVERSALCPPSUPPORT_API static std::size_t count_codepoints(const char* input, std::size_t input_length) noexcept;
+
+      ///<summary> validate utf8 encoded input (by the rules transcode applies), and count its code points.</summary>
+      ///<param name='input'> utf8 encoded input.</param>
+      ///<param name='input_length'> the input length in bytes.</param>
+      ///<returns> the status, the length of the well formed input and the number of code points it holds.</returns>
+      BASICUNIVERSALCPPSUPPORT_API static scan_result validate(const char* input, std::size_t input_length) noexcept;
+
+      ///<summary> get the byte offset of a code point (E.g. to take the first n code points of a string).</summary>
+      ///<param name='input'> utf8 encoded input.</param>
+      ///<param name='input_length'> the input length in bytes.</param>
+      ///<param name='index'> the (zero based) index of the code point.</param>
+      ///<returns> the offset of the lead byte of code point 'index', or input_length if there are not that many code points.</returns>
+      BASICUNIVERSALCPPSUPPORT_API static std::size_t offset_of_codepoint(const char* input, std::size_t input_length, std::size_t index) noexcept;
+
+      ///<summary> get the longest length, no more than max_length, that does not split a code point.</summary>
+      ///<remarks> only the (at most 3) bytes around max_length are examined.</remarks>
+      ///<param name='input'> utf8 encoded input.</param>
+      ///<param name='input_length'> the input length in bytes.</param>
+      ///<param name='max_length'> the most bytes wanted.</param>
+      ///<returns> the truncated length in bytes.</returns>
+      static constexpr std::size_t truncate(const char* input, std::size_t input_length, std::size_t max_length) noexcept
+      {
+         if (input_length <= max_length)
+         {
+            return input_length;
+         }
+
+         // back up over continuation bytes (a sequence has at most 3) to the lead byte of the code point that would be split
+         std::size_t length = max_length;
+         while ((length > 0) && (max_length - length < 3) && ((static_cast<unsigned char>(input[length]) & 0xC0) == 0x80))
+         {
+            length--;
+         }
+         return ((static_cast<unsigned char>(input[length]) & 0xC0) == 0x80) ? max_length : length;
+      }
+   };
+}
+
+#endif // __UTF8_SCAN_HPP__
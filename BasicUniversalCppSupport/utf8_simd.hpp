@@ -0,0 +1,115 @@
+//
+// utf8_simd.hpp : instruction set support and utf8 sequence rules shared by the vectorized utf8 kernels
+//
+// Internal to BasicUniversalCppSupport (included by utf8_transcode.cpp and utf8_scan.cpp, not by stdafx.h).
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __UTF8_SIMD_HPP__
+#define __UTF8_SIMD_HPP__
+
+#include <cstddef>
+
+#include "utf8_transcode.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// INSTRUCTION SET SUPPORT
+//
+// UTF8_TRANSCODE_X86 - x86/x64 targets, where the SSE2 and AVX2 kernels are built (and selected at run time if supported).
+// UTF8_TARGET_AVX2   - gcc and clang only build AVX2 intrinsics in functions that are marked for the AVX2 target (msvc always does).
+//
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define UTF8_TRANSCODE_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__clang__) || defined(__GNUC__)
+#define UTF8_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define UTF8_TARGET_AVX2
+#endif
+
+namespace utf8
+{
+   ///<summary> decode one (non ASCII) utf8 sequence.</summary>
+   ///<param name='input'> the sequence (the lead byte is at least 0x80).</param>
+   ///<param name='remaining'> the input bytes available.</param>
+   ///<param name='code_point'> set to the decoded code point (if successful).</param>
+   ///<param name='length'> set to the sequence length (if successful).</param>
+   ///<returns> ok, invalid (ill formed) or incomplete (well formed so far, but input ends part way through).</returns>
+   inline transcode_status decode_code_point(const unsigned char* input, std::size_t remaining, char32_t& code_point, std::size_t& length) noexcept
+   {
+      // the well formed utf8 byte sequences (Unicode 13.0, table 3-7): the second byte range depends on the lead byte
+      const unsigned char lead = input[0];
+      std::size_t sequence_length = 0;
+      char32_t value = 0;
+      unsigned char lower = 0x80;
+      unsigned char upper = 0xBF;
+
+      if (lead < 0xC2)
+      {
+         return transcode_status::invalid;      // unexpected continuation byte, or overlong 2 byte form
+      }
+      else if (lead < 0xE0)
+      {
+         sequence_length = 2; value = lead & 0x1Fu;
+      }
+      else if (lead < 0xF0)
+      {
+         sequence_length = 3; value = lead & 0x0Fu;
+         if (lead == 0xE0) lower = 0xA0;        // overlong 3 byte form
+         if (lead == 0xED) upper = 0x9F;        // surrogate code points
+      }
+      else if (lead < 0xF5)
+      {
+         sequence_length = 4; value = lead & 0x07u;
+         if (lead == 0xF0) lower = 0x90;        // overlong 4 byte form
+         if (lead == 0xF4) upper = 0x8F;        // above U+10FFFF
+      }
+      else
+      {
+         return transcode_status::invalid;      // above U+10FFFF
+      }
+
+      for (std::size_t k = 1; k < sequence_length; k++)
+      {
+         if (k >= remaining)
+         {
+            return transcode_status::incomplete;
+         }
+
+         const unsigned char continuation = input[k];
+         if ((continuation < lower) || (continuation > upper))
+         {
+            return transcode_status::invalid;
+         }
+         lower = 0x80;
+         upper = 0xBF;
+         value = (value << 6) | (continuation & 0x3Fu);
+      }
+
+      code_point = value;
+      length = sequence_length;
+      return transcode_status::ok;
+   }
+}
+
+#endif // __UTF8_SIMD_HPP__
@@ -0,0 +1,157 @@
+//
+// utf8_stream_convert.cpp : chunked (streaming) conversions to support utf8 everywhere coding paradigm
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include "utf8_stream_convert.hpp"
+
+#include <algorithm>
+
+#define UTF8_STREAM_CONVERT_WARNINGS_SUPPRESSED 26481 26490
+#pragma warning(disable: UTF8_STREAM_CONVERT_WARNINGS_SUPPRESSED)
+
+// As in utf8_convert.cpp, ill formed input raises utf8::conversion_error (not error_context).
+
+namespace utf8
+{
+   ///<summary> convert a chunk of a stream, completing any sequence held back from the last chunk.</summary>
+   ///<param name='encoding'> the input encoding (for error reporting).</param>
+   ///<param name='transcoder'> converts (input, length, output, capacity) to a transcode_result.</param>
+   ///<param name='pending'> the held back sequence (updated).</param>
+   ///<param name='pending_length'> the held back sequence length (updated).</param>
+   ///<param name='position'> the stream offset of the held back sequence, or of the chunk (updated).</param>
+   template<std::size_t MaxPending, typename In, typename Out, typename Transcoder>
+   static std::size_t convert_chunk(const char* encoding, Transcoder transcoder, In(&pending)[MaxPending], std::size_t& pending_length,
+      std::size_t& position, std::basic_string_view<In> chunk, std::span<Out> output)
+   {
+      std::size_t written = 0;
+
+      if (pending_length > 0)
+      {
+         // complete the held back sequence with (at most one sequence worth of) the start of this chunk
+         In joined[MaxPending + 1] = {};
+         const std::size_t taken = std::min(chunk.size(), MaxPending + 1 - pending_length);
+         std::copy(pending, pending + pending_length, joined);
+         std::copy(chunk.data(), chunk.data() + taken, joined + pending_length);
+         const std::size_t joined_length = pending_length + taken;
+
+         const transcode_result result = transcoder(joined, joined_length, output.data(), output.size());
+         switch (result.status)
+         {
+         case transcode_status::ok:
+            break;
+         case transcode_status::incomplete:
+            if (result.read == 0)
+            {
+               // the chunk was too short to complete the sequence, so hold all of it back
+               std::copy(joined, joined + joined_length, pending);
+               pending_length = joined_length;
+               return 0;
+            }
+            break;
+         case transcode_status::invalid:
+            throw conversion_error(encoding, result.status, position + result.read);
+         default:
+            throw std::length_error("stream conversion output buffer is too small");
+         }
+
+         // the held back sequence is converted (a sequence starting later in joined is converted from the chunk below)
+         const std::size_t consumed = result.read - pending_length;
+         written = result.written;
+         position += result.read;
+         pending_length = 0;
+         chunk.remove_prefix(consumed);
+      }
+
+      const transcode_result result = transcoder(chunk.data(), chunk.size(), output.data() + written, output.size() - written);
+      switch (result.status)
+      {
+      case transcode_status::ok:
+         break;
+      case transcode_status::incomplete:
+         // hold back the incomplete sequence at the end of the chunk
+         pending_length = chunk.size() - result.read;
+         std::copy(chunk.data() + result.read, chunk.data() + chunk.size(), pending);
+         break;
+      case transcode_status::invalid:
+         throw conversion_error(encoding, result.status, position + result.read);
+      default:
+         throw std::length_error("stream conversion output buffer is too small");
+      }
+
+      position += result.read;
+      return written + result.written;
+   }
+
+   /*
+   * ***************************************************************************
+   * to_utf16_stream
+   * ***************************************************************************
+   */
+
+   std::size_t to_utf16_stream::convert(std::string_view chunk, std::span<wchar_t> output)
+   {
+      const auto transcoder = [](const char* input, std::size_t length, wchar_t* converted, std::size_t capacity) noexcept
+      {
+         return transcode::utf8_to_utf16(input, length, reinterpret_cast<char16_t*>(converted), capacity);
+      };
+      return convert_chunk("utf8", transcoder, m_pending, m_pending_length, m_position, chunk, output);
+   }
+
+   void to_utf16_stream::finish()
+   {
+      if (m_pending_length > 0)
+      {
+         throw conversion_error("utf8", transcode_status::incomplete, m_position);
+      }
+   }
+
+   std::size_t to_utf16_stream::position() const noexcept
+   {
+      return m_position;
+   }
+
+   /*
+   * ***************************************************************************
+   * from_utf16_stream
+   * ***************************************************************************
+   */
+
+   std::size_t from_utf16_stream::convert(std::wstring_view chunk, std::span<char> output)
+   {
+      const auto transcoder = [](const wchar_t* input, std::size_t length, char* converted, std::size_t capacity) noexcept
+      {
+         return transcode::utf16_to_utf8(reinterpret_cast<const char16_t*>(input), length, converted, capacity);
+      };
+      return convert_chunk("utf16", transcoder, m_pending, m_pending_length, m_position, chunk, output);
+   }
+
+   void from_utf16_stream::finish()
+   {
+      if (m_pending_length > 0)
+      {
+         throw conversion_error("utf16", transcode_status::incomplete, m_position);
+      }
+   }
+
+   std::size_t from_utf16_stream::position() const noexcept
+   {
+      return m_position;
+   }
+}
+
+#pragma warning(default: UTF8_STREAM_CONVERT_WARNINGS_SUPPRESSED)
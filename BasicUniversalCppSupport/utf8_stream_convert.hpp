@@ -0,0 +1,120 @@
+//
+// utf8_stream_convert.hpp : chunked (streaming) conversions to support utf8 everywhere coding paradigm
+//
+// Converts large inputs a chunk at a time, into a caller supplied buffer, without a full copy of the input or the
+// output. A sequence split across a chunk boundary is held back and completed by the next chunk.
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __UTF8_STREAM_CONVERT_HPP__
+#define __UTF8_STREAM_CONVERT_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace utf8
+{
+   ///<summary>converts a utf8 stream to utf16, a chunk at a time</summary>
+   class to_utf16_stream
+   {
+   public:
+      ///<summary>the output buffer size (in utf16 code units) that is always sufficient to convert a chunk</summary>
+      static constexpr std::size_t max_output_length(std::size_t chunk_length) noexcept
+      {
+         return chunk_length + max_pending;
+      }
+
+      ///<summary>convert a chunk</summary>
+      ///<remarks>a sequence that is incomplete at the end of the chunk is held back, and converted with the next chunk</remarks>
+      ///<param name='chunk'>the next part of the utf8 encoded stream</param>
+      ///<param name='output'>receives utf16 code units (no terminator is written)</param>
+      ///<returns>the number of utf16 code units written</returns>
+      ///<exception cref='utf8::conversion_error'>if the stream is not well formed (the position is the offset in the stream)</exception>
+      ///<exception cref='std::length_error'>if output is too small (max_output_length is always sufficient)</exception>
+      BASICUNIVERSALCPPSUPPORT_API std::size_t convert(std::string_view chunk, std::span<wchar_t> output);
+
+      ///<summary>end the stream</summary>
+      ///<exception cref='utf8::conversion_error'>if the stream ends part way through a sequence</exception>
+      BASICUNIVERSALCPPSUPPORT_API void finish();
+
+      ///<summary>get the number of bytes of the stream converted so far (excluding any held back)</summary>
+      BASICUNIVERSALCPPSUPPORT_API std::size_t position() const noexcept;
+
+   private:
+      ///<summary>the longest incomplete sequence that can be held back</summary>
+      static constexpr std::size_t max_pending = 3;
+
+      ///<summary>an incomplete sequence held back from the end of the last chunk</summary>
+      char m_pending[max_pending] = {};
+
+      ///<summary>the number of bytes held back</summary>
+      std::size_t m_pending_length = 0;
+
+      ///<summary>the stream offset of the first byte held back (or the next byte of the stream)</summary>
+      std::size_t m_position = 0;
+   };
+
+   ///<summary>converts a utf16 stream to utf8, a chunk at a time</summary>
+   class from_utf16_stream
+   {
+   public:
+      ///<summary>the output buffer size (in bytes) that is always sufficient to convert a chunk</summary>
+      static constexpr std::size_t max_output_length(std::size_t chunk_length) noexcept
+      {
+         return 3 * (chunk_length + max_pending);
+      }
+
+      ///<summary>convert a chunk</summary>
+      ///<remarks>a high surrogate at the end of the chunk is held back, and converted with the next chunk</remarks>
+      ///<param name='chunk'>the next part of the utf16 encoded stream</param>
+      ///<param name='output'>receives utf8 bytes (no terminator is written)</param>
+      ///<returns>the number of bytes written</returns>
+      ///<exception cref='utf8::conversion_error'>if the stream is not well formed (the position is the offset in the stream)</exception>
+      ///<exception cref='std::length_error'>if output is too small (max_output_length is always sufficient)</exception>
+      BASICUNIVERSALCPPSUPPORT_API std::size_t convert(std::wstring_view chunk, std::span<char> output);
+
+      ///<summary>end the stream</summary>
+      ///<exception cref='utf8::conversion_error'>if the stream ends with an unpaired high surrogate</exception>
+      BASICUNIVERSALCPPSUPPORT_API void finish();
+
+      ///<summary>get the number of code units of the stream converted so far (excluding any held back)</summary>
+      BASICUNIVERSALCPPSUPPORT_API std::size_t position() const noexcept;
+
+   private:
+      ///<summary>the longest incomplete sequence that can be held back (a high surrogate)</summary>
+      static constexpr std::size_t max_pending = 1;
+
+      ///<summary>a high surrogate held back from the end of the last chunk</summary>
+      wchar_t m_pending[max_pending] = {};
+
+      ///<summary>the number of code units held back</summary>
+      std::size_t m_pending_length = 0;
+
+      ///<summary>the stream offset of the code unit held back (or the next code unit of the stream)</summary>
+      std::size_t m_position = 0;
+   };
+}
+
+#endif // __UTF8_STREAM_CONVERT_HPP__
@@ -0,0 +1,500 @@
+//
+// utf8_transcode.cpp : validating utf8 <-> utf16 transcoder (portable, vectorized)
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include "utf8_transcode.hpp"
+#include "utf8_simd.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#define UTF8_TRANSCODE_WARNINGS_SUPPRESSED 26481 26490
+#pragma warning(disable: UTF8_TRANSCODE_WARNINGS_SUPPRESSED)
+
+// In this source file (as in utf8_convert.cpp) 'throw error_context("reason");' is NOT viable - due to mutual recursion.
+// Nothing here throws: every outcome is reported in a transcode_result.
+
+namespace utf8
+{
+   /*
+   * ***************************************************************************
+   * Scalar (one sequence at a time) conversion steps, used by all kernels
+   * ***************************************************************************
+   */
+
+   ///<summary> decode one (non ASCII) utf8 sequence, and encode it as utf16.</summary>
+   ///<param name='input'> the sequence (the lead byte is at least 0x80).</param>
+   ///<param name='remaining'> the input bytes available.</param>
+   ///<param name='output'> where to write the utf16 code units (one or a surrogate pair).</param>
+   ///<param name='space'> the output code units available.</param>
+   ///<param name='consumed'> set to the sequence length (if successful).</param>
+   ///<param name='produced'> set to the number of code units written (if successful).</param>
+   static inline transcode_status decode_sequence(const unsigned char* input, std::size_t remaining, char16_t* output, std::size_t space,
+      std::size_t& consumed, std::size_t& produced) noexcept
+   {
+      char32_t code_point = 0;
+      std::size_t length = 0;
+      const transcode_status status = decode_code_point(input, remaining, code_point, length);
+      if (status != transcode_status::ok)
+      {
+         return status;
+      }
+
+      if (code_point < 0x10000)
+      {
+         if (space < 1) return transcode_status::output_full;
+         output[0] = static_cast<char16_t>(code_point);
+         produced = 1;
+      }
+      else
+      {
+         if (space < 2) return transcode_status::output_full;
+         code_point -= 0x10000;
+         output[0] = static_cast<char16_t>(0xD800 + (code_point >> 10));
+         output[1] = static_cast<char16_t>(0xDC00 + (code_point & 0x3FF));
+         produced = 2;
+      }
+
+      consumed = length;
+      return transcode_status::ok;
+   }
+
+   ///<summary> decode one (non ASCII) utf16 code point, and encode it as utf8.</summary>
+   ///<param name='input'> the code point (the first code unit is at least 0x80).</param>
+   ///<param name='remaining'> the input code units available.</param>
+   ///<param name='output'> where to write the utf8 sequence.</param>
+   ///<param name='space'> the output bytes available.</param>
+   ///<param name='consumed'> set to the number of code units read (if successful).</param>
+   ///<param name='produced'> set to the utf8 sequence length (if successful).</param>
+   static inline transcode_status encode_sequence(const char16_t* input, std::size_t remaining, char* output, std::size_t space,
+      std::size_t& consumed, std::size_t& produced) noexcept
+   {
+      char32_t code_point = input[0];
+      std::size_t units = 1;
+
+      if ((code_point >= 0xD800) && (code_point <= 0xDFFF))
+      {
+         if (code_point >= 0xDC00)
+         {
+            return transcode_status::invalid;   // unpaired low surrogate
+         }
+         if (remaining < 2)
+         {
+            return transcode_status::incomplete;
+         }
+
+         const char32_t low = input[1];
+         if ((low < 0xDC00) || (low > 0xDFFF))
+         {
+            return transcode_status::invalid;   // unpaired high surrogate
+         }
+         code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+         units = 2;
+      }
+
+      if (code_point < 0x800)
+      {
+         if (space < 2) return transcode_status::output_full;
+         output[0] = static_cast<char>(0xC0 | (code_point >> 6));
+         output[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+         produced = 2;
+      }
+      else if (code_point < 0x10000)
+      {
+         if (space < 3) return transcode_status::output_full;
+         output[0] = static_cast<char>(0xE0 | (code_point >> 12));
+         output[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+         output[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+         produced = 3;
+      }
+      else
+      {
+         if (space < 4) return transcode_status::output_full;
+         output[0] = static_cast<char>(0xF0 | (code_point >> 18));
+         output[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+         output[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+         output[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+         produced = 4;
+      }
+
+      consumed = units;
+      return transcode_status::ok;
+   }
+
+   /*
+   * ***************************************************************************
+   * ASCII fast paths (one per instruction set)
+   *
+   * widen_ascii converts the leading ASCII bytes of input (and narrow_ascii the leading ASCII code units), a block
+   * at a time, returning how many were converted. A block is only processed when a whole block of input and of
+   * output is available (so a block may be written past the ASCII prefix, but never past the output capacity).
+   * ***************************************************************************
+   */
+
+   ///<summary> portable ASCII fast path (8 bytes at a time).</summary>
+   struct scalar_ascii
+   {
+      static constexpr simd_level level = simd_level::scalar;
+      static constexpr std::size_t block = 8;
+
+      static std::size_t widen_ascii(const unsigned char* input, std::size_t remaining, char16_t* output, std::size_t space) noexcept
+      {
+         std::size_t done = 0;
+         while ((remaining - done >= block) && (space - done >= block))
+         {
+            std::uint64_t word = 0;
+            std::memcpy(&word, input + done, block);
+            if ((word & 0x8080808080808080ull) != 0)
+            {
+               break;
+            }
+            for (std::size_t k = 0; k < block; k++)
+            {
+               output[done + k] = input[done + k];
+            }
+            done += block;
+         }
+         return done;
+      }
+
+      static std::size_t narrow_ascii(const char16_t* input, std::size_t remaining, char* output, std::size_t space) noexcept
+      {
+         std::size_t done = 0;
+         while ((remaining - done >= block) && (space - done >= block))
+         {
+            char16_t units = 0;
+            for (std::size_t k = 0; k < block; k++)
+            {
+               units |= input[done + k];
+            }
+            if (units >= 0x80)
+            {
+               break;
+            }
+            for (std::size_t k = 0; k < block; k++)
+            {
+               output[done + k] = static_cast<char>(input[done + k]);
+            }
+            done += block;
+         }
+         return done;
+      }
+   };
+
+#ifdef UTF8_TRANSCODE_X86
+   ///<summary> SSE2 ASCII fast path (16 bytes at a time).</summary>
+   struct sse2_ascii
+   {
+      static constexpr simd_level level = simd_level::sse2;
+      static constexpr std::size_t block = 16;
+
+      static std::size_t widen_ascii(const unsigned char* input, std::size_t remaining, char16_t* output, std::size_t space) noexcept
+      {
+         const __m128i zero = _mm_setzero_si128();
+         std::size_t done = 0;
+         while ((remaining - done >= block) && (space - done >= block))
+         {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + done));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + done), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + done + 8), _mm_unpackhi_epi8(bytes, zero));
+
+            const unsigned int non_ascii = static_cast<unsigned int>(_mm_movemask_epi8(bytes));
+            if (non_ascii != 0)
+            {
+               return done + std::countr_zero(non_ascii);   // the ASCII prefix of this block was converted
+            }
+            done += block;
+         }
+         return done;
+      }
+
+      static std::size_t narrow_ascii(const char16_t* input, std::size_t remaining, char* output, std::size_t space) noexcept
+      {
+         const __m128i ascii_mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+         const __m128i zero = _mm_setzero_si128();
+         std::size_t done = 0;
+         while ((remaining - done >= block) && (space - done >= block))
+         {
+            const __m128i units_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + done));
+            const __m128i units_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + done + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + done), _mm_packus_epi16(units_lo, units_hi));
+
+            const __m128i ascii = _mm_packs_epi16(
+               _mm_cmpeq_epi16(_mm_and_si128(units_lo, ascii_mask), zero),
+               _mm_cmpeq_epi16(_mm_and_si128(units_hi, ascii_mask), zero));
+            const unsigned int non_ascii = ~static_cast<unsigned int>(_mm_movemask_epi8(ascii)) & 0xFFFFu;
+            if (non_ascii != 0)
+            {
+               return done + std::countr_zero(non_ascii);
+            }
+            done += block;
+         }
+         return done;
+      }
+   };
+
+   ///<summary> AVX2 ASCII fast path (32 bytes at a time).</summary>
+   struct avx2_ascii
+   {
+      static constexpr simd_level level = simd_level::avx2;
+      static constexpr std::size_t block = 32;
+
+      UTF8_TARGET_AVX2 static std::size_t widen_ascii(const unsigned char* input, std::size_t remaining, char16_t* output, std::size_t space) noexcept
+      {
+         std::size_t done = 0;
+         while ((remaining - done >= block) && (space - done >= block))
+         {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + done));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + done), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + done + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+
+            const unsigned int non_ascii = static_cast<unsigned int>(_mm256_movemask_epi8(bytes));
+            if (non_ascii != 0)
+            {
+               return done + std::countr_zero(non_ascii);
+            }
+            done += block;
+         }
+         return done;
+      }
+
+      UTF8_TARGET_AVX2 static std::size_t narrow_ascii(const char16_t* input, std::size_t remaining, char* output, std::size_t space) noexcept
+      {
+         const __m256i ascii_mask = _mm256_set1_epi16(static_cast<short>(0xFF80));
+         const __m256i zero = _mm256_setzero_si256();
+         std::size_t done = 0;
+         while ((remaining - done >= block) && (space - done >= block))
+         {
+            const __m256i units_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + done));
+            const __m256i units_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + done + 16));
+
+            // packs work within 128 bit lanes, so restore the order of the 64 bit quarters afterwards
+            const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(units_lo, units_hi), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + done), bytes);
+
+            const __m256i ascii = _mm256_permute4x64_epi64(_mm256_packs_epi16(
+               _mm256_cmpeq_epi16(_mm256_and_si256(units_lo, ascii_mask), zero),
+               _mm256_cmpeq_epi16(_mm256_and_si256(units_hi, ascii_mask), zero)), 0xD8);
+            const unsigned int non_ascii = ~static_cast<unsigned int>(_mm256_movemask_epi8(ascii));
+            if (non_ascii != 0)
+            {
+               return done + std::countr_zero(non_ascii);
+            }
+            done += block;
+         }
+         return done;
+      }
+   };
+#endif
+
+   /*
+   * ***************************************************************************
+   * Transcoding loops (ASCII runs use the fast path, other sequences the scalar steps)
+   * ***************************************************************************
+   */
+
+   template<typename Ascii>
+   static transcode_result utf8_to_utf16_with(const char* input, std::size_t input_length, char16_t* output, std::size_t output_capacity) noexcept
+   {
+      const auto bytes = reinterpret_cast<const unsigned char*>(input);
+      std::size_t read = 0;
+      std::size_t written = 0;
+
+      while (read < input_length)
+      {
+         if (bytes[read] < 0x80)
+         {
+            const std::size_t run = Ascii::widen_ascii(bytes + read, input_length - read, output + written, output_capacity - written);
+            if (run == 0)
+            {
+               if (written == output_capacity) return { transcode_status::output_full, read, written };
+               output[written++] = bytes[read++];
+            }
+            read += run;
+            written += run;
+            continue;
+         }
+
+         std::size_t consumed = 0;
+         std::size_t produced = 0;
+         const transcode_status status = decode_sequence(bytes + read, input_length - read, output + written, output_capacity - written, consumed, produced);
+         if (status != transcode_status::ok)
+         {
+            return { status, read, written };
+         }
+         read += consumed;
+         written += produced;
+      }
+      return { transcode_status::ok, read, written };
+   }
+
+   template<typename Ascii>
+   static transcode_result utf16_to_utf8_with(const char16_t* input, std::size_t input_length, char* output, std::size_t output_capacity) noexcept
+   {
+      std::size_t read = 0;
+      std::size_t written = 0;
+
+      while (read < input_length)
+      {
+         if (input[read] < 0x80)
+         {
+            const std::size_t run = Ascii::narrow_ascii(input + read, input_length - read, output + written, output_capacity - written);
+            if (run == 0)
+            {
+               if (written == output_capacity) return { transcode_status::output_full, read, written };
+               output[written++] = static_cast<char>(input[read++]);
+            }
+            read += run;
+            written += run;
+            continue;
+         }
+
+         std::size_t consumed = 0;
+         std::size_t produced = 0;
+         const transcode_status status = encode_sequence(input + read, input_length - read, output + written, output_capacity - written, consumed, produced);
+         if (status != transcode_status::ok)
+         {
+            return { status, read, written };
+         }
+         read += consumed;
+         written += produced;
+      }
+      return { transcode_status::ok, read, written };
+   }
+
+   /*
+   * ***************************************************************************
+   * Run time dispatch
+   * ***************************************************************************
+   */
+
+   ///<summary> the transcoding kernels for one instruction set.</summary>
+   struct transcode_kernels
+   {
+      simd_level level;
+      transcode_result(*utf8_to_utf16)(const char*, std::size_t, char16_t*, std::size_t) noexcept;
+      transcode_result(*utf16_to_utf8)(const char16_t*, std::size_t, char*, std::size_t) noexcept;
+   };
+
+   template<typename Ascii>
+   static constexpr transcode_kernels kernels_for = { Ascii::level, &utf8_to_utf16_with<Ascii>, &utf16_to_utf8_with<Ascii> };
+
+   ///<summary> get the kernels for an instruction set (which must be supported).</summary>
+   static const transcode_kernels* select_kernels(simd_level level) noexcept
+   {
+      switch (level)
+      {
+#ifdef UTF8_TRANSCODE_X86
+      case simd_level::avx2:
+         return &kernels_for<avx2_ascii>;
+      case simd_level::sse2:
+         return &kernels_for<sse2_ascii>;
+#endif
+      default:
+         return &kernels_for<scalar_ascii>;
+      }
+   }
+
+   ///<summary> detect the best instruction set supported by this processor and operating system.</summary>
+   static simd_level detect_simd_level() noexcept
+   {
+#ifdef UTF8_TRANSCODE_X86
+      unsigned int leaf1[4] = {};
+      unsigned int leaf7[4] = {};
+#if defined(_MSC_VER)
+      __cpuid(reinterpret_cast<int*>(leaf1), 1);
+      __cpuidex(reinterpret_cast<int*>(leaf7), 7, 0);
+#else
+      __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+      __get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+#endif
+      const bool sse2 = (leaf1[3] & (1u << 26)) != 0;
+      const bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+      const bool avx = (leaf1[2] & (1u << 28)) != 0;
+      const bool avx2 = (leaf7[1] & (1u << 5)) != 0;
+
+      if (osxsave && avx && avx2)
+      {
+         // the operating system must also save the AVX (ymm) registers on a context switch
+#if defined(_MSC_VER)
+         const unsigned long long xcr0 = _xgetbv(0);
+#else
+         unsigned int xcr0_lo = 0;
+         unsigned int xcr0_hi = 0;
+         __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+         const unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0_hi) << 32) | xcr0_lo;
+#endif
+         if ((xcr0 & 0x6) == 0x6)
+         {
+            return simd_level::avx2;
+         }
+      }
+      if (sse2)
+      {
+         return simd_level::sse2;
+      }
+#endif
+      return simd_level::scalar;
+   }
+
+   ///<summary> the kernels in use (the best supported, unless set_simd_level says otherwise).</summary>
+   static std::atomic<const transcode_kernels*>& active_kernels() noexcept
+   {
+      static std::atomic<const transcode_kernels*> active(select_kernels(transcode::get_supported_simd_level()));
+      return active;
+   }
+
+   /*
+   * ***************************************************************************
+   * Public interface
+   * ***************************************************************************
+   */
+
+   transcode_result transcode::utf8_to_utf16(const char* input, std::size_t input_length, char16_t* output, std::size_t output_capacity) noexcept
+   {
+      return active_kernels().load(std::memory_order_relaxed)->utf8_to_utf16(input, input_length, output, output_capacity);
+   }
+
+   transcode_result transcode::utf16_to_utf8(const char16_t* input, std::size_t input_length, char* output, std::size_t output_capacity) noexcept
+   {
+      return active_kernels().load(std::memory_order_relaxed)->utf16_to_utf8(input, input_length, output, output_capacity);
+   }
+
+   simd_level transcode::get_supported_simd_level() noexcept
+   {
+      static const simd_level supported = detect_simd_level();
+      return supported;
+   }
+
+   simd_level transcode::get_simd_level() noexcept
+   {
+      return active_kernels().load(std::memory_order_relaxed)->level;
+   }
+
+   simd_level transcode::set_simd_level(simd_level level) noexcept
+   {
+      const simd_level supported = get_supported_simd_level();
+      const simd_level selected = (static_cast<int>(level) < static_cast<int>(supported)) ? level : supported;
+      active_kernels().store(select_kernels(selected), std::memory_order_relaxed);
+      return selected;
+   }
+}
+
+#pragma warning(default: UTF8_TRANSCODE_WARNINGS_SUPPRESSED)
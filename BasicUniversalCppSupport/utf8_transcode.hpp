@@ -0,0 +1,115 @@
+//
+// utf8_transcode.hpp : validating utf8 <-> utf16 transcoder (portable, vectorized)
+//
+// Converts and validates in a single pass, with an ASCII fast path that uses the best instruction set available
+// (AVX2 or SSE2, selected at run time, with a scalar fallback). Ill formed input is reported with its exact position.
+// No system calls are made (the thread last error is never changed), and no memory is allocated.
+//
+// Copyright (c) 2016-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __UTF8_TRANSCODE_HPP__
+#define __UTF8_TRANSCODE_HPP__
+
+#ifndef _WIN32
+#define BASICUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(BASICUNIVERSALCPPSUPPORT_EXPORTS)
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define BASICUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstddef>
+
+namespace utf8
+{
+   ///<summary> the instruction set used by the transcoder.</summary>
+   enum class simd_level
+   {
+      scalar,     // portable code (8 bytes at a time on the ASCII fast path)
+      sse2,       // 16 bytes at a time
+      avx2        // 32 bytes at a time
+   };
+
+   ///<summary> the outcome of a transcoding operation.</summary>
+   enum class transcode_status
+   {
+      ok,            // all input was converted
+      invalid,       // the input is ill formed at position 'read'
+      incomplete,    // the input ends part way through a (so far well formed) sequence, which starts at position 'read'
+      output_full    // the output capacity was reached (conversion stopped at a sequence boundary)
+   };
+
+   ///<summary> the result of a transcoding operation.</summary>
+   struct transcode_result
+   {
+      ///<summary> how the operation ended.</summary>
+      transcode_status status;
+
+      ///<summary> the number of input code units converted (if the input is ill formed, the position of the error).</summary>
+      std::size_t read;
+
+      ///<summary> the number of output code units written.</summary>
+      std::size_t written;
+   };
+
+   ///<summary> validating utf8 <-> utf16 transcoder.</summary>
+   ///<remarks> utf8 is validated strictly (no overlong forms, surrogates or code points above U+10FFFF), and utf16
+   /// surrogates must be correctly paired. Safe to call concurrently from any thread.</remarks>
+   class transcode
+   {
+   public:
+      ///<summary> convert utf8 to utf16.</summary>
+      ///<param name='input'> utf8 encoded input.</param>
+      ///<param name='input_length'> the input length in bytes.</param>
+      ///<param name='output'> the output buffer.</param>
+      ///<param name='output_capacity'> the output buffer size in utf16 code units (max_utf16_length is always sufficient).</param>
+      ///<returns> the status, and how much input was converted into how much output.</returns>
+      BASICUNIVERSALCPPSUPPORT_API static transcode_result utf8_to_utf16(const char* input, std::size_t input_length, char16_t* output, std::size_t output_capacity) noexcept;
+
+      ///<summary> convert utf16 to utf8.</summary>
+      ///<param name='input'> utf16 encoded input.</param>
+      ///<param name='input_length'> the input length in utf16 code units.</param>
+      ///<param name='output'> the output buffer.</param>
+      ///<param name='output_capacity'> the output buffer size in bytes (max_utf8_length is always sufficient).</param>
+      ///<returns> the status, and how much input was converted into how much output.</returns>
+      BASICUNIVERSALCPPSUPPORT_API static transcode_result utf16_to_utf8(const char16_t* input, std::size_t input_length, char* output, std::size_t output_capacity) noexcept;
+
+      ///<summary> the largest utf16 length (in code units) that a utf8 input of the given length (in bytes) can convert to.</summary>
+      static constexpr std::size_t max_utf16_length(std::size_t utf8_length) noexcept
+      {
+         return utf8_length;
+      }
+
+      ///<summary> the largest utf8 length (in bytes) that a utf16 input of the given length (in code units) can convert to.</summary>
+      static constexpr std::size_t max_utf8_length(std::size_t utf16_length) noexcept
+      {
+         return 3 * utf16_length;
+      }
+
+      ///<summary> get the best instruction set supported by this processor (and operating system).</summary>
+      BASICUNIVERSALCPPSUPPORT_API static simd_level get_supported_simd_level() noexcept;
+
+      ///<summary> get the instruction set in use.</summary>
+      BASICUNIVERSALCPPSUPPORT_API static simd_level get_simd_level() noexcept;
+
+      ///<summary> select the instruction set to use (E.g. to compare implementations in tests and benchmarks).</summary>
+      ///<param name='level'> the instruction set wanted (limited to get_supported_simd_level()).</param>
+      ///<returns> the instruction set now in use.</returns>
+      BASICUNIVERSALCPPSUPPORT_API static simd_level set_simd_level(simd_level level) noexcept;
+   };
+}
+
+#endif // __UTF8_TRANSCODE_HPP__
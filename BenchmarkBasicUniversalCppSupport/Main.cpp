@@ -0,0 +1,72 @@
+﻿//
+// main.cpp : Defines the entry point for the BenchmarkBasicUniversalCppSupport console application.
+//
+// Measures the cost of selected BasicUniversalCppSupport operations, and reports the mean time per operation
+// (and the throughput, where meaningful). Build and run the Release configuration for meaningful figures.
+//
+// Usage: BenchmarkBasicUniversalCppSupport [--csv]
+//
+//   --csv    report comma separated values (one line per benchmark, after a header line), for regression tracking.
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+///<summary> *** PROGRAM ENTRYPOINT ***.</summary>
+///<param name='argc'> the number of command line arguments.</param>
+///<param name='argv'> the command line arguments (see Usage).</param>
+///<returns> exit code EXIT_SUCCESS if all benchmarks ran, or exit code EXIT_FAILURE if an error occurred.</returns>
+int main(int argc, char* argv[])
+{
+   try
+   {
+      utf8::console::configure_codepage();
+
+      const bool csv = (argc > 1) && (std::string(argv[1]) == "--csv");
+      const auto report = [csv](const std::vector<benchmark::result>& results)
+      {
+         for (const auto& measured : results)
+         {
+            if (csv)
+            {
+               benchmark::report_csv(std::cout, measured);
+            }
+            else
+            {
+               benchmark::report(std::cout, measured);
+            }
+         }
+      };
+
+      if (csv)
+      {
+         benchmark::report_csv_header(std::cout);
+      }
+      report(benchmark::error_context_benchmarks());
+      report(benchmark::pimpl_benchmarks());
+      report(benchmark::utf8_benchmarks());
+      return EXIT_SUCCESS;
+   }
+   catch (const error::context& e)
+   {
+      std::cerr << "Benchmark failed. " << e.full_what() << std::endl;
+   }
+   catch (const std::exception& e)
+   {
+      std::cerr << "Benchmark failed. " << e.what() << std::endl;
+   }
+   return EXIT_FAILURE;
+}
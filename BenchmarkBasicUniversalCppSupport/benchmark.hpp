@@ -0,0 +1,149 @@
+//
+// benchmark.hpp : minimal timing support for the BasicUniversalCppSupport benchmarks
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __BENCHMARK_HPP__
+#define __BENCHMARK_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace benchmark
+{
+   ///<summary> the measured cost of one benchmarked operation.</summary>
+   struct result
+   {
+      std::string name;
+      std::uint64_t iterations = 0;
+      double ns_per_op = 0.0;
+      std::uint64_t bytes_per_op = 0;     // input bytes processed by one call (0 if throughput is not meaningful)
+
+      ///<summary> get the throughput in MB/s (decimal megabytes, or 0 if bytes_per_op is not set).</summary>
+      double mb_per_s() const noexcept
+      {
+         return (ns_per_op > 0.0) ? (static_cast<double>(bytes_per_op) * 1000.0) / ns_per_op : 0.0;
+      }
+   };
+
+   ///<summary> keep a value alive, so that the optimizer can't discard the work that produced it.</summary>
+   ///<remarks> the value is read here by code the optimizer can't see into (an empty asm statement that may read any
+   /// memory, or with microsoft's compiler, volatile reads of the value's bytes and a compiler barrier). Storing the
+   /// value's address is not enough: the store is discarded with the value once the optimizer sees nothing read it.</remarks>
+   template<typename T>
+   void keep(const T& value) noexcept
+   {
+#ifdef _MSC_VER
+      static volatile unsigned char sink = 0;
+      const auto bytes = reinterpret_cast<const volatile unsigned char*>(&value);
+      for (std::size_t index = 0; index < sizeof(T); index++)
+      {
+         sink = bytes[index];
+      }
+      _ReadWriteBarrier();
+#else
+      asm volatile("" : : "r"(&value) : "memory");
+#endif
+   }
+
+   ///<summary> time an operation.</summary>
+   ///<param name='name'> the benchmark name (as reported).</param>
+   ///<param name='iterations'> how many times to call the operation (after a short warm up).</param>
+   ///<param name='operation'> the operation to time.</param>
+   ///<returns> the mean cost of one call.</returns>
+   template<typename Operation>
+   result measure(const std::string& name, std::uint64_t iterations, Operation&& operation)
+   {
+      for (std::uint64_t i = 0; i < (iterations / 10) + 1; i++)
+      {
+         operation();
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      for (std::uint64_t i = 0; i < iterations; i++)
+      {
+         operation();
+      }
+      const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+      return { name, iterations, elapsed / static_cast<double>(iterations) };
+   }
+
+   ///<summary> time an operation that processes input, choosing iterations so that about the same volume is processed at any size.</summary>
+   ///<param name='name'> the benchmark name (as reported).</param>
+   ///<param name='bytes'> the input bytes processed by one call.</param>
+   ///<param name='operation'> the operation to time.</param>
+   ///<returns> the mean cost of one call, and its throughput.</returns>
+   template<typename Operation>
+   result measure_throughput(const std::string& name, std::uint64_t bytes, Operation&& operation)
+   {
+      constexpr std::uint64_t bytes_per_measurement = 64ull * 1024 * 1024;
+      constexpr std::uint64_t min_iterations = 4;
+      constexpr std::uint64_t max_iterations = 1000000;
+
+      const std::uint64_t iterations = std::clamp((bytes > 0) ? bytes_per_measurement / bytes : max_iterations, min_iterations, max_iterations);
+      result measured = measure(name, iterations, std::forward<Operation>(operation));
+      measured.bytes_per_op = bytes;
+      return measured;
+   }
+
+   ///<summary> report a result (one line of text).</summary>
+   inline void report(std::ostream& out, const result& measured)
+   {
+      out << std::left << std::setw(56) << measured.name << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+         << measured.ns_per_op << " ns/op  (" << measured.iterations << " iterations)";
+      if (measured.bytes_per_op > 0)
+      {
+         out << std::setw(12) << measured.mb_per_s() << " MB/s";
+      }
+      out << std::endl;
+   }
+
+   ///<summary> report the column names of report_csv (one line of comma separated values).</summary>
+   inline void report_csv_header(std::ostream& out)
+   {
+      out << "benchmark,iterations,ns_per_op,bytes_per_op,mb_per_s" << std::endl;
+   }
+
+   ///<summary> report a result (one line of comma separated values, for regression tracking).</summary>
+   ///<remarks> the name is quoted (names may contain commas, but not quotes).</remarks>
+   inline void report_csv(std::ostream& out, const result& measured)
+   {
+      out << '"' << measured.name << "\"," << measured.iterations << ',' << std::fixed << std::setprecision(3) << measured.ns_per_op << ','
+         << measured.bytes_per_op << ',' << measured.mb_per_s() << std::endl;
+   }
+
+   ///<summary> error::context throw and catch cost (eager formatting before, lazy formatting after).</summary>
+   std::vector<result> error_context_benchmarks();
+
+   ///<summary> pimpl construction and copy cost (heap storage before, in place storage after).</summary>
+   std::vector<result> pimpl_benchmarks();
+
+   ///<summary> utf8 conversion, scanning, trimming and guid conversion throughput (by corpus and size).</summary>
+   std::vector<result> utf8_benchmarks();
+}
+
+#endif // __BENCHMARK_HPP__
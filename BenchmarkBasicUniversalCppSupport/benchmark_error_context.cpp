@@ -0,0 +1,92 @@
+//
+// benchmark_error_context.cpp : measures the cost of throwing (and catching) error::context
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+namespace
+{
+   constexpr std::uint64_t throw_iterations = 100000;
+
+   ///<summary> a replica of error::context as it was before lazy formatting (the "before" measurement).</summary>
+   ///<remarks> the system error text, file and function names are copied, and the full description built, at construction.</remarks>
+   class eager_context : public std::exception
+   {
+   public:
+      eager_context(const char* a_path, int a_line, const char* a_func, const char* a_what) :
+         std::exception(a_what),
+         m_file(get_short_file(a_path)),
+         m_line(a_line),
+         m_func(a_func),
+         m_reason(SystemError().get_error_text())
+      {
+         m_full_what = logging::decorate_error_context(m_file, m_line, m_func, std::exception::what(), m_reason);
+      }
+
+      const char* full_what() const noexcept
+      {
+         return m_full_what.c_str();
+      }
+
+   private:
+      const std::string m_file;
+      const int m_line;
+      const std::string m_func;
+      const std::string m_reason;
+      std::string m_full_what;
+   };
+
+   ///<summary> throw (with a typical system error pending) and catch an eager_context.</summary>
+   void throw_eager(bool use_full_what)
+   {
+      try
+      {
+         SetLastError(ERROR_FILE_NOT_FOUND);
+         throw eager_context(__FILE__, __LINE__, __FUNCTION__, "simulated failure");
+      }
+      catch (const eager_context& e)
+      {
+         benchmark::keep(use_full_what ? e.full_what() : e.what());
+      }
+   }
+
+   ///<summary> throw (with a typical system error pending) and catch an error::context.</summary>
+   void throw_lazy(bool use_full_what)
+   {
+      try
+      {
+         SetLastError(ERROR_FILE_NOT_FOUND);
+         throw error_context("simulated failure");
+      }
+      catch (const error::context& e)
+      {
+         benchmark::keep(use_full_what ? e.full_what() : e.what());
+      }
+   }
+}
+
+///<summary> error::context throw and catch cost (eager formatting before, lazy formatting after).</summary>
+std::vector<benchmark::result> benchmark::error_context_benchmarks()
+{
+   return
+   {
+      measure("throw/catch error::context (before: eager)", throw_iterations, [] { throw_eager(false); }),
+      measure("throw/catch error::context (after: lazy)", throw_iterations, [] { throw_lazy(false); }),
+      measure("throw/catch + full_what() (before: eager)", throw_iterations, [] { throw_eager(true); }),
+      measure("throw/catch + full_what() (after: lazy, cached text)", throw_iterations, [] { throw_lazy(true); })
+   };
+}
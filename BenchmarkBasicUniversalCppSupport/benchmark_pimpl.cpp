@@ -0,0 +1,108 @@
+//
+// benchmark_pimpl.cpp : measures the cost of constructing and copying pimpl objects (heap vs in place storage)
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+namespace
+{
+   constexpr std::uint64_t pimpl_iterations = 10000000;
+
+   ///<summary> a typical small private implementation (an error code and a handle, like SystemError and Device).</summary>
+   struct payload
+   {
+      int code;
+      void* handle;
+
+      payload(int a_code) noexcept :
+         code(a_code),
+         handle(nullptr)
+      {
+      }
+   };
+
+   ///<summary> a pimpl object using heap storage (spimpl::impl_ptr, the "before" measurement).</summary>
+   class heap_pimpl
+   {
+   public:
+      heap_pimpl(int code) :
+         pimpl(spimpl::make_impl<payload>(code))
+      {
+      }
+
+      int get_code() const noexcept
+      {
+         return pimpl->code;
+      }
+
+   private:
+      spimpl::impl_ptr<payload> pimpl;
+   };
+
+   ///<summary> a pimpl object using in place storage (spimpl::fast_impl_ptr, the "after" measurement).</summary>
+   class in_place_pimpl
+   {
+   public:
+      in_place_pimpl(int code) noexcept :
+         pimpl(std::in_place, code)
+      {
+      }
+
+      int get_code() const noexcept
+      {
+         return pimpl->code;
+      }
+
+   private:
+      spimpl::fast_impl_ptr<payload, 2 * sizeof(void*)> pimpl;
+   };
+
+   ///<summary> the error code a pimpl object is constructed with (read at run time, as a real error code would be, so
+   /// that the construction can't be folded into a constant).</summary>
+   volatile int error_code = ERROR_FILE_NOT_FOUND;
+
+   ///<summary> construct (and destroy) a pimpl object.</summary>
+   template<typename Pimpl>
+   void construct() 
+   {
+      const Pimpl constructed(error_code);
+      benchmark::keep(constructed);
+   }
+
+   ///<summary> copy (and destroy) a pimpl object.</summary>
+   template<typename Pimpl>
+   void copy(const Pimpl& original)
+   {
+      const Pimpl copied(original);
+      benchmark::keep(copied);
+   }
+}
+
+///<summary> pimpl construction and copy cost (heap storage before, in place storage after).</summary>
+std::vector<benchmark::result> benchmark::pimpl_benchmarks()
+{
+   const heap_pimpl heap_original(ERROR_FILE_NOT_FOUND);
+   const in_place_pimpl in_place_original(ERROR_FILE_NOT_FOUND);
+
+   return
+   {
+      measure("construct pimpl (before: spimpl::impl_ptr, heap)", pimpl_iterations, [] { construct<heap_pimpl>(); }),
+      measure("construct pimpl (after: spimpl::fast_impl_ptr, in place)", pimpl_iterations, [] { construct<in_place_pimpl>(); }),
+      measure("copy pimpl (before: spimpl::impl_ptr, heap)", pimpl_iterations, [&] { copy(heap_original); }),
+      measure("copy pimpl (after: spimpl::fast_impl_ptr, in place)", pimpl_iterations, [&] { copy(in_place_original); })
+   };
+}
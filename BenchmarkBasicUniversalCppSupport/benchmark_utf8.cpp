@@ -0,0 +1,180 @@
+﻿//
+// benchmark_utf8.cpp : utf8 conversion, scanning, trimming and guid conversion throughput
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <array>
+#include <span>
+
+namespace
+{
+   ///<summary> the corpus sizes (in utf8 bytes), from 16 B to 64 MB.</summary>
+   constexpr std::array<std::size_t, 7> corpus_sizes = { 16, 256, 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024 };
+
+   ///<summary> a benchmark corpus (a sample of text, repeated to the size wanted).</summary>
+   struct corpus
+   {
+      std::string name;
+      std::string sample;
+      bool ill_formed;     // the corpus ends with an ill formed sequence (so that conversion fails, after scanning all of it)
+   };
+
+   ///<summary> the corpora: 1 byte (ASCII), 2 byte (mixed Greek, as in SampleProgram), 3 byte (CJK) and 4 byte (emoji) text,
+   /// and ill formed text.</summary>
+   const std::vector<corpus>& corpora()
+   {
+      static const std::vector<corpus> all =
+      {
+         { "ascii", "The quick brown fox jumps over the lazy dog. ", false },
+         { "greek", U8("Γειά σας Κόσμε! "), false },
+         { "cjk", U8("你好，世界。こんにちは世界。"), false },
+         { "emoji", U8("😀😃😄😁🚀🌍🎉 "), false },
+         { "invalid", U8("Γειά σας Κόσμε! "), true }
+      };
+      return all;
+   }
+
+   ///<summary> build utf8 text of (about) the size wanted, without splitting a code point.</summary>
+   std::string make_utf8(const corpus& source, std::size_t size)
+   {
+      std::string text;
+      text.reserve(size + source.sample.size());
+      while (text.size() < size)
+      {
+         text.append(source.sample);
+      }
+
+      if (source.ill_formed)
+      {
+         // end with an overlong (ill formed) encoding of U+0000
+         text.resize(utf8::truncate_bytes(text, size - 2).size());
+         text.append("\xC0\x80");
+      }
+      else
+      {
+         text.resize(utf8::truncate_bytes(text, size).size());
+      }
+      return text;
+   }
+
+   ///<summary> build the utf16 equivalent of utf8 text (ending with an unpaired surrogate, if the corpus is ill formed).</summary>
+   std::wstring make_utf16(const corpus& source, const std::string& utf8_text)
+   {
+      if (source.ill_formed)
+      {
+         return utf8::convert::to_utf16(std::string_view(utf8_text).substr(0, utf8_text.size() - 2)).append(1, L'\xDC00');
+      }
+      return utf8::convert::to_utf16(utf8_text);
+   }
+
+   ///<summary> run a conversion (ill formed corpora are expected to fail).</summary>
+   template<typename Conversion>
+   void convert(const corpus& source, Conversion&& conversion)
+   {
+      try
+      {
+         benchmark::keep(conversion());
+      }
+      catch (const utf8::conversion_error&)
+      {
+         if (!source.ill_formed)
+         {
+            throw;
+         }
+      }
+   }
+
+   ///<summary> measure each operation with one corpus, at one size.</summary>
+   void corpus_benchmarks(std::vector<benchmark::result>& results, const corpus& source, std::size_t size)
+   {
+      using benchmark::measure_throughput;
+
+      const std::string utf8_text = make_utf8(source, size);
+      const std::string label = "/" + source.name + "/" + std::to_string(size);
+
+      results.push_back(measure_throughput("to_utf16" + label, utf8_text.size(), [&]
+      {
+         convert(source, [&] { return utf8::convert::to_utf16(utf8_text); });
+      }));
+
+      {
+         std::vector<wchar_t> buffer(utf8::transcode::max_utf16_length(utf8_text.size()));
+         results.push_back(measure_throughput("to_utf16 (buffer)" + label, utf8_text.size(), [&]
+         {
+            convert(source, [&] { return utf8::convert::to_utf16(utf8_text, std::span<wchar_t>(buffer)); });
+         }));
+      }
+
+      results.push_back(measure_throughput("count_codepoints" + label, utf8_text.size(), [&]
+      {
+         benchmark::keep(utf8::count_codepoints(utf8_text));
+      }));
+
+      results.push_back(measure_throughput("validate" + label, utf8_text.size(), [&]
+      {
+         benchmark::keep(utf8::scan::validate(utf8_text.data(), utf8_text.size()));
+      }));
+
+      {
+         // trim (copying) text with leading and trailing white space
+         const std::string padded = "  \t " + utf8_text + " \r\n ";
+         results.push_back(measure_throughput("ltrim" + label, padded.size(), [&] { benchmark::keep(ltrim_copy(padded)); }));
+         results.push_back(measure_throughput("rtrim" + label, padded.size(), [&] { benchmark::keep(rtrim_copy(padded)); }));
+         results.push_back(measure_throughput("trim" + label, padded.size(), [&] { benchmark::keep(trim_copy(padded)); }));
+      }
+
+      {
+         const std::wstring utf16_text = make_utf16(source, utf8_text);
+         const std::uint64_t utf16_bytes = utf16_text.size() * sizeof(wchar_t);
+
+         results.push_back(measure_throughput("from_utf16" + label, utf16_bytes, [&]
+         {
+            convert(source, [&] { return utf8::convert::from_utf16(utf16_text); });
+         }));
+
+         std::vector<char> buffer(utf8::transcode::max_utf8_length(utf16_text.size()));
+         results.push_back(measure_throughput("from_utf16 (buffer)" + label, utf16_bytes, [&]
+         {
+            convert(source, [&] { return utf8::convert::from_utf16(utf16_text, std::span<char>(buffer)); });
+         }));
+      }
+   }
+}
+
+///<summary> utf8 conversion, scanning, trimming and guid conversion throughput (by corpus and size).</summary>
+///<remarks> throughput is in input bytes (utf16 input is 2 bytes per code unit). The largest corpora need about 0.5 GB of memory.</remarks>
+std::vector<benchmark::result> benchmark::utf8_benchmarks()
+{
+   std::vector<result> results;
+
+   for (const auto& source : corpora())
+   {
+      for (const auto size : corpus_sizes)
+      {
+         corpus_benchmarks(results, source, size);
+      }
+   }
+
+   const GUID guid = { 0x53f56308L, 0xb6bf, 0x11d0, { 0x94, 0xf2, 0x00, 0xa0, 0xc9, 0x1e, 0xfb, 0x8b } };
+   const std::string guid_text = utf8::guid_convert::from_guid(guid);
+
+   results.push_back(measure_throughput("guid_convert::from_guid", guid_text.size(), [&] { keep(utf8::guid_convert::from_guid(guid)); }));
+   results.push_back(measure_throughput("guid_convert::to_guid", guid_text.size(), [&] { keep(utf8::guid_convert::to_guid(guid_text)); }));
+
+   return results;
+}
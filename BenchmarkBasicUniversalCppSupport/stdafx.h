@@ -0,0 +1,37 @@
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+#ifndef __STDAFX_H__
+#define __STDAFX_H__
+
+// add check for tools limitations (clang support) with impact on build preferences
+#include "toolsver.h"
+
+#include "targetver.h"
+
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
+#include <windows.h>
+
+#include <stdio.h>
+#include <tchar.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Additional headers program requires are here...
+
+#include "error_context.hpp"
+#include "fast_pimpl.hpp"
+#include "logger.hpp"
+#include "spimpl.hpp"
+#include "system_error.hpp"
+#include "utc_timestamp.hpp"
+#include "utf8_console.hpp"
+#include "utf8_convert.hpp"
+#include "utf8_guid.hpp"
+
+#include "benchmark.hpp"
+
+#endif // __STDAFX_H__
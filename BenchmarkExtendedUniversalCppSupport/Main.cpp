@@ -0,0 +1,90 @@
+//
+// main.cpp : Defines the entry point for the BenchmarkExtendedUniversalCppSupport console application.
+//
+// Measures the throughput of DeviceReadQueue with each backend (synchronous reads, and io_uring where the system has
+// it), reading an image file and the same image attached to a loop device. Build Release for meaningful figures.
+//
+// Usage: BenchmarkExtendedUniversalCppSupport [--csv] [--size <MiB>]
+//
+//   --csv    report comma separated values (one line per benchmark, after a header line), for regression tracking.
+//   --size   the size of the image read (64 MiB by default).
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+///<summary> *** PROGRAM ENTRYPOINT ***.</summary>
+///<param name='argc'> the number of command line arguments.</param>
+///<param name='argv'> the command line arguments (see Usage).</param>
+///<returns> exit code EXIT_SUCCESS if all benchmarks ran, or exit code EXIT_FAILURE if an error occurred.</returns>
+int main(int argc, char* argv[])
+{
+   try
+   {
+      utf8::console::configure_codepage();
+
+      bool csv = false;
+      std::uint64_t image_size = benchmark::default_image_size;
+      for (int arg = 1; arg < argc; arg++)
+      {
+         const std::string option(argv[arg]);
+         if (option == "--csv")
+         {
+            csv = true;
+         }
+         else if ((option == "--size") && (arg + 1 < argc) && (std::stoul(argv[arg + 1]) > 0))
+         {
+            image_size = std::stoul(argv[++arg]) * 1024ull * 1024;
+         }
+         else
+         {
+            std::cerr << "Usage: BenchmarkExtendedUniversalCppSupport [--csv] [--size <MiB>]" << std::endl;
+            return EXIT_FAILURE;
+         }
+      }
+
+      const auto report = [csv](const std::vector<benchmark::result>& results)
+      {
+         for (const auto& measured : results)
+         {
+            if (csv)
+            {
+               benchmark::report_csv(std::cout, measured);
+            }
+            else
+            {
+               benchmark::report(std::cout, measured);
+            }
+         }
+      };
+
+      if (csv)
+      {
+         benchmark::report_csv_header(std::cout);
+      }
+      report(benchmark::device_read_queue_benchmarks(image_size));
+      return EXIT_SUCCESS;
+   }
+   catch (const error::context& e)
+   {
+      std::cerr << "Benchmark failed. " << e.full_what() << std::endl;
+   }
+   catch (const std::exception& e)
+   {
+      std::cerr << "Benchmark failed. " << e.what() << std::endl;
+   }
+   return EXIT_FAILURE;
+}
@@ -0,0 +1,239 @@
+//
+// benchmark_device_read_queue.cpp : measures DeviceReadQueue throughput (synchronous reads vs io_uring)
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <system_error>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/loop.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+   ///<summary> the read sizes measured (a sector run, a typical transfer, and a large transfer).</summary>
+   constexpr std::uint32_t read_sizes[] = { 4096, 65536, 1048576 };
+
+   ///<summary> an image file (of patterned content) in the temporary directory, deleted on destruction.</summary>
+   class image_file
+   {
+   public:
+      ///<summary> create the image file.</summary>
+      ///<param name='size'> the file size in bytes.</param>
+      explicit image_file(std::uint64_t size) :
+         path(to_utf8(std::filesystem::temp_directory_path() / "BenchmarkDeviceReadQueue.iso"))
+      {
+         std::vector<char> chunk(1024 * 1024);
+         for (std::size_t index = 0; index < chunk.size(); index++)
+         {
+            chunk[index] = static_cast<char>(index * 31 + 7);
+         }
+
+         std::ofstream file(to_path(path), std::ios::binary | std::ios::trunc);
+         for (std::uint64_t written = 0; written < size; written += chunk.size())
+         {
+            file.write(chunk.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(chunk.size(), size - written)));
+         }
+         if (!file)
+         {
+            throw error_context("the benchmark image file could not be written");
+         }
+      }
+
+      image_file(const image_file& other) = delete;
+      image_file& operator=(const image_file& other) = delete;
+
+      ~image_file()
+      {
+         DeviceHandlePool::retire(path);
+         DeviceHandlePool::close_idle();
+         std::error_code error;
+         std::filesystem::remove(to_path(path), error);
+      }
+
+      ///<summary> the (utf8 encoded) path of the file.</summary>
+      const std::string path;
+
+   private:
+      static std::filesystem::path to_path(const std::string& utf8_path)
+      {
+         return std::filesystem::path(std::u8string(utf8_path.begin(), utf8_path.end()));
+      }
+
+      static std::string to_utf8(const std::filesystem::path& a_path)
+      {
+         const std::u8string utf8_path = a_path.u8string();
+         return std::string(utf8_path.begin(), utf8_path.end());
+      }
+   };
+
+#ifdef __linux__
+   ///<summary> a file attached to a free loop device (a block device backed by the file), detached on destruction.</summary>
+   ///<remarks> needs the right to attach loop devices (E.g. root).</remarks>
+   class loop_device
+   {
+   public:
+      ///<summary> attach a file to a free loop device.</summary>
+      ///<param name='file_path'> the file.</param>
+      ///<exception cref='std::exception'> if the file could not be attached.</exception>
+      explicit loop_device(const std::string& file_path)
+      {
+         const int control = ::open("/dev/loop-control", O_RDWR | O_CLOEXEC);
+         if (control == -1)
+         {
+            throw error_context("open(\"/dev/loop-control\", ...) failed");
+         }
+         const int number = ::ioctl(control, LOOP_CTL_GET_FREE);
+         ::close(control);
+         if (number == -1)
+         {
+            throw error_context("there is no free loop device");
+         }
+
+         path = "/dev/loop" + std::to_string(number);
+         loop_fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+         if (loop_fd == -1)
+         {
+            throw error_context("the loop device could not be opened");
+         }
+
+         const int file_fd = ::open(file_path.c_str(), O_RDWR | O_CLOEXEC);
+         const bool attached = (file_fd != -1) && (::ioctl(loop_fd, LOOP_SET_FD, file_fd) == 0);
+         if (!attached)
+         {
+            const int error = errno;
+            if (file_fd != -1)
+            {
+               ::close(file_fd);
+            }
+            ::close(loop_fd);
+            errno = error;
+            throw error_context("the file could not be attached to the loop device");
+         }
+         ::close(file_fd);    // (the loop device holds its own reference)
+      }
+
+      loop_device(const loop_device& other) = delete;
+      loop_device& operator=(const loop_device& other) = delete;
+
+      ~loop_device()
+      {
+         DeviceHandlePool::retire(path);
+         DeviceHandlePool::close_idle();
+         ::ioctl(loop_fd, LOOP_CLR_FD, 0);
+         ::close(loop_fd);
+      }
+
+      ///<summary> the path of the loop device (E.g. /dev/loop0).</summary>
+      std::string path;
+
+   private:
+      int loop_fd = -1;
+   };
+#endif
+
+   ///<summary> get the name of a backend (as reported).</summary>
+   std::string backend_name(DeviceReadQueue::Backend aBackend)
+   {
+      return (aBackend == DeviceReadQueue::Backend::io_uring) ? "io_uring" : "synchronous";
+   }
+
+   ///<summary> get the name of a caching mode (as reported).</summary>
+   std::string caching_name(DeviceHandlePool::caching a_caching)
+   {
+      return (a_caching == DeviceHandlePool::caching::unbuffered) ? "unbuffered" : "buffered";
+   }
+
+   ///<summary> get the name of a read size (as reported).</summary>
+   std::string size_name(std::uint32_t cbySize)
+   {
+      return (cbySize >= 1048576) ? std::to_string(cbySize / 1048576) + "MiB" : std::to_string(cbySize / 1024) + "KiB";
+   }
+
+   ///<summary> time reading the whole of a device with each backend, caching mode and read size.</summary>
+   ///<param name='results'> receives the results.</param>
+   ///<param name='target'> the name of the device (as reported).</param>
+   ///<param name='device_path'> the device (or image file).</param>
+   ///<param name='size'> the size of the device in bytes.</param>
+   void measure_reads(std::vector<benchmark::result>& results, const std::string& target, const std::string& device_path, std::uint64_t size)
+   {
+      for (const auto caching : { DeviceHandlePool::caching::buffered, DeviceHandlePool::caching::unbuffered })
+      {
+         for (const auto cbyReadSize : read_sizes)
+         {
+            for (const auto backend : { DeviceReadQueue::Backend::synchronous, DeviceReadQueue::Backend::io_uring })
+            {
+               DeviceReadQueue queue(device_path, cbyReadSize, DeviceReadQueue::default_depth, backend, caching);
+               if (queue.get_backend() != backend)
+               {
+                  static bool reported = false;
+                  if (!reported)
+                  {
+                     std::cerr << "io_uring is not available here, so it was not measured" << std::endl;
+                     reported = true;
+                  }
+                  continue;
+               }
+
+               const std::string name = "DeviceReadQueue/" + target + "/" + backend_name(backend) + "/" + caching_name(caching) + "/" + size_name(cbyReadSize);
+               results.push_back(benchmark::measure_throughput(name, size, [&queue, size]()
+                  {
+                     const auto cbyRead = queue.read(0, size, [](const void* lpData, std::uint32_t) { benchmark::keep(lpData); });
+                     if (cbyRead != size)
+                     {
+                        throw error_context("the device was not read to the end");
+                     }
+                  }));
+            }
+         }
+      }
+   }
+}
+
+std::vector<benchmark::result> benchmark::device_read_queue_benchmarks(std::uint64_t image_size)
+{
+   std::vector<result> results;
+
+   const image_file image(image_size);
+   measure_reads(results, "image", image.path, image_size);
+
+#ifdef __linux__
+   std::optional<loop_device> loop;
+   try
+   {
+      loop.emplace(image.path);
+   }
+   catch (const std::exception& e)
+   {
+      std::cerr << "the loop device was not measured (" << e.what() << ")" << std::endl;
+   }
+   if (loop)
+   {
+      measure_reads(results, "loop", loop->path, image_size);
+   }
+#endif
+
+   return results;
+}
@@ -0,0 +1,39 @@
+//
+// benchmark_extended.hpp : the ExtendedUniversalCppSupport benchmarks (timed with benchmark.hpp)
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __BENCHMARK_EXTENDED_HPP__
+#define __BENCHMARK_EXTENDED_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace benchmark
+{
+   ///<summary> the default size of the image read by device_read_queue_benchmarks.</summary>
+   constexpr std::uint64_t default_image_size = 64ull * 1024 * 1024;
+
+   ///<summary> DeviceReadQueue throughput, synchronous (pread) against io_uring, by caching mode and read size.</summary>
+   ///<remarks> an image file is read, and then (on Linux, with the right to attach loop devices) the same image
+   /// attached to a loop device.</remarks>
+   ///<param name='image_size'> the image size in bytes (a multiple of 1 MiB).</param>
+   std::vector<result> device_read_queue_benchmarks(std::uint64_t image_size);
+}
+
+#endif // __BENCHMARK_EXTENDED_HPP__
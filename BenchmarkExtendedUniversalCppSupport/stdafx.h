@@ -0,0 +1,22 @@
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+#ifndef __STDAFX_H__
+#define __STDAFX_H__
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "error_context.hpp"
+#include "logger.hpp"
+#include "utf8_console.hpp"
+
+#include "device_handle_pool.hpp"
+#include "device_read_queue.hpp"
+
+#include "benchmark_extended.hpp"
+
+#endif // __STDAFX_H__
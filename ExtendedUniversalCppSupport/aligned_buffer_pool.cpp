@@ -0,0 +1,196 @@
+//
+// aligned_buffer_pool.cpp : a pool of reusable, aligned i/o buffers
+//
+// A handed out buffer holds the pool implementation (weakly), so its deleter can return the buffer to
+// the pool while the pool lives, and otherwise frees it.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "aligned_buffer_pool.hpp"
+
+///<summary> true if a value is a (non zero) power of 2.</summary>
+static constexpr bool is_power_of_2(std::size_t value) noexcept
+{
+   return (value != 0) && ((value & (value - 1)) == 0);
+}
+
+///<summary> round a size up to a multiple of a granularity.</summary>
+static constexpr std::size_t round_up(std::size_t size, std::size_t granularity) noexcept
+{
+   return ((size + granularity - 1) / granularity) * granularity;
+}
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of AlignedBufferPool class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of AlignedBufferPool.</summary>
+class AlignedBufferPool::impl : public std::enable_shared_from_this<AlignedBufferPool::impl>
+{
+private:
+   std::size_t buffer_size;
+   std::size_t alignment;
+   std::size_t max_idle;
+
+   ///<summary> guards idle.</summary>
+   mutable std::mutex mutex;
+
+   ///<summary> the released buffers kept for reuse.</summary>
+   std::vector<unsigned char*> idle;
+
+   ///<summary> free a buffer.</summary>
+   static void free_buffer(unsigned char* lpBuffer, std::size_t cbyAlignment) noexcept
+   {
+      ::operator delete[](lpBuffer, std::align_val_t(cbyAlignment));
+   }
+
+   ///<summary> return a buffer to the pool (called as a handed out buffer is released), or free it if the pool is full.</summary>
+   void release(unsigned char* lpBuffer) noexcept
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         if (idle.size() < max_idle)
+         {
+            idle.push_back(lpBuffer);     // (capacity is reserved for max_idle, so this does not allocate)
+            return;
+         }
+      }
+      free_buffer(lpBuffer, alignment);
+   }
+
+public:
+   impl(std::size_t cbyBufferSize, std::size_t cbyAlignment, std::size_t a_max_idle) :
+      buffer_size(0),
+      alignment(cbyAlignment),
+      max_idle(a_max_idle),
+      idle()
+   {
+      if (!is_power_of_2(cbyAlignment))
+      {
+         throw error_context("buffer alignment is not a power of 2");
+      }
+      buffer_size = round_up(std::max<std::size_t>(cbyBufferSize, 1), alignment);
+      idle.reserve(max_idle);
+   }
+
+   impl(const impl& other) = delete;
+   impl& operator=(const impl& other) = delete;
+
+   ///<summary> destructor frees the idle buffers (handed out buffers are freed as they are released).</summary>
+   ~impl()
+   {
+      for (auto* lpBuffer : idle)
+      {
+         free_buffer(lpBuffer, alignment);
+      }
+   }
+
+   buffer acquire()
+   {
+      unsigned char* lpBuffer = nullptr;
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         if (!idle.empty())
+         {
+            lpBuffer = idle.back();
+            idle.pop_back();
+         }
+      }
+
+      if (lpBuffer == nullptr)
+      {
+         lpBuffer = static_cast<unsigned char*>(::operator new[](buffer_size, std::align_val_t(alignment)));
+      }
+
+      // (if the buffer can't be handed out, the deleter is called, so the buffer is still released)
+      const std::size_t cbyAlignment = alignment;
+      return buffer(lpBuffer, [pool = weak_from_this(), cbyAlignment](unsigned char* lpReleased)
+         {
+            if (const auto live_pool = pool.lock())
+            {
+               live_pool->release(lpReleased);
+            }
+            else
+            {
+               free_buffer(lpReleased, cbyAlignment);
+            }
+         });
+   }
+
+   std::size_t get_buffer_size() const noexcept
+   {
+      return buffer_size;
+   }
+
+   std::size_t get_alignment() const noexcept
+   {
+      return alignment;
+   }
+
+   std::size_t get_idle_count() const noexcept
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      return idle.size();
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for AlignedBufferPool implementation
+* ***************************************************************************
+*/
+
+AlignedBufferPool::AlignedBufferPool(std::size_t cbyBufferSize, std::size_t cbyAlignment, std::size_t max_idle) :
+   pimpl(std::make_shared<impl>(cbyBufferSize, cbyAlignment, max_idle))
+{
+}
+
+AlignedBufferPool::AlignedBufferPool(const DeviceCapabilities& capabilities, std::size_t cbyBufferSize, std::size_t max_idle) :
+   AlignedBufferPool(round_up(std::max<std::size_t>(cbyBufferSize, 1), std::max<std::size_t>(capabilities.physical_sector_size, 1)),
+      std::max<std::size_t>(capabilities.buffer_alignment, capabilities.physical_sector_size), max_idle)
+{
+}
+
+AlignedBufferPool::buffer AlignedBufferPool::acquire()
+{
+   return pimpl->acquire();
+}
+
+std::size_t AlignedBufferPool::get_buffer_size() const noexcept
+{
+   return pimpl->get_buffer_size();
+}
+
+std::size_t AlignedBufferPool::get_alignment() const noexcept
+{
+   return pimpl->get_alignment();
+}
+
+std::size_t AlignedBufferPool::get_idle_count() const noexcept
+{
+   return pimpl->get_idle_count();
+}
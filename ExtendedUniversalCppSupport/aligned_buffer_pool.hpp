@@ -0,0 +1,89 @@
+//
+// aligned_buffer_pool.hpp : a pool of reusable, aligned i/o buffers
+//
+// Unbuffered i/o (which bypasses the system cache) needs buffers aligned to the sector size, and bulk
+// transfers need many buffers of the same size, one after another. Here buffers are allocated aligned
+// once, and returned to the pool (rather than freed) when released, so that a transfer loop allocates
+// nothing after its first few buffers.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __ALIGNED_BUFFER_POOL_HPP__
+#define __ALIGNED_BUFFER_POOL_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstddef>
+#include <memory>
+
+#include "device.hpp"
+
+///<summary> hands out aligned buffers of one size, and reuses them once released.</summary>
+///<remarks> safe to use from any thread. Copies share the same pool, and a buffer released after the last copy of
+/// its pool has gone is simply freed.</remarks>
+class AlignedBufferPool
+{
+public:
+   ///<summary> an aligned buffer (of get_buffer_size bytes). The buffer returns to the pool when the last copy is released.</summary>
+   using buffer = std::shared_ptr<unsigned char>;
+
+   ///<summary> the most released buffers kept for reuse (by default).</summary>
+   static constexpr std::size_t default_max_idle = 4;
+
+   ///<summary> construct a pool of buffers.</summary>
+   ///<param name='cbyBufferSize'> the size of each buffer (rounded up to a multiple of the alignment).</param>
+   ///<param name='cbyAlignment'> the alignment of each buffer (a power of 2).</param>
+   ///<param name='max_idle'> the most released buffers kept for reuse (the rest are freed).</param>
+   ///<exception cref='std::exception'> if the alignment is not a power of 2.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API AlignedBufferPool(std::size_t cbyBufferSize, std::size_t cbyAlignment, std::size_t max_idle = default_max_idle);
+
+   ///<summary> construct a pool of buffers suited to a device (aligned for unbuffered i/o, and sized in physical sectors).</summary>
+   ///<param name='capabilities'> the capabilities of the device (see Device::get_capabilities).</param>
+   ///<param name='cbyBufferSize'> the size of each buffer (rounded up to a multiple of the physical sector size, and of the alignment).</param>
+   ///<param name='max_idle'> the most released buffers kept for reuse.</param>
+   ///<exception cref='std::exception'> if the capabilities are not usable (E.g. an alignment that is not a power of 2).</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API AlignedBufferPool(const DeviceCapabilities& capabilities, std::size_t cbyBufferSize, std::size_t max_idle = default_max_idle);
+
+   ///<summary> get a buffer, reusing a released buffer if there is one.</summary>
+   ///<returns> the buffer (its content is whatever it last held).</returns>
+   ///<exception cref='std::bad_alloc'> if a new buffer could not be allocated.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API buffer acquire();
+
+   ///<summary> get the size of each buffer.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::size_t get_buffer_size() const noexcept;
+
+   ///<summary> get the alignment of each buffer.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::size_t get_alignment() const noexcept;
+
+   ///<summary> get the number of released buffers kept for reuse.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::size_t get_idle_count() const noexcept;
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> shared pointer to private implementation.</summary>
+   ///<remarks> shared with the copies of this pool, and with the buffers it has handed out.</remarks>
+   std::shared_ptr<impl> pimpl;
+};
+
+#endif // __ALIGNED_BUFFER_POOL_HPP__
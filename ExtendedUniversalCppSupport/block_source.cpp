@@ -0,0 +1,454 @@
+//
+// block_source.cpp : a readable image of fixed size sectors, wherever it is held
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <mutex>
+
+#ifndef _WIN32
+#include <cerrno>
+#endif
+
+#include "block_source.hpp"
+#include "device_read_queue.hpp"
+#include "file_transfer.hpp"
+
+///<summary> the reads queued at once by an ImageFileBlockSource.</summary>
+constexpr std::uint32_t image_file_queue_depth = 4;
+
+///<summary> get the size of the largest read of whole sectors allowed by some capabilities.</summary>
+static std::uint64_t get_transfer_size(const DeviceCapabilities& capabilities) noexcept
+{
+   const std::uint64_t cbySectorSize = std::max<std::uint64_t>(capabilities.physical_sector_size, 1);
+   const std::uint64_t cSectorsPerTransfer = std::max<std::uint64_t>(capabilities.max_transfer_size / cbySectorSize, 1);
+   return cSectorsPerTransfer * cbySectorSize;
+}
+
+///<summary> get the capabilities of a source that is not a device (only the sector size matters).</summary>
+static DeviceCapabilities get_memory_capabilities(std::uint32_t cbySectorSize) noexcept
+{
+   const std::uint32_t cbyTransferSize = std::max(BlockSource::default_transfer_size, cbySectorSize);
+   return DeviceCapabilities{ cbyTransferSize, 1, std::max<std::uint32_t>(cbySectorSize, 1), false };
+}
+
+///<summary> report a source that ended before the image was read.</summary>
+static error::code unexpected_end() noexcept
+{
+#ifdef _WIN32
+   SetLastError(ERROR_HANDLE_EOF);
+#else
+   errno = ENODATA;
+#endif
+   return error_code_context("Unexpected end of source");
+}
+
+
+/*
+* ***************************************************************************
+* BlockSource - public members, forwarding to the implementation
+* ***************************************************************************
+*/
+
+std::uint64_t BlockSource::get_size() const
+{
+   return size().value();
+}
+
+error::expected<std::uint64_t> BlockSource::get_size(std::nothrow_t) const noexcept
+{
+   return size();
+}
+
+DeviceCapabilities BlockSource::get_capabilities() const noexcept
+{
+   return capabilities();
+}
+
+std::uint32_t BlockSource::get_sector_size() const noexcept
+{
+   return std::max<std::uint32_t>(capabilities().physical_sector_size, 1);
+}
+
+std::uint32_t BlockSource::read_at(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const
+{
+   return read(cbyOffset, span).value();
+}
+
+error::expected<std::uint32_t> BlockSource::read_at(std::nothrow_t, std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   return read(cbyOffset, span);
+}
+
+void BlockSource::read_image(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const
+{
+   read_whole(span, a_progress).value();
+}
+
+error::expected<void> BlockSource::read_image(std::nothrow_t, gsl::span<unsigned char> span, std::atomic<int>& a_progress) const noexcept
+{
+   return read_whole(span, a_progress);
+}
+
+error::expected<void> BlockSource::read_whole(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const noexcept
+{
+   a_progress = 0;
+   const std::uint64_t cbyTransferSize = get_transfer_size(capabilities());
+   const std::uint64_t cbyImageSize = span.size_bytes();
+
+   std::uint64_t cbyRead = 0;
+   while (cbyRead < cbyImageSize)
+   {
+      const auto cbyToRead = static_cast<std::size_t>(std::min(cbyTransferSize, cbyImageSize - cbyRead));
+      const auto read_now = read(cbyRead, span.subspan(static_cast<std::size_t>(cbyRead), cbyToRead));
+      if (!read_now)
+      {
+         return read_now.error();
+      }
+      if (read_now.value() == 0)
+      {
+         return unexpected_end();
+      }
+      cbyRead += read_now.value();
+      a_progress = static_cast<int>((100 * cbyRead) / cbyImageSize);
+   }
+   a_progress = 100;
+   return {};
+}
+
+
+#ifdef _WIN32
+/*
+* ***************************************************************************
+* CdromBlockSource
+* ***************************************************************************
+*/
+
+CdromBlockSource::CdromBlockSource(const CdromDevice& cdrom) :
+   m_cdrom(cdrom),
+   m_capabilities(cdrom.get_capabilities())
+{
+}
+
+error::expected<std::uint64_t> CdromBlockSource::size() const noexcept
+{
+   return m_cdrom.get_image_size(std::nothrow);
+}
+
+DeviceCapabilities CdromBlockSource::capabilities() const noexcept
+{
+   return m_capabilities;
+}
+
+error::expected<std::uint32_t> CdromBlockSource::read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   return m_cdrom.read_at(std::nothrow, cbyOffset, span);
+}
+
+error::expected<void> CdromBlockSource::read_whole(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const noexcept
+{
+   return m_cdrom.get_image(std::nothrow, span, a_progress);
+}
+#endif // _WIN32
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of ImageFileBlockSource class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of ImageFileBlockSource.</summary>
+class ImageFileBlockSource::impl
+{
+private:
+   std::string file_path;
+   std::uint32_t sector_size;
+   std::uint64_t cbySize;
+
+   ///<summary> guards queue (which reads one range at a time).</summary>
+   mutable std::mutex mutex;
+   mutable DeviceReadQueue queue;
+
+public:
+   impl(const std::string& a_file_path, std::uint32_t cbySectorSize) :
+      file_path(a_file_path),
+      sector_size(std::max<std::uint32_t>(cbySectorSize, 1)),
+      cbySize(FileTransfer::get_size(a_file_path)),
+      queue(a_file_path, BlockSource::default_transfer_size, image_file_queue_depth, DeviceReadQueue::Backend::io_uring,
+         DeviceHandlePool::caching::buffered, DeviceHandlePool::access::read)     // (an image may be read only)
+   {
+   }
+
+   impl(const impl& other) = delete;
+   impl& operator=(const impl& other) = delete;
+
+   const std::string& get_file_path() const noexcept
+   {
+      return file_path;
+   }
+
+   std::uint64_t size() const noexcept
+   {
+      return cbySize;
+   }
+
+   DeviceCapabilities capabilities() const noexcept
+   {
+      return get_memory_capabilities(sector_size);
+   }
+
+   error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+   {
+      if (cbyOffset >= cbySize)
+      {
+         return 0u;
+      }
+
+      // (reads are clipped to the size, so the queue is never asked to read past the end)
+      const std::uint64_t cbyToRead = std::min<std::uint64_t>(span.size_bytes(), cbySize - cbyOffset);
+      std::lock_guard<std::mutex> lock(mutex);
+      const auto read_now = queue.read_into(std::nothrow, cbyOffset, span.data(), cbyToRead);
+      if (!read_now)
+      {
+         return read_now.error();
+      }
+      return static_cast<std::uint32_t>(read_now.value());
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for ImageFileBlockSource implementation
+* ***************************************************************************
+*/
+
+ImageFileBlockSource::ImageFileBlockSource(const std::string& file_path, std::uint32_t cbySectorSize) :
+   pimpl(spimpl::make_unique_impl<impl>(file_path, cbySectorSize))
+{
+}
+
+const std::string& ImageFileBlockSource::get_file_path() const noexcept
+{
+   return pimpl->get_file_path();
+}
+
+error::expected<std::uint64_t> ImageFileBlockSource::size() const noexcept
+{
+   return pimpl->size();
+}
+
+DeviceCapabilities ImageFileBlockSource::capabilities() const noexcept
+{
+   return pimpl->capabilities();
+}
+
+error::expected<std::uint32_t> ImageFileBlockSource::read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   return pimpl->read(cbyOffset, span);
+}
+
+
+/*
+* ***************************************************************************
+* MemoryBlockSource
+* ***************************************************************************
+*/
+
+MemoryBlockSource::MemoryBlockSource(gsl::span<const unsigned char> span, std::uint32_t cbySectorSize) noexcept :
+   m_span(span),
+   m_cbySectorSize(cbySectorSize)
+{
+}
+
+error::expected<std::uint64_t> MemoryBlockSource::size() const noexcept
+{
+   return static_cast<std::uint64_t>(m_span.size_bytes());
+}
+
+DeviceCapabilities MemoryBlockSource::capabilities() const noexcept
+{
+   return get_memory_capabilities(m_cbySectorSize);
+}
+
+error::expected<std::uint32_t> MemoryBlockSource::read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   if (cbyOffset >= m_span.size_bytes())
+   {
+      return 0u;
+   }
+
+   const auto cbyToRead = static_cast<std::size_t>(std::min<std::uint64_t>(span.size_bytes(), m_span.size_bytes() - cbyOffset));
+   const auto source = m_span.subspan(static_cast<std::size_t>(cbyOffset), cbyToRead);
+   std::copy(source.begin(), source.end(), span.begin());
+   return static_cast<std::uint32_t>(cbyToRead);
+}
+
+
+/*
+* ***************************************************************************
+* OffsetBlockSource
+* ***************************************************************************
+*/
+
+OffsetBlockSource::OffsetBlockSource(const BlockSource& base, std::uint64_t cbyOffset, std::uint64_t cbySize) noexcept :
+   m_base(base),
+   m_cbyOffset(cbyOffset),
+   m_cbySize(cbySize)
+{
+}
+
+error::expected<std::uint64_t> OffsetBlockSource::size() const noexcept
+{
+   const auto cbyBaseSize = m_base.get_size(std::nothrow);
+   if (!cbyBaseSize)
+   {
+      return cbyBaseSize.error();
+   }
+   return std::min(m_cbySize, cbyBaseSize.value() - std::min(m_cbyOffset, cbyBaseSize.value()));
+}
+
+DeviceCapabilities OffsetBlockSource::capabilities() const noexcept
+{
+   return m_base.get_capabilities();
+}
+
+error::expected<std::uint32_t> OffsetBlockSource::read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   if (cbyOffset >= m_cbySize)
+   {
+      return 0u;
+   }
+
+   // (the end of the base ends a read too, so the range needs no clipping to it here)
+   const auto cbyToRead = static_cast<std::size_t>(std::min<std::uint64_t>(span.size_bytes(), m_cbySize - cbyOffset));
+   return m_base.read_at(std::nothrow, m_cbyOffset + cbyOffset, span.first(cbyToRead));
+}
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of CompositeBlockSource class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of CompositeBlockSource.</summary>
+class CompositeBlockSource::impl
+{
+private:
+   std::vector<std::reference_wrapper<const BlockSource>> parts;
+
+   ///<summary> where each part starts (and, last, the end of the whole).</summary>
+   std::vector<std::uint64_t> starts;
+
+   ///<summary> the strictest limits of the parts.</summary>
+   DeviceCapabilities merged_capabilities;
+
+public:
+   impl(const std::vector<std::reference_wrapper<const BlockSource>>& a_parts) :
+      parts(a_parts),
+      starts(),
+      merged_capabilities(get_memory_capabilities(BlockSource::default_sector_size))
+   {
+      starts.reserve(parts.size() + 1);
+      starts.push_back(0);
+      for (std::size_t index = 0; index < parts.size(); index++)
+      {
+         const BlockSource& part = parts[index];
+         starts.push_back(starts.back() + part.get_size());
+
+         const DeviceCapabilities capabilities = part.get_capabilities();
+         if (index == 0)
+         {
+            merged_capabilities = capabilities;
+            continue;
+         }
+         merged_capabilities.max_transfer_size = std::min(merged_capabilities.max_transfer_size, capabilities.max_transfer_size);
+         merged_capabilities.buffer_alignment = std::max(merged_capabilities.buffer_alignment, capabilities.buffer_alignment);
+         merged_capabilities.physical_sector_size = std::max(merged_capabilities.physical_sector_size, capabilities.physical_sector_size);
+         merged_capabilities.concurrent_requests = merged_capabilities.concurrent_requests && capabilities.concurrent_requests;
+      }
+   }
+
+   impl(const impl& other) = delete;
+   impl& operator=(const impl& other) = delete;
+
+   std::uint64_t size() const noexcept
+   {
+      return starts.back();
+   }
+
+   DeviceCapabilities capabilities() const noexcept
+   {
+      return merged_capabilities;
+   }
+
+   error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+   {
+      // a read may span parts, so is made a part at a time (starting with the part that holds the offset)
+      auto next_start = std::upper_bound(starts.begin(), starts.end(), cbyOffset);
+      std::size_t cbyRead = 0;
+      while ((cbyRead < span.size_bytes()) && (next_start != starts.end()))
+      {
+         const auto index = static_cast<std::size_t>(std::distance(starts.begin(), next_start) - 1);
+         const std::uint64_t cbyPartOffset = cbyOffset + cbyRead - starts[index];
+         const auto cbyToRead = static_cast<std::size_t>(std::min<std::uint64_t>(span.size_bytes() - cbyRead, *next_start - (cbyOffset + cbyRead)));
+
+         const auto read_now = parts[index].get().read_at(std::nothrow, cbyPartOffset, span.subspan(cbyRead, cbyToRead));
+         if (!read_now)
+         {
+            return read_now.error();
+         }
+         cbyRead += read_now.value();
+         if (read_now.value() < cbyToRead)
+         {
+            break;      // (the part is shorter than it was, so the whole ends here)
+         }
+         ++next_start;
+      }
+      return static_cast<std::uint32_t>(cbyRead);
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for CompositeBlockSource implementation
+* ***************************************************************************
+*/
+
+CompositeBlockSource::CompositeBlockSource(const std::vector<std::reference_wrapper<const BlockSource>>& parts) :
+   pimpl(spimpl::make_unique_impl<impl>(parts))
+{
+}
+
+error::expected<std::uint64_t> CompositeBlockSource::size() const noexcept
+{
+   return pimpl->size();
+}
+
+DeviceCapabilities CompositeBlockSource::capabilities() const noexcept
+{
+   return pimpl->capabilities();
+}
+
+error::expected<std::uint32_t> CompositeBlockSource::read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   return pimpl->read(cbyOffset, span);
+}
@@ -0,0 +1,249 @@
+//
+// block_source.hpp : a readable image of fixed size sectors, wherever it is held
+//
+// Ripping only needs a size, a sector size and positional reads, so the rip pipeline (see Ripper) is written
+// against a BlockSource rather than a CdromDevice. The same pipeline then reads an image file, a memory buffer,
+// or a view made of other sources (E.g. a session within an image, or split image files joined together), so it
+// can be measured and regression tested on a machine with no drive, and reused to convert one image to another.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __BLOCK_SOURCE_HPP__
+#define __BLOCK_SOURCE_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <expected.hpp>
+#include <gsl.hpp>
+#include <spimpl.hpp>
+
+#ifdef _WIN32
+#include "cd_rom_device.hpp"
+#endif
+#include "device.hpp"
+
+///<summary> abstract base class for a readable image (a cdrom, an image file, a memory buffer, or a view of others).</summary>
+///<remarks> the public members are the same for every source, and forward to the (private) virtual members an
+/// implementation overrides. Reads are positional, so a source keeps no file pointer.</remarks>
+class BlockSource
+{
+public:
+   ///<summary> the sector size of an image with no other (a cd or dvd data sector, as in an iso 9660 image).</summary>
+   static constexpr std::uint32_t default_sector_size = 2048;
+
+   ///<summary> the size of the reads made to copy an image from a source with no limits of its own.</summary>
+   static constexpr std::uint32_t default_transfer_size = 1024 * 1024;
+
+   ///<summary> virtual destructor.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API virtual ~BlockSource() = default;
+
+   ///<summary> get the size of the image.</summary>
+   ///<returns> the size in bytes.</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::uint64_t get_size() const;
+
+   ///<summary> get the size of the image, without throwing on failure.</summary>
+   ///<returns> the size in bytes, or the error (E.g. ERROR_NOT_READY when a drive has no media).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> get_size(std::nothrow_t) const noexcept;
+
+   ///<summary> get the limits of reads from the source (sector size, buffer alignment and largest transfer).</summary>
+   ///<remarks> a source that is not a device reports its sector size, no alignment, and default_transfer_size.</remarks>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities get_capabilities() const noexcept;
+
+   ///<summary> get the sector size (reads of a device are sized, and placed, in whole sectors).</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::uint32_t get_sector_size() const noexcept;
+
+   ///<summary> read part of the image.</summary>
+   ///<param name='cbyOffset'> the byte offset to read from (a multiple of the sector size).</param>
+   ///<param name='span'> receives the data (sized in whole sectors).</param>
+   ///<returns> the number of bytes read (fewer than asked for only at the end of the image, 0 past it).</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::uint32_t read_at(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const;
+
+   ///<summary> read part of the image, without throwing on failure.</summary>
+   ///<param name='cbyOffset'> the byte offset to read from (a multiple of the sector size).</param>
+   ///<param name='span'> receives the data (sized in whole sectors).</param>
+   ///<returns> the number of bytes read (fewer than asked for only at the end of the image, 0 past it), or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read_at(std::nothrow_t, std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept;
+
+   ///<summary> read the start of the image into a span (the whole image, for a span of get_size bytes).</summary>
+   ///<remarks> the progress indicator is maintained (as a percentage) during this operation.</remarks>
+   ///<param name='span'> receives the image.</param>
+   ///<param name='a_progress'> reference to where percentage read progress will be maintained.</param>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API void read_image(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const;
+
+   ///<summary> read the start of the image into a span, without throwing on failure.</summary>
+   ///<param name='span'> receives the image.</param>
+   ///<param name='a_progress'> reference to where percentage read progress will be maintained.</param>
+   ///<returns> success, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<void> read_image(std::nothrow_t, gsl::span<unsigned char> span, std::atomic<int>& a_progress) const noexcept;
+
+protected:
+   ///<summary> default constructor.</summary>
+   BlockSource() = default;
+
+   ///<summary> copy constructor.</summary>
+   BlockSource(const BlockSource& other) = default;
+
+   ///<summary> copy assignment operator.</summary>
+   BlockSource& operator=(const BlockSource& other) = default;
+
+private:
+   ///<summary> get the size of the image (see get_size).</summary>
+   virtual error::expected<std::uint64_t> size() const noexcept = 0;
+
+   ///<summary> get the limits of reads from the source (see get_capabilities).</summary>
+   virtual DeviceCapabilities capabilities() const noexcept = 0;
+
+   ///<summary> read part of the image (see read_at).</summary>
+   virtual error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept = 0;
+
+   ///<summary> read the start of the image (see read_image).</summary>
+   ///<remarks> by default, in reads of the largest transfer (so a source only overrides this to read faster).</remarks>
+   EXTENDEDUNIVERSALCPPSUPPORT_API virtual error::expected<void> read_whole(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const noexcept;
+};
+
+#ifdef _WIN32
+///<summary> the media in a cd drive, as a BlockSource.</summary>
+///<remarks> refers to (does not own) the CdromDevice, which must outlive it. A whole image is read by
+/// CdromDevice::get_image (with its queued reads, where the drive supports them).</remarks>
+class CdromBlockSource : public BlockSource
+{
+public:
+   ///<summary> construct a source for the media in a cd drive.</summary>
+   ///<param name='cdrom'> the cd drive (see CdromDevice).</param>
+   ///<exception cref='std::exception'> if the capabilities of the drive could not be found.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API explicit CdromBlockSource(const CdromDevice& cdrom);
+
+private:
+   const CdromDevice& m_cdrom;
+   DeviceCapabilities m_capabilities;
+
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> size() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities capabilities() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<void> read_whole(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const noexcept override;
+};
+#endif // _WIN32 (CdromDevice is Windows only)
+
+///<summary> an image file, as a BlockSource.</summary>
+///<remarks> the size is that of the file when it is opened. The file is opened for reading only, and read through a
+/// DeviceReadQueue (queued, where the system supports it), one read at a time. Not copyable, but movable.</remarks>
+class ImageFileBlockSource : public BlockSource
+{
+public:
+   ///<summary> open an image file.</summary>
+   ///<param name='file_path'> the utf8 path name of the file.</param>
+   ///<param name='cbySectorSize'> the sector size of the image.</param>
+   ///<exception cref='std::exception'> if the file could not be opened.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API explicit ImageFileBlockSource(const std::string& file_path, std::uint32_t cbySectorSize = default_sector_size);
+
+   ///<summary> get the path name of the file.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API const std::string& get_file_path() const noexcept;
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default move support.</remarks>
+   spimpl::unique_impl_ptr<impl> pimpl;
+
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> size() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities capabilities() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept override;
+};
+
+///<summary> a memory buffer, as a BlockSource.</summary>
+///<remarks> refers to (does not own, or copy) the memory, which must outlive it.</remarks>
+class MemoryBlockSource : public BlockSource
+{
+public:
+   ///<summary> construct a source for a memory buffer.</summary>
+   ///<param name='span'> the image.</param>
+   ///<param name='cbySectorSize'> the sector size of the image.</param>
+   EXTENDEDUNIVERSALCPPSUPPORT_API explicit MemoryBlockSource(gsl::span<const unsigned char> span, std::uint32_t cbySectorSize = default_sector_size) noexcept;
+
+private:
+   gsl::span<const unsigned char> m_span;
+   std::uint32_t m_cbySectorSize;
+
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> size() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities capabilities() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept override;
+};
+
+///<summary> a range of another source (E.g. a session, or a partition), as a BlockSource.</summary>
+///<remarks> refers to (does not own) the other source, which must outlive it. The range is clipped to the end of the
+/// other source. Reads are made with the limits of the other source (so the offset is best a whole number of its sectors).</remarks>
+class OffsetBlockSource : public BlockSource
+{
+public:
+   ///<summary> construct a view of a range of another source.</summary>
+   ///<param name='base'> the other source.</param>
+   ///<param name='cbyOffset'> where the range starts in the other source.</param>
+   ///<param name='cbySize'> the size of the range.</param>
+   EXTENDEDUNIVERSALCPPSUPPORT_API OffsetBlockSource(const BlockSource& base, std::uint64_t cbyOffset, std::uint64_t cbySize) noexcept;
+
+private:
+   const BlockSource& m_base;
+   std::uint64_t m_cbyOffset;
+   std::uint64_t m_cbySize;
+
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> size() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities capabilities() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept override;
+};
+
+///<summary> other sources end to end (E.g. an image split over several files), as a BlockSource.</summary>
+///<remarks> refers to (does not own) the other sources, which must outlive it. Their sizes are found once, on
+/// construction. Reads are made with the strictest limits of the other sources. Not copyable, but movable.</remarks>
+class CompositeBlockSource : public BlockSource
+{
+public:
+   ///<summary> construct a source of other sources, end to end.</summary>
+   ///<param name='parts'> the other sources, in order.</param>
+   ///<exception cref='std::exception'> if the size of another source could not be found.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API explicit CompositeBlockSource(const std::vector<std::reference_wrapper<const BlockSource>>& parts);
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default move support.</remarks>
+   spimpl::unique_impl_ptr<impl> pimpl;
+
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> size() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities capabilities() const noexcept override;
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read(std::uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept override;
+};
+
+#endif // __BLOCK_SOURCE_HPP__
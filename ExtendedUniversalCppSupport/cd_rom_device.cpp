@@ -25,19 +25,209 @@
 
 #include "device.hpp"
 #include "cd_rom_device.hpp"
+#include "device_discovery_cache.hpp"
+#include "device_read_queue.hpp"
 #include "logger.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 ///<summary>simulate_resource_limitation</summary>
 ///<remarks>can be used to force multiple smaller reads (which allows for progress tracking)</remarks>
-static void simulate_resource_limitation(void)
+static error::code simulate_resource_limitation(void)
 {
    LOG_WARNING("Simulating a resource limitation"); // TODO: refactor. This works, but its a dirty trick
    SetLastError(ERROR_NO_SYSTEM_RESOURCES);
-   throw std::exception("simulated resource limitation");
+   return error_code_context("simulated resource limitation");
 }
 
+///<summary> check if a read failed only because the system could not resource a read of that size (smaller reads may succeed).</summary>
+static bool is_resource_limitation(const error::expected<void>& result) noexcept
+{
+   return !result && (result.error().get_error_code() == ERROR_NO_SYSTEM_RESOURCES);
+}
+
+///<summary> get the size of the reads used to acquire an image.</summary>
+///<returns> the largest multiple of the physical sector size that the device accepts in one transfer.</returns>
+static uint64_t get_transfer_size(const DeviceCapabilities& capabilities) noexcept
+{
+   const uint64_t cbySectorSize = std::max<uint64_t>(capabilities.physical_sector_size, 1);
+   const uint64_t cSectorsPerTransfer = std::max<uint64_t>(capabilities.max_transfer_size / cbySectorSize, 1);
+   return cSectorsPerTransfer * cbySectorSize;
+}
+
+///<summary> classify the system error code that ended a probe.</summary>
+static CdromDevice::probe_status classify_probe_error(int error_code) noexcept
+{
+   switch (error_code)
+   {
+   case ERROR_NOT_READY:               // empty (or the door is open)
+   case ERROR_NO_MEDIA_IN_DRIVE:
+   case ERROR_UNRECOGNIZED_MEDIA:
+      return CdromDevice::probe_status::no_media;
+
+   case ERROR_BUSY:                    // spinning up, or in use by another process
+   case ERROR_SHARING_VIOLATION:
+   case ERROR_ACCESS_DENIED:
+   case ERROR_MEDIA_CHANGED:
+   case ERROR_OPERATION_ABORTED:       // (cancelled by probe_all)
+   case ERROR_SEM_TIMEOUT:
+   case ERROR_TIMEOUT:
+      return CdromDevice::probe_status::busy;
+
+   default:
+      return CdromDevice::probe_status::error;
+   }
+}
+
+///<summary> how often a late probe is cancelled again as the program ends (it may have issued another request since).</summary>
+static constexpr std::chrono::milliseconds probe_cancel_interval{ 50 };
+
+///<summary> the state shared by probe_all and the thread probing one drive.</summary>
+///<remarks> shared, because a probe that has timed out outlives the probe_all that started it.</remarks>
+struct probe_task
+{
+   std::mutex mutex;
+   std::condition_variable finished;
+   bool done = false;
+   CdromDevice::probe_result result;
+};
+
+///<summary> owns the probe threads that are still running when their probe_all returns (they timed out).</summary>
+///<remarks> the threads are joined once they finish (at the next hand over, or as the program ends), so none is
+/// detached, and none holds up a later scan.</remarks>
+class late_probes
+{
+private:
+   std::mutex mutex;
+   std::vector<std::pair<std::thread, std::shared_ptr<probe_task>>> probes;
+
+   late_probes() = default;
+
+   static bool is_done(probe_task& task)
+   {
+      std::lock_guard<std::mutex> lock(task.mutex);
+      return task.done;
+   }
+
+public:
+   late_probes(const late_probes& other) = delete;
+   late_probes& operator=(const late_probes& other) = delete;
+
+   ///<summary> static getInstance (singleton).</summary>
+   static late_probes& getInstance()
+   {
+      static late_probes instance;
+      return instance;
+   }
+
+   ///<summary> take over a probe thread, joining any taken over earlier that have finished since.</summary>
+   ///<param name='thread'> the probe thread (its synchronous I/O already cancelled).</param>
+   ///<param name='task'> the state the thread reports to.</param>
+   void adopt(std::thread thread, std::shared_ptr<probe_task> task)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      const auto finished = std::partition(probes.begin(), probes.end(), [](auto& probe) { return !is_done(*probe.second); });
+      for (auto probe = finished; probe != probes.end(); probe++)
+      {
+         probe->first.join();
+      }
+      probes.erase(finished, probes.end());
+      probes.emplace_back(std::move(thread), std::move(task));
+   }
+
+   ///<summary> destructor cancels the probes still running, and joins them.</summary>
+   ~late_probes()
+   {
+      for (auto& probe : probes)
+      {
+         std::unique_lock<std::mutex> lock(probe.second->mutex);
+         while (!probe.second->finished.wait_for(lock, probe_cancel_interval, [&probe]() { return probe.second->done; }))
+         {
+            CancelSynchronousIo(probe.first.native_handle());
+         }
+         lock.unlock();
+         probe.first.join();
+      }
+   }
+};
+
+///<summary> the threads started by probe_all (on every path out of it, a finished thread is joined, and one that is
+/// still running is cancelled and handed to late_probes).</summary>
+struct probe_threads
+{
+   std::vector<std::pair<std::thread, std::shared_ptr<probe_task>>> probes;
+
+   ~probe_threads()
+   {
+      for (auto& probe : probes)
+      {
+         bool done = false;
+         {
+            std::lock_guard<std::mutex> lock(probe.second->mutex);
+            done = probe.second->done;
+         }
+         if (done)
+         {
+            probe.first.join();
+            continue;
+         }
+
+         CancelSynchronousIo(probe.first.native_handle());
+         try
+         {
+            late_probes::getInstance().adopt(std::move(probe.first), probe.second);
+         }
+         catch (...)
+         {
+            probe.first.join();     // (no room to hand it over, so wait for it after all)
+         }
+      }
+   }
+};
+
+///<summary> the media data a CdromDevice has read from the drive.</summary>
+///<remarks> valid while the media change count is unchanged (or until refresh). Moving takes the data, not the mutex
+/// (a device is not moved while it is in use), and leaves the moved from cache invalid.</remarks>
+struct cdrom_media_cache
+{
+   std::mutex mutex;
+   bool valid = false;                       // media_change_count and geometry are current
+   std::uint32_t media_change_count = 0;
+   std::chrono::steady_clock::time_point checked;   // when media_change_count was last read from the drive
+   DISK_GEOMETRY geometry {};
+   bool toc_valid = false;                   // toc is current (read on demand)
+   CDROM_TOC toc {};
+
+   cdrom_media_cache() = default;
+
+   cdrom_media_cache(cdrom_media_cache&& other) noexcept
+   {
+      *this = std::move(other);
+   }
+
+   cdrom_media_cache& operator=(cdrom_media_cache&& other) noexcept
+   {
+      if (this != &other)
+      {
+         valid = std::exchange(other.valid, false);
+         media_change_count = other.media_change_count;
+         checked = other.checked;
+         geometry = other.geometry;
+         toc_valid = std::exchange(other.toc_valid, false);
+         toc = other.toc;
+      }
+      return *this;
+   }
+};
+
 /*
 * ***************************************************************************
 * PIMPL idiom - private implementation of CdromDevice class
@@ -49,6 +239,10 @@ static void simulate_resource_limitation(void)
 class CdromDevice::impl : Device
 {
 
+private:
+   ///<summary> the cached media data (in place, like the rest of the impl).</summary>
+   mutable cdrom_media_cache media;
+
 public:
    ///<summary> construct a cdrom device.</summary> 
    ///<param name='device_path'>the path selecting the physical device instance</param>
@@ -57,33 +251,117 @@ public:
    {
    }
 
-   // no copy constructor (unique ptr)
+   ///<summary> construct a cdrom device, with or without the system cache.</summary>
+   ///<param name='device_path'>the path selecting the physical device instance</param>
+   ///<param name='a_caching'>whether i/o goes through the system cache</param>
+   impl(const std::string& device_path, Device::caching a_caching) :
+      Device(device_path, a_caching)
+   {
+   }
+
+   // no copy constructor (unique device handle)
    impl(const impl &other) = delete;
    
-   // no move constructor (unique ptr)
-   impl(impl&& other) = delete;
+   // move constructor (moves the device)
+   impl(impl&& other) noexcept = default;
 
-   // (unique ptr= NonCopyable)
-   impl& operator=(impl& other) = delete;
+   // (unique device handle = NonCopyable)
+   impl& operator=(const impl& other) = delete;
 
-   // base class has const members (non-moveable after construction)
-   impl& operator=(impl&& other) = delete; 
+   // move assignment operator (moves the device)
+   impl& operator=(impl&& other) noexcept = default; 
 
    ///<summary> destructor maintains accessible device state at end of use.</summary> 
    ~impl(void) = default;
+
+   ///<summary> get the limits of the i/o path to the device (see Device).</summary>
+   using Device::get_capabilities;
+   using Device::get_caching;
+
+   ///<summary> read part of the media image, without throwing on device errors.</summary>
+   ///<param name='cbyOffset'> the byte offset to read from (a multiple of the sector size).</param>
+   ///<param name='span'> receives the data (sized in whole sectors).</param>
+   ///<returns> the number of bytes read (0 at the end of the media), or the error.</returns>
+   error::expected<uint32_t> read_at(std::nothrow_t, uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+   {
+      const auto seek_result = seek(std::nothrow, cbyOffset);
+      if (!seek_result)
+      {
+         return seek_result.error();
+      }
+      return read(std::nothrow, span.data(), gsl::narrow_cast<uint32_t>(span.size_bytes()));
+   }
+
+   ///<summary> discard the cached media data (the next query reads it from the drive).</summary>
+   void refresh(void) noexcept
+   {
+      std::lock_guard<std::mutex> lock(media.mutex);
+      media.valid = false;
+      media.toc_valid = false;
+   }
+
+   ///<summary> get the tracks of the media (from the table of contents, cached while the media is unchanged).</summary>
+   ///<returns> the tracks in order, or the error if the operation could not be completed (E.g. ERROR_NOT_READY when there is no media).</returns>
+   error::expected<std::vector<CdromDevice::track>> get_tracks(void) const
+   {
+      std::lock_guard<std::mutex> lock(media.mutex);
+      const auto validated = validate_media_cache();
+      if (!validated)
+      {
+         return validated.error();
+      }
+
+      if (!media.toc_valid)
+      {
+         const auto nBytesReturned =
+            ioctl(std::nothrow, IOCTL_CDROM_READ_TOC, nullptr, 0, &media.toc, sizeof(CDROM_TOC));
+
+         if (!nBytesReturned)
+         {
+            return nBytesReturned.error();
+         }
+
+         if ((nBytesReturned.value() < offsetof(CDROM_TOC, TrackData)) || (media.toc.LastTrack < media.toc.FirstTrack))
+         {
+            return error_code_context("ioctl returned unexpected table of contents");
+         }
+         media.toc_valid = true;
+      }
+
+      // (the table ends with the lead out, which is not a track)
+      const CDROM_TOC& toc = media.toc;
+      const std::size_t cTracks = std::min<std::size_t>(toc.LastTrack - toc.FirstTrack + 1, MAXIMUM_NUMBER_TRACKS - 1);
+
+      std::vector<CdromDevice::track> tracks;
+      tracks.reserve(cTracks);
+      for (std::size_t nTrack = 0; nTrack < cTracks; nTrack++)
+      {
+         const TRACK_DATA& track_data = gsl::at(toc.TrackData, nTrack);
+
+         // addresses are reported as minute, second, frame (75 frames per second, after a 2 second pregap)
+         const uint32_t cFrames = (((track_data.Address[1] * 60u) + track_data.Address[2]) * 75u) + track_data.Address[3];
+         tracks.push_back(CdromDevice::track{ track_data.TrackNumber, (track_data.Control & 0x04) != 0, (cFrames >= 150) ? cFrames - 150 : 0 });
+      }
+      return tracks;
+   }
  
    ///<summary> get size of media image.</summary>
-   ///<returns> size in bytes of image data.</returns>
-   ///<exception cref='std::exception'>if the operation could not be completed.</exception>
-   const uint64_t get_image_size() const
+   ///<returns> size in bytes of image data, or the error if the operation could not be completed.</returns>
+   error::expected<uint64_t> get_image_size(std::nothrow_t) const
    {
       // query current media for data needed for buffer size calculation
-      const DISK_GEOMETRY diskGeometry = get_disk_geometry();
+      const auto geometry = get_disk_geometry();
+      if (!geometry)
+      {
+         return geometry.error();
+      }
+
+      const DISK_GEOMETRY& diskGeometry = geometry.value();
 
       if (diskGeometry.Cylinders.HighPart != 0)
       {
          SetLastError(ERROR_NOT_SUPPORTED);
-         throw error_context("Unsupported media size");   // future proofing
+         return error_code_context("Unsupported media size");   // future proofing
       }
 
       // calculate size of buffer needed to read entire media content
@@ -97,159 +375,158 @@ public:
    }
 
    ///<summary> check for presence or absence of media in drive.</summary>
-   ///<returns>true if a compatible compact disk is recognized as being present in the drive, otherwise false.</returns> 
-   ///<exception cref='std::exception'>if the operation could not be completed.</exception>
-   const bool check_for_media_present(void) const
+   ///<returns>true if a compatible compact disk is recognized as being present in the drive, false if not, or the error.</returns> 
+   error::expected<bool> check_for_media_present(std::nothrow_t) const
    {
-      try
+      const auto imageSize = get_image_size(std::nothrow);
+      if (imageSize)
       {
-         return get_image_size(); // true when non-zero size
+         return imageSize.value() != 0;   // true when non-zero size
       }
-      catch (...)
-      {
-         // there is no function to ask nicely up front...
-         if (GetLastError() == ERROR_NOT_READY) 
-            return false;
 
-         throw;   // rethrow any weird stuff 
+      // there is no function to ask nicely up front...
+      if (imageSize.error().get_error_code() == ERROR_NOT_READY)
+      {
+         return false;
       }
-   }
-
-
 
+      return imageSize.error();
+   }
 
    ///<summary>get image of media into span, while maintaining a progress indication as we go.</summary>
    ///<remarks> This is a synchronous operation that can be very time consuming with some media (eg DVD).</remarks>
    ///<param name ='span'> a gsl::span repesenting a memory location to receive the image.</param>
    ///<param name ='a_progress'> reference to the external location where get_image() %progress is maintained</param>
-   ///<exception cref='std::exception'>if the operation could not be completed with m_progress==100.</exception>
-   void get_image(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const
+   ///<returns> success (with m_progress==100), or the error if the operation could not be completed.</returns>
+   error::expected<void> get_image(std::nothrow_t, gsl::span<unsigned char> span, std::atomic<int>& a_progress) const
    {
-      // initialize the low and high water marks (used in read, and resource limited exception handling)
+      // initialize the low and high water marks (used in read, and resource limited retries)
       LPBYTE lpabyBufferMemoryBase = span.data();
       LPBYTE lpabyBufferMemoryAddress = lpabyBufferMemoryBase;
 
-      try
-      {
-         a_progress = 0;
+      a_progress = 0;
 
+      error::expected<void> result;
+      const auto capabilities = get_capabilities(std::nothrow);
+      if (capabilities)
+      {
+         // read in the largest transfers the device accepts (sized from its capabilities, so the first read succeeds)
+         // (with several reads outstanding where the adapter queues commands)
+         result = capabilities.value().concurrent_requests ?
+            read_transfers_queued(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, span.size_bytes(), get_transfer_size(capabilities.value()), a_progress) :
+            read_transfers(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, span.size_bytes(), get_transfer_size(capabilities.value()), a_progress);
+      }
+      else
+      {
          // force multiple smaller reads (where a granular progress tracker can be maintained)
-         simulate_resource_limitation();
+         result = simulate_resource_limitation();
 
-         // reading full image in one go is most probable scenario (at least for CD's)
-         read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, 1, span.size_bytes(), a_progress);
+         if (result)
+         {
+            // reading full image in one go is most probable scenario (at least for CD's)
+            result = read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, 1, span.size_bytes(), a_progress);
+         }
       }
-      catch (std::exception&)
+
+      // manage resource limitations by attempting multiple smaller reads
+      if (is_resource_limitation(result))
       {
-         // manage resource limitations by attempting multiple smaller reads
-         if (GetLastError() == ERROR_NO_SYSTEM_RESOURCES)
+         lpabyBufferMemoryAddress = lpabyBufferMemoryBase;    // (start again, in chunks sized from the media geometry)
+
+         // query current media for details used in the retry strategy (physical block alignment constraint)
+         const auto geometry = get_disk_geometry();
+         if (!geometry)
          {
-            // query current media for details used in exception handling strategy (physical block alignment constraint)
-            const DISK_GEOMETRY diskGeometry = get_disk_geometry();
+            return geometry.error();
+         }
 
-            const uint64_t cTracksPerCylinder = gsl::narrow<uint64_t>(diskGeometry.TracksPerCylinder);
-            const uint64_t cSectorsPerTrack = gsl::narrow<uint64_t>(diskGeometry.SectorsPerTrack);
-            const uint64_t cBytesPerSector = gsl::narrow<uint64_t>(diskGeometry.BytesPerSector);
-            const uint64_t cCylinders = gsl::narrow<uint64_t>(diskGeometry.Cylinders.LowPart);
+         const DISK_GEOMETRY& diskGeometry = geometry.value();
 
-            if (diskGeometry.Cylinders.HighPart != 0)
-            {
-               SetLastError(ERROR_NOT_SUPPORTED);
-               throw error_context("Unsupported media size"); // future proofing
-            }
+         const uint64_t cTracksPerCylinder = gsl::narrow<uint64_t>(diskGeometry.TracksPerCylinder);
+         const uint64_t cSectorsPerTrack = gsl::narrow<uint64_t>(diskGeometry.SectorsPerTrack);
+         const uint64_t cBytesPerSector = gsl::narrow<uint64_t>(diskGeometry.BytesPerSector);
+         const uint64_t cCylinders = gsl::narrow<uint64_t>(diskGeometry.Cylinders.LowPart);
+
+         if (diskGeometry.Cylinders.HighPart != 0)
+         {
+            SetLastError(ERROR_NOT_SUPPORTED);
+            return error_code_context("Unsupported media size"); // future proofing
+         }
 
-            const uint64_t cbyCylinderSize = cTracksPerCylinder * cSectorsPerTrack * cBytesPerSector;
+         const uint64_t cbyCylinderSize = cTracksPerCylinder * cSectorsPerTrack * cBytesPerSector;
 
-            try
-            {
-               // read remainder of the image in cylinder sized chunks 
-               // (not necessarily physical cylinders but guaranteed to be an exact multiple of physical block size)
-               read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cCylinders, cbyCylinderSize, a_progress);
-            }
-            catch (std::exception&)
+         // read remainder of the image in cylinder sized chunks 
+         // (not necessarily physical cylinders but guaranteed to be an exact multiple of physical block size)
+         result = read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cCylinders, cbyCylinderSize, a_progress);
+
+         if (is_resource_limitation(result))
+         {
+            const uint64_t cTracksReadAsCylinders = (gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase) / cbyCylinderSize) * cTracksPerCylinder;
+            const uint64_t cbyTrackSize = cSectorsPerTrack * cBytesPerSector;
+            const uint64_t cTracksStillToRead = (cCylinders * cTracksPerCylinder) - cTracksReadAsCylinders;
+
+            // read remainder of the image in track sized sized chunks 
+            // (not necessarily physical tracks but guaranteed to be an exact multiple of physical block size)
+            result = read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cTracksStillToRead, cbyTrackSize, a_progress);
+
+            if (is_resource_limitation(result))
             {
-               if (GetLastError() == ERROR_NO_SYSTEM_RESOURCES)
-               {
-                  const uint64_t cTracksReadAsCylinders = (gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase) / cbyCylinderSize) * cTracksPerCylinder;
-                  const uint64_t cbyTrackSize = cSectorsPerTrack * cBytesPerSector;
-                  const uint64_t cTracksStillToRead = (cCylinders * cTracksPerCylinder) - cTracksReadAsCylinders;
-                  try
-                  {
-                     // read remainder of the image in track sized sized chunks 
-                     // (not necessarily physical tracks but guaranteed to be an exact multiple of physical block size)
-                     read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cTracksStillToRead, cbyTrackSize, a_progress);
-                  }
-                  catch (std::exception&)
-                  {
-                     const uint64_t cSectorsReadAsTracks = (gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase) / cbyTrackSize) * cSectorsPerTrack;
-                     const uint64_t cSectorsStillToRead = (cCylinders * cTracksPerCylinder * cSectorsPerTrack) - cSectorsReadAsTracks;
-                     if (GetLastError() == ERROR_NO_SYSTEM_RESOURCES)
-                     {
-                        // read remainder of the image in sector sized sized chunks 
-                        // (not necessarily physical sectors but guaranteed to be an exact multiple of physical block size)
-                        read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cSectorsStillToRead, cBytesPerSector, a_progress);
-                     }
-                     else throw;
-                  }
-               }
-               else throw;
+               const uint64_t cSectorsReadAsTracks = (gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase) / cbyTrackSize) * cSectorsPerTrack;
+               const uint64_t cSectorsStillToRead = (cCylinders * cTracksPerCylinder * cSectorsPerTrack) - cSectorsReadAsTracks;
+
+               // read remainder of the image in sector sized sized chunks 
+               // (not necessarily physical sectors but guaranteed to be an exact multiple of physical block size)
+               result = read_blocks(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cSectorsStillToRead, cBytesPerSector, a_progress);
             }
          }
-         else throw;
+      }
+
+      if (!result)
+      {
+         return result;
       }
 
       Ensures(a_progress == 100);   // if not, program will deadlock
+      return {};
    }
 
    ///<summary> prevents media removal (if the hardware has a lockable drive).</summary>
    void lock(void) noexcept
    {
-      try
+      const auto result = lock_control(true);
+      if (!result)
       {
-         lock_control(true);
-      }
-      catch (const error::context & e)
-      {
-         LOG_WARNING(e.full_what());
+         LOG_RATE_LIMITED(LogLevel::Warning, 1, result.error().to_context().full_what());   // a failing drive can repeat these in a loop, so don't flood the log
       }
    }
 
    ///<summary> allows media removal.</summary>
    void unlock(void) noexcept
    {
-      try
+      const auto result = lock_control(false);
+      if (!result)
       {
-         lock_control(false);
-      }
-      catch (const error::context& e)
-      {
-         LOG_WARNING(e.full_what());
+         LOG_RATE_LIMITED(LogLevel::Warning, 1, result.error().to_context().full_what());
       }
    }
 
    ///<summary> claim exclusive access to the physical device.</summary>
    void claim_exclusive_access(const std::string& moniker) noexcept
    {
-      try
-      {
-         claim_control(true, moniker);
-      }
-      catch (const error::context& e)
+      const auto result = claim_control(true, moniker);
+      if (!result)
       {
-         LOG_WARNING(e.full_what());
+         LOG_RATE_LIMITED(LogLevel::Warning, 1, result.error().to_context().full_what());
       }
    }
 
    ///<summary> release exclisive access to the physical device.</summary>
    void release_exclusive_access(const std::string& moniker) noexcept
    {
-      try
-      {
-         claim_control(false, moniker);
-      }
-      catch (const error::context& e)
+      const auto result = claim_control(false, moniker);
+      if (!result)
       {
-         LOG_WARNING(e.full_what());
+         LOG_RATE_LIMITED(LogLevel::Warning, 1, result.error().to_context().full_what());
       }
    }
 
@@ -283,20 +560,26 @@ private:
 
    ///<summary>apply the IOCTL to allow/disallow media removal</summary>
    ///<remarks>this physically locks the cdrom tray door</remarks>
-   ///<exception cref='std::exception'>if the operation could not be completed</exception>
-   void lock_control(bool aLockedValue) const
+   ///<returns> success, or the error if the operation could not be completed.</returns>
+   error::expected<void> lock_control(bool aLockedValue) const noexcept
    {
       PREVENT_MEDIA_REMOVAL lpInBuffer {};
 
       lpInBuffer.PreventMediaRemoval = aLockedValue;
 
-      const DWORD nBytesReturned =
-         ioctl(IOCTL_STORAGE_MEDIA_REMOVAL, &lpInBuffer, sizeof(PREVENT_MEDIA_REMOVAL), nullptr, 0);
+      const auto nBytesReturned =
+         ioctl(std::nothrow, IOCTL_STORAGE_MEDIA_REMOVAL, &lpInBuffer, sizeof(PREVENT_MEDIA_REMOVAL), nullptr, 0);
 
-      if (nBytesReturned != 0)
+      if (!nBytesReturned)
       {
-         throw error_context("ioctl returned non-zero length");
+         return nBytesReturned.error();
       }
+
+      if (nBytesReturned.value() != 0)
+      {
+         return error_code_context("ioctl returned non-zero length");
+      }
+      return {};
    }
 
    ///<summary>apply the IOCTL to claim/release exclusive access of physical device</summary>
@@ -306,8 +589,8 @@ private:
    ///<param name='aCallerName'> A NULL-terminated string that identifies the application or system component that has a lock on the CD-ROM device. 
    /// The length of the string must be less than or equal to CDROM_EXCLUSIVE_CALLER_LENGTH bytes, including the NULL character at the end of the string.
    /// The string must contain alphanumerics (A - Z, a - z, 0 - 9), spaces, periods, commas, colons (:), semi-colons (;), hyphens (-), and underscores (_).</param> 
-   ///<exception cref='std::exception'>if the operation could not be completed</exception>
-   void claim_control(bool anExclusiveAccessValue, const std::string& aCallerName) const
+   ///<returns> success, or the error if the operation could not be completed.</returns>
+   error::expected<void> claim_control(bool anExclusiveAccessValue, const std::string& aCallerName) const noexcept
    {
       CDROM_EXCLUSIVE_LOCK lpInBuffer {};
 
@@ -326,35 +609,195 @@ private:
       if (strcpy_s(reinterpret_cast<char*>(lpInBuffer.CallerName), CDROM_EXCLUSIVE_CALLER_LENGTH, aCallerName.c_str()) != 0)
 #pragma warning(default:26490)
       {
-         throw error_context("parameter error (aCallerName)");
+         return error_code_context("parameter error (aCallerName)");
       }
 
-      const DWORD nBytesReturned =
-         ioctl(IOCTL_CDROM_EXCLUSIVE_ACCESS, &lpInBuffer, sizeof(CDROM_EXCLUSIVE_LOCK), nullptr, 0);
+      const auto nBytesReturned =
+         ioctl(std::nothrow, IOCTL_CDROM_EXCLUSIVE_ACCESS, &lpInBuffer, sizeof(CDROM_EXCLUSIVE_LOCK), nullptr, 0);
 
-      if (nBytesReturned != 0)
+      if (!nBytesReturned)
       {
-         throw error_context("ioctl returned non-zero length");
+         return nBytesReturned.error();
+      }
+
+      if (nBytesReturned.value() != 0)
+      {
+         return error_code_context("ioctl returned non-zero length");
       }
+      return {};
    }
 
-   ///<summary>get shape and size of medium currently in cdrom drive</summary>
-   ///<exception cref='std::exception'>if the operation could not be completed</exception>
-   const DISK_GEOMETRY get_disk_geometry(void) const
+   ///<summary>get shape and size of medium currently in cdrom drive (cached while the media is unchanged)</summary>
+   ///<returns> the disk geometry, or the error if the operation could not be completed (E.g. ERROR_NOT_READY when there is no media).</returns>
+   error::expected<DISK_GEOMETRY> get_disk_geometry(void) const noexcept
    {
-      DISK_GEOMETRY disk_geometry;
+      std::lock_guard<std::mutex> lock(media.mutex);
+      const auto validated = validate_media_cache();
+      if (!validated)
+      {
+         return validated.error();
+      }
+      return media.geometry;
+   }
 
-      const DWORD nBytesReturned =
-         ioctl(IOCTL_CDROM_GET_DRIVE_GEOMETRY, nullptr, 0, &disk_geometry, sizeof(DISK_GEOMETRY));    // (re-)fetch from device
+   ///<summary> check the cached media data against the media change count, and re-read the geometry if the media has changed.</summary>
+   ///<remarks> the caller holds media.mutex. Within media_check_interval of the last check the cache is trusted as it is
+   /// (so a run of queries costs one IOCTL_STORAGE_CHECK_VERIFY2, not one each).</remarks>
+   ///<returns> success (the cache is valid), or the error if the operation could not be completed (E.g. ERROR_NOT_READY when there is no media).</returns>
+   error::expected<void> validate_media_cache(void) const noexcept
+   {
+      const auto now = std::chrono::steady_clock::now();
+      if (media.valid && ((now - media.checked) < CdromDevice::media_check_interval))
+      {
+         return {};
+      }
+
+      const auto media_change_count = get_media_change_count(std::nothrow);
+      if (!media_change_count)
+      {
+         media.valid = false;
+         media.toc_valid = false;
+         return media_change_count.error();
+      }
+
+      if (media.valid && (media.media_change_count == media_change_count.value()))
+      {
+         media.checked = now;
+         return {};
+      }
+
+      media.valid = false;
+      media.toc_valid = false;
 
-      if (nBytesReturned != sizeof(DISK_GEOMETRY))
+      const auto geometry = fetch_disk_geometry();
+      if (!geometry)
       {
-         throw error_context("ioctl returned unexpected length");
+         return geometry.error();
+      }
+
+      media.geometry = geometry.value();
+      media.media_change_count = media_change_count.value();
+      media.checked = now;
+      media.valid = true;
+      return {};
+   }
+
+   ///<summary>read shape and size of medium currently in cdrom drive (from the drive)</summary>
+   ///<returns> the disk geometry, or the error if the operation could not be completed (E.g. ERROR_NOT_READY when there is no media).</returns>
+   error::expected<DISK_GEOMETRY> fetch_disk_geometry(void) const noexcept
+   {
+      DISK_GEOMETRY disk_geometry {};
+
+      const auto nBytesReturned =
+         ioctl(std::nothrow, IOCTL_CDROM_GET_DRIVE_GEOMETRY, nullptr, 0, &disk_geometry, sizeof(DISK_GEOMETRY));    // (re-)fetch from device
+
+      if (!nBytesReturned)
+      {
+         return nBytesReturned.error();
+      }
+
+      if (nBytesReturned.value() != sizeof(DISK_GEOMETRY))
+      {
+         return error_code_context("ioctl returned unexpected length");
       }
 
       return disk_geometry;
    }
 
+   ///<summary> read the entire device in transfers of a specified size (the last transfer may be shorter).</summary>
+   ///<remarks> the transfer size should be a multiple of the physical block size (as the image size is).</remarks>
+   ///<param name='lpabyBufferMemoryBase'>the address where the start of the data is stored</param>
+   ///<param name='lpabyBufferMemoryAddress'>the address where the data will be stored after reading</param>
+   ///<param name='cbyImageSize'>the size in bytes of the entire device content</param>
+   ///<param name='cbyTransferSize'>the size in bytes of each read</param>
+   ///<param name ='a_progress'> reference to the external location where get_image() %progress is maintained</param>
+   ///<returns> success, or the error if the operation could not be completed (lpabyBufferMemoryAddress marks the data read so far).</returns>
+   error::expected<void> read_transfers(LPBYTE& lpabyBufferMemoryBase, LPBYTE& lpabyBufferMemoryAddress, uint64_t cbyImageSize, uint64_t cbyTransferSize, std::atomic<int>& a_progress) const
+   {
+      uint64_t cbyRead = 0;
+      while (cbyRead < cbyImageSize)
+      {
+         const auto seek_result = seek(std::nothrow, cbyRead);
+         if (!seek_result)
+         {
+            return seek_result;
+         }
+
+         const auto read_result = read(std::nothrow, lpabyBufferMemoryAddress, gsl::narrow_cast<uint32_t>(std::min(cbyTransferSize, cbyImageSize - cbyRead)));
+         if (!read_result)
+         {
+            return read_result.error();
+         }
+
+         if (read_result.value() == 0)
+         {
+            SetLastError(ERROR_HANDLE_EOF);
+            return error_code_context("Unexpected end of media");
+         }
+#pragma warning (disable:26481)
+         lpabyBufferMemoryAddress += read_result.value();
+#pragma warning (default:26481)
+
+         cbyRead = gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase);
+         a_progress = gsl::narrow<int>((100 * cbyRead) / cbyImageSize);
+      }
+      a_progress = 100;
+      return {};
+   }
+
+   ///<summary> read the entire device in transfers of a specified size, with several transfers in flight (see DeviceReadQueue).</summary>
+   ///<remarks> the queue drains at the end of each segment (of several transfers), where progress is updated. If the
+   /// queue can't be set up, the transfers are read one at a time (see read_transfers).</remarks>
+   ///<param name='lpabyBufferMemoryBase'>the address where the start of the data is stored</param>
+   ///<param name='lpabyBufferMemoryAddress'>the address where the data will be stored after reading</param>
+   ///<param name='cbyImageSize'>the size in bytes of the entire device content</param>
+   ///<param name='cbyTransferSize'>the size in bytes of each read</param>
+   ///<param name ='a_progress'> reference to the external location where get_image() %progress is maintained</param>
+   ///<returns> success, or the error if the operation could not be completed (lpabyBufferMemoryAddress marks the data read so far).</returns>
+   error::expected<void> read_transfers_queued(LPBYTE& lpabyBufferMemoryBase, LPBYTE& lpabyBufferMemoryAddress, uint64_t cbyImageSize, uint64_t cbyTransferSize, std::atomic<int>& a_progress) const
+   {
+      std::unique_ptr<DeviceReadQueue> queue;
+      try
+      {
+         // (on the pooled handle of this device, so the reads are covered by its locks)
+         queue = std::make_unique<DeviceReadQueue>(get_device_path(), gsl::narrow<std::uint32_t>(cbyTransferSize), DeviceReadQueue::default_depth,
+            DeviceReadQueue::Backend::io_uring, get_caching());
+      }
+      catch (const std::exception& e)
+      {
+         LOG_WARNING_FMT("read queue unavailable, reading one transfer at a time: {}", e.what());
+         return read_transfers(lpabyBufferMemoryBase, lpabyBufferMemoryAddress, cbyImageSize, cbyTransferSize, a_progress);
+      }
+
+      constexpr uint64_t cTransfersPerSegment = 4 * DeviceReadQueue::default_depth;
+      const uint64_t cbySegmentSize = cTransfersPerSegment * cbyTransferSize;
+
+      uint64_t cbyRead = gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase);
+      while (cbyRead < cbyImageSize)
+      {
+         const uint64_t cbyToRead = std::min(cbySegmentSize, cbyImageSize - cbyRead);
+         const auto read_result = queue->read_into(std::nothrow, cbyRead, lpabyBufferMemoryAddress, cbyToRead);
+         if (!read_result)
+         {
+            return read_result.error();
+         }
+#pragma warning (disable:26481)
+         lpabyBufferMemoryAddress += read_result.value();
+#pragma warning (default:26481)
+
+         cbyRead = gsl::narrow<uint64_t>(lpabyBufferMemoryAddress - lpabyBufferMemoryBase);
+         a_progress = gsl::narrow<int>((100 * cbyRead) / cbyImageSize);
+
+         if (read_result.value() < cbyToRead)
+         {
+            SetLastError(ERROR_HANDLE_EOF);
+            return error_code_context("Unexpected end of media");
+         }
+      }
+      a_progress = 100;
+      return {};
+   }
+
    ///<summary> read the entire device as specified number of blocks of a specified size.</summary>
    ///<remarks> for block devices reads must be integral multiples of the physical block size, and block aligned.</remarks>
    ///<param name='lpabyBufferMemoryBase'>the address where the start of the data is stored</param>
@@ -362,14 +805,22 @@ private:
    ///<param name='cBlocks'>the number of blocks to read</param>
    ///<param name='cbyBlockSize'>the size in bytes of the blocks to read</param>
    ///<param name ='a_progress'> reference to the external location where get_image() %progress is maintained</param>
-   ///<exception cref='std::exception'>if the operation could not be completed</exception>
-   void read_blocks(LPBYTE& lpabyBufferMemoryBase, LPBYTE& lpabyBufferMemoryAddress, uint64_t cBlocks, uint64_t cbyBlockSize, std::atomic<int>& a_progress) const
+   ///<returns> success, or the error if the operation could not be completed (lpabyBufferMemoryAddress marks the data read so far).</returns>
+   error::expected<void> read_blocks(LPBYTE& lpabyBufferMemoryBase, LPBYTE& lpabyBufferMemoryAddress, uint64_t cBlocks, uint64_t cbyBlockSize, std::atomic<int>& a_progress) const
    {
       for (uint64_t nBlock = 0; nBlock < cBlocks; nBlock++)
       {
-         seek(lpabyBufferMemoryAddress - lpabyBufferMemoryBase);
+         const auto seek_result = seek(std::nothrow, lpabyBufferMemoryAddress - lpabyBufferMemoryBase);
+         if (!seek_result)
+         {
+            return seek_result;
+         }
          
-         read(lpabyBufferMemoryAddress, gsl::narrow_cast<uint32_t>(cbyBlockSize)); // see remarks above
+         const auto read_result = read(std::nothrow, lpabyBufferMemoryAddress, gsl::narrow_cast<uint32_t>(cbyBlockSize)); // see remarks above
+         if (!read_result)
+         {
+            return read_result.error();
+         }
 #pragma warning (disable:26481)
          lpabyBufferMemoryAddress += cbyBlockSize;
 #pragma warning (default:26481)
@@ -377,6 +828,7 @@ private:
          a_progress = gsl::narrow<int>((100 * nBlock) / cBlocks);
       }
       a_progress = 100; // handle possible rounding error
+      return {};
    }
 };
 
@@ -391,16 +843,34 @@ private:
 ///<param name='device_path'> the system name of the cdrom device to use.</param>
 ///<exception cref='std::exception'>if construction fails.</exception>
 CdromDevice::CdromDevice(const std::string& device_path) :
-   pimpl(spimpl::make_unique_impl<impl>(device_path))
+   pimpl(std::in_place, device_path)
+{
+}
+
+///<summary> constructs a user mode Device for a particular system cdrom instance, with or without the system cache.</summary>
+///<param name='device_path'> the system name of the cdrom device to use.</param>
+///<param name='a_caching'> whether i/o goes through the system cache.</param>
+///<exception cref='std::exception'>if construction fails.</exception>
+CdromDevice::CdromDevice(const std::string& device_path, Device::caching a_caching) :
+   pimpl(std::in_place, device_path, a_caching)
 {
 }
 
+///<summary> move constructor (defined here, where impl is complete).</summary>
+CdromDevice::CdromDevice(CdromDevice&& other) noexcept = default;
+
+///<summary> move assignment operator.</summary>
+CdromDevice& CdromDevice::operator=(CdromDevice&& other) noexcept = default;
+
+///<summary> destructor.</summary>
+CdromDevice::~CdromDevice() = default;
+
 ///<summary> check for presence or absence of media in drive.</summary>
 ///<returns>true if a compatible compact disk is recognized as being present in the drive, otherwise false.</returns> 
 ///<exception cref='std::exception'>if the operation could not be completed.</exception>
 const bool CdromDevice::check_for_media_present(void) const
 {
-   return pimpl->check_for_media_present();
+   return pimpl->check_for_media_present(std::nothrow).value();
 }
 
 ///<summary> get size of media image.</summary>
@@ -408,7 +878,7 @@ const bool CdromDevice::check_for_media_present(void) const
 ///<exception cref='std::exception'>if the operation could not be completed.</exception>
 const uint64_t CdromDevice::get_image_size(void) const 
 {
-   return pimpl->get_image_size();
+   return pimpl->get_image_size(std::nothrow).value();
 }
 
 ///<summary>get image of media into span.</summary>
@@ -418,7 +888,200 @@ const uint64_t CdromDevice::get_image_size(void) const
 ///<exception cref='std::exception'>if the operation could not be completed.</exception>
 void CdromDevice::get_image(gsl::span<unsigned char>span, std::atomic<int>& a_progress) const
 {
-   pimpl->get_image(span, a_progress);
+   pimpl->get_image(std::nothrow, span, a_progress).value();
+}
+
+///<summary> get the limits of the i/o path to the cdrom device.</summary>
+///<returns> the device capabilities.</returns>
+///<exception cref='std::exception'>if the operation could not be completed.</exception>
+DeviceCapabilities CdromDevice::get_capabilities(void) const
+{
+   return pimpl->get_capabilities(std::nothrow).value();
+}
+
+///<summary> get the limits of the i/o path to the cdrom device, without throwing on device errors.</summary>
+///<returns> the device capabilities, or the error.</returns>
+error::expected<DeviceCapabilities> CdromDevice::get_capabilities(std::nothrow_t) const
+{
+   return pimpl->get_capabilities(std::nothrow);
+}
+
+///<summary> read part of the media image.</summary>
+///<param name='cbyOffset'> the byte offset to read from.</param>
+///<param name='span'> receives the data.</param>
+///<returns> the number of bytes read (0 at the end of the media).</returns>
+///<exception cref='std::exception'>if the operation could not be completed.</exception>
+uint32_t CdromDevice::read_at(uint64_t cbyOffset, gsl::span<unsigned char> span) const
+{
+   return pimpl->read_at(std::nothrow, cbyOffset, span).value();
+}
+
+///<summary> read part of the media image, without throwing on device errors.</summary>
+///<param name='cbyOffset'> the byte offset to read from.</param>
+///<param name='span'> receives the data.</param>
+///<returns> the number of bytes read (0 at the end of the media), or the error.</returns>
+error::expected<uint32_t> CdromDevice::read_at(std::nothrow_t, uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept
+{
+   return pimpl->read_at(std::nothrow, cbyOffset, span);
+}
+
+///<summary> get whether i/o with the cdrom drive goes through the system cache.</summary>
+Device::caching CdromDevice::get_caching(void) const noexcept
+{
+   return pimpl->get_caching();
+}
+
+///<summary> get the tracks of the media in the cdrom drive.</summary>
+///<returns> the tracks, in order.</returns>
+///<exception cref='std::exception'>if the operation could not be completed.</exception>
+std::vector<CdromDevice::track> CdromDevice::get_tracks(void) const
+{
+   return pimpl->get_tracks().value();
+}
+
+///<summary> get the tracks of the media in the cdrom drive, without throwing on device errors.</summary>
+///<returns> the tracks in order, or the error.</returns>
+error::expected<std::vector<CdromDevice::track>> CdromDevice::get_tracks(std::nothrow_t) const
+{
+   return pimpl->get_tracks();
+}
+
+///<summary> discard the cached media geometry and table of contents.</summary>
+void CdromDevice::refresh(void) noexcept
+{
+   pimpl->refresh();
+}
+
+///<summary> get size of media image, without throwing on device errors.</summary>
+///<returns> size in bytes of image data, or the error.</returns>
+error::expected<uint64_t> CdromDevice::get_image_size(std::nothrow_t) const
+{
+   return pimpl->get_image_size(std::nothrow);
+}
+
+///<summary> check for presence or absence of media in drive, without throwing on device errors.</summary>
+///<returns>true if a compatible compact disk is recognized as being present in the drive, false if not, or the error.</returns> 
+error::expected<bool> CdromDevice::check_for_media_present(std::nothrow_t) const
+{
+   return pimpl->check_for_media_present(std::nothrow);
+}
+
+///<summary>get image of media into span, without throwing on device errors.</summary>
+///<param name ='span'> a gsl::span representing a memory location to receive the image.</param>
+///<param name='a_progress'> reference to percentage progress used in get_image.</param>
+///<returns> success, or the error.</returns>
+error::expected<void> CdromDevice::get_image(std::nothrow_t, gsl::span<unsigned char>span, std::atomic<int>& a_progress) const
+{
+   return pimpl->get_image(std::nothrow, span, a_progress);
+}
+
+///<summary> probe a drive for media, without throwing.</summary>
+///<param name='device_path'> the system name of the cdrom device to use.</param>
+///<returns> the state of the drive (and the media size, if ready).</returns>
+CdromDevice::probe_result CdromDevice::probe(const std::string& device_path) noexcept
+{
+   const auto started = std::chrono::steady_clock::now();
+   probe_result result{ device_path, probe_status::error, 0, 0, std::chrono::milliseconds(0) };
+
+   try
+   {
+      const auto image_size = CdromDevice(device_path).get_image_size(std::nothrow);
+      if (image_size)
+      {
+         result.media_size = image_size.value();
+         result.status = (result.media_size != 0) ? probe_status::ready : probe_status::no_media;
+      }
+      else
+      {
+         result.error_code = image_size.error().get_error_code();
+         result.status = classify_probe_error(result.error_code);
+      }
+   }
+   catch (const error::context& e)   // the device could not be opened
+   {
+      result.error_code = e.get_error_code();
+      result.status = classify_probe_error(result.error_code);
+   }
+   catch (...)
+   {
+      result.status = probe_status::error;
+   }
+
+   result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+   return result;
+}
+
+///<summary> probe every drive of a device type for media, concurrently.</summary>
+///<param name='aDeviceType'> the device type (E.g. CDROM_DEVICES).</param>
+///<param name='a_timeout'> the time allowed for each drive to answer.</param>
+///<returns> the state of each drive, in enumeration order.</returns>
+///<exception cref='std::exception'> if the drives could not be enumerated.</exception>
+std::vector<CdromDevice::probe_result> CdromDevice::probe_all(DeviceTypeDirectory::DeviceType aDeviceType, std::chrono::milliseconds a_timeout)
+{
+   const auto devices = DeviceDiscoveryCache::get_device_paths(aDeviceType);
+
+   std::vector<std::string> device_paths;
+   device_paths.reserve(devices->size());
+   for (const auto& device : *devices)
+   {
+      device_paths.push_back(device.second);
+   }
+   return probe_all(device_paths, a_timeout, &probe);
+}
+
+///<summary> probe a list of drives concurrently, with any probe (E.g. a stand-in for testing).</summary>
+///<param name='device_paths'> the drives to be probed.</param>
+///<param name='a_timeout'> the time allowed for each drive to answer.</param>
+///<param name='a_probe'> the probe (called on a thread of its own for each drive).</param>
+///<returns> the state of each drive, in the order given.</returns>
+///<exception cref='std::exception'> if a probe thread could not be started.</exception>
+std::vector<CdromDevice::probe_result> CdromDevice::probe_all(const std::vector<std::string>& device_paths, std::chrono::milliseconds a_timeout, const std::function<probe_result(const std::string&)>& a_probe)
+{
+   probe_threads workers;
+   workers.probes.reserve(device_paths.size());
+
+   // start a probe of each drive, on a thread of its own (so that one slow drive doesn't hold up the others). The thread
+   // owns its copy of the probe and the path, as it may outlive this call.
+   for (const auto& device_path : device_paths)
+   {
+      auto task = std::make_shared<probe_task>();
+      task->result = probe_result{ device_path, probe_status::busy, 0, ERROR_TIMEOUT, a_timeout };   // (unless it answers in time)
+
+      std::thread thread([task, a_probe, path = device_path]()
+      {
+         probe_result result{ path, probe_status::error, 0, 0, std::chrono::milliseconds(0) };
+         try
+         {
+            result = a_probe(path);
+         }
+         catch (...)
+         {
+            // (reported as an error)
+         }
+         std::lock_guard<std::mutex> lock(task->mutex);
+         task->result = std::move(result);
+         task->done = true;
+         task->finished.notify_all();
+      });
+      workers.probes.emplace_back(std::move(thread), std::move(task));
+   }
+
+   // collect the results at the deadline (all drives share it, so the scan takes as long as the slowest drive, or the timeout)
+   const auto deadline = std::chrono::steady_clock::now() + a_timeout;
+   std::vector<probe_result> results;
+   results.reserve(workers.probes.size());
+   for (auto& probe : workers.probes)
+   {
+      auto& task = *probe.second;
+      std::unique_lock<std::mutex> lock(task.mutex);
+      if (!task.finished.wait_until(lock, deadline, [&task]() { return task.done; }))
+      {
+         // too late (reported busy): the probe is cancelled, and left to finish on its own (see probe_threads)
+         LOG_WARNING_FMT("probe of {} timed out", task.result.device_path);
+      }
+      results.push_back(task.result);     // (busy, unless it answered in time)
+   }
+   return results;
 }
 
 ///<summary> claim exclusive access to the physical device.</summary>
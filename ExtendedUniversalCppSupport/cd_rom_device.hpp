@@ -21,18 +21,27 @@
 #ifndef __CD_ROM_DEVICE_HPP__
 #define __CD_ROM_DEVICE_HPP__
 
-#ifdef EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
 #endif
 
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
 #include <string>
+#include <vector>
 
+#include <expected.hpp>
 #include <gsl.hpp>
-#include <spimpl.hpp>
+#include <fast_pimpl.hpp>
 
+#include "device.hpp"
+#include "device_type_directory.hpp"
 #include "memory_mapped_file.hpp"
 
 ///<summary> CdromDevice offers a limited feature set specific to CD ROM Devices</summary>
@@ -42,11 +51,66 @@
 class CdromDevice
 {
 public:
+   ///<summary> the state of a drive, as found by probe.</summary>
+   enum class probe_status
+   {
+      no_media,      // the drive is empty (or the media is unreadable)
+      ready,         // the drive holds media (of media_size bytes)
+      busy,          // the drive did not answer in time, or is in use (E.g. spinning up, or claimed by another process)
+      error          // the drive could not be probed (see error_code)
+   };
+
+   ///<summary> the result of probing a drive.</summary>
+   struct probe_result
+   {
+      std::string device_path;
+      probe_status status;
+      uint64_t media_size;                   // in bytes (when ready)
+      int error_code;                        // the system error code (when busy or error)
+      std::chrono::milliseconds elapsed;     // how long the probe took (or the timeout)
+   };
+
+   ///<summary> a track on the media (from the table of contents).</summary>
+   struct track
+   {
+      int number;                            // the track number (usually from 1)
+      bool data;                             // true for a data track, false for an audio track
+      uint32_t first_sector;                 // the logical block address where the track starts
+   };
+
+   ///<summary> the default time allowed for each drive to answer a probe.</summary>
+   static constexpr std::chrono::milliseconds default_probe_timeout{ 5000 };
+
+   ///<summary> how long cached media data is trusted before the media change count is checked again.</summary>
+   static constexpr std::chrono::milliseconds media_check_interval{ 1000 };
+
    ///<summary> constructs a user mode Device that can be used to access a particular system cdrom instance.</summary>
    ///<param name='device_path'> the system name of the cdrom device to use.</param>
    ///<exception cref='std::exception'>if construction fails.</exception>
    EXTENDEDUNIVERSALCPPSUPPORT_API CdromDevice(const std::string& device_path);
 
+   ///<summary> constructs a user mode Device for a particular system cdrom instance, with or without the system cache.</summary>
+   ///<remarks> unbuffered, reads must be sized and aligned to get_capabilities().buffer_alignment (see Device).</remarks>
+   ///<param name='device_path'> the system name of the cdrom device to use.</param>
+   ///<param name='a_caching'> whether i/o goes through the system cache.</param>
+   ///<exception cref='std::exception'>if construction fails.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API CdromDevice(const std::string& device_path, Device::caching a_caching);
+
+   ///<summary> no copy constructor (a device handle is unique).</summary>
+   CdromDevice(const CdromDevice& other) = delete;
+
+   ///<summary> move constructor.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API CdromDevice(CdromDevice&& other) noexcept;
+
+   ///<summary> no copy assignment operator (a device handle is unique).</summary>
+   CdromDevice& operator=(const CdromDevice& other) = delete;
+
+   ///<summary> move assignment operator.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API CdromDevice& operator=(CdromDevice&& other) noexcept;
+
+   ///<summary> destructor.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API ~CdromDevice();
+
    ///<summary> get size of media image.</summary>
    ///<returns> size in bytes of image data.</returns>
    ///<exception cref='std::exception'>if the operation could not be completed.</exception>
@@ -65,6 +129,67 @@ public:
    ///<exception cref='std::exception'>if the operation could not be completed.</exception>
    EXTENDEDUNIVERSALCPPSUPPORT_API void get_image(gsl::span<unsigned char> span, std::atomic<int>& a_progress) const;
 
+   ///<summary> get size of media image, without throwing on device errors.</summary>
+   ///<returns> size in bytes of image data, or the error (E.g. ERROR_NOT_READY when there is no media).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<uint64_t> get_image_size(std::nothrow_t) const;
+
+   ///<summary> check for presence or absence of media in this CD drive, without throwing on device errors.</summary>
+   ///<remarks> suitable for media polling (a missing disk is an answer, not an error).</remarks>
+   ///<returns> true if a compatible compact disk is recognized as being present in the drive, false if not, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<bool> check_for_media_present(std::nothrow_t) const;
+
+   ///<summary>get image of media into span, without throwing on device errors.</summary>
+   ///<remarks> as get_image above. Reads are sized from the device capabilities, and retried in smaller block aligned
+   /// chunks while the system reports ERROR_NO_SYSTEM_RESOURCES.</remarks>
+   ///<param name ='span'> a gsl::span representing a memory location to receive the image.</param>
+   ///<param name='a_progress'> reference to percentage progress used in get_image.</param>
+   ///<returns> success, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<void> get_image(std::nothrow_t, gsl::span<unsigned char> span, std::atomic<int>& a_progress) const;
+
+   ///<summary> get the limits of the i/o path to this CD drive (see Device::get_capabilities).</summary>
+   ///<remarks> get_image sizes its reads from these, rather than finding the limits by failing reads.</remarks>
+   ///<returns> the device capabilities.</returns>
+   ///<exception cref='std::exception'>if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities get_capabilities(void) const;
+
+   ///<summary> get the limits of the i/o path to this CD drive, without throwing on device errors.</summary>
+   ///<returns> the device capabilities, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<DeviceCapabilities> get_capabilities(std::nothrow_t) const;
+
+   ///<summary> read part of the media image.</summary>
+   ///<remarks> for reading an image a piece at a time (E.g. into reusable buffers, see AlignedBufferPool).</remarks>
+   ///<param name='cbyOffset'> the byte offset to read from (a multiple of the sector size).</param>
+   ///<param name='span'> receives the data (sized in whole sectors).</param>
+   ///<returns> the number of bytes read (0 at the end of the media).</returns>
+   ///<exception cref='std::exception'>if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API uint32_t read_at(uint64_t cbyOffset, gsl::span<unsigned char> span) const;
+
+   ///<summary> read part of the media image, without throwing on device errors.</summary>
+   ///<param name='cbyOffset'> the byte offset to read from (a multiple of the sector size).</param>
+   ///<param name='span'> receives the data (sized in whole sectors).</param>
+   ///<returns> the number of bytes read (0 at the end of the media), or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<uint32_t> read_at(std::nothrow_t, uint64_t cbyOffset, gsl::span<unsigned char> span) const noexcept;
+
+   ///<summary> get whether i/o with this CD drive goes through the system cache.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API Device::caching get_caching(void) const noexcept;
+
+   ///<summary> get the tracks of the media in this CD drive.</summary>
+   ///<remarks> the table of contents is read once, and cached until the media changes (or refresh). The media change
+   /// count is checked at most once per media_check_interval, so a change may go unnoticed for that long.</remarks>
+   ///<returns> the tracks, in order.</returns>
+   ///<exception cref='std::exception'>if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::vector<track> get_tracks(void) const;
+
+   ///<summary> get the tracks of the media in this CD drive, without throwing on device errors.</summary>
+   ///<returns> the tracks in order, or the error (E.g. ERROR_NOT_READY when there is no media).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::vector<track>> get_tracks(std::nothrow_t) const;
+
+   ///<summary> discard the media geometry and table of contents cached by this device.</summary>
+   ///<remarks> these are cached until the drive reports a media change (checked at most once per media_check_interval),
+   /// so refresh is only needed to notice a change at once (E.g. when a DeviceMonitor reports one), or to force a re-read
+   /// after an operation the media change count does not reflect.</remarks>
+   EXTENDEDUNIVERSALCPPSUPPORT_API void refresh(void) noexcept;
+
    ///<summary> claims exclusive access to device.</summary>
    ///<remarks> by sending IOCTL. If successful, the filesystem that overlays the physical device will be inaccessible 
    /// until a call to release_exclusive_access() is made</remarks>
@@ -107,13 +232,45 @@ public:
       return CdromDevice(device_path).check_for_media_present();
    }
 
+   ///<summary> probe a drive for media, without throwing.</summary>
+   ///<param name='device_path'> the system name of the cdrom device to use.</param>
+   ///<returns> the state of the drive (and the media size, if ready).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API static probe_result probe(const std::string& device_path) noexcept;
+
+   ///<summary> probe every drive of a device type for media, concurrently.</summary>
+   ///<remarks> each drive is probed on a thread of its own, so the scan takes as long as the slowest drive (or the timeout),
+   /// not the sum of them all. A drive that does not answer in time is reported busy, and its request is cancelled. This
+   /// returns at the deadline: a probe still running is left to finish on its own (its thread is joined later).</remarks>
+   ///<param name='aDeviceType'> the device type (E.g. CDROM_DEVICES).</param>
+   ///<param name='a_timeout'> the time allowed for each drive to answer.</param>
+   ///<returns> the state of each drive, in enumeration order.</returns>
+   ///<exception cref='std::exception'> if the drives could not be enumerated.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API static std::vector<probe_result> probe_all(DeviceTypeDirectory::DeviceType aDeviceType, std::chrono::milliseconds a_timeout = default_probe_timeout);
+
+   ///<summary> probe a list of drives concurrently, with any probe (E.g. a stand-in for testing).</summary>
+   ///<remarks> as above. The probe (a copy of it) may still be running after this returns, so it must not refer to
+   /// anything that the caller destroys.</remarks>
+   ///<param name='device_paths'> the drives to be probed.</param>
+   ///<param name='a_timeout'> the time allowed for each drive to answer.</param>
+   ///<param name='a_probe'> the probe (called on a thread of its own for each drive).</param>
+   ///<returns> the state of each drive, in the order given.</returns>
+   ///<exception cref='std::exception'> if a probe thread could not be started.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API static std::vector<probe_result> probe_all(const std::vector<std::string>& device_paths, std::chrono::milliseconds a_timeout, const std::function<probe_result(const std::string&)>& a_probe);
+
 private:
    ///<summary> forward reference to private implementation.</summary>
    class impl;
 
-   ///<summary> unique pointer to private implementation.</summary>
-   ///<remarks> Non copyable, with move limitations.</remarks>
-   spimpl::unique_impl_ptr<impl> pimpl;
+   ///<summary> the capacity of the in place storage for the private implementation (a Device, and its media cache:
+   /// a mutex, the geometry and an 804 byte table of contents).</summary>
+   static constexpr std::size_t impl_capacity = 24 * sizeof(void*) + 1024;
+
+   ///<summary> the alignment of the in place storage (as a Device).</summary>
+   static constexpr std::size_t impl_alignment = alignof(std::uint64_t);
+
+   ///<summary> private implementation, stored in place (no heap allocation).</summary>
+   ///<remarks> Non copyable. The capacity is checked against the implementation at compile time (in cd_rom_device.cpp).</remarks>
+   spimpl::fast_impl_ptr<impl, impl_capacity, impl_alignment> pimpl;
 };
 
 #endif // __CD_ROM_DEVICE_HPP__
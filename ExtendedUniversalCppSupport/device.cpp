@@ -4,6 +4,9 @@
 // Here we implement methods which wrap the Win32 calls. This offloads the
 // parameterization of these functions from clients, for ease of use.
 //
+// Elsewhere (POSIX) the same methods wrap open, pread, pwrite and ioctl, and
+// a regular file (E.g. a disc image) is accepted as a device.
+//
 // Copyright (c) 2003-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
 //
 //    This program is free software : you can redistribute it and/or modify
@@ -20,7 +23,141 @@
 //    along with this program.If not, see < http://www.gnu.org/licenses/ >.
 //
 #include "stdafx.h"
+#ifdef _WIN32
+#include <winioctl.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/cdrom.h>
+#include <linux/fs.h>
+#endif
+#endif
+
 #include "device.hpp"
+#include "device_handle_pool.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+
+///<summary> the sector size assumed when a device reports none.</summary>
+constexpr std::uint32_t default_sector_size = 512;
+
+#ifdef _WIN32
+///<summary> the system handle of an open device.</summary>
+using native_handle = HANDLE;
+
+///<summary> the system handle value of no device.</summary>
+static const native_handle invalid_native_handle = INVALID_HANDLE_VALUE;
+#else
+///<summary> the system handle of an open device (a file descriptor).</summary>
+using native_handle = int;
+
+///<summary> the system handle value of no device.</summary>
+constexpr native_handle invalid_native_handle = -1;
+
+///<summary> the largest single read or write (Linux transfers at most this many bytes per call).</summary>
+constexpr std::uint32_t max_read_write_size = 0x7ffff000;
+
+///<summary> the media change count of each removable media drive (by path), counted process wide. A Singleton.</summary>
+///<remarks> a drive reports that its media changed just once (to whoever asks first), so every check of the drive
+/// made here is counted here. Checks made by another process can hide a change from us.</remarks>
+class media_change_counts
+{
+private:
+   std::mutex mutex;
+   std::map<std::string, std::uint32_t> counts;
+
+   media_change_counts() = default;
+
+public:
+   ///<summary> static getInstance (singleton).</summary>
+   static media_change_counts& getInstance() noexcept
+   {
+      static media_change_counts singleton;
+      return singleton;
+   }
+
+   ///<summary> count a media check of a drive.</summary>
+   ///<param name='device_path'> the system name of the drive.</param>
+   ///<param name='changed'> true if the drive reported that its media changed.</param>
+   ///<returns> the media change count of the drive.</returns>
+   std::uint32_t count(const std::string& device_path, bool changed) noexcept
+   {
+      try
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         std::uint32_t& count = counts[device_path];
+         count += changed ? 1 : 0;
+         return count;
+      }
+      catch (...)
+      {
+         return 0;   // (not counted, so a cached result may be used for new media)
+      }
+   }
+};
+#endif
+
+///<summary> the capabilities of each device (by path), as queried for the media in the device. A Singleton.</summary>
+///<remarks> capabilities are queried again when the media change count differs (the media, and perhaps its sector size, changed).</remarks>
+class capabilities_cache
+{
+private:
+   ///<summary> the capabilities queried for a media generation.</summary>
+   struct entry
+   {
+      std::uint32_t media_change_count;
+      DeviceCapabilities capabilities;
+   };
+
+   std::mutex mutex;
+   std::map<std::string, entry> entries;
+
+   capabilities_cache() = default;
+
+public:
+   ///<summary> static getInstance (singleton).</summary>
+   static capabilities_cache& getInstance() noexcept
+   {
+      static capabilities_cache singleton;
+      return singleton;
+   }
+
+   ///<summary> find the capabilities of a device, as queried for a media generation.</summary>
+   ///<returns> the capabilities, or nullopt if they are not cached (or were queried for other media).</returns>
+   std::optional<DeviceCapabilities> find(const std::string& device_path, std::uint32_t media_change_count) noexcept
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      const auto found = entries.find(device_path);
+      if ((found == entries.end()) || (found->second.media_change_count != media_change_count))
+      {
+         return std::nullopt;
+      }
+      return found->second.capabilities;
+   }
+
+   ///<summary> store the capabilities of a device, as queried for a media generation.</summary>
+   void store(const std::string& device_path, std::uint32_t media_change_count, const DeviceCapabilities& capabilities) noexcept
+   {
+      try
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         entries[device_path] = entry{ media_change_count, capabilities };
+      }
+      catch (...)
+      {
+         // (not cached, so the next caller queries again)
+      }
+   }
+};
 
 /*
 * ***************************************************************************
@@ -29,24 +166,37 @@
 */
 
 ///<summary> the private implementation of Device.</summary>
-///<remarks> Windows types used internally, adheres to "utf8 everywhere" paradigm at public interface</remarks>
+///<remarks> Windows types used internally (POSIX types elsewhere), adheres to "utf8 everywhere" paradigm at public interface</remarks>
 class Device::impl
 {
 
 private:
-   ///<summary>the wstring form of the device path and the memory</summary>
-   const std::wstring device_path_w;
+   ///<summary>the device path (the key of the pooled handle)</summary>
+   std::string device_path;
+
+   ///<summary> the (pooled) handle to the device, shared with other Devices of the same path.</summary>
+   DeviceHandlePool::handle shared_handle;
 
    ///<summary> handle to the (open) device.</summary>
-   HANDLE hDevice;
+   native_handle hDevice;
+
+   ///<summary> whether i/o goes through the system cache.</summary>
+   DeviceHandlePool::caching caching_mode;
+
+   ///<summary> the file position of this Device (reads and writes are at explicit offsets, as the handle is shared).</summary>
+   mutable std::uint64_t position;
 
 public:
    ///<summary> constructs a user mode Device that can be used to access a particular system device instance.</summary>
    ///<param name='a_device_path'> the system name of the device to use.</param>
+   ///<param name='a_caching'> whether i/o goes through the system cache.</param>
    ///<exception cref='std::exception'>if construction fails.</exception>
-   impl(const std::string& a_device_path) :
-      device_path_w(utf8::convert::to_utf16(a_device_path)),
-      hDevice(INVALID_HANDLE_VALUE)
+   impl(const std::string& a_device_path, DeviceHandlePool::caching a_caching) :
+      device_path(a_device_path),
+      shared_handle(),
+      hDevice(invalid_native_handle),
+      caching_mode(a_caching),
+      position(0)
    {
       open();
    }
@@ -54,66 +204,74 @@ public:
    ///<summary> copy constructor deleted for unique impl.</summary>
    impl(const impl& other) = delete;
 
-   ///<summary> move constructor deleted.</summary>
-   impl(impl&& other) noexcept = delete;
+   ///<summary> move constructor (the device handle is transferred, the moved from impl is closed).</summary>
+   impl(impl&& other) noexcept :
+      device_path(std::move(other.device_path)),
+      shared_handle(std::move(other.shared_handle)),
+      hDevice(std::exchange(other.hDevice, invalid_native_handle)),
+      caching_mode(other.caching_mode),
+      position(other.position)
+   {
+   }
 
-   ///<summary> no copy assignment operator (class has unique ptr and const member)</summary>
-   impl& operator=(impl& other) = delete;
+   ///<summary> no copy assignment operator (a device handle is unique)</summary>
+   impl& operator=(const impl& other) = delete;
  
-   ///<summary> no move assignment operator (class has const member)</summary>
-   impl& operator=(impl&& other) = delete;
+   ///<summary> move assignment operator (closes this device, then takes over the other device handle).</summary>
+   impl& operator=(impl&& other) noexcept
+   {
+      if (this != &other)
+      {
+         close();
+         device_path = std::move(other.device_path);
+         shared_handle = std::move(other.shared_handle);
+         hDevice = std::exchange(other.hDevice, invalid_native_handle);
+         caching_mode = other.caching_mode;
+         position = other.position;
+      }
+      return (*this);
+   }
    
    ///<summary> destructor</summary> 
-   ///<remarks>If the handle to the device is open, it will be closed here.</remarks>
+   ///<remarks>If the handle to the device is open, it will be returned to the pool here.</remarks>
    ~impl() 
    {
       close();
    }
 
-   ///<summary> open device for win32 device control and file i/o access.</summary>
+   ///<summary> open device for device control and file i/o access.</summary>
+   ///<remarks> the device is only opened if the pool holds no handle to it.</remarks>
    ///<exception cref='std::exception'>if the operation cannot be completed.</exception>
    void open()
    {
-      constexpr DWORD dwDesiredAccess = GENERIC_READ | GENERIC_WRITE;
-      constexpr DWORD dwShareMode = FILE_SHARE_READ | FILE_SHARE_WRITE;
-      //LPSECURITY_ATTRIBUTES lpSecurityAttributes = NULL;
-      constexpr DWORD dwCreateDisposition = OPEN_EXISTING;
-      constexpr DWORD dwFlagsAndAttributes = FILE_ATTRIBUTE_NORMAL;
-      HANDLE hTemplateFile = nullptr;
-
-      hDevice = CreateFile(device_path_w.c_str(),
-         dwDesiredAccess,
-         dwShareMode,
-         NULL, //lpSecurityAttributes,
-         dwCreateDisposition,
-         dwFlagsAndAttributes,
-         hTemplateFile
-      );
-
-      if (hDevice == INVALID_HANDLE_VALUE) 
-      {
-         std::stringstream create_file_failed; create_file_failed << "CreateFile(\"" << utf8::convert::from_utf16(device_path_w) << "\", ...) failed";
-         throw error_context(create_file_failed.str().c_str());
-      }
+      shared_handle = DeviceHandlePool::acquire(device_path, DeviceHandlePool::access::read_write, caching_mode);
+#ifdef _WIN32
+      hDevice = shared_handle.get();
+#else
+      hDevice = *static_cast<const int*>(shared_handle.get());
+#endif
+      position = 0;
    }
 
    /// <summary> issue a synchronous device i/o control message. The thread is suspended until this request completes.</summary>
+   ///<remarks> a POSIX ioctl has a single argument, for input and output both, so here the input is copied to the output buffer
+   /// (which is the argument), and when there is no output buffer the result of the request (E.g. CDROM_DRIVE_STATUS) is returned.</remarks>
    ///<param name ='dwIoControlCode'> Specifies the IOCTL_XXX to be set up. For more information about system specific device-type-specific I/O codes, 
    /// see the appropriate system reference. Eg for Windows this is the Windows DDK Kernel Mode Driver Design Guide Reference Part II.</param>
    ///<param name='lpInBuffer'> Points to an input buffer to be passed to the driver or nullptr if the request does not pass input data.</param>
    ///<param name='nInBufferSize'> Specifies the length in bytes of the input buffer. If InputBuffer is nullptr, this value must be zero.</param>
    ///<param name='lpOutBuffer'> Points to an output buffer in which the driver is to return data or NULL if the request does not require driver to return data.</param>
    ///<param name='nOutBufferSize'> Specifies the length in bytes of the output buffer. If OutputBuffer is NULL, this value must be zero.</param>
-   ///<returns> actual number of output buffer bytes transferred in the operation.</returns>
-   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
-   const DWORD ioctl(DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize) const
+   ///<returns> actual number of output buffer bytes transferred in the operation, or the error if the operation could not be completed.</returns>
+   error::expected<std::uint32_t> ioctl(std::uint32_t dwIoControlCode, void* lpInBuffer, std::uint32_t nInBufferSize, void* lpOutBuffer, std::uint32_t nOutBufferSize) const noexcept
    {
 
-      if (hDevice == INVALID_HANDLE_VALUE) 
+      if (hDevice == invalid_native_handle) 
       {
-         throw error_context("Invalid handle");
+         return error_code_context("Invalid handle");
       }
 
+#ifdef _WIN32
       DWORD nBytesReturned = 0;
 
       if (!DeviceIoControl(hDevice,
@@ -126,78 +284,207 @@ public:
          NULL
       ))
       {
-         throw error_context("DeviceIoControl failed");
+         return error_code_context("DeviceIoControl failed");
       }
 
       return nBytesReturned;
+#else
+      if ((lpOutBuffer != nullptr) && (lpInBuffer != nullptr) && (lpOutBuffer != lpInBuffer))
+      {
+         std::memcpy(lpOutBuffer, lpInBuffer, std::min(nInBufferSize, nOutBufferSize));
+      }
+
+      void* argument = (lpOutBuffer != nullptr) ? lpOutBuffer : lpInBuffer;
+      int result = 0;
+      do
+      {
+         result = ::ioctl(hDevice, dwIoControlCode, argument);
+      } while ((result == -1) && (errno == EINTR));
+
+      if (result == -1)
+      {
+         return error_code_context("ioctl failed");
+      }
+
+      return (lpOutBuffer != nullptr) ? nOutBufferSize : static_cast<std::uint32_t>(result);
+#endif
    }
 
    ///<summary> seek in the read/write space of the device (set the file pointer).</summary>
    ///<param name='cbyByteOffsetFromStart'> byte offset from start of device.</param>
-   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
-   const void seek(ULONGLONG cbyByteOffsetFromStart) const
+   ///<returns> success, or the error if the operation could not be completed.</returns>
+   error::expected<void> seek(std::uint64_t cbyByteOffsetFromStart) const noexcept
    {
-      LARGE_INTEGER liDistanceToMove;
-      liDistanceToMove.QuadPart = cbyByteOffsetFromStart;
-
-      if (!SetFilePointerEx(hDevice, liDistanceToMove, nullptr, FILE_BEGIN))
+      if (hDevice == invalid_native_handle) 
       {
-         throw error_context("SetFilePointer failed");
+         return error_code_context("Invalid handle");
       }
+
+      position = cbyByteOffsetFromStart;
+      return {};
    }
 
    ///<summary> issue a synchronous read. The thread is suspended pending completion of the read.</summary>
    ///<param name='lpBuffer'> pointer to buffer which will receive read data.</param>
    ///<param name='nBytesToRead'> number of bytes to read. this must be less than or equal to the available memory at lpBuffer.</param>
-   ///<returns> actual number of bytes transferred/read.</returns>
-   ///<exception cref='std::exception'>if the operation could not be completed.</exception>
-   const DWORD read(LPVOID lpBuffer, DWORD numberOfBytesToRead) const
+   ///<returns> actual number of bytes transferred/read, or the error if the operation could not be completed.</returns>
+   error::expected<std::uint32_t> read(void* lpBuffer, std::uint32_t numberOfBytesToRead) const noexcept
    {
 
-      if (hDevice == INVALID_HANDLE_VALUE) 
+      if (hDevice == invalid_native_handle) 
       {
-         throw error_context("Invalid handle");
+         return error_code_context("Invalid handle");
       }
 
+#ifdef _WIN32
       DWORD numberOfBytesRead = 0;
+      OVERLAPPED overlapped = at_position();
 
       if (!ReadFile(hDevice,
          lpBuffer,
          numberOfBytesToRead,
          &numberOfBytesRead,
-         NULL
+         &overlapped
       ))
       {
-         throw error_context("ReadFile failed");
+         if (GetLastError() != ERROR_HANDLE_EOF)
+         {
+            return error_code_context("ReadFile failed");
+         }
+         numberOfBytesRead = 0;   // (at the end, as reported by a read without an offset)
+      }
+#else
+      ssize_t numberOfBytesRead = 0;
+      do
+      {
+         numberOfBytesRead = ::pread(hDevice, lpBuffer, numberOfBytesToRead, static_cast<off_t>(position));
+      } while ((numberOfBytesRead == -1) && (errno == EINTR));
+
+      if (numberOfBytesRead == -1)
+      {
+         return error_code_context("pread failed");
       }
-      return numberOfBytesRead;
+#endif
+
+      position += numberOfBytesRead;
+      return static_cast<std::uint32_t>(numberOfBytesRead);
    }
 
    ///<summary> issue a synchronous write. The thread is suspended pending completion of the write.</summary>
    ///<param name='lpBuffer'> pointer to buffer containing data to write.</param>
    ///<param name='nBytesToWrite'> number of bytes to write from the buffer.</param>
-   ///<returns> actual number of bytes transferred/written.</returns>
-   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
-   const DWORD write(LPVOID lpBuffer, DWORD numberOfBytesToWrite) const
+   ///<returns> actual number of bytes transferred/written, or the error if the operation could not be completed.</returns>
+   error::expected<std::uint32_t> write(void* lpBuffer, std::uint32_t numberOfBytesToWrite) const noexcept
    {
  
-      if (hDevice == INVALID_HANDLE_VALUE) 
+      if (hDevice == invalid_native_handle) 
       {
-         throw error_context("Invalid handle");
+         return error_code_context("Invalid handle");
       }
 
+#ifdef _WIN32
       DWORD numberOfBytesWritten = 0;
+      OVERLAPPED overlapped = at_position();
 
       if (!WriteFile(hDevice,
          lpBuffer,
          numberOfBytesToWrite,
          &numberOfBytesWritten,
-         NULL
+         &overlapped
       ))
       {
-         throw error_context("WriteFile failed");
+         return error_code_context("WriteFile failed");
+      }
+#else
+      ssize_t numberOfBytesWritten = 0;
+      do
+      {
+         numberOfBytesWritten = ::pwrite(hDevice, lpBuffer, numberOfBytesToWrite, static_cast<off_t>(position));
+      } while ((numberOfBytesWritten == -1) && (errno == EINTR));
+
+      if (numberOfBytesWritten == -1)
+      {
+         return error_code_context("pwrite failed");
+      }
+#endif
+
+      position += numberOfBytesWritten;
+      return static_cast<std::uint32_t>(numberOfBytesWritten);
+   }
+
+   ///<summary> get the media change count (from a media check).</summary>
+   ///<remarks> elsewhere than Windows, a drive reports that its media changed (once), so the changes are counted process wide
+   /// (see media_change_counts). Fixed media (E.g. a disk, or an image file) never changes, so its count is zero.</remarks>
+   ///<returns> the media change count, or the error if the operation could not be completed (E.g. ERROR_NOT_READY, or ENOMEDIUM, when there is no media).</returns>
+   error::expected<std::uint32_t> get_media_change_count() const noexcept
+   {
+#ifdef _WIN32
+      ULONG media_change_count = 0;
+
+      const auto nBytesReturned =
+         ioctl(IOCTL_STORAGE_CHECK_VERIFY2, nullptr, 0, &media_change_count, sizeof(ULONG));
+
+      if (!nBytesReturned)
+      {
+         return nBytesReturned.error();
+      }
+
+      if (nBytesReturned.value() != sizeof(ULONG))
+      {
+         return error_code_context("ioctl returned unexpected length");
+      }
+
+      return media_change_count;
+#else
+      if (hDevice == invalid_native_handle) 
+      {
+         return error_code_context("Invalid handle");
+      }
+
+#ifdef __linux__
+      const int status = ::ioctl(hDevice, CDROM_DRIVE_STATUS, CDSL_CURRENT);
+      if (status != -1)
+      {
+         if ((status != CDS_DISC_OK) && (status != CDS_NO_INFO))
+         {
+            errno = ENOMEDIUM;
+            return error_code_context("no media");
+         }
+
+         const bool changed = (::ioctl(hDevice, CDROM_MEDIA_CHANGED, CDSL_CURRENT) == 1);
+         return media_change_counts::getInstance().count(device_path, changed);
       }
-      return numberOfBytesWritten;
+#endif
+      return 0;   // (not a removable media drive)
+#endif
+   }
+
+   ///<summary> get the limits of the i/o path to the device (cached for each media generation).</summary>
+   ///<returns> the device capabilities, or the error if the operation could not be completed.</returns>
+   error::expected<DeviceCapabilities> get_capabilities() const noexcept
+   {
+      // without media there is no media generation to cache against (so the capabilities are queried each time)
+      const auto media_change_count = get_media_change_count();
+      if (media_change_count)
+      {
+         const auto cached = capabilities_cache::getInstance().find(device_path, media_change_count.value());
+         if (cached)
+         {
+            return for_caching(cached.value());
+         }
+      }
+
+      const auto capabilities = query_capabilities();
+      if (!capabilities)
+      {
+         return capabilities;
+      }
+
+      if (media_change_count)
+      {
+         capabilities_cache::getInstance().store(device_path, media_change_count.value(), capabilities.value());
+      }
+      return for_caching(capabilities.value());
    }
 
    ///<summary> reset the device.</summary>
@@ -208,18 +495,169 @@ public:
    void reset() 
    {
       close();
+      DeviceHandlePool::retire(device_path);    // (so that the device really is opened again)
       open();  // implies we implement reset on open semantics in driver
    }
 
+   ///<summary> get the system name of the device.</summary>
+   const std::string& get_device_path() const noexcept
+   {
+      return device_path;
+   }
+
+   ///<summary> get whether i/o goes through the system cache.</summary>
+   DeviceHandlePool::caching get_caching() const noexcept
+   {
+      return caching_mode;
+   }
+
    ///<summary> close the device for device control and file i/o operations.</summary>
+   ///<remarks> the handle is returned to the pool (which closes it once no Device has used it for a while).</remarks>
    void close() noexcept
    {
-      if (hDevice != INVALID_HANDLE_VALUE) 
+      shared_handle.reset();
+      hDevice = invalid_native_handle;
+   }
+
+private:
+   ///<summary> tighten the (cached) capabilities of the device for the caching of this Device.</summary>
+   ///<remarks> unbuffered i/o bypasses the system cache, so buffers must also be aligned to the sector size (or for a
+   /// regular file, to the file system block size).</remarks>
+   DeviceCapabilities for_caching(DeviceCapabilities capabilities) const noexcept
+   {
+      if (caching_mode == DeviceHandlePool::caching::unbuffered)
+      {
+         capabilities.buffer_alignment = std::max(capabilities.buffer_alignment, capabilities.physical_sector_size);
+#ifndef _WIN32
+         struct stat status {};
+         if ((::fstat(hDevice, &status) == 0) && S_ISREG(status.st_mode))
+         {
+            capabilities.buffer_alignment = std::max(capabilities.buffer_alignment, static_cast<std::uint32_t>(status.st_blksize));
+         }
+#endif
+      }
+      return capabilities;
+   }
+
+#ifdef _WIN32
+   ///<summary> get the file position, as the offset of a synchronous read or write.</summary>
+   OVERLAPPED at_position() const noexcept
+   {
+      OVERLAPPED overlapped {};
+      overlapped.Offset = static_cast<DWORD>(position);
+      overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+      return overlapped;
+   }
+
+   ///<summary> query the storage adapter (and driver) for the limits of the i/o path to the device.</summary>
+   ///<returns> the device capabilities, or the error if the operation could not be completed.</returns>
+   error::expected<DeviceCapabilities> query_capabilities() const noexcept
+   {
+      STORAGE_PROPERTY_QUERY query {};
+      query.PropertyId = StorageAdapterProperty;
+      query.QueryType = PropertyStandardQuery;
+
+      STORAGE_ADAPTER_DESCRIPTOR adapter {};
+
+      const auto nAdapterBytesReturned =
+         ioctl(IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(STORAGE_PROPERTY_QUERY), &adapter, sizeof(STORAGE_ADAPTER_DESCRIPTOR));
+
+      if (!nAdapterBytesReturned)
+      {
+         return nAdapterBytesReturned.error();
+      }
+
+      if (nAdapterBytesReturned.value() < offsetof(STORAGE_ADAPTER_DESCRIPTOR, AcceleratedTransfer))
+      {
+         return error_code_context("ioctl returned unexpected length");
+      }
+
+      DeviceCapabilities capabilities {};
+      capabilities.max_transfer_size = adapter.MaximumTransferLength;
+      capabilities.buffer_alignment = adapter.AlignmentMask + 1;
+      capabilities.concurrent_requests = (adapter.CommandQueueing != FALSE);
+
+      // a transfer is also limited by the pages the adapter can map (one page is lost when a buffer isn't page aligned)
+      if ((adapter.MaximumPhysicalPages > 1) && (adapter.MaximumPhysicalPages != ULONG_MAX))
+      {
+         SYSTEM_INFO system_info {};
+         GetSystemInfo(&system_info);
+
+         const std::uint64_t cbyPageLimit = static_cast<std::uint64_t>(adapter.MaximumPhysicalPages - 1) * system_info.dwPageSize;
+         if (cbyPageLimit < capabilities.max_transfer_size)
+         {
+            capabilities.max_transfer_size = static_cast<std::uint32_t>(cbyPageLimit);
+         }
+      }
+
+      // the physical sector size (not all drivers report the access alignment, E.g. some optical drives, so fall back to the geometry)
+      query.PropertyId = StorageAccessAlignmentProperty;
+      STORAGE_ACCESS_ALIGNMENT_DESCRIPTOR alignment {};
+      DISK_GEOMETRY geometry {};
+
+      const auto nAlignmentBytesReturned =
+         ioctl(IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(STORAGE_PROPERTY_QUERY), &alignment, sizeof(STORAGE_ACCESS_ALIGNMENT_DESCRIPTOR));
+
+      if (nAlignmentBytesReturned && (nAlignmentBytesReturned.value() == sizeof(STORAGE_ACCESS_ALIGNMENT_DESCRIPTOR)))
+      {
+         capabilities.physical_sector_size = alignment.BytesPerPhysicalSector;
+      }
+      else
+      {
+         const auto nGeometryBytesReturned =
+            ioctl(IOCTL_DISK_GET_DRIVE_GEOMETRY, nullptr, 0, &geometry, sizeof(DISK_GEOMETRY));
+
+         if (nGeometryBytesReturned && (nGeometryBytesReturned.value() == sizeof(DISK_GEOMETRY)))
+         {
+            capabilities.physical_sector_size = geometry.BytesPerSector;
+         }
+      }
+
+      if (capabilities.physical_sector_size == 0)
       {
-         CloseHandle(hDevice);
-         hDevice = INVALID_HANDLE_VALUE;
+         capabilities.physical_sector_size = default_sector_size;
       }
+
+      return capabilities;
    }
+#else
+   ///<summary> query the device (block device ioctls) for the limits of the i/o path to the device.</summary>
+   ///<remarks> a regular file (E.g. an image file) has no limits but the largest single read.</remarks>
+   ///<returns> the device capabilities, or the error if the operation could not be completed.</returns>
+   error::expected<DeviceCapabilities> query_capabilities() const noexcept
+   {
+      struct stat status {};
+      if (::fstat(hDevice, &status) == -1)
+      {
+         return error_code_context("fstat failed");
+      }
+
+      DeviceCapabilities capabilities {};
+      capabilities.max_transfer_size = max_read_write_size;
+      capabilities.buffer_alignment = 1;                    // (reads are buffered)
+      capabilities.physical_sector_size = default_sector_size;
+      capabilities.concurrent_requests = true;              // (the block layer queues requests)
+
+#ifdef __linux__
+      if (S_ISBLK(status.st_mode))
+      {
+         unsigned short max_sectors = 0;      // (in 512 byte units, whatever the sector size)
+         if ((::ioctl(hDevice, BLKSECTGET, &max_sectors) == 0) && (max_sectors != 0))
+         {
+            capabilities.max_transfer_size = std::min<std::uint32_t>(max_sectors * 512u, max_read_write_size);
+         }
+
+         unsigned int physical_sector_size = 0;
+         if ((::ioctl(hDevice, BLKPBSZGET, &physical_sector_size) == 0) && (physical_sector_size != 0))
+         {
+            capabilities.physical_sector_size = physical_sector_size;
+         }
+      }
+#endif
+
+      return capabilities;
+   }
+#endif
 };
 
 /*
@@ -233,30 +671,94 @@ public:
 ///<exception cref='std::exception'> if construction fails.</exception>
 ///<remarks>opens the device</remarks>
 Device::Device(const std::string& a_device_path) : 
-   pimpl(spimpl::make_unique_impl<impl>(a_device_path))
+   pimpl(std::in_place, a_device_path, DeviceHandlePool::caching::buffered)
+{
+}
+
+///<summary> constructs a movable user mode Device, with or without the system cache.</summary>
+///<param name='a_device_path'> the system name of the device to use.</param>
+///<param name='a_caching'> whether i/o goes through the system cache.</param>
+///<exception cref='std::exception'> if construction fails.</exception>
+///<remarks>opens the device</remarks>
+Device::Device(const std::string& a_device_path, caching a_caching) :
+   pimpl(std::in_place, a_device_path, a_caching)
 {
 }
 
+///<summary> move constructor (defined here, where impl is complete).</summary>
+Device::Device(Device&& other) noexcept = default;
+
+///<summary> move assignment operator.</summary>
+Device& Device::operator=(Device&& other) noexcept = default;
+
+///<summary> destructor (closes the device).</summary>
+Device::~Device() = default;
+
 const std::uint32_t Device::ioctl(std::uint32_t dwIoControlCode, void* lpInBuffer, std::uint32_t nInBufferSize, void* lpOutBuffer, std::uint32_t nOutBufferSize) const
 {
-   return pimpl->ioctl(dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize);
+   return pimpl->ioctl(dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize).value();
 }
 
 const void Device::seek(std::uint64_t cByOffsetFromStart) const
 {
-   pimpl->seek(cByOffsetFromStart);
+   pimpl->seek(cByOffsetFromStart).value();
 }
 
 const std::uint32_t Device::read(void* lpBuffer, std::uint32_t nBytesToRead) const
 {
-   return pimpl->read(lpBuffer, nBytesToRead);
+   return pimpl->read(lpBuffer, nBytesToRead).value();
 }
 
 const std::uint32_t Device::write(void* lpBuffer, std::uint32_t nBytesToWrite) const
+{
+   return pimpl->write(lpBuffer, nBytesToWrite).value();
+}
+
+error::expected<std::uint32_t> Device::ioctl(std::nothrow_t, std::uint32_t dwIoControlCode, void* lpInBuffer, std::uint32_t nInBufferSize, void* lpOutBuffer, std::uint32_t nOutBufferSize) const noexcept
+{
+   return pimpl->ioctl(dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize);
+}
+
+error::expected<void> Device::seek(std::nothrow_t, std::uint64_t cByOffsetFromStart) const noexcept
+{
+   return pimpl->seek(cByOffsetFromStart);
+}
+
+error::expected<std::uint32_t> Device::read(std::nothrow_t, void* lpBuffer, std::uint32_t nBytesToRead) const noexcept
+{
+   return pimpl->read(lpBuffer, nBytesToRead);
+}
+
+error::expected<std::uint32_t> Device::write(std::nothrow_t, void* lpBuffer, std::uint32_t nBytesToWrite) const noexcept
 {
    return pimpl->write(lpBuffer, nBytesToWrite);
 }
 
+DeviceCapabilities Device::get_capabilities() const
+{
+   return pimpl->get_capabilities().value();
+}
+
+error::expected<DeviceCapabilities> Device::get_capabilities(std::nothrow_t) const noexcept
+{
+   return pimpl->get_capabilities();
+}
+
+error::expected<std::uint32_t> Device::get_media_change_count(std::nothrow_t) const noexcept
+{
+   return pimpl->get_media_change_count();
+}
+
+const std::string& Device::get_device_path() const noexcept
+{
+   return pimpl->get_device_path();
+}
+
+Device::caching Device::get_caching() const noexcept
+{
+   return pimpl->get_caching();
+}
+
 void Device::reset()
 {
    pimpl->reset();
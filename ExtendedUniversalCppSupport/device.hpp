@@ -22,27 +22,69 @@
 #ifndef __DEVICE_HPP__
 #define __DEVICE_HPP__
 
-#ifdef EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
 #endif
 
+#include <cstdint>
+#include <new>
 #include <string>
 
-#include <spimpl.hpp>
+#include <expected.hpp>
+#include <fast_pimpl.hpp>
+
+#include "device_handle_pool.hpp"
+
+///<summary> the limits of the i/o path to a device (as reported by its driver and storage adapter).</summary>
+///<remarks> reads sized and aligned to these limits succeed first time, instead of being found by failing reads.</remarks>
+struct DeviceCapabilities
+{
+   std::uint32_t max_transfer_size;       // the largest single transfer, in bytes
+   std::uint32_t buffer_alignment;        // the alignment buffers require, in bytes (a power of 2)
+   std::uint32_t physical_sector_size;    // in bytes (reads are sized in multiples of this)
+   bool concurrent_requests;              // true if the adapter queues commands (several requests can be outstanding)
+};
 
 ///<summary> represents a movable abstract physical system device.</summary>  
 ///<remarks> we explicitly disallow copy, and compare of devices as these operations have no great value.</remarks>
 class Device {
 
 public:
+   ///<summary> whether i/o goes through the system cache (see DeviceHandlePool::caching).</summary>
+   using caching = DeviceHandlePool::caching;
 
    ///<summary> constructs a movable user mode Device that can be used to access a particular system device instance.</summary>
    ///<param name='device_path'> the system name of the device to use.</param>
    ///<exception cref='std::exception'>if construction fails.</exception>
    EXTENDEDUNIVERSALCPPSUPPORT_API Device(const std::string& device_path);
 
+   ///<summary> constructs a movable user mode Device, with or without the system cache.</summary>
+   ///<remarks> unbuffered i/o (for bulk imaging, where caching the data only evicts useful data) needs offsets, sizes and
+   /// buffer addresses aligned to get_capabilities().buffer_alignment.</remarks>
+   ///<param name='device_path'> the system name of the device to use.</param>
+   ///<param name='a_caching'> whether i/o goes through the system cache.</param>
+   ///<exception cref='std::exception'>if construction fails.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API Device(const std::string& device_path, caching a_caching);
+
+   ///<summary> no copy constructor (a device handle is unique).</summary>
+   Device(const Device& other) = delete;
+
+   ///<summary> move constructor.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API Device(Device&& other) noexcept;
+
+   ///<summary> no copy assignment operator (a device handle is unique).</summary>
+   Device& operator=(const Device& other) = delete;
+
+   ///<summary> move assignment operator.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API Device& operator=(Device&& other) noexcept;
+
+   ///<summary> destructor (closes the device).</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API ~Device();
+
    /// <summary> issue a synchronous device i/o control message. The thread is suspended until this request completes.</summary>
    ///<param name ='dwIoControlCode'> Specifies the IOCTL_XXX to be set up. For more information about system specific device-type-specific I/O codes, 
    /// see the appropriate system reference. Eg for Windows this is the Windows DDK Kernel Mode Driver Design Guide Reference Part II.</param>
@@ -54,7 +96,8 @@ public:
    ///<exception cref='std::exception'> if the operation could not be completed.</exception>
    EXTENDEDUNIVERSALCPPSUPPORT_API const std::uint32_t ioctl(std::uint32_t dwIoControlCode, void* lpInBuffer, std::uint32_t nInBufferSize, void* lpOutBuffer, std::uint32_t nOutBufferSize) const;
 
-   ///<summary> seek in the read/write space of the device (set the file pointer).</summary>
+   ///<summary> seek in the read/write space of the device (set the file position of this Device).</summary>
+   ///<remarks> each Device has its own file position (Devices of the same path share a pooled handle, see DeviceHandlePool).</remarks>
    ///<param name='cbyOffsetFromStart'> byte offset from start of device.</param>
    ///<exception cref='std::exception'> if the operation could not be completed.</exception>
    EXTENDEDUNIVERSALCPPSUPPORT_API const void seek(std::uint64_t cbyOffsetFromStart) const;
@@ -73,6 +116,51 @@ public:
    ///<exception cref='std::exception'>if the operation could not be completed.</exception>
    EXTENDEDUNIVERSALCPPSUPPORT_API const std::uint32_t write(void* lpBuffer, std::uint32_t nBytesToWrite) const;
 
+   /// <summary> issue a synchronous device i/o control message, without throwing on failure.</summary>
+   ///<remarks> as ioctl above, for callers where failure is routine (E.g. polling or retrying).</remarks>
+   ///<returns> actual number of bytes transferred in the operation, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> ioctl(std::nothrow_t, std::uint32_t dwIoControlCode, void* lpInBuffer, std::uint32_t nInBufferSize, void* lpOutBuffer, std::uint32_t nOutBufferSize) const noexcept;
+
+   ///<summary> seek in the read/write space of the device (set the file pointer), without throwing on failure.</summary>
+   ///<param name='cbyOffsetFromStart'> byte offset from start of device.</param>
+   ///<returns> success, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<void> seek(std::nothrow_t, std::uint64_t cbyOffsetFromStart) const noexcept;
+
+   ///<summary> issue a synchronous read, without throwing on failure.</summary>
+   ///<param name='lpBuffer'> pointer to buffer which will receive read data.</param>
+   ///<param name='nBytesToRead'> number of bytes to read. this must be less than or equal to the available memory at lpBuffer.</param>
+   ///<returns> actual number of bytes transferred/read, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> read(std::nothrow_t, void* lpBuffer, std::uint32_t nBytesToRead) const noexcept;
+
+   ///<summary> issue a synchronous write, without throwing on failure.</summary>
+   ///<param name='lpBuffer'> pointer to buffer containing data to write.</param>
+   ///<param name='nBytesToWrite'> number of bytes to write from the buffer.</param>
+   ///<returns> actual number of bytes transferred/written, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> write(std::nothrow_t, void* lpBuffer, std::uint32_t nBytesToWrite) const noexcept;
+
+   ///<summary> get the limits of the i/o path to the device.</summary>
+   ///<remarks> the result is cached (process wide) by device path and media change count, so only the first query
+   /// for each media costs more than a media check.</remarks>
+   ///<returns> the device capabilities.</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceCapabilities get_capabilities() const;
+
+   ///<summary> get the limits of the i/o path to the device, without throwing on failure.</summary>
+   ///<returns> the device capabilities, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<DeviceCapabilities> get_capabilities(std::nothrow_t) const noexcept;
+
+   ///<summary> get the media change count of a removable media device, without throwing on failure.</summary>
+   ///<remarks> the count increases each time media is changed, so it identifies the media generation.</remarks>
+   ///<returns> the media change count, or the error (E.g. ERROR_NOT_READY when there is no media).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint32_t> get_media_change_count(std::nothrow_t) const noexcept;
+
+   ///<summary> get the system name of the device (E.g. to open a DeviceReadQueue on the same device).</summary>
+   ///<returns> the device path (empty once moved from).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API const std::string& get_device_path() const noexcept;
+
+   ///<summary> get whether i/o goes through the system cache.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API caching get_caching() const noexcept;
+
    ///<summary> reset the device.</summary>
    ///<remarks> this is implemented as a close then open sequence and relies on the system device
    /// performing a "reset on open" semantics. This condition is not guaranteed for all devices, although a
@@ -85,9 +173,15 @@ private:
    ///<summary> forward reference to private implementation.</summary>
    class impl;
 
-   ///<summary> smart unique pointer to private implementation.</summary>
-   ///<remarks> Non copyable, with move limitations.</remarks>
-   spimpl::unique_impl_ptr<impl> pimpl;
+   ///<summary> the capacity of the in place storage for the private implementation (a device path, a pooled handle, its caching and a file position).</summary>
+   static constexpr std::size_t impl_capacity = 12 * sizeof(void*) + sizeof(std::uint64_t);
+
+   ///<summary> the alignment of the in place storage (the file position is 64 bit on every platform).</summary>
+   static constexpr std::size_t impl_alignment = alignof(std::uint64_t);
+
+   ///<summary> private implementation, stored in place (no heap allocation).</summary>
+   ///<remarks> Non copyable. The capacity is checked against the implementation at compile time (in device.cpp).</remarks>
+   spimpl::fast_impl_ptr<impl, impl_capacity, impl_alignment> pimpl;
 };
 
 #endif // __DEVICE_HPP__
@@ -9,6 +9,9 @@
 //
 // See: Microsoft Knowledge Base Article - 259695 
 //
+// Elsewhere (E.g. Linux) the block devices are enumerated from a sysfs style tree,
+// whose root can be chosen (on Windows too), so that a fake tree can stand in for it.
+//
 // Copyright (c) 2003-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
 //
 //    This program is free software : you can redistribute it and/or modify
@@ -25,10 +28,169 @@
 //    along with this program.If not, see < http://www.gnu.org/licenses/ >.
 //
 #include "stdafx.h"
+#ifdef _WIN32
 #include <setupapi.h>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
 
 #include "device_discoverer.hpp"
+#ifdef _WIN32
 #include "utf8_guid.hpp"
+#endif
+
+
+///<summary> enumerates the block devices of a sysfs style tree (on Linux, the tree mounted at /sys).</summary>
+///<remarks> each whole device is a directory under block/ (its partitions are subdirectories with a 'partition' attribute),
+/// and a SCSI device reports its peripheral device type in device/type. Only these attributes are read, so any copy of
+/// the tree (E.g. a fake tree made by a test) can stand in for it.</remarks>
+class sysfs_tree
+{
+private:
+   ///<summary> the root of the tree.</summary>
+   std::filesystem::path root;
+
+   ///<summary> the SCSI peripheral device types (of device/type) that identify the optical device types.</summary>
+   static constexpr std::uint64_t scsi_type_disk = 0x00;
+   static constexpr std::uint64_t scsi_type_worm = 0x04;
+   static constexpr std::uint64_t scsi_type_rom = 0x05;
+   static constexpr std::uint64_t scsi_type_mod = 0x07;
+   static constexpr std::uint64_t scsi_type_rbc = 0x0e;
+
+public:
+   ///<summary> construct a sysfs_tree.</summary>
+   ///<param name='a_root'> the (utf8) root of the tree.</param>
+   sysfs_tree(const std::string& a_root) :
+      root(to_path(a_root))
+   {
+   }
+
+   ///<summary> get the device paths (the device node under /dev) of the devices of a device type.</summary>
+   ///<remarks> the devices are numbered in name order. Device types with no sysfs equivalent have no devices.</remarks>
+   ///<param name='aDeviceType'> the device type to be enumerated.</param>
+   ///<returns> the device paths.</returns>
+   ///<exception cref='std::exception'> if the tree has no block/ directory.</exception>
+   std::map<int, std::string> get_device_paths(DeviceTypeDirectory::DeviceType aDeviceType) const
+   {
+      std::vector<std::string> names;
+
+      std::error_code ec;
+      std::filesystem::directory_iterator device(root / "block", ec);
+      if (ec)
+      {
+         throw error_context("sysfs tree has no block directory");
+      }
+
+      for (const std::filesystem::directory_iterator end; !ec && (device != end); device.increment(ec))
+      {
+         if (aDeviceType == DeviceTypeDirectory::DeviceType::PARTITION_DEVICES)
+         {
+            std::error_code partition_ec;
+            std::filesystem::directory_iterator partition(device->path(), partition_ec);
+            for (; !partition_ec && (partition != end); partition.increment(partition_ec))
+            {
+               if (std::filesystem::exists(partition->path() / "partition", partition_ec))
+               {
+                  names.push_back(from_path(partition->path().filename()));
+               }
+            }
+         }
+         else if (classify(device->path()) == aDeviceType)
+         {
+            names.push_back(from_path(device->path().filename()));
+         }
+      }
+
+      std::sort(names.begin(), names.end());
+
+      std::map<int, std::string> device_paths;
+      for (const auto& name : names)
+      {
+         device_paths.emplace(static_cast<int>(device_paths.size()), "/dev/" + name);
+      }
+      return device_paths;
+   }
+
+private:
+   ///<summary> get the device type of a whole device.</summary>
+   ///<param name='device'> the device directory.</param>
+   ///<returns> the device type, or nullopt if the device isn't one we enumerate.</returns>
+   static std::optional<DeviceTypeDirectory::DeviceType> classify(const std::filesystem::path& device)
+   {
+      const std::string name = from_path(device.filename());
+      if (name.compare(0, 2, "fd") == 0)
+      {
+         return DeviceTypeDirectory::DeviceType::FLOPPY_DEVICES;
+      }
+
+      const auto scsi_type = read_number(device / "device" / "type");
+      if (scsi_type)
+      {
+         switch (scsi_type.value())
+         {
+         case scsi_type_disk:
+         case scsi_type_rbc:
+            return DeviceTypeDirectory::DeviceType::DISK_DEVICES;
+         case scsi_type_rom:
+            return DeviceTypeDirectory::DeviceType::CDROM_DEVICES;
+         case scsi_type_worm:
+         case scsi_type_mod:
+            return DeviceTypeDirectory::DeviceType::WRITEONCEDISK_DEVICES;
+         default:
+            return std::nullopt;
+         }
+      }
+
+      if (name.compare(0, 2, "sr") == 0)
+      {
+         return DeviceTypeDirectory::DeviceType::CDROM_DEVICES;
+      }
+
+      // not SCSI (E.g. nvme, virtio, mmc or loop), so a disk, unless it has no size and no removable media (E.g. an unbound loop device)
+      if ((read_number(device / "size").value_or(0) == 0) && (read_number(device / "removable").value_or(0) == 0))
+      {
+         return std::nullopt;
+      }
+      return DeviceTypeDirectory::DeviceType::DISK_DEVICES;
+   }
+
+   ///<summary> read a numeric attribute.</summary>
+   ///<returns> the value, or nullopt if there is no such attribute (or it isn't a number).</returns>
+   static std::optional<std::uint64_t> read_number(const std::filesystem::path& attribute)
+   {
+      std::ifstream stream(attribute);
+      std::uint64_t value = 0;
+      if (!(stream >> value))
+      {
+         return std::nullopt;
+      }
+      return value;
+   }
+
+   ///<summary> get the filesystem path of a utf8 path.</summary>
+   static std::filesystem::path to_path(const std::string& a_path)
+   {
+#ifdef _WIN32
+      return std::filesystem::path(utf8::convert::to_utf16(a_path));
+#else
+      return std::filesystem::path(a_path);     // (narrow paths are utf8)
+#endif
+   }
+
+   ///<summary> get the utf8 path of a filesystem path.</summary>
+   static std::string from_path(const std::filesystem::path& a_path)
+   {
+#ifdef _WIN32
+      return utf8::convert::from_utf16(a_path.wstring());
+#else
+      return a_path.string();
+#endif
+   }
+};
 
 
 /*
@@ -41,8 +203,9 @@
 ///<remarks> Windows types used internally, adheres to "utf8 everywhere" paradigm at public interface</remarks>
 class DeviceDiscoverer::impl
 {
+#ifdef _WIN32
 private:
-   ///<summary> handle to the DEVINFO structure used.</summary>
+   ///<summary> handle to the DEVINFO structure used (INVALID_HANDLE_VALUE when a sysfs tree is enumerated).</summary>
    ///<remarks> used when enumerating devices via DeviceDiscoverer interface.</remarks>
    HDEVINFO m_hDevInfo;
 
@@ -53,14 +216,17 @@ public:
 
    ///<summary> pointer to class GUID as required by legacy api's</summary>
    LPCGUID INTERFACE_CLASS_GUID;
+#endif
 
+public:
    ///<summary> the device path data member.</summary>
    std::map<int, std::string> device_path_data;
 
+#ifdef _WIN32
    ///<summary> construct a DeviceDiscoverer::private_impl object used to enumerate the devices of a particular device interface class.</summary>
    ///<param name = "aDeviceType"> the device type for the interface class to be enumerated.</param>
    impl(DeviceTypeDirectory::DeviceType aDeviceType) /*noexcept*/ :
-      theGuid(utf8::guid_convert::to_guid(DeviceTypeDirectory::get_device_type_as_string(aDeviceType))),
+      theGuid(utf8::guid_convert::to_guid(DeviceTypeDirectory::get_device_type_guid(aDeviceType))),
       INTERFACE_CLASS_GUID(&theGuid),
       device_path_data()
    {
@@ -76,17 +242,48 @@ public:
       }
    }
 
+   ///<summary> construct a DeviceDiscoverer::private_impl object used to enumerate the devices of a sysfs style tree.</summary>
+   ///<param name = "aDeviceType"> the device type to be enumerated.</param>
+   ///<param name = "a_sysfs_root"> the root of the tree.</param>
+   impl(DeviceTypeDirectory::DeviceType aDeviceType, const std::string& a_sysfs_root) :
+      m_hDevInfo(INVALID_HANDLE_VALUE),
+      theGuid(utf8::guid_convert::to_guid(DeviceTypeDirectory::get_device_type_guid(aDeviceType))),
+      INTERFACE_CLASS_GUID(&theGuid),
+      device_path_data(sysfs_tree(a_sysfs_root).get_device_paths(aDeviceType))
+   {
+   }
+#else
+   ///<summary> construct a DeviceDiscoverer::private_impl object used to enumerate the devices of a particular device type.</summary>
+   ///<param name = "aDeviceType"> the device type to be enumerated.</param>
+   impl(DeviceTypeDirectory::DeviceType aDeviceType) :
+      impl(aDeviceType, DeviceDiscoverer::default_sysfs_root)
+   {
+   }
+
+   ///<summary> construct a DeviceDiscoverer::private_impl object used to enumerate the devices of a sysfs style tree.</summary>
+   ///<param name = "aDeviceType"> the device type to be enumerated.</param>
+   ///<param name = "a_sysfs_root"> the root of the tree.</param>
+   impl(DeviceTypeDirectory::DeviceType aDeviceType, const std::string& a_sysfs_root) :
+      device_path_data(sysfs_tree(a_sysfs_root).get_device_paths(aDeviceType))
+   {
+   }
+#endif
+
    ///<summary> equals comparison operator.</summary>
    ///<remarks> defines equals to mean accessible data is identical.</remarks>
    const bool operator==(const impl& other) const
    {
       if ((this == nullptr) || (&other == nullptr)) return false;       // NOLINT (safety) msvc std::move leaves a null reference to the stale source object, whereas C++ standard requires a valid object (with undefined behaviour) to remain.
       if (this == &other) return true; // same object
+#ifdef _WIN32
       return (
          (INTERFACE_CLASS_GUID == other.INTERFACE_CLASS_GUID) &&
          (device_path_data == other.device_path_data)    
          // considered equal if public data is identical
       );
+#else
+      return (device_path_data == other.device_path_data);
+#endif
    }
 
    ///<summary> not equals comparison operator.</summary>
@@ -111,9 +308,15 @@ public:
    ///<summary> dtor release resources used by the class.</summary>
    ~impl()
    {
-      SetupDiDestroyDeviceInfoList(m_hDevInfo); //TODO : after moves, there is a redundant extra call (which is harmless in this case)
+#ifdef _WIN32
+      if (m_hDevInfo != INVALID_HANDLE_VALUE)
+      {
+         SetupDiDestroyDeviceInfoList(m_hDevInfo); //TODO : after moves, there is a redundant extra call (which is harmless in this case)
+      }
+#endif
    }
 
+#ifdef _WIN32
 private:
    ///<summary> get handle to device information set corresponding to the interface class guid supplied.</summary>
    ///<param name ="anInterfaceClassGuid"> pointer to setup interface class guid or device class guid to interrogate.</param>
@@ -213,6 +416,7 @@ private:
       return std::wstring(pDeviceInterfaceDetailData->DevicePath); // copies buffer content before its destroyed
 #pragma warning(default : 26485)
    }
+#endif
 };
 
 
@@ -232,6 +436,15 @@ DeviceDiscoverer::DeviceDiscoverer(DeviceTypeDirectory::DeviceType aDeviceType)
 {
 }
 
+///<summary> constructs a DeviceDiscoverer for a device type, enumerating a sysfs style tree.</summary>
+///<param name='aDeviceType'>value representing a chosen device type</param>
+///<param name='a_sysfs_root'>the root of the tree</param>
+DeviceDiscoverer::DeviceDiscoverer(DeviceTypeDirectory::DeviceType aDeviceType, const std::string& a_sysfs_root) :
+   pimpl(spimpl::make_impl<impl>(aDeviceType, a_sysfs_root)),
+   device_path_map(std::ref<std::map<int,std::string>>(pimpl->device_path_data))
+{
+}
+
 ///<summary> equals comparison operator.</summary>
 ///<remarks> objects considered equal if private_impl's are equal.</remarks>
 const bool DeviceDiscoverer::operator==(const DeviceDiscoverer& other) const
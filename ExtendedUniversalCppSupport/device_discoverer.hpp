@@ -25,7 +25,9 @@
 #ifndef __DEVICE_DISCOVERER_HPP__
 #define __DEVICE_DISCOVERER_HPP__
 
-#ifdef EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -45,6 +47,17 @@ public:
    ///<param name = "aDeviceType"> the device type to be enumerated.</param>
    EXTENDEDUNIVERSALCPPSUPPORT_API DeviceDiscoverer(DeviceTypeDirectory::DeviceType aDeviceType) noexcept;
 
+   ///<summary> the root of the sysfs tree enumerated (where there is no SetupAPI, E.g. on Linux).</summary>
+   static constexpr const char* default_sysfs_root = "/sys";
+
+   ///<summary> construct an interface object used to enumerate the block devices of a sysfs style tree.</summary>
+   ///<remarks> available on every platform, so that a test can point it at a fake tree. Device paths are the
+   /// device nodes (/dev/name). Device types with no sysfs equivalent (E.g. TAPE_DEVICES) have no devices.</remarks>
+   ///<param name = "aDeviceType"> the device type to be enumerated.</param>
+   ///<param name = "a_sysfs_root"> the (utf8) root of the tree.</param>
+   ///<exception cref='std::exception'> if the tree has no block directory.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceDiscoverer(DeviceTypeDirectory::DeviceType aDeviceType, const std::string& a_sysfs_root);
+
    ///<summary> equals comparison operator.</summary>
    ///<remarks> defines equals to mean identical device path content.</remarks>
    EXTENDEDUNIVERSALCPPSUPPORT_API const bool operator==(const DeviceDiscoverer& other) const;
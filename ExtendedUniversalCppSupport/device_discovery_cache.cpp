@@ -0,0 +1,201 @@
+//
+// device_discovery_cache.cpp : a process wide cache of enumerated device paths
+//
+// Each device type has a slot holding its latest snapshot (an immutable map, published through an atomic
+// shared_ptr). A snapshot records the cache generation it was taken in, and when. Readers check both, and
+// only enumerate (with DeviceDiscoverer) when the snapshot is stale. Enumeration is serialized, so that
+// concurrent readers of a stale slot wait for (and share) a single new snapshot.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+#include "device_discoverer.hpp"
+#include "device_discovery_cache.hpp"
+
+
+///<summary> the private implementation of DeviceDiscoveryCache. A Singleton.</summary>
+///<remarks> holds a snapshot slot for each standard device type, and each possible custom device type.</remarks>
+class DeviceDiscoveryCache::impl
+{
+
+private:
+   ///<summary> the device paths of a device type, as enumerated at a point in time.</summary>
+   struct snapshot
+   {
+      std::shared_ptr<const device_paths> paths;
+      std::uint64_t generation;
+      std::chrono::steady_clock::time_point taken;
+   };
+
+   ///<summary> the number of slots (standard device types, then custom device types in order of registration).</summary>
+   static constexpr std::size_t slot_count = DeviceTypeDirectory::standard_device_type_count + DeviceTypeDirectory::max_custom_device_types;
+
+   ///<summary> the latest snapshot of each device type.</summary>
+   std::array<std::atomic<std::shared_ptr<const snapshot>>, slot_count> slots;
+
+   ///<summary> the cache generation (snapshots of earlier generations are stale).</summary>
+   std::atomic<std::uint64_t> generation;
+
+   ///<summary> serializes enumeration.</summary>
+   std::mutex enumerating;
+
+   ///<summary> constructs the singleton DeviceDiscoveryCache::impl.</summary>
+   impl() noexcept :
+      slots{},
+      generation(0)
+   {
+   }
+
+   ///<summary> get the slot of a device type.</summary>
+   ///<returns> the slot, or nullptr if the device type cannot be cached.</returns>
+   std::atomic<std::shared_ptr<const snapshot>>* get_slot(DeviceTypeDirectory::DeviceType aDeviceType) noexcept
+   {
+      const int value = static_cast<int>(aDeviceType);
+      std::size_t index = slot_count;
+      if ((value >= 0) && (static_cast<std::size_t>(value) < DeviceTypeDirectory::standard_device_type_count))
+      {
+         index = static_cast<std::size_t>(value);
+      }
+      else if (value >= DeviceTypeDirectory::first_custom_device_type)
+      {
+         index = DeviceTypeDirectory::standard_device_type_count + static_cast<std::size_t>(value - DeviceTypeDirectory::first_custom_device_type);
+      }
+      return (index < slot_count) ? &slots.at(index) : nullptr;
+   }
+
+   ///<summary> check whether a snapshot can be used.</summary>
+   bool is_current(const std::shared_ptr<const snapshot>& aSnapshot, std::chrono::milliseconds aMaxAge) const noexcept
+   {
+      return aSnapshot &&
+         (aSnapshot->generation == generation.load(std::memory_order_acquire)) &&
+         (std::chrono::steady_clock::now() - aSnapshot->taken < aMaxAge);
+   }
+
+   ///<summary> enumerate the device paths of a device type.</summary>
+   static std::shared_ptr<const device_paths> enumerate(DeviceTypeDirectory::DeviceType aDeviceType)
+   {
+      return std::make_shared<const device_paths>(DeviceDiscoverer(aDeviceType).device_path_map.get());
+   }
+
+public:
+
+   ///<summary> static getInstance (singleton).</summary>
+   static impl& getInstance() noexcept
+   {
+      static impl singleton;
+      return singleton;
+   }
+
+   ///<summary> copy constructor deleted (singleton).</summary>
+   impl(const impl& other) = delete;
+
+   ///<summary> move constructor deleted (singleton).</summary>
+   impl(impl&& other) noexcept = delete;
+
+   ///<summary> no copy assignment operator (singleton).</summary>
+   impl& operator=(impl& other) = delete;
+
+   ///<summary> no move assignment operator (singleton).</summary>
+   impl& operator=(impl&& other) = delete;
+
+   ///<summary> explicit default destructor (rule of 5).</summary>
+   ~impl() = default;
+
+   std::shared_ptr<const device_paths> get_device_paths(DeviceTypeDirectory::DeviceType aDeviceType, std::chrono::milliseconds aMaxAge)
+   {
+      auto slot = get_slot(aDeviceType);
+      if (slot == nullptr)
+      {
+         return enumerate(aDeviceType);   // (not cached)
+      }
+
+      // the fast path: a current snapshot
+      auto current = slot->load(std::memory_order_acquire);
+      if (is_current(current, aMaxAge))
+      {
+         return current->paths;
+      }
+
+      // the slow path: enumerate (unless another thread did so while this one waited)
+      std::lock_guard<std::mutex> lock(enumerating);
+      current = slot->load(std::memory_order_acquire);
+      if (is_current(current, aMaxAge))
+      {
+         return current->paths;
+      }
+
+      // an invalidation during enumeration leaves the new snapshot stale (it may have missed the change)
+      const std::uint64_t taken_generation = generation.load(std::memory_order_acquire);
+      const auto taken = std::chrono::steady_clock::now();
+      auto next = std::make_shared<const snapshot>(snapshot{ enumerate(aDeviceType), taken_generation, taken });
+      slot->store(next, std::memory_order_release);
+      return next->paths;
+   }
+
+   std::shared_ptr<const device_paths> peek_device_paths(DeviceTypeDirectory::DeviceType aDeviceType) noexcept
+   {
+      const auto slot = get_slot(aDeviceType);
+      if (slot == nullptr)
+      {
+         return nullptr;
+      }
+
+      const auto current = slot->load(std::memory_order_acquire);
+      return current ? current->paths : nullptr;
+   }
+
+   void invalidate() noexcept
+   {
+      generation.fetch_add(1, std::memory_order_acq_rel);
+   }
+
+   std::uint64_t get_generation() const noexcept
+   {
+      return generation.load(std::memory_order_acquire);
+   }
+};
+
+
+/*
+* ***************************************************************************
+* Public interface - forwards to the singleton
+* ***************************************************************************
+*/
+
+std::shared_ptr<const DeviceDiscoveryCache::device_paths> DeviceDiscoveryCache::get_device_paths(DeviceTypeDirectory::DeviceType aDeviceType, std::chrono::milliseconds aMaxAge)
+{
+   return impl::getInstance().get_device_paths(aDeviceType, aMaxAge);
+}
+
+std::shared_ptr<const DeviceDiscoveryCache::device_paths> DeviceDiscoveryCache::peek_device_paths(DeviceTypeDirectory::DeviceType aDeviceType) noexcept
+{
+   return impl::getInstance().peek_device_paths(aDeviceType);
+}
+
+void DeviceDiscoveryCache::invalidate() noexcept
+{
+   impl::getInstance().invalidate();
+}
+
+std::uint64_t DeviceDiscoveryCache::get_generation() noexcept
+{
+   return impl::getInstance().get_generation();
+}
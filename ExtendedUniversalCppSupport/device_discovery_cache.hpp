@@ -0,0 +1,82 @@
+//
+// device_discovery_cache.hpp : a process wide cache of enumerated device paths
+//
+// Enumerating device interfaces (see DeviceDiscoverer) is slow, and the answer seldom changes. Here the
+// device paths of each device type are kept as an immutable snapshot, shared by all readers. A snapshot
+// is used until it is invalidated (by DeviceMonitor, when windows reports a device change, or explicitly)
+// or it exceeds the age the caller accepts, so a repeat lookup costs about as much as reading a pointer.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __DEVICE_DISCOVERY_CACHE_HPP__
+#define __DEVICE_DISCOVERY_CACHE_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "device_type_directory.hpp"
+
+///<summary> caches the device paths of each device type (as DeviceDiscoverer enumerates them).</summary>
+///<remarks> lookups are lock free (enumeration is serialized). Safe to call concurrently from any thread.</remarks>
+class EXTENDEDUNIVERSALCPPSUPPORT_API DeviceDiscoveryCache {
+
+public:
+   ///<summary> the device paths of a device type, by zero based ordinal index (as DeviceDiscoverer::device_path_map).</summary>
+   using device_paths = std::map<int, std::string>;
+
+   ///<summary> the oldest snapshot get_device_paths returns by default.</summary>
+   static constexpr std::chrono::milliseconds default_max_age{ 1000 };
+
+   ///<summary> get the device paths of a device type, enumerating them only if the cached snapshot is stale.</summary>
+   ///<param name='aDeviceType'> the device type.</param>
+   ///<param name='aMaxAge'> the oldest snapshot acceptable (zero to always enumerate).</param>
+   ///<returns> the (shared, immutable) snapshot.</returns>
+   ///<exception cref='std::exception'> if the devices could not be enumerated.</exception>
+   static std::shared_ptr<const device_paths> get_device_paths(DeviceTypeDirectory::DeviceType aDeviceType, std::chrono::milliseconds aMaxAge = default_max_age);
+
+   ///<summary> get the cached device paths of a device type, however old, without ever enumerating.</summary>
+   ///<remarks> for paths that must not block or enumerate (E.g. a signal handler during process shutdown).</remarks>
+   ///<param name='aDeviceType'> the device type.</param>
+   ///<returns> the last snapshot taken, or nullptr if the device type was never enumerated (or cannot be cached).</returns>
+   static std::shared_ptr<const device_paths> peek_device_paths(DeviceTypeDirectory::DeviceType aDeviceType) noexcept;
+
+   ///<summary> mark every snapshot stale (E.g. when a device has been attached or detached).</summary>
+   static void invalidate() noexcept;
+
+   ///<summary> get the cache generation (incremented by each invalidate).</summary>
+   static std::uint64_t get_generation() noexcept;
+
+private:
+   ///<summary> not constructed (all members are static).</summary>
+   DeviceDiscoveryCache() = default;
+
+   ///<summary> forward reference to a private (singleton) inner implementation class.</summary>
+   ///<remarks> inner class holds the snapshots.</remarks>
+   class impl;
+};
+
+#endif // __DEVICE_DISCOVERY_CACHE_HPP__
@@ -0,0 +1,448 @@
+//
+// device_handle_pool.cpp : a process wide pool of open device handles
+//
+// Each pooled handle is an entry, keyed by device path and access. A user holds a shared handle whose
+// deleter returns the entry to the pool, and the entry counts its users. When the last user lets go, the
+// entry goes idle, and a reaper thread (running only while there are idle entries) closes it once it has
+// been idle for the idle timeout. Entries are closed by their destructor, so an entry that is retired or
+// reaped while still in use is closed when its last user lets go.
+//
+// On Windows a shared handle is the device HANDLE. Elsewhere (POSIX) it points to the file descriptor.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "device_handle_pool.hpp"
+
+#ifdef _WIN32
+///<summary> the system handle of an open device.</summary>
+using native_handle = HANDLE;
+
+///<summary> close the system handle of an open device.</summary>
+static void close_native_handle(native_handle hDevice) noexcept
+{
+   CloseHandle(hDevice);
+}
+#else
+///<summary> the system handle of an open device (a file descriptor).</summary>
+using native_handle = int;
+
+///<summary> close the system handle of an open device.</summary>
+static void close_native_handle(native_handle hDevice) noexcept
+{
+   ::close(hDevice);
+}
+#endif
+
+
+///<summary> the private implementation of DeviceHandlePool. A Singleton.</summary>
+///<remarks> shared, so that a handle released after the singleton is destroyed (E.g. held by another static object)
+/// can find that the pool is gone (its entry is then simply closed).</remarks>
+class DeviceHandlePool::impl : public std::enable_shared_from_this<DeviceHandlePool::impl>
+{
+
+private:
+   ///<summary> the key of a pooled handle.</summary>
+   using key = std::tuple<std::string, access, caching>;
+
+   ///<summary> an open device handle, and its users.</summary>
+   struct entry
+   {
+      key k;
+      native_handle hDevice;
+      std::size_t users;                                    // (guarded by the pool mutex)
+      std::chrono::steady_clock::time_point idle_since;     // when users fell to zero
+      bool pooled;                                          // false once retired or reaped
+
+      entry(const key& a_key, native_handle a_handle) :
+         k(a_key),
+         hDevice(a_handle),
+         users(0),
+         idle_since(),
+         pooled(true)
+      {
+      }
+
+      entry(const entry& other) = delete;
+      entry(entry&& other) = delete;
+      entry& operator=(const entry& other) = delete;
+      entry& operator=(entry&& other) = delete;
+
+      ///<summary> destructor closes the handle (when neither the pool nor any user holds the entry).</summary>
+      ~entry()
+      {
+         close_native_handle(hDevice);
+      }
+
+      ///<summary> get the shared handle value (on Windows the HANDLE, elsewhere a pointer to the file descriptor).</summary>
+      void* get_handle() noexcept
+      {
+#ifdef _WIN32
+         return hDevice;
+#else
+         return &hDevice;
+#endif
+      }
+   };
+
+   ///<summary> guards everything below.</summary>
+   std::mutex mutex;
+
+   ///<summary> signalled when the idle entries (or the idle timeout) change.</summary>
+   std::condition_variable idle_changed;
+
+   ///<summary> the pooled entries.</summary>
+   std::map<key, std::shared_ptr<entry>> entries;
+
+   ///<summary> how long an entry stays pooled after its last user lets go.</summary>
+   std::chrono::milliseconds idle_timeout;
+
+   ///<summary> the thread that closes idle entries (running while reaping).</summary>
+   std::thread reaper;
+   bool reaping;
+   bool stopping;
+
+   ///<summary> constructs the singleton DeviceHandlePool::impl.</summary>
+   impl() :
+      idle_timeout(default_idle_timeout),
+      reaping(false),
+      stopping(false)
+   {
+   }
+
+   ///<summary> open a device.</summary>
+   ///<param name='a_caching'> the caching asked for (set to buffered if the file system refused unbuffered i/o).</param>
+   ///<exception cref='std::exception'> if the device could not be opened.</exception>
+   static native_handle open_device(const std::string& device_path, access an_access, caching& a_caching)
+   {
+#ifdef _WIN32
+      const DWORD dwDesiredAccess = (an_access == access::read_write) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+      constexpr DWORD dwShareMode = FILE_SHARE_READ | FILE_SHARE_WRITE;
+      constexpr DWORD dwCreateDisposition = OPEN_EXISTING;
+      const DWORD dwFlagsAndAttributes = FILE_ATTRIBUTE_NORMAL | ((a_caching == caching::unbuffered) ? FILE_FLAG_NO_BUFFERING : 0);
+      HANDLE hTemplateFile = nullptr;
+
+      HANDLE hDevice = CreateFile(utf8::convert::to_small_utf16(device_path).c_str(),
+         dwDesiredAccess,
+         dwShareMode,
+         NULL, //lpSecurityAttributes,
+         dwCreateDisposition,
+         dwFlagsAndAttributes,
+         hTemplateFile
+      );
+
+      if (hDevice == INVALID_HANDLE_VALUE)
+      {
+         std::stringstream create_file_failed; create_file_failed << "CreateFile(\"" << device_path << "\", ...) failed";
+         throw error_context(create_file_failed.str().c_str());
+      }
+      return hDevice;
+#else
+      // non blocking, so that a drive without media can be opened (as on Windows). Regular files and block devices ignore it
+      int flags = O_CLOEXEC | O_NONBLOCK;
+#ifdef O_DIRECT
+      if (a_caching == caching::unbuffered)
+      {
+         flags |= O_DIRECT;
+      }
+#endif
+
+      int fd = ::open(device_path.c_str(), ((an_access == access::read_write) ? O_RDWR : O_RDONLY) | flags);
+      if ((fd == -1) && (an_access == access::read_write) && ((errno == EROFS) || (errno == EACCES)))
+      {
+         fd = ::open(device_path.c_str(), O_RDONLY | flags);    // (read only media, or a read only image file: writes will fail)
+      }
+#ifdef O_DIRECT
+      if ((fd == -1) && (errno == EINVAL) && ((flags & O_DIRECT) != 0))
+      {
+         a_caching = caching::buffered;   // (the file system does not support direct i/o, E.g. tmpfs)
+         return open_device(device_path, an_access, a_caching);
+      }
+#endif
+
+      if (fd == -1)
+      {
+         std::stringstream open_failed; open_failed << "open(\"" << device_path << "\", ...) failed";
+         throw error_context(open_failed.str().c_str());
+      }
+      return fd;
+#endif
+   }
+
+   ///<summary> return an entry to the pool (called as a shared handle is released).</summary>
+   void release(const std::shared_ptr<entry>& an_entry) noexcept
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      if ((--an_entry->users != 0) || !an_entry->pooled)
+      {
+         return;
+      }
+
+      if (idle_timeout.count() == 0)
+      {
+         an_entry->pooled = false;
+         entries.erase(an_entry->k);   // (closed as the releasing handle lets go of the entry)
+         return;
+      }
+
+      an_entry->idle_since = std::chrono::steady_clock::now();
+      start_reaper();
+   }
+
+   ///<summary> start the reaper thread, unless it is running.</summary>
+   ///<remarks> the caller holds the mutex. If the thread can't be started, idle entries stay open until the next release.</remarks>
+   void start_reaper() noexcept
+   {
+      if (reaping || stopping)
+      {
+         return;
+      }
+
+      try
+      {
+         if (reaper.joinable())
+         {
+            reaper.join();    // (the previous reaper has cleared reaping, so is exiting without the mutex)
+         }
+         reaper = std::thread([this]() { reap(); });
+         reaping = true;
+      }
+      catch (...)
+      {
+         // (retried at the next release)
+      }
+   }
+
+   ///<summary> the reaper thread. Closes entries that have been idle for the idle timeout, and exits when none are idle.</summary>
+   void reap() noexcept
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!stopping)
+      {
+         const auto now = std::chrono::steady_clock::now();
+         auto next_expiry = std::chrono::steady_clock::time_point::max();
+
+         for (auto it = entries.begin(); it != entries.end(); )
+         {
+            const auto& pooled_entry = it->second;
+            if (pooled_entry->users == 0)
+            {
+               const auto expiry = pooled_entry->idle_since + idle_timeout;
+               if (expiry <= now)
+               {
+                  pooled_entry->pooled = false;
+                  it = entries.erase(it);
+                  continue;
+               }
+               next_expiry = std::min(next_expiry, expiry);
+            }
+            ++it;
+         }
+
+         if (next_expiry == std::chrono::steady_clock::time_point::max())
+         {
+            break;   // nothing is idle
+         }
+         idle_changed.wait_until(lock, next_expiry);
+      }
+      reaping = false;
+   }
+
+public:
+
+   ///<summary> static getInstance (singleton).</summary>
+   static impl& getInstance() noexcept
+   {
+      static const std::shared_ptr<impl> singleton(new impl());
+      return *singleton;
+   }
+
+   ///<summary> copy constructor deleted (singleton).</summary>
+   impl(const impl& other) = delete;
+
+   ///<summary> move constructor deleted (singleton).</summary>
+   impl(impl&& other) noexcept = delete;
+
+   ///<summary> no copy assignment operator (singleton).</summary>
+   impl& operator=(impl& other) = delete;
+
+   ///<summary> no move assignment operator (singleton).</summary>
+   impl& operator=(impl&& other) = delete;
+
+   ///<summary> destructor stops the reaper thread (pooled handles are closed as the entries are destroyed).</summary>
+   ~impl()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stopping = true;
+      }
+      idle_changed.notify_all();
+
+      if (reaper.joinable())
+      {
+         reaper.join();
+      }
+   }
+
+   handle acquire(const std::string& device_path, access an_access, caching a_caching)
+   {
+      const key k(device_path, an_access, a_caching);
+      std::shared_ptr<entry> shared_entry;
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         const auto found = entries.find(k);
+         if (found != entries.end())
+         {
+            shared_entry = found->second;
+            ++shared_entry->users;
+         }
+      }
+
+      if (!shared_entry)
+      {
+         // open without the mutex (opening can be slow, and must not hold up the users of other devices)
+         caching opened_caching = a_caching;
+         const native_handle hDevice = open_device(device_path, an_access, opened_caching);
+         const key opened_key(device_path, an_access, opened_caching);
+         std::shared_ptr<entry> opened;
+         try
+         {
+            if (opened_caching != a_caching)
+            {
+               LOG_WARNING_FMT("unbuffered i/o is not supported for {}, it is opened buffered", device_path);
+            }
+            opened = std::make_shared<entry>(opened_key, hDevice);
+         }
+         catch (...)
+         {
+            close_native_handle(hDevice);
+            throw;
+         }
+
+         // (pooled under the caching it really has. If another thread opened the device meanwhile, its entry is shared,
+         //  and this one is closed)
+         std::lock_guard<std::mutex> lock(mutex);
+         shared_entry = entries.emplace(opened_key, opened).first->second;
+         ++shared_entry->users;
+      }
+
+      // (if the handle can't be allocated, the deleter is called, so the entry is still released)
+      return handle(shared_entry->get_handle(), [pool = weak_from_this(), shared_entry](void*)
+      {
+         if (const auto alive = pool.lock())
+         {
+            alive->release(shared_entry);
+         }
+      });
+   }
+
+   void retire(const std::string& device_path) noexcept
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto it = entries.begin(); it != entries.end(); )
+      {
+         if (std::get<std::string>(it->first) == device_path)
+         {
+            it->second->pooled = false;
+            it = entries.erase(it);
+         }
+         else
+         {
+            ++it;
+         }
+      }
+   }
+
+   void close_idle() noexcept
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto it = entries.begin(); it != entries.end(); )
+      {
+         if (it->second->users == 0)
+         {
+            it->second->pooled = false;
+            it = entries.erase(it);
+         }
+         else
+         {
+            ++it;
+         }
+      }
+   }
+
+   void set_idle_timeout(std::chrono::milliseconds an_idle_timeout) noexcept
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         idle_timeout = an_idle_timeout;
+      }
+      idle_changed.notify_all();
+   }
+
+   std::size_t get_open_count() noexcept
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      return entries.size();
+   }
+};
+
+
+/*
+* ***************************************************************************
+* Public interface - forwards to the singleton
+* ***************************************************************************
+*/
+
+DeviceHandlePool::handle DeviceHandlePool::acquire(const std::string& device_path, access an_access, caching a_caching)
+{
+   return impl::getInstance().acquire(device_path, an_access, a_caching);
+}
+
+void DeviceHandlePool::retire(const std::string& device_path) noexcept
+{
+   impl::getInstance().retire(device_path);
+}
+
+void DeviceHandlePool::close_idle() noexcept
+{
+   impl::getInstance().close_idle();
+}
+
+void DeviceHandlePool::set_idle_timeout(std::chrono::milliseconds an_idle_timeout) noexcept
+{
+   impl::getInstance().set_idle_timeout(an_idle_timeout);
+}
+
+std::size_t DeviceHandlePool::get_open_count() noexcept
+{
+   return impl::getInstance().get_open_count();
+}
@@ -0,0 +1,102 @@
+//
+// device_handle_pool.hpp : a process wide pool of open device handles
+//
+// Opening a device is expensive (an optical drive may spin up), and several objects often need the same
+// device at once (E.g. a rip, its RAII locks, and a signal handler). Here open handles are shared by device
+// path and access, reference counted, and kept open for a while after their last user lets go, so that a
+// device that is opened again soon is not opened again at all.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __DEVICE_HANDLE_POOL_HPP__
+#define __DEVICE_HANDLE_POOL_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+///<summary> shares open device handles by device path and access (Device acquires its handle here).</summary>
+///<remarks> safe to call concurrently from any thread. A shared handle has one file pointer, so users of a handle
+/// must read and write at explicit offsets (as Device does).</remarks>
+class EXTENDEDUNIVERSALCPPSUPPORT_API DeviceHandlePool {
+
+public:
+   ///<summary> the access a handle is opened with.</summary>
+   enum class access
+   {
+      read,
+      read_write
+   };
+
+   ///<summary> whether i/o on a handle goes through the system cache.</summary>
+   ///<remarks> unbuffered i/o (FILE_FLAG_NO_BUFFERING, or O_DIRECT) needs offsets, sizes and buffer addresses aligned
+   /// (see DeviceCapabilities::buffer_alignment). Where the file system refuses it, the handle is opened buffered (the
+   /// downgrade is logged as a warning), and pooled as a buffered handle.</remarks>
+   enum class caching
+   {
+      buffered,
+      unbuffered
+   };
+
+   ///<summary> a shared (system) device handle. The handle is returned to the pool when the last copy is released.</summary>
+   ///<remarks> on Windows this holds the HANDLE. Elsewhere (POSIX) it points to the file descriptor.</remarks>
+   using handle = std::shared_ptr<void>;
+
+   ///<summary> how long a handle stays open after its last user releases it (by default).</summary>
+   static constexpr std::chrono::milliseconds default_idle_timeout{ 2000 };
+
+   ///<summary> get a shared handle to a device, opening the device only if no handle is pooled.</summary>
+   ///<param name='device_path'> the system name of the device.</param>
+   ///<param name='an_access'> the access required.</param>
+   ///<param name='a_caching'> whether i/o goes through the system cache (handles are pooled separately for each).</param>
+   ///<returns> the shared handle.</returns>
+   ///<exception cref='std::exception'> if the device could not be opened.</exception>
+   static handle acquire(const std::string& device_path, access an_access = access::read_write, caching a_caching = caching::buffered);
+
+   ///<summary> retire the pooled handles of a device, so that the next acquire opens the device again.</summary>
+   ///<remarks> handles already acquired stay usable, and are closed when released (used by Device::reset).</remarks>
+   ///<param name='device_path'> the system name of the device.</param>
+   static void retire(const std::string& device_path) noexcept;
+
+   ///<summary> close every pooled handle that has no user (without waiting for the idle timeout).</summary>
+   static void close_idle() noexcept;
+
+   ///<summary> set how long a handle stays open after its last user releases it.</summary>
+   ///<param name='an_idle_timeout'> the idle time (zero closes handles as soon as they are released).</param>
+   static void set_idle_timeout(std::chrono::milliseconds an_idle_timeout) noexcept;
+
+   ///<summary> get the number of pooled handles (in use, or idle).</summary>
+   static std::size_t get_open_count() noexcept;
+
+private:
+   ///<summary> not constructed (all members are static).</summary>
+   DeviceHandlePool() = default;
+
+   ///<summary> forward reference to a private (singleton) inner implementation class.</summary>
+   ///<remarks> inner class holds the handles, and the thread that closes idle handles.</remarks>
+   class impl;
+};
+
+#endif // __DEVICE_HANDLE_POOL_HPP__
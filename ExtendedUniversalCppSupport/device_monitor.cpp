@@ -0,0 +1,653 @@
+//
+// device_monitor.cpp : delivers device attach/detach and media insert/remove events
+//
+// A background thread compares the devices (and media) present with those seen last time, and queues
+// and dispatches an event for each difference. Windows broadcasts WM_DEVICECHANGE to top level windows
+// when device interfaces arrive or are removed, and when media is inserted or removed, so a hidden
+// window (with a message loop on a thread of its own) is used to wake the monitor thread at once.
+// Without broadcasts the devices are polled at an adaptive interval. With them, media is still checked at a
+// slow interval, for the changes that no broadcast reports (E.g. an audio or blank disc).
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#include <dbt.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "cd_rom_device.hpp"
+#include "device_discovery_cache.hpp"
+#include "device_monitor.hpp"
+#include "utf8_guid.hpp"
+
+#define DEVICE_MONITOR_WARNINGS_SUPPRESSED 26490
+#pragma warning(disable: DEVICE_MONITOR_WARNINGS_SUPPRESSED)
+
+/*
+* ***************************************************************************
+* Device change broadcasts (wake a monitor when windows reports a change)
+* ***************************************************************************
+*/
+
+///<summary> receives device change broadcasts in a hidden top level window.</summary>
+///<remarks> device interface arrival and removal is registered for explicitly. Media arrival and removal (volume)
+/// broadcasts can't be registered for: they go to all top level windows (but not to message only windows), which is
+/// why this window is a top level one. Only arrival and removal wake the monitor (other broadcasts are ignored).</remarks>
+class device_change_window
+{
+public:
+   ///<summary> create the window (on a thread of its own), and register for device interface notifications.</summary>
+   ///<param name='anInterfaceClassGuid'> the device interface class to be notified about.</param>
+   ///<param name='aWake'> called (on the window thread) for each arrival or removal broadcast, with true for a device
+   /// interface (false for a volume, E.g. media being inserted or removed).</param>
+   ///<exception cref='std::exception'> if the window could not be created.</exception>
+   device_change_window(const GUID& anInterfaceClassGuid, std::function<void(bool)> aWake) :
+      m_wake(std::move(aWake)),
+      m_notification(nullptr),
+      m_hwnd(nullptr)
+   {
+      std::promise<HWND> created;
+      auto window = created.get_future();
+      m_thread = std::thread([this, anInterfaceClassGuid, created = std::move(created)]() mutable { run(anInterfaceClassGuid, created); });
+      m_hwnd = window.get();
+      if (m_hwnd == nullptr)
+      {
+         m_thread.join();
+         throw error_context("DeviceMonitor: device change window could not be created");
+      }
+   }
+
+   ///<summary> no copy constructor (the window refers to this object).</summary>
+   device_change_window(const device_change_window& other) = delete;
+
+   ///<summary> no copy assignment operator (the window refers to this object).</summary>
+   device_change_window& operator=(const device_change_window& other) = delete;
+
+   ///<summary> close the window (unregistering the notifications), and end its thread.</summary>
+   ~device_change_window()
+   {
+      PostMessageW(m_hwnd, WM_CLOSE, 0, 0);
+      m_thread.join();
+   }
+
+private:
+   ///<summary> the window class name.</summary>
+   static constexpr const wchar_t* class_name = L"DeviceMonitorWindow";
+
+   ///<summary> called for each arrival or removal broadcast.</summary>
+   std::function<void(bool)> m_wake;
+
+   ///<summary> the device interface notification registration.</summary>
+   HDEVNOTIFY m_notification;
+
+   ///<summary> the hidden window.</summary>
+   HWND m_hwnd;
+
+   ///<summary> the window thread (runs the message loop).</summary>
+   std::thread m_thread;
+
+   ///<summary> register the window class (once per process).</summary>
+   static bool register_class() noexcept
+   {
+      static const ATOM atom = []() noexcept
+      {
+         WNDCLASSEXW windowClass{};
+         windowClass.cbSize = sizeof(windowClass);
+         windowClass.lpfnWndProc = &window_procedure;
+         windowClass.hInstance = GetModuleHandleW(nullptr);
+         windowClass.lpszClassName = class_name;
+         return RegisterClassExW(&windowClass);
+      }();
+      return atom != 0;
+   }
+
+   ///<summary> the window thread: create the window, then pump messages until it is closed.</summary>
+   void run(GUID anInterfaceClassGuid, std::promise<HWND>& created) noexcept
+   {
+      const HWND hwnd = register_class() ?
+         CreateWindowExW(0, class_name, L"", WS_OVERLAPPED, 0, 0, 0, 0, nullptr, nullptr, GetModuleHandleW(nullptr), this) :
+         nullptr;
+
+      if (hwnd != nullptr)
+      {
+         DEV_BROADCAST_DEVICEINTERFACE_W filter{};
+         filter.dbcc_size = sizeof(filter);
+         filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+         filter.dbcc_classguid = anInterfaceClassGuid;
+         m_notification = RegisterDeviceNotificationW(hwnd, &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+      }
+
+      created.set_value(hwnd);
+      if (hwnd == nullptr)
+      {
+         return;
+      }
+
+      MSG msg{};
+      while (GetMessageW(&msg, nullptr, 0, 0) > 0)
+      {
+         DispatchMessageW(&msg);
+      }
+   }
+
+   ///<summary> the window procedure.</summary>
+   static LRESULT CALLBACK window_procedure(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+   {
+      if (message == WM_NCCREATE)
+      {
+         SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(reinterpret_cast<const CREATESTRUCTW*>(lParam)->lpCreateParams));
+      }
+
+      auto self = reinterpret_cast<device_change_window*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+      switch (message)
+      {
+      case WM_DEVICECHANGE:
+         if ((self != nullptr) && ((wParam == DBT_DEVICEARRIVAL) || (wParam == DBT_DEVICEREMOVECOMPLETE)) && (lParam != 0))
+         {
+            const auto header = reinterpret_cast<const DEV_BROADCAST_HDR*>(lParam);
+            if ((header->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE) || (header->dbch_devicetype == DBT_DEVTYP_VOLUME))
+            {
+               self->m_wake(header->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE);
+            }
+         }
+         return TRUE;
+
+      case WM_DESTROY:
+         if ((self != nullptr) && (self->m_notification != nullptr))
+         {
+            UnregisterDeviceNotification(self->m_notification);
+            self->m_notification = nullptr;
+         }
+         PostQuitMessage(0);
+         return 0;
+
+      default:
+         return DefWindowProcW(hwnd, message, wParam, lParam);
+      }
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of DeviceMonitor class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of DeviceMonitor.</summary>
+class DeviceMonitor::impl
+{
+private:
+   ///<summary> what is watched.</summary>
+   const Source m_source;
+
+   ///<summary> the polling interval bounds.</summary>
+   const Polling m_polling;
+
+   ///<summary> guards everything below.</summary>
+   mutable std::mutex m_mutex;
+
+   ///<summary> signalled to wake the monitor thread (refresh, notifications and stopping).</summary>
+   std::condition_variable m_wake;
+
+   ///<summary> signalled when an event is queued.</summary>
+   std::condition_variable m_queued;
+
+   ///<summary> the devices (and whether they hold media) when last checked, in enumeration order.</summary>
+   std::vector<std::pair<std::string, bool>> m_devices;
+
+   ///<summary> the queued events.</summary>
+   std::deque<Event> m_events;
+
+   ///<summary> the subscribers (by subscription id).</summary>
+   std::map<int, std::shared_ptr<const Callback>> m_subscribers;
+
+   ///<summary> the next subscription id.</summary>
+   int m_next_subscription;
+
+   ///<summary> set to check the devices without waiting for the next poll.</summary>
+   bool m_woken;
+
+   ///<summary> set to stop the monitor thread.</summary>
+   bool m_stopping;
+
+   ///<summary> the notification registration (if the source supports notifications).</summary>
+   std::shared_ptr<void> m_registration;
+
+   ///<summary> the monitor thread.</summary>
+   std::thread m_thread;
+
+public:
+   ///<summary> read the initial state, register for notifications, and start the monitor thread.</summary>
+   impl(Source aSource, Polling aPolling) :
+      m_source(std::move(aSource)),
+      m_polling(aPolling),
+      m_next_subscription(0),
+      m_woken(false),
+      m_stopping(false)
+   {
+      if (!m_source.enumerate)
+      {
+         throw error_context("DeviceMonitor: the source cannot enumerate devices");
+      }
+
+      m_devices = check(m_source.enumerate());
+
+      if (m_source.watch)
+      {
+         try
+         {
+            m_registration = m_source.watch([this]() { refresh(); });
+         }
+         catch (const std::exception& e)
+         {
+            LOG_WARNING_FMT("DeviceMonitor notifications are unavailable (polling only): {}", e.what());
+         }
+      }
+
+      m_thread = std::thread([this]() { run(); });
+   }
+
+   ///<summary> no copy constructor (the monitor thread refers to this object).</summary>
+   impl(const impl& other) = delete;
+
+   ///<summary> no copy assignment operator (the monitor thread refers to this object).</summary>
+   impl& operator=(const impl& other) = delete;
+
+   ///<summary> stop the monitor thread, and unregister notifications.</summary>
+   ~impl()
+   {
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_stopping = true;
+      }
+      m_wake.notify_all();
+      m_thread.join();
+      m_registration.reset();
+   }
+
+   int subscribe(Callback aCallback)
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const int subscription = m_next_subscription++;
+      m_subscribers.emplace(subscription, std::make_shared<const Callback>(std::move(aCallback)));
+      return subscription;
+   }
+
+   void unsubscribe(int aSubscription) noexcept
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_subscribers.erase(aSubscription);
+   }
+
+   std::optional<Event> wait_for_event(std::chrono::milliseconds aTimeout)
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (!m_queued.wait_for(lock, aTimeout, [this]() { return !m_events.empty(); }))
+      {
+         return std::nullopt;
+      }
+
+      Event event = std::move(m_events.front());
+      m_events.pop_front();
+      return event;
+   }
+
+   Event wait_for_event()
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_queued.wait(lock, [this]() { return !m_events.empty(); });
+
+      Event event = std::move(m_events.front());
+      m_events.pop_front();
+      return event;
+   }
+
+   std::vector<std::string> get_devices() const
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      std::vector<std::string> paths;
+      paths.reserve(m_devices.size());
+      for (const auto& device : m_devices)
+      {
+         paths.push_back(device.first);
+      }
+      return paths;
+   }
+
+   bool has_media(const std::string& aDevicePath) const
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const auto found = std::find_if(m_devices.begin(), m_devices.end(), [&aDevicePath](const auto& device) { return device.first == aDevicePath; });
+      return (found != m_devices.end()) && found->second;
+   }
+
+   void refresh() noexcept
+   {
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_woken = true;
+      }
+      m_wake.notify_all();
+   }
+
+private:
+   ///<summary> the monitor thread: check the devices when woken, and report the differences.</summary>
+   ///<remarks> with notifications the device list is only read when woken (by a notification, or refresh), and the
+   /// media of the devices already known is checked every media_interval. Without them, the devices are also checked at
+   /// each poll.</remarks>
+   void run() noexcept
+   {
+      auto interval = m_polling.min_interval;
+
+      for (;;)
+      {
+         bool woken = false;
+         {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_registration)
+            {
+               m_wake.wait_for(lock, m_polling.media_interval, [this]() { return m_woken || m_stopping; });
+            }
+            else
+            {
+               m_wake.wait_for(lock, interval, [this]() { return m_woken || m_stopping; });
+            }
+            if (m_stopping)
+            {
+               return;
+            }
+            woken = std::exchange(m_woken, false);
+         }
+
+         const bool changed = poll(woken || !m_registration);
+         interval = (changed || woken) ? m_polling.min_interval : std::min(interval * 2, m_polling.max_interval);
+      }
+   }
+
+   ///<summary> check the devices, queue and dispatch an event for each difference.</summary>
+   ///<param name='enumerate'> true to read the device list (otherwise only the media of the devices known is checked).</param>
+   ///<returns> true if anything changed.</returns>
+   bool poll(bool enumerate) noexcept
+   {
+      try
+      {
+         auto devices = check(enumerate ? m_source.enumerate() : get_devices());
+
+         std::vector<Event> events;
+         std::vector<std::shared_ptr<const Callback>> subscribers;
+         {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            events = compare(m_devices, devices);
+            if (events.empty())
+            {
+               return false;
+            }
+
+            m_devices = std::move(devices);
+            for (const auto& event : events)
+            {
+               if (m_events.size() == max_queued_events)
+               {
+                  m_events.pop_front();
+               }
+               m_events.push_back(event);
+            }
+            for (const auto& subscriber : m_subscribers)
+            {
+               subscribers.push_back(subscriber.second);
+            }
+         }
+         m_queued.notify_all();
+
+         for (const auto& event : events)
+         {
+            for (const auto& subscriber : subscribers)
+            {
+               try
+               {
+                  (*subscriber)(event);
+               }
+               catch (const std::exception& e)
+               {
+                  LOG_WARNING_FMT("DeviceMonitor subscriber failed: {}", e.what());
+               }
+            }
+         }
+         return true;
+      }
+      catch (const std::exception& e)
+      {
+         LOG_RATE_LIMITED(LogLevel::Warning, 1, std::string("DeviceMonitor could not check devices: ").append(e.what()));   // keep polling
+         return false;
+      }
+   }
+
+   ///<summary> check each device for media.</summary>
+   std::vector<std::pair<std::string, bool>> check(const std::vector<std::string>& paths) const
+   {
+      std::vector<std::pair<std::string, bool>> devices;
+      devices.reserve(paths.size());
+      for (const auto& path : paths)
+      {
+         // a device that cannot answer (E.g. one being removed) is treated as empty
+         const bool media = m_source.check_for_media ? m_source.check_for_media(path).value_or(false) : false;
+         devices.emplace_back(path, media);
+      }
+      return devices;
+   }
+
+   ///<summary> get the events that describe the differences between two device lists.</summary>
+   static std::vector<Event> compare(const std::vector<std::pair<std::string, bool>>& before, const std::vector<std::pair<std::string, bool>>& after)
+   {
+      const auto find = [](const std::vector<std::pair<std::string, bool>>& devices, const std::string& path)
+      {
+         return std::find_if(devices.begin(), devices.end(), [&path](const auto& device) { return device.first == path; });
+      };
+
+      std::vector<Event> events;
+      for (const auto& device : before)
+      {
+         if (find(after, device.first) == after.end())
+         {
+            if (device.second)
+            {
+               events.push_back({ EventType::media_removed, device.first });
+            }
+            events.push_back({ EventType::device_detached, device.first });
+         }
+      }
+
+      for (const auto& device : after)
+      {
+         const auto previous = find(before, device.first);
+         if (previous == before.end())
+         {
+            events.push_back({ EventType::device_attached, device.first });
+            if (device.second)
+            {
+               events.push_back({ EventType::media_inserted, device.first });
+            }
+         }
+         else if (previous->second != device.second)
+         {
+            events.push_back({ device.second ? EventType::media_inserted : EventType::media_removed, device.first });
+         }
+      }
+      return events;
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for DeviceMonitor implementation
+* ***************************************************************************
+*/
+
+///<summary> get the source for the system devices of a device type.</summary>
+DeviceMonitor::Source DeviceMonitor::system_source(DeviceTypeDirectory::DeviceType aDeviceType)
+{
+   Source source;
+
+   // enumeration goes through the process wide cache (a broadcast invalidates it, before waking the monitor)
+   source.enumerate = [aDeviceType]()
+   {
+      std::vector<std::string> paths;
+      for (const auto& device : *DeviceDiscoveryCache::get_device_paths(aDeviceType))
+      {
+         paths.push_back(device.second);
+      }
+      return paths;
+   };
+
+   if (aDeviceType == DeviceTypeDirectory::DeviceType::CDROM_DEVICES)
+   {
+      source.check_for_media = [](const std::string& aDevicePath) -> error::expected<bool>
+      {
+         try
+         {
+            return CdromDevice(aDevicePath).check_for_media_present(std::nothrow);
+         }
+         catch (const std::exception&)
+         {
+            return error_code_context("DeviceMonitor: device could not be opened");
+         }
+      };
+   }
+
+   const GUID interfaceClassGuid = utf8::guid_convert::to_guid(DeviceTypeDirectory::get_device_type_guid(aDeviceType));
+   source.watch = [interfaceClassGuid](std::function<void()> aWake) -> std::shared_ptr<void>
+   {
+      return std::make_shared<device_change_window>(interfaceClassGuid, [aWake](bool aDeviceInterfaceChanged)
+      {
+         if (aDeviceInterfaceChanged)
+         {
+            DeviceDiscoveryCache::invalidate();   // (media coming and going doesn't change the device list)
+         }
+         aWake();
+      });
+   };
+
+   return source;
+}
+
+///<summary> get a source that treats the files in a directory as devices (a stand-in for testing).</summary>
+DeviceMonitor::Source DeviceMonitor::directory_source(const std::string& aDirectory)
+{
+   Source source;
+
+   source.enumerate = [aDirectory]()
+   {
+      std::vector<std::string> paths;
+      WIN32_FIND_DATAW findData{};
+      const HANDLE hFind = FindFirstFileW(utf8::convert::to_utf16(aDirectory + "\\*").c_str(), &findData);
+      if (hFind == INVALID_HANDLE_VALUE)
+      {
+         if (GetLastError() == ERROR_FILE_NOT_FOUND)
+         {
+            return paths;   // an empty directory
+         }
+         throw error_context("DeviceMonitor: directory could not be read");
+      }
+
+      do
+      {
+         if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+         {
+            paths.push_back(aDirectory + "\\" + utf8::convert::from_utf16(findData.cFileName));
+         }
+      } while (FindNextFileW(hFind, &findData));
+
+      FindClose(hFind);
+      std::sort(paths.begin(), paths.end());
+      return paths;
+   };
+
+   source.check_for_media = [](const std::string& aDevicePath) -> error::expected<bool>
+   {
+      WIN32_FILE_ATTRIBUTE_DATA attributes{};
+      if (!GetFileAttributesExW(utf8::convert::to_utf16(aDevicePath).c_str(), GetFileExInfoStandard, &attributes))
+      {
+         return error_code_context("DeviceMonitor: file could not be read");
+      }
+      return (attributes.nFileSizeHigh != 0) || (attributes.nFileSizeLow != 0);
+   };
+
+   return source;
+}
+
+///<summary> construct a monitor for the system devices of a device type.</summary>
+DeviceMonitor::DeviceMonitor(DeviceTypeDirectory::DeviceType aDeviceType) :
+   DeviceMonitor(system_source(aDeviceType), Polling())
+{
+}
+
+///<summary> construct a monitor for any source of devices.</summary>
+DeviceMonitor::DeviceMonitor(Source aSource) :
+   DeviceMonitor(std::move(aSource), Polling())
+{
+}
+
+///<summary> construct a monitor for any source of devices.</summary>
+DeviceMonitor::DeviceMonitor(Source aSource, Polling aPolling) :
+   pimpl(spimpl::make_unique_impl<impl>(std::move(aSource), aPolling))
+{
+}
+
+int DeviceMonitor::subscribe(Callback aCallback)
+{
+   return pimpl->subscribe(std::move(aCallback));
+}
+
+void DeviceMonitor::unsubscribe(int aSubscription) noexcept
+{
+   pimpl->unsubscribe(aSubscription);
+}
+
+std::optional<DeviceMonitor::Event> DeviceMonitor::wait_for_event(std::chrono::milliseconds aTimeout)
+{
+   return pimpl->wait_for_event(aTimeout);
+}
+
+DeviceMonitor::Event DeviceMonitor::wait_for_event()
+{
+   return pimpl->wait_for_event();
+}
+
+std::vector<std::string> DeviceMonitor::get_devices() const
+{
+   return pimpl->get_devices();
+}
+
+bool DeviceMonitor::has_media(const std::string& aDevicePath) const
+{
+   return pimpl->has_media(aDevicePath);
+}
+
+void DeviceMonitor::refresh() noexcept
+{
+   pimpl->refresh();
+}
+
+#pragma warning(default: DEVICE_MONITOR_WARNINGS_SUPPRESSED)
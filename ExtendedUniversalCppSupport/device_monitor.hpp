@@ -0,0 +1,171 @@
+//
+// device_monitor.hpp : delivers device attach/detach and media insert/remove events
+//
+// A DeviceMonitor watches the devices of a particular type (defined by DeviceType) from a background
+// thread, and reports changes to subscribers (callbacks) and through a wait-able event queue. System
+// devices are watched with OS device notifications (which wake the monitor at once), and their media is
+// checked at a slow interval for the changes the OS does not report. A source without notifications is
+// polled at an adaptive interval (short after a change, growing while nothing happens). Any other source
+// of devices (E.g. a test stand-in) can be watched by supplying a Source.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __DEVICE_MONITOR_HPP__
+#define __DEVICE_MONITOR_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <expected.hpp>
+#include <spimpl.hpp>
+
+#include "device_type_directory.hpp"
+
+///<summary> watches a set of devices, and reports devices and media coming and going.</summary>
+///<remarks> The initial state is read at construction (see get_devices and has_media), and events report changes
+/// from then on. Safe to call concurrently from any thread. Not copyable (a monitor owns its thread), but movable.</remarks>
+class DeviceMonitor
+{
+public:
+   ///<summary> the kinds of change reported.</summary>
+   enum class EventType
+   {
+      device_attached,
+      device_detached,
+      media_inserted,
+      media_removed
+   };
+
+   ///<summary> a change to a device.</summary>
+   struct Event
+   {
+      EventType type;
+      std::string device_path;
+   };
+
+   ///<summary> a subscriber (called on the monitor thread, so it should return promptly).</summary>
+   using Callback = std::function<void(const Event&)>;
+
+   ///<summary> what is watched, and how.</summary>
+   struct Source
+   {
+      ///<summary> list the paths of the devices currently present.</summary>
+      std::function<std::vector<std::string>()> enumerate;
+
+      ///<summary> check a device for media (optional: without it no media events are reported).</summary>
+      std::function<error::expected<bool>(const std::string&)> check_for_media;
+
+      ///<summary> register for notifications, calling wake when anything may have changed (optional: without it the
+      /// monitor polls). Called once, when the monitor starts. With a registration the device list is only read when
+      /// woken, and media is still checked every Polling::media_interval (not every change of media is notified). The
+      /// registration returned is released (to unregister) when the monitor stops.</summary>
+      std::function<std::shared_ptr<void>(std::function<void()>)> watch;
+   };
+
+   ///<summary> the polling interval bounds (the interval doubles from min_interval to max_interval while nothing changes).</summary>
+   ///<remarks> min_interval and max_interval are only used by a source without notifications (see Source::watch).</remarks>
+   struct Polling
+   {
+      std::chrono::milliseconds min_interval{ 20 };
+      std::chrono::milliseconds max_interval{ 1000 };
+
+      ///<summary> how often a source with notifications is still checked for media (Windows broadcasts no media change
+      /// for audio or blank discs, or for drives without a drive letter).</summary>
+      std::chrono::milliseconds media_interval{ 2000 };
+   };
+
+   ///<summary> the most events held in the queue (the oldest are discarded when nobody waits for events).</summary>
+   static constexpr std::size_t max_queued_events = 256;
+
+   ///<summary> get the source for the system devices of a device type.</summary>
+   ///<remarks> CDROM_DEVICES are also checked for media. Device and volume (media) arrival and removal broadcasts
+   /// wake the monitor (so the device list isn't polled, and media only slowly, see Polling::media_interval).</remarks>
+   ///<param name='aDeviceType'> the device type to be watched.</param>
+   EXTENDEDUNIVERSALCPPSUPPORT_API static Source system_source(DeviceTypeDirectory::DeviceType aDeviceType);
+
+   ///<summary> get a source that treats the files in a directory as devices (a stand-in for testing).</summary>
+   ///<remarks> each regular file is a device (its path is the device path), holding media when it is not empty.</remarks>
+   ///<param name='aDirectory'> the (utf8 encoded) directory path.</param>
+   EXTENDEDUNIVERSALCPPSUPPORT_API static Source directory_source(const std::string& aDirectory);
+
+   ///<summary> construct a monitor for the system devices of a device type (with the default polling interval bounds).</summary>
+   ///<param name='aDeviceType'> the device type to be watched.</param>
+   ///<exception cref='std::exception'> if the devices could not be enumerated, or the monitor thread could not be started.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceMonitor(DeviceTypeDirectory::DeviceType aDeviceType);
+
+   ///<summary> construct a monitor for any source of devices (with the default polling interval bounds).</summary>
+   ///<param name='aSource'> the source (enumerate is required).</param>
+   ///<exception cref='std::exception'> if the devices could not be enumerated, or the monitor thread could not be started.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceMonitor(Source aSource);
+
+   ///<summary> construct a monitor for any source of devices.</summary>
+   ///<param name='aSource'> the source (enumerate is required).</param>
+   ///<param name='aPolling'> the polling interval bounds.</param>
+   ///<exception cref='std::exception'> if the devices could not be enumerated, or the monitor thread could not be started.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceMonitor(Source aSource, Polling aPolling);
+
+   ///<summary> subscribe to events.</summary>
+   ///<param name='aCallback'> called (on the monitor thread) for each event.</param>
+   ///<returns> a subscription id (for unsubscribe).</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API int subscribe(Callback aCallback);
+
+   ///<summary> unsubscribe from events.</summary>
+   ///<remarks> the callback may still be running (on the monitor thread) when this returns.</remarks>
+   ///<param name='aSubscription'> the id returned by subscribe.</param>
+   EXTENDEDUNIVERSALCPPSUPPORT_API void unsubscribe(int aSubscription) noexcept;
+
+   ///<summary> take the next event from the queue, waiting for one if necessary.</summary>
+   ///<param name='aTimeout'> the longest time to wait.</param>
+   ///<returns> the event, or nothing if the wait timed out.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::optional<Event> wait_for_event(std::chrono::milliseconds aTimeout);
+
+   ///<summary> take the next event from the queue, waiting as long as necessary.</summary>
+   ///<returns> the event.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API Event wait_for_event();
+
+   ///<summary> get the paths of the devices present (when last checked), in enumeration order.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::vector<std::string> get_devices() const;
+
+   ///<summary> check whether a device held media (when last checked).</summary>
+   ///<param name='aDevicePath'> the device path.</param>
+   ///<returns> true if the device is present and holds media, otherwise false.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API bool has_media(const std::string& aDevicePath) const;
+
+   ///<summary> check the devices now (without waiting for the next poll).</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API void refresh() noexcept;
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default move support (the monitor thread only refers to the implementation).</remarks>
+   spimpl::unique_impl_ptr<impl> pimpl;
+};
+
+#endif // __DEVICE_MONITOR_HPP__
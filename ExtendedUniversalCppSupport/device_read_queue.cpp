@@ -0,0 +1,709 @@
+//
+// device_read_queue.cpp : keeps many reads of a device in flight
+//
+// Each read in flight has a slot. Slots are issued in offset order, and (as reads complete in any order)
+// handed over in offset order, so a slot is only reused once every earlier slot has been handed over. A
+// short read is read again from where it stopped, and a read of nothing marks the end of the device. After
+// an error (or a sink exception), nothing more is issued, and the reads in flight are completed before
+// returning, so the kernel never writes to memory the caller has been given back.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#ifdef __linux__
+#include <atomic>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#include "device_handle_pool.hpp"
+#include "device_read_queue.hpp"
+
+///<summary> the alignment of the queue's buffers (a page, so they also suit unbuffered reads).</summary>
+constexpr std::size_t buffer_alignment = 4096;
+
+///<summary> releases memory allocated with buffer_alignment.</summary>
+struct aligned_delete
+{
+   void operator()(unsigned char* lpMemory) const noexcept
+   {
+      ::operator delete[](lpMemory, std::align_val_t(buffer_alignment));
+   }
+};
+
+#ifdef __linux__
+///<summary> an io_uring (its submission and completion queues, mapped into this process).</summary>
+///<remarks> used by one thread at a time, so only the queue indices shared with the kernel are atomic.</remarks>
+class io_ring
+{
+private:
+   int ring_fd;
+   unsigned sq_entries;
+   void* sq_ring;
+   std::size_t sq_ring_size;
+   void* cq_ring;
+   std::size_t cq_ring_size;
+   io_uring_sqe* sqes;
+   std::size_t sqes_size;
+
+   unsigned* sq_tail;
+   unsigned sq_mask;
+   unsigned* sq_array;
+   unsigned* cq_head;
+   unsigned* cq_tail;
+   unsigned cq_mask;
+   const io_uring_cqe* cqes;
+
+   ///<summary> the queued entries not yet submitted.</summary>
+   unsigned to_submit;
+
+   ///<summary> map a region of the ring.</summary>
+   void* map(std::size_t size, off_t offset) const noexcept
+   {
+      void* region = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+      return (region == MAP_FAILED) ? nullptr : region;
+   }
+
+   ///<summary> offset into a mapped region.</summary>
+   template<typename T>
+   static T* at(void* region, std::uint32_t offset) noexcept
+   {
+      return reinterpret_cast<T*>(static_cast<unsigned char*>(region) + offset);
+   }
+
+public:
+   io_ring() noexcept :
+      ring_fd(-1), sq_entries(0), sq_ring(nullptr), sq_ring_size(0), cq_ring(nullptr), cq_ring_size(0), sqes(nullptr), sqes_size(0),
+      sq_tail(nullptr), sq_mask(0), sq_array(nullptr), cq_head(nullptr), cq_tail(nullptr), cq_mask(0), cqes(nullptr),
+      to_submit(0)
+   {
+   }
+
+   io_ring(const io_ring& other) = delete;
+   io_ring& operator=(const io_ring& other) = delete;
+
+   ~io_ring()
+   {
+      if (sqes != nullptr)
+      {
+         ::munmap(sqes, sqes_size);
+      }
+      if ((cq_ring != nullptr) && (cq_ring != sq_ring))
+      {
+         ::munmap(cq_ring, cq_ring_size);
+      }
+      if (sq_ring != nullptr)
+      {
+         ::munmap(sq_ring, sq_ring_size);
+      }
+      if (ring_fd != -1)
+      {
+         ::close(ring_fd);
+      }
+   }
+
+   ///<summary> set up the ring, and map its queues.</summary>
+   ///<param name='entries'> the most entries submitted (and completions pending) at once.</param>
+   ///<returns> true if the ring is ready, otherwise false (errno is set).</returns>
+   bool setup(unsigned entries) noexcept
+   {
+      io_uring_params params {};
+      ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+      if (ring_fd == -1)
+      {
+         return false;
+      }
+
+      sq_entries = params.sq_entries;
+      sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+      cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+      if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+      {
+         sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+      }
+
+      sq_ring = map(sq_ring_size, IORING_OFF_SQ_RING);
+      if (sq_ring == nullptr)
+      {
+         return false;
+      }
+      cq_ring = ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) ? sq_ring : map(cq_ring_size, IORING_OFF_CQ_RING);
+      if (cq_ring == nullptr)
+      {
+         return false;
+      }
+      sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+      sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+      if (sqes == nullptr)
+      {
+         return false;
+      }
+
+      sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+      sq_mask = *at<const unsigned>(sq_ring, params.sq_off.ring_mask);
+      sq_array = at<unsigned>(sq_ring, params.sq_off.array);
+      cq_head = at<unsigned>(cq_ring, params.cq_off.head);
+      cq_tail = at<unsigned>(cq_ring, params.cq_off.tail);
+      cq_mask = *at<const unsigned>(cq_ring, params.cq_off.ring_mask);
+      cqes = at<const io_uring_cqe>(cq_ring, params.cq_off.cqes);
+      return true;
+   }
+
+   ///<summary> check that the kernel supports the operations used (IORING_OP_READ is newer than io_uring itself).</summary>
+   bool supports(std::initializer_list<int> opcodes) const noexcept
+   {
+      constexpr unsigned probe_ops = 64;
+      std::vector<unsigned char> buffer;
+      try
+      {
+         buffer.resize(sizeof(io_uring_probe) + (probe_ops * sizeof(io_uring_probe_op)));
+      }
+      catch (...)
+      {
+         return false;
+      }
+
+      auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+      if (::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) == -1)
+      {
+         return false;
+      }
+      return std::all_of(opcodes.begin(), opcodes.end(), [probe](int opcode)
+         {
+            return (opcode <= probe->last_op) && ((probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0);
+         });
+   }
+
+   ///<summary> register the file read (so that entries refer to it as file 0, with IOSQE_FIXED_FILE).</summary>
+   bool register_file(int fd) noexcept
+   {
+      return ::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, &fd, 1) != -1;
+   }
+
+   ///<summary> register buffers (so that IORING_OP_READ_FIXED entries refer to them by index).</summary>
+   bool register_buffers(const std::vector<iovec>& buffers) noexcept
+   {
+      return ::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) != -1;
+   }
+
+   ///<summary> queue an entry (it is submitted by the next submit_and_wait).</summary>
+   ///<remarks> the caller keeps no more entries in flight than the ring holds, so there is always room.</remarks>
+   void queue(const io_uring_sqe& entry) noexcept
+   {
+      const unsigned tail = *sq_tail;
+      const unsigned index = tail & sq_mask;
+      sqes[index] = entry;
+      sq_array[index] = index;
+      std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+      ++to_submit;
+   }
+
+   ///<summary> submit the queued entries, and wait for at least one completion.</summary>
+   ///<returns> true if the wait succeeded, otherwise false (errno is set).</returns>
+   bool submit_and_wait() noexcept
+   {
+      for (;;)
+      {
+         const long submitted = ::syscall(__NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+         if (submitted >= 0)
+         {
+            to_submit -= static_cast<unsigned>(submitted);
+            return true;
+         }
+         if (errno != EINTR)
+         {
+            return false;
+         }
+      }
+   }
+
+   ///<summary> take back the queued entries that no submit_and_wait has submitted (the kernel has not seen them).</summary>
+   ///<returns> the number of entries taken back.</returns>
+   unsigned discard_unsubmitted() noexcept
+   {
+      const unsigned discarded = to_submit;
+      std::atomic_ref<unsigned>(*sq_tail).store(*sq_tail - discarded, std::memory_order_release);
+      to_submit = 0;
+      return discarded;
+   }
+
+   ///<summary> take the next completion.</summary>
+   ///<returns> true if there was a completion, otherwise false.</returns>
+   bool next_completion(io_uring_cqe& completion) noexcept
+   {
+      const unsigned head = *cq_head;
+      if (head == std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire))
+      {
+         return false;
+      }
+      completion = cqes[head & cq_mask];
+      std::atomic_ref<unsigned>(*cq_head).store(head + 1, std::memory_order_release);
+      return true;
+   }
+};
+#endif
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of DeviceReadQueue class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of DeviceReadQueue.</summary>
+class DeviceReadQueue::impl
+{
+private:
+   ///<summary> a read in flight (or handed over).</summary>
+   struct slot
+   {
+      std::uint64_t offset;
+      unsigned char* lpData;
+      std::uint32_t size;
+      std::uint32_t done;        // bytes read so far
+      bool complete;             // read in full, up to the end of the device, or failed
+      bool failed;
+   };
+
+   ///<summary> the (pooled) handle to the device (shared with Devices of the same path).</summary>
+   DeviceHandlePool::handle shared_handle;
+
+   std::uint32_t read_size;
+   std::uint32_t depth;
+   Backend backend;
+
+   ///<summary> the buffers that read hands to a sink (depth buffers of read_size, allocated at the first read).</summary>
+   std::unique_ptr<unsigned char[], aligned_delete> buffers;
+
+   std::vector<slot> slots;
+
+#ifdef __linux__
+   io_ring ring;
+   bool registered_file;
+   bool registered_buffers;
+#endif
+
+   ///<summary> get the system handle of the device.</summary>
+#ifdef _WIN32
+   HANDLE get_native_handle() const noexcept
+   {
+      return shared_handle.get();
+   }
+#else
+   int get_native_handle() const noexcept
+   {
+      return *static_cast<const int*>(shared_handle.get());
+   }
+#endif
+
+public:
+   impl(const std::string& device_path, std::uint32_t cbyReadSize, std::uint32_t a_depth, Backend aBackend, DeviceHandlePool::caching a_caching,
+      DeviceHandlePool::access an_access) :
+      shared_handle(DeviceHandlePool::acquire(device_path, an_access, a_caching)),
+      read_size(std::max<std::uint32_t>(cbyReadSize, 1)),
+      depth(std::max<std::uint32_t>(a_depth, 1)),
+      backend(Backend::synchronous),
+      buffers(),
+      slots(depth)
+#ifdef __linux__
+      , ring(),
+      registered_file(false),
+      registered_buffers(false)
+#endif
+   {
+#ifdef __linux__
+      if ((aBackend == Backend::io_uring) && ring.setup(depth) && ring.supports({ IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_ASYNC_CANCEL }))
+      {
+         registered_file = ring.register_file(get_native_handle());    // (unregistered, the file is looked up for each read)
+         backend = Backend::io_uring;
+      }
+#else
+      (void)aBackend;   // (synchronous only)
+#endif
+   }
+
+   impl(const impl& other) = delete;
+   impl& operator=(const impl& other) = delete;
+
+   Backend get_backend() const noexcept
+   {
+      return backend;
+   }
+
+   std::uint64_t read(std::uint64_t cbyOffset, std::uint64_t cbySize, const Sink& aSink)
+   {
+      if (!buffers)
+      {
+         allocate_buffers();
+      }
+
+      std::exception_ptr sink_exception;
+      const auto delivered = read_slots(cbyOffset, cbySize, nullptr, [&aSink, &sink_exception](const slot& a_slot) noexcept
+         {
+            try
+            {
+               aSink(a_slot.lpData, a_slot.done);
+               return true;
+            }
+            catch (...)
+            {
+               sink_exception = std::current_exception();
+               return false;
+            }
+         });
+
+      if (sink_exception)
+      {
+         std::rethrow_exception(sink_exception);
+      }
+      return delivered.value();
+   }
+
+   error::expected<std::uint64_t> read_into(std::uint64_t cbyOffset, void* lpBuffer, std::uint64_t cbySize) noexcept
+   {
+      return read_slots(cbyOffset, cbySize, static_cast<unsigned char*>(lpBuffer), [](const slot&) noexcept { return true; });
+   }
+
+private:
+   ///<summary> allocate the buffers handed to a sink (and register them with the ring, if there is one).</summary>
+   void allocate_buffers()
+   {
+      const std::size_t cbyBuffers = static_cast<std::size_t>(read_size) * depth;
+      buffers.reset(static_cast<unsigned char*>(::operator new[](cbyBuffers, std::align_val_t(buffer_alignment))));
+
+#ifdef __linux__
+      if (backend == Backend::io_uring)
+      {
+         std::vector<iovec> iovecs(depth);
+         for (std::uint32_t index = 0; index < depth; index++)
+         {
+            iovecs[index].iov_base = &buffers[static_cast<std::size_t>(index) * read_size];
+            iovecs[index].iov_len = read_size;
+         }
+         registered_buffers = ring.register_buffers(iovecs);  // (unregistered E.g. over RLIMIT_MEMLOCK, the pages are pinned for each read)
+      }
+#endif
+   }
+
+   ///<summary> read a range, a slot at a time, handing over the slots in order.</summary>
+   ///<param name='lpDestination'> where the range is read to, or nullptr to read into the queue's buffers.</param>
+   ///<param name='hand_over'> called with each slot in order, returns false to stop reading.</param>
+   ///<returns> the bytes handed over, or the error.</returns>
+   template<typename HandOver>
+   error::expected<std::uint64_t> read_slots(std::uint64_t cbyOffset, std::uint64_t cbySize, unsigned char* lpDestination, HandOver&& hand_over) noexcept
+   {
+#ifdef __linux__
+      if (backend == Backend::io_uring)
+      {
+         return read_slots_queued(cbyOffset, cbySize, lpDestination, hand_over);
+      }
+#endif
+
+      std::uint64_t cbyHandedOver = 0;
+      for (std::uint64_t index = 0; cbyHandedOver < cbySize; index++)
+      {
+         slot& current = slots[index % depth];
+         prepare(current, index % depth, cbyOffset + cbyHandedOver, cbyOffset, std::min<std::uint64_t>(read_size, cbySize - cbyHandedOver), lpDestination);
+
+         while (!current.complete)
+         {
+            const auto result = read_at(current.offset + current.done, current.lpData + current.done, current.size - current.done);
+            if (!result)
+            {
+               return result.error();
+            }
+            current.done += result.value();
+            current.complete = (result.value() == 0) || (current.done == current.size);
+         }
+
+         cbyHandedOver += current.done;
+         if ((current.done != 0) && !hand_over(current))
+         {
+            break;
+         }
+         if (current.done < current.size)
+         {
+            break;   // (the end of the device)
+         }
+      }
+      return cbyHandedOver;
+   }
+
+   ///<summary> set up a slot for the read of part of a range.</summary>
+   void prepare(slot& a_slot, std::uint64_t index, std::uint64_t offset, std::uint64_t cbyRangeOffset, std::uint64_t cbySize, unsigned char* lpDestination) const noexcept
+   {
+      a_slot.offset = offset;
+      a_slot.lpData = (lpDestination != nullptr) ? lpDestination + (offset - cbyRangeOffset) : &buffers[index * read_size];
+      a_slot.size = static_cast<std::uint32_t>(cbySize);
+      a_slot.done = 0;
+      a_slot.complete = false;
+      a_slot.failed = false;
+   }
+
+   ///<summary> a synchronous read, at an offset.</summary>
+   ///<returns> the bytes read (0 at the end of the device), or the error.</returns>
+   error::expected<std::uint32_t> read_at(std::uint64_t offset, unsigned char* lpBuffer, std::uint32_t nBytesToRead) const noexcept
+   {
+#ifdef _WIN32
+      OVERLAPPED overlapped {};
+      overlapped.Offset = static_cast<DWORD>(offset);
+      overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+      DWORD numberOfBytesRead = 0;
+      if (!ReadFile(get_native_handle(), lpBuffer, nBytesToRead, &numberOfBytesRead, &overlapped))
+      {
+         if (GetLastError() != ERROR_HANDLE_EOF)
+         {
+            return error_code_context("ReadFile failed");
+         }
+         numberOfBytesRead = 0;
+      }
+      return numberOfBytesRead;
+#else
+      ssize_t numberOfBytesRead = 0;
+      do
+      {
+         numberOfBytesRead = ::pread(get_native_handle(), lpBuffer, nBytesToRead, static_cast<off_t>(offset));
+      } while ((numberOfBytesRead == -1) && (errno == EINTR));
+
+      if (numberOfBytesRead == -1)
+      {
+         return error_code_context("pread failed");
+      }
+      return static_cast<std::uint32_t>(numberOfBytesRead);
+#endif
+   }
+
+#ifdef __linux__
+   ///<summary> queue the read of (the rest of) a slot to the ring.</summary>
+   void queue(const slot& a_slot, std::uint32_t index) noexcept
+   {
+      const bool fixed_buffer = registered_buffers && (a_slot.lpData >= buffers.get()) && (a_slot.lpData < buffers.get() + (static_cast<std::size_t>(read_size) * depth));
+
+      io_uring_sqe entry {};
+      entry.opcode = fixed_buffer ? IORING_OP_READ_FIXED : IORING_OP_READ;
+      entry.fd = registered_file ? 0 : get_native_handle();
+      entry.flags = registered_file ? IOSQE_FIXED_FILE : 0;
+      entry.addr = reinterpret_cast<std::uint64_t>(a_slot.lpData + a_slot.done);
+      entry.len = a_slot.size - a_slot.done;
+      entry.off = a_slot.offset + a_slot.done;
+      entry.buf_index = fixed_buffer ? static_cast<std::uint16_t>(index) : 0;
+      entry.user_data = index;
+      ring.queue(entry);
+   }
+
+   ///<summary> read a range with up to depth reads in flight, handing over the slots in order.</summary>
+   template<typename HandOver>
+   error::expected<std::uint64_t> read_slots_queued(std::uint64_t cbyOffset, std::uint64_t cbySize, unsigned char* lpDestination, HandOver& hand_over) noexcept
+   {
+      std::uint64_t cbyIssued = 0;        // from the start of the range
+      std::uint64_t cbyHandedOver = 0;
+      std::uint32_t head = 0;             // the slot next handed over
+      std::uint32_t issued = 0;           // the slots issued, and not yet handed over
+      std::uint32_t in_flight = 0;        // the slots queued to the ring, and not yet completed
+      bool stopping = false;              // at the end of the device, after an error, or when hand over stops
+      int error_code = 0;
+
+      for (;;)
+      {
+         // hand over the completed slots, in order
+         while (!stopping && (issued != 0) && slots[head].complete)
+         {
+            const slot& current = slots[head];
+            if (current.failed)
+            {
+               stopping = true;
+               break;
+            }
+            cbyHandedOver += current.done;
+            if (((current.done != 0) && !hand_over(current)) || (current.done < current.size))
+            {
+               stopping = true;  // (stopped by the sink, or the end of the device)
+            }
+            head = (head + 1) % depth;
+            --issued;
+         }
+
+         // issue reads to the free slots
+         while (!stopping && (issued < depth) && (cbyIssued < cbySize))
+         {
+            const std::uint32_t index = (head + issued) % depth;
+            prepare(slots[index], index, cbyOffset + cbyIssued, cbyOffset, std::min<std::uint64_t>(read_size, cbySize - cbyIssued), lpDestination);
+            queue(slots[index], index);
+            cbyIssued += slots[index].size;
+            ++issued;
+            ++in_flight;
+         }
+
+         if (in_flight == 0)
+         {
+            break;
+         }
+
+         // submit the batch, and harvest every completion (waiting for one at least)
+         if (!ring.submit_and_wait())
+         {
+            // (reads submitted by earlier batches may still be writing to the slots' buffers, which may be the caller's,
+            //  so they are cancelled, and waited for, before returning)
+            error_code = errno;
+            stopping = true;
+            in_flight -= ring.discard_unsubmitted();
+            cancel_in_flight(in_flight);
+            break;
+         }
+
+         io_uring_cqe completion {};
+         while (ring.next_completion(completion))
+         {
+            const auto index = static_cast<std::uint32_t>(completion.user_data);
+            slot& completed = slots[index];
+            --in_flight;
+
+            if ((completion.res == -EINTR) || (completion.res == -EAGAIN))
+            {
+               queue(completed, index);      // (read again)
+               ++in_flight;
+            }
+            else if (completion.res < 0)
+            {
+               error_code = -completion.res;
+               completed.failed = completed.complete = true;
+               stopping = true;
+            }
+            else
+            {
+               completed.done += static_cast<std::uint32_t>(completion.res);
+               if ((completion.res == 0) || (completed.done == completed.size) || stopping)
+               {
+                  completed.complete = true;
+               }
+               else
+               {
+                  queue(completed, index);   // (a short read, so read the rest)
+                  ++in_flight;
+               }
+            }
+         }
+      }
+
+      if (error_code != 0)
+      {
+         errno = error_code;
+         return error_code_context("io_uring read failed");
+      }
+      return cbyHandedOver;
+   }
+
+   ///<summary> cancel the reads in flight, and wait until they (and the cancellations) have completed.</summary>
+   ///<remarks> the ring is left empty, so it can be used for the next range. The wait is retried while the kernel is short
+   /// of resources (EAGAIN, EBUSY). Only if the ring itself is broken (E.g. EBADF, EFAULT) can the reads not be waited for.</remarks>
+   void cancel_in_flight(std::uint32_t in_flight) noexcept
+   {
+      constexpr std::uint64_t cancel_tag = ~std::uint64_t(0);   // (the user_data of a cancellation, never a slot index)
+      std::uint32_t cancelling = 0;
+
+      // (a cancellation of a slot that is not in flight completes with -ENOENT. The ring has room, as nothing is queued)
+      for (std::uint32_t index = 0; (in_flight != 0) && (index < depth); index++)
+      {
+         io_uring_sqe entry {};
+         entry.opcode = IORING_OP_ASYNC_CANCEL;
+         entry.fd = -1;
+         entry.addr = index;
+         entry.user_data = cancel_tag;
+         ring.queue(entry);
+         ++cancelling;
+      }
+
+      while ((in_flight != 0) || (cancelling != 0))
+      {
+         if (!ring.submit_and_wait())
+         {
+            if ((errno == EAGAIN) || (errno == EBUSY))
+            {
+               sched_yield();
+               continue;
+            }
+            return;
+         }
+
+         io_uring_cqe completion {};
+         while (ring.next_completion(completion))
+         {
+            if (completion.user_data == cancel_tag)
+            {
+               --cancelling;
+            }
+            else
+            {
+               --in_flight;
+            }
+         }
+      }
+   }
+#endif
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for DeviceReadQueue implementation
+* ***************************************************************************
+*/
+
+DeviceReadQueue::DeviceReadQueue(const std::string& device_path, std::uint32_t cbyReadSize, std::uint32_t depth) :
+   DeviceReadQueue(device_path, cbyReadSize, depth, Backend::io_uring)
+{
+}
+
+DeviceReadQueue::DeviceReadQueue(const std::string& device_path, std::uint32_t cbyReadSize, std::uint32_t depth, Backend aBackend, DeviceHandlePool::caching a_caching,
+   DeviceHandlePool::access an_access) :
+   pimpl(spimpl::make_unique_impl<impl>(device_path, cbyReadSize, depth, aBackend, a_caching, an_access))
+{
+}
+
+DeviceReadQueue::Backend DeviceReadQueue::get_backend() const noexcept
+{
+   return pimpl->get_backend();
+}
+
+std::uint64_t DeviceReadQueue::read(std::uint64_t cbyOffset, std::uint64_t cbySize, const Sink& aSink)
+{
+   return pimpl->read(cbyOffset, cbySize, aSink);
+}
+
+std::uint64_t DeviceReadQueue::read_into(std::uint64_t cbyOffset, void* lpBuffer, std::uint64_t cbySize)
+{
+   return pimpl->read_into(cbyOffset, lpBuffer, cbySize).value();
+}
+
+error::expected<std::uint64_t> DeviceReadQueue::read_into(std::nothrow_t, std::uint64_t cbyOffset, void* lpBuffer, std::uint64_t cbySize) noexcept
+{
+   return pimpl->read_into(cbyOffset, lpBuffer, cbySize);
+}
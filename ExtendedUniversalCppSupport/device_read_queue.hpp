@@ -0,0 +1,124 @@
+//
+// device_read_queue.hpp : keeps many reads of a device in flight
+//
+// A synchronous read leaves a device idle while each result is handed back, and costs a system call per read.
+// Here (on Linux) reads are queued to an io_uring: a batch is submitted, and completions are harvested, with one
+// system call, and the device file and the queue's own buffers are registered with the ring once (so the kernel
+// doesn't look them up, or pin the pages, for every read). Where there is no io_uring (E.g. on Windows, an older
+// kernel, or a sandbox that forbids it) the same reads are made synchronously.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __DEVICE_READ_QUEUE_HPP__
+#define __DEVICE_READ_QUEUE_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <string>
+
+#include <expected.hpp>
+#include <spimpl.hpp>
+
+#include "device_handle_pool.hpp"
+
+///<summary> reads a range of a device with many reads in flight, and hands the data over in order.</summary>
+///<remarks> the device is read through its pooled handle (see DeviceHandlePool), so the reads are covered by any
+/// locks that a Device of the same path holds. Not copyable (a queue owns its ring), but movable. Not safe to use from
+/// several threads at once.</remarks>
+class DeviceReadQueue
+{
+public:
+   ///<summary> how the reads are made.</summary>
+   enum class Backend
+   {
+      io_uring,         // queued to an io_uring (Linux)
+      synchronous       // one at a time (pread, or ReadFile)
+   };
+
+   ///<summary> the most reads in flight (by default).</summary>
+   static constexpr std::uint32_t default_depth = 8;
+
+   ///<summary> receives the data read, in order (a buffer is reused once the sink returns).</summary>
+   using Sink = std::function<void(const void* lpData, std::uint32_t nBytes)>;
+
+   ///<summary> construct a read queue for a device, using io_uring where it is available.</summary>
+   ///<param name='device_path'> the system name of the device (or an image file).</param>
+   ///<param name='cbyReadSize'> the size of each read (a multiple of the physical sector size, see Device::get_capabilities).</param>
+   ///<param name='depth'> the most reads in flight.</param>
+   ///<exception cref='std::exception'> if the device could not be opened.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceReadQueue(const std::string& device_path, std::uint32_t cbyReadSize, std::uint32_t depth = default_depth);
+
+   ///<summary> construct a read queue for a device, with a chosen backend (E.g. to benchmark one against the other).</summary>
+   ///<remarks> when Backend::io_uring is chosen but is not available, the reads are synchronous (see get_backend).</remarks>
+   ///<param name='device_path'> the system name of the device (or an image file).</param>
+   ///<param name='cbyReadSize'> the size of each read.</param>
+   ///<param name='depth'> the most reads in flight.</param>
+   ///<param name='aBackend'> the backend to use.</param>
+   ///<param name='a_caching'> whether the reads go through the system cache (unbuffered, offsets, sizes and buffers must
+   /// be aligned to the device's buffer alignment).</param>
+   ///<param name='an_access'> the access the device is opened with (read_write shares the handle of a Device of the same
+   /// path, read opens files that may not be written, E.g. a read only image file).</param>
+   ///<exception cref='std::exception'> if the device could not be opened.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API DeviceReadQueue(const std::string& device_path, std::uint32_t cbyReadSize, std::uint32_t depth, Backend aBackend,
+      DeviceHandlePool::caching a_caching = DeviceHandlePool::caching::buffered, DeviceHandlePool::access an_access = DeviceHandlePool::access::read_write);
+
+   ///<summary> get the backend in use.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API Backend get_backend() const noexcept;
+
+   ///<summary> read a range of the device into the queue's (registered) buffers, handing each to a sink in order.</summary>
+   ///<remarks> the buffers are allocated (and registered) at the first read. If the sink throws, the reads in flight
+   /// are completed (and discarded) before the exception is passed on.</remarks>
+   ///<param name='cbyOffset'> the byte offset of the range.</param>
+   ///<param name='cbySize'> the byte size of the range.</param>
+   ///<param name='aSink'> receives the data.</param>
+   ///<returns> the number of bytes read (fewer than cbySize if the end of the device is reached).</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::uint64_t read(std::uint64_t cbyOffset, std::uint64_t cbySize, const Sink& aSink);
+
+   ///<summary> read a range of the device into memory.</summary>
+   ///<param name='cbyOffset'> the byte offset of the range.</param>
+   ///<param name='lpBuffer'> receives the data (at least cbySize bytes).</param>
+   ///<param name='cbySize'> the byte size of the range.</param>
+   ///<returns> the number of bytes read (fewer than cbySize if the end of the device is reached).</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::uint64_t read_into(std::uint64_t cbyOffset, void* lpBuffer, std::uint64_t cbySize);
+
+   ///<summary> read a range of the device into memory, without throwing on failure.</summary>
+   ///<param name='cbyOffset'> the byte offset of the range.</param>
+   ///<param name='lpBuffer'> receives the data (at least cbySize bytes).</param>
+   ///<param name='cbySize'> the byte size of the range.</param>
+   ///<returns> the number of bytes read (fewer than cbySize if the end of the device is reached), or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<std::uint64_t> read_into(std::nothrow_t, std::uint64_t cbyOffset, void* lpBuffer, std::uint64_t cbySize) noexcept;
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default move support (the ring refers to the implementation, not to this object).</remarks>
+   spimpl::unique_impl_ptr<impl> pimpl;
+};
+
+#endif // __DEVICE_READ_QUEUE_HPP__
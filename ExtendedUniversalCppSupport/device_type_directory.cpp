@@ -21,46 +21,33 @@
 //
 #include "stdafx.h"
 
-#include <map>
-
-#include <winioctl.h>
+#include <atomic>
+#include <thread>
 
 #include "device_type_directory.hpp"
-#include "utf8_guid.hpp"
 
 
 ///<summary> the private implementation of DeviceTypeDirectory. A Singleton.</summary>
-///<remarks> Motivation for use of an inner class is to encapsulate/hide 'GUID' (a Windows specific type).</remarks>
+///<remarks> holds the custom device types, in an append only table that is read without locking.</remarks>
 class DeviceTypeDirectory::impl
 {
 
 private:
-   ///<summary> a std::map relating all device types recognized by this implementation, to a recognised Windows platform specific representation.</summary>
-   std::map<DeviceTypeDirectory::DeviceType, const GUID> device_type_map;
+   ///<summary> the interface class GUIDs of the custom device types (in order of registration).</summary>
+   std::array<utf8::guid, max_custom_device_types> custom_guids;
+
+   ///<summary> the number of custom_guids slots claimed by registrations (may exceed the capacity).</summary>
+   std::atomic<std::size_t> reserved;
+
+   ///<summary> the number of custom_guids slots fully written (readers only look at these).</summary>
+   std::atomic<std::size_t> published;
 
    ///<summary> constructs the singleton DeviceTypeDirectory::impl.</summary>
    impl() noexcept :
-      device_type_map{}
+      custom_guids{},
+      reserved(0),
+      published(0)
    {
-      try 
-      {
-         device_type_map.insert(std::make_pair(DeviceType::DISK_DEVICES, GUID_DEVINTERFACE_DISK));
-         device_type_map.insert(std::make_pair(DeviceType::CDROM_DEVICES, GUID_DEVINTERFACE_CDROM));
-         device_type_map.insert(std::make_pair(DeviceType::PARTITION_DEVICES, GUID_DEVINTERFACE_PARTITION));
-         device_type_map.insert(std::make_pair(DeviceType::TAPE_DEVICES, GUID_DEVINTERFACE_TAPE));
-         device_type_map.insert(std::make_pair(DeviceType::WRITEONCEDISK_DEVICES, GUID_DEVINTERFACE_WRITEONCEDISK));
-         device_type_map.insert(std::make_pair(DeviceType::VOLUME_DEVICES, GUID_DEVINTERFACE_VOLUME));
-         device_type_map.insert(std::make_pair(DeviceType::MEDIUMCHANGER_DEVICES, GUID_DEVINTERFACE_MEDIUMCHANGER));
-         device_type_map.insert(std::make_pair(DeviceType::FLOPPY_DEVICES, GUID_DEVINTERFACE_FLOPPY));
-         device_type_map.insert(std::make_pair(DeviceType::CDCHANGER_DEVICES, GUID_DEVINTERFACE_CDCHANGER));
-         device_type_map.insert(std::make_pair(DeviceType::STORAGEPORT_DEVICES, GUID_DEVINTERFACE_STORAGEPORT));
-         device_type_map.insert(std::make_pair(DeviceType::VMLUN_DEVICES, GUID_DEVINTERFACE_VMLUN));
-         device_type_map.insert(std::make_pair(DeviceType::SES_DEVICES, GUID_DEVINTERFACE_SES));
-      }
-      catch (...)
-      {
-         LOG_WARNING("DeviceTypeDirectory::impl constructor had an issue!");
-      }
    }
 
 public:
@@ -87,9 +74,67 @@ public:
    ///<summary> explicit default destructor (rule of 5).</summary>
    ~impl() = default;
 
-   std::string get_device_type_as_string(DeviceType aDeviceType)
+   utf8::guid get_device_type_guid(DeviceType aDeviceType) const
    {
-      return utf8::guid_convert::from_guid(device_type_map[aDeviceType]);
+      const int value = static_cast<int>(aDeviceType);
+      if ((value >= 0) && (static_cast<std::size_t>(value) < standard_device_type_count))
+      {
+         return standard_device_type_guids[static_cast<std::size_t>(value)];
+      }
+
+      if ((value >= first_custom_device_type) && (static_cast<std::size_t>(value - first_custom_device_type) < published.load(std::memory_order_acquire)))
+      {
+         return custom_guids[static_cast<std::size_t>(value - first_custom_device_type)];
+      }
+
+      throw error_context("DeviceTypeDirectory: unknown device type");
+   }
+
+   std::optional<DeviceType> find_device_type(const utf8::guid& anInterfaceClassGuid) const noexcept
+   {
+      for (std::size_t i = 0; i < standard_device_type_count; i++)
+      {
+         if (standard_device_type_guids[i] == anInterfaceClassGuid)
+         {
+            return static_cast<DeviceType>(i);
+         }
+      }
+
+      const std::size_t count = published.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < count; i++)
+      {
+         if (custom_guids[i] == anInterfaceClassGuid)
+         {
+            return static_cast<DeviceType>(first_custom_device_type + static_cast<int>(i));
+         }
+      }
+      return std::nullopt;
+   }
+
+   ///<remarks> concurrent registrations of the same (new) GUID may each get a device type (lookups find the first).</remarks>
+   DeviceType register_device_type(const utf8::guid& anInterfaceClassGuid)
+   {
+      const std::optional<DeviceType> known = find_device_type(anInterfaceClassGuid);
+      if (known)
+      {
+         return *known;
+      }
+
+      const std::size_t slot = reserved.fetch_add(1, std::memory_order_relaxed);
+      if (slot >= max_custom_device_types)
+      {
+         throw error_context("DeviceTypeDirectory: too many custom device types");
+      }
+      custom_guids[slot] = anInterfaceClassGuid;
+
+      // publish in slot order (an earlier registration may still be writing its slot)
+      std::size_t expected = slot;
+      while (!published.compare_exchange_weak(expected, slot + 1, std::memory_order_release, std::memory_order_relaxed))
+      {
+         expected = slot;
+         std::this_thread::yield();
+      }
+      return static_cast<DeviceType>(first_custom_device_type + static_cast<int>(slot));
    }
 
 };
@@ -100,7 +145,22 @@ public:
 * ******************************************************************************
 */
 
+utf8::guid DeviceTypeDirectory::get_device_type_guid(DeviceType aDeviceType)
+{
+   return impl::getInstance().get_device_type_guid(aDeviceType);
+}
+
 std::string DeviceTypeDirectory::get_device_type_as_string(DeviceType aDeviceType)
 {
-   return impl::getInstance().get_device_type_as_string(aDeviceType);
+   return get_device_type_guid(aDeviceType).to_string();
+}
+
+DeviceTypeDirectory::DeviceType DeviceTypeDirectory::register_device_type(const utf8::guid& anInterfaceClassGuid)
+{
+   return impl::getInstance().register_device_type(anInterfaceClassGuid);
+}
+
+std::optional<DeviceTypeDirectory::DeviceType> DeviceTypeDirectory::find_device_type(const utf8::guid& anInterfaceClassGuid) noexcept
+{
+   return impl::getInstance().find_device_type(anInterfaceClassGuid);
 }
@@ -22,14 +22,20 @@
 #ifndef __DEVICE_TYPE_DIRECTORY_HPP__
 #define __DEVICE_TYPE_DIRECTORY_HPP__
 
-#ifdef EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
 #endif
 
+#include <array>
+#include <cstddef>
+#include <optional>
 #include <string>
 
+#include <guid.hpp>
 #include <spimpl.hpp>
 
 ///<summary> wraps the system device interface.</summary>
@@ -54,17 +60,72 @@ public:
       SES_DEVICES = 0x0b
    };
 
+   ///<summary> the number of standard device types (the DeviceType values above).</summary>
+   static constexpr std::size_t standard_device_type_count = 12;
+
+   ///<summary> the DeviceType value of the first custom device type (see register_device_type).</summary>
+   static constexpr int first_custom_device_type = 0x100;
+
+   ///<summary> the most custom device types that can be registered.</summary>
+   static constexpr std::size_t max_custom_device_types = 64;
+
+   ///<summary> the interface class GUIDs of the standard device types, indexed by DeviceType (values from winioctl.h, parsed at compile time).</summary>
+   static constexpr std::array<utf8::guid, standard_device_type_count> standard_device_type_guids =
+   {
+      utf8::guid::parse("53f56307-b6bf-11d0-94f2-00a0c91efb8b"),    // DISK_DEVICES
+      utf8::guid::parse("53f56308-b6bf-11d0-94f2-00a0c91efb8b"),    // CDROM_DEVICES
+      utf8::guid::parse("53f5630a-b6bf-11d0-94f2-00a0c91efb8b"),    // PARTITION_DEVICES
+      utf8::guid::parse("53f5630b-b6bf-11d0-94f2-00a0c91efb8b"),    // TAPE_DEVICES
+      utf8::guid::parse("53f5630c-b6bf-11d0-94f2-00a0c91efb8b"),    // WRITEONCEDISK_DEVICES
+      utf8::guid::parse("53f5630d-b6bf-11d0-94f2-00a0c91efb8b"),    // VOLUME_DEVICES
+      utf8::guid::parse("53f56310-b6bf-11d0-94f2-00a0c91efb8b"),    // MEDIUMCHANGER_DEVICES
+      utf8::guid::parse("53f56311-b6bf-11d0-94f2-00a0c91efb8b"),    // FLOPPY_DEVICES
+      utf8::guid::parse("53f56312-b6bf-11d0-94f2-00a0c91efb8b"),    // CDCHANGER_DEVICES
+      utf8::guid::parse("2accfe60-c130-11d2-b082-00a0c91efb8b"),    // STORAGEPORT_DEVICES
+      utf8::guid::parse("6f416619-9f29-42a5-b20b-37e219ca02b0"),    // VMLUN_DEVICES
+      utf8::guid::parse("1790c9ec-47d5-4df3-b5af-9adf3cf23e48")     // SES_DEVICES
+   };
+
+   ///<summary> lookup the interface class GUID of a standard device type (at compile time, if aDeviceType is a constant).</summary>
+   ///<param name='aDeviceType'> any of the standard device types.</param>
+   ///<returns> the interface class GUID.</returns>
+   ///<exception cref='std::out_of_range'> if aDeviceType is not a standard device type.</exception>
+   static constexpr utf8::guid get_standard_device_type_guid(DeviceType aDeviceType)
+   {
+      return standard_device_type_guids.at(static_cast<std::size_t>(aDeviceType));
+   }
+
+   ///<summary> lookup the interface class GUID of a device type (standard or custom).</summary>
+   ///<remarks> lock free, safe to call concurrently with register_device_type.</remarks>
+   ///<param name='aDeviceType'> any of the standard device types, or a registered custom device type.</param>
+   ///<returns> the interface class GUID.</returns>
+   ///<exception cref='error::context'> if aDeviceType is not known.</exception>
+   static utf8::guid get_device_type_guid(DeviceType aDeviceType);
+
    ///<summary> lookup the system representation of a device type.</summary>
    ///<param name='aDeviceType'> any of the supported device types.</param>
    ///<returns> an opaque string representing the device type to the system.</returns>
    static std::string get_device_type_as_string(DeviceType aDeviceType);
 
+   ///<summary> register a custom device type (E.g. for a vendor specific device interface class).</summary>
+   ///<remarks> if the GUID is already known, its existing device type is returned. Registrations last for the life of the process.</remarks>
+   ///<param name='anInterfaceClassGuid'> the device interface class GUID.</param>
+   ///<returns> the device type to use (E.g. with DeviceDiscoverer).</returns>
+   ///<exception cref='error::context'> if max_custom_device_types are already registered.</exception>
+   static DeviceType register_device_type(const utf8::guid& anInterfaceClassGuid);
+
+   ///<summary> find the device type of an interface class GUID (standard or custom).</summary>
+   ///<remarks> lock free, safe to call concurrently with register_device_type.</remarks>
+   ///<param name='anInterfaceClassGuid'> the device interface class GUID.</param>
+   ///<returns> the device type, or std::nullopt if the GUID is not known.</returns>
+   static std::optional<DeviceType> find_device_type(const utf8::guid& anInterfaceClassGuid) noexcept;
+
 private:
    ///<summary> construct a singleton to map all supported DeviceTypes to corresponding system representations.</summary>
    DeviceTypeDirectory() = default;
 
    ///<summary> forward reference to a private (singleton) inner implementation class.</summary>
-   ///<remarks> inner class decouples this header from the system types needed by the implementation.</remarks>
+   ///<remarks> inner class holds the registry of custom device types.</remarks>
    class impl;
 
 };
@@ -0,0 +1,642 @@
+//
+// file_transfer.cpp : copies a device or image file to a file, inside the kernel where possible
+//
+// A copy is a sequence of methods, each carrying on from where the one before stopped. A kernel method
+// that refuses the files (E.g. EXDEV, EINVAL or ENOSYS) hands over to the next, and any other error ends
+// the copy. The source is read through a pooled handle (see DeviceHandlePool), only ever at explicit
+// offsets, so the file pointer other users of the handle share is left alone.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+#ifdef _WIN32
+#include <winioctl.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <new>
+
+#include "aligned_buffer_pool.hpp"
+#include "device_handle_pool.hpp"
+#include "file_transfer.hpp"
+
+///<summary> the most bytes moved by one kernel call (so progress is kept between calls).</summary>
+constexpr std::uint64_t kernel_chunk_size = 16 * 1024 * 1024;
+
+///<summary> the size of the buffer of a buffered copy (a multiple of any sector size).</summary>
+constexpr std::size_t buffered_chunk_size = 1024 * 1024;
+
+///<summary> the alignment of the buffer of a buffered copy (raw devices need sector aligned buffers).</summary>
+constexpr std::size_t buffered_chunk_alignment = 4096;
+
+#ifdef _WIN32
+///<summary> the system handle of an open file.</summary>
+using native_handle = HANDLE;
+
+///<summary> the system handle value of no file.</summary>
+static const native_handle invalid_native_handle = INVALID_HANDLE_VALUE;
+#else
+///<summary> the system handle of an open file (a file descriptor).</summary>
+using native_handle = int;
+
+///<summary> the system handle value of no file.</summary>
+static constexpr native_handle invalid_native_handle = -1;
+#endif
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of FileTransfer class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of FileTransfer.</summary>
+class FileTransfer::impl
+{
+private:
+   ///<summary> a copy in progress.</summary>
+   struct transfer
+   {
+      native_handle hSource;
+      native_handle hTarget;
+      std::uint64_t cbySize;
+      std::uint64_t cbyCopied;
+      std::atomic<int>& progress;
+
+      ///<summary> record bytes copied.</summary>
+      void copied(std::uint64_t cbyCopiedNow) noexcept
+      {
+         cbyCopied += cbyCopiedNow;
+         progress = static_cast<int>((100 * cbyCopied) / std::max<std::uint64_t>(cbySize, 1));
+      }
+
+      ///<summary> the size of the next kernel call.</summary>
+      std::uint64_t next_chunk() const noexcept
+      {
+         return std::min(kernel_chunk_size, cbySize - cbyCopied);
+      }
+   };
+
+   ///<summary> get the (pooled) handle of a source, without throwing.</summary>
+   static error::expected<DeviceHandlePool::handle> acquire_source(const std::string& source_path) noexcept
+   {
+      try
+      {
+         return DeviceHandlePool::acquire(source_path, DeviceHandlePool::access::read);
+      }
+      catch (const error::context& e)
+      {
+         // (the error code captured by the failing open, as errno or the last error may have changed since)
+         return error::code(__FILE__, __LINE__, __FUNCTION__, "couldn't open the source", e.get_error_code());
+      }
+      catch (const std::bad_alloc&)
+      {
+#ifdef _WIN32
+         return error::code(__FILE__, __LINE__, __FUNCTION__, "couldn't open the source", ERROR_NOT_ENOUGH_MEMORY);
+#else
+         return error::code(__FILE__, __LINE__, __FUNCTION__, "couldn't open the source", ENOMEM);
+#endif
+      }
+      catch (...)
+      {
+         return error_code_context("couldn't open the source");
+      }
+   }
+
+   ///<summary> get the system handle of a pooled handle.</summary>
+   static native_handle get_native_handle(const DeviceHandlePool::handle& shared_handle) noexcept
+   {
+#ifdef _WIN32
+      return shared_handle.get();
+#else
+      return *static_cast<const int*>(shared_handle.get());
+#endif
+   }
+
+   ///<summary> report a source that ended before the size copied.</summary>
+   static error::code unexpected_end() noexcept
+   {
+#ifdef _WIN32
+      SetLastError(ERROR_HANDLE_EOF);
+#else
+      errno = ENODATA;
+#endif
+      return error_code_context("Unexpected end of source");
+   }
+
+#ifdef __linux__
+   ///<summary> true if an error means a kernel method does not apply to these files (rather than that the copy failed).</summary>
+   static bool is_not_applicable(int error_code) noexcept
+   {
+      return (error_code == EXDEV) || (error_code == EINVAL) || (error_code == ENOSYS) || (error_code == EOPNOTSUPP) || (error_code == ENOTSUP);
+   }
+
+   ///<summary> copy with copy_file_range (file to file, possibly without moving any data, E.g. a reflink).</summary>
+   ///<returns> true if the copy completed, false if the method does not apply, or the error.</returns>
+   static error::expected<bool> copy_with_copy_file_range(transfer& a_transfer) noexcept
+   {
+      while (a_transfer.cbyCopied < a_transfer.cbySize)
+      {
+         auto offset_in = static_cast<off_t>(a_transfer.cbyCopied);
+         auto offset_out = static_cast<off_t>(a_transfer.cbyCopied);
+         const ssize_t cbyCopiedNow = ::copy_file_range(a_transfer.hSource, &offset_in, a_transfer.hTarget, &offset_out, a_transfer.next_chunk(), 0);
+         if (cbyCopiedNow == -1)
+         {
+            if (errno == EINTR)
+            {
+               continue;
+            }
+            if (is_not_applicable(errno))
+            {
+               return false;
+            }
+            return error_code_context("copy_file_range failed");
+         }
+         if (cbyCopiedNow == 0)
+         {
+            return unexpected_end();
+         }
+         a_transfer.copied(static_cast<std::uint64_t>(cbyCopiedNow));
+      }
+      return true;
+   }
+
+   ///<summary> copy with sendfile (from the page cache of the source, E.g. a block device, to the target).</summary>
+   ///<returns> true if the copy completed, false if the method does not apply, or the error.</returns>
+   static error::expected<bool> copy_with_sendfile(transfer& a_transfer) noexcept
+   {
+      // (sendfile writes at the file position of the target)
+      if (::lseek(a_transfer.hTarget, static_cast<off_t>(a_transfer.cbyCopied), SEEK_SET) == -1)
+      {
+         return error_code_context("lseek failed");
+      }
+
+      while (a_transfer.cbyCopied < a_transfer.cbySize)
+      {
+         auto offset_in = static_cast<off_t>(a_transfer.cbyCopied);
+         const ssize_t cbyCopiedNow = ::sendfile(a_transfer.hTarget, a_transfer.hSource, &offset_in, a_transfer.next_chunk());
+         if (cbyCopiedNow == -1)
+         {
+            if ((errno == EINTR) || (errno == EAGAIN))
+            {
+               continue;
+            }
+            if (is_not_applicable(errno))
+            {
+               return false;
+            }
+            return error_code_context("sendfile failed");
+         }
+         if (cbyCopiedNow == 0)
+         {
+            return unexpected_end();
+         }
+         a_transfer.copied(static_cast<std::uint64_t>(cbyCopiedNow));
+      }
+      return true;
+   }
+
+   ///<summary> copy with splice (the source into a pipe, and the pipe into the target, moving page references).</summary>
+   ///<returns> true if the copy completed, false if the method does not apply, or the error.</returns>
+   static error::expected<bool> copy_with_splice(transfer& a_transfer) noexcept
+   {
+      int pipe_ends[2] = { -1, -1 };
+      if (::pipe2(pipe_ends, O_CLOEXEC) == -1)
+      {
+         return false;     // (no pipe, so try the next method)
+      }
+
+      error::expected<bool> result = true;
+      while (a_transfer.cbyCopied < a_transfer.cbySize)
+      {
+         auto offset_in = static_cast<off_t>(a_transfer.cbyCopied);
+         const ssize_t cbyInPipe = ::splice(a_transfer.hSource, &offset_in, pipe_ends[1], nullptr, a_transfer.next_chunk(), SPLICE_F_MOVE);
+         if (cbyInPipe == -1)
+         {
+            if ((errno == EINTR) || (errno == EAGAIN))
+            {
+               continue;
+            }
+            result = is_not_applicable(errno) ? error::expected<bool>(false) : error::expected<bool>(error_code_context("splice failed"));
+            break;
+         }
+         if (cbyInPipe == 0)
+         {
+            result = unexpected_end();
+            break;
+         }
+
+         // drain the pipe into the target (what was spliced in is copied, whatever happens below)
+         auto offset_out = static_cast<off_t>(a_transfer.cbyCopied);
+         ssize_t cbyLeft = cbyInPipe;
+         while (cbyLeft > 0)
+         {
+            const ssize_t cbyOut = ::splice(pipe_ends[0], nullptr, a_transfer.hTarget, &offset_out, static_cast<std::size_t>(cbyLeft), SPLICE_F_MOVE);
+            if (cbyOut == -1)
+            {
+               if ((errno == EINTR) || (errno == EAGAIN))
+               {
+                  continue;
+               }
+               break;
+            }
+            cbyLeft -= cbyOut;
+         }
+         if (cbyLeft != 0)
+         {
+            result = error_code_context("splice failed");   // (the pipe holds data, so no other method can carry on)
+            break;
+         }
+         a_transfer.copied(static_cast<std::uint64_t>(cbyInPipe));
+      }
+
+      ::close(pipe_ends[0]);
+      ::close(pipe_ends[1]);
+      return result;
+   }
+#endif
+
+#ifdef _WIN32
+   ///<summary> CopyFileEx progress routine.</summary>
+   static DWORD CALLBACK copy_progress(LARGE_INTEGER TotalFileSize, LARGE_INTEGER TotalBytesTransferred, LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD, HANDLE, HANDLE, LPVOID lpData) noexcept
+   {
+      auto* progress = static_cast<std::atomic<int>*>(lpData);
+      *progress = static_cast<int>((100 * TotalBytesTransferred.QuadPart) / std::max<LONGLONG>(TotalFileSize.QuadPart, 1));
+      return PROGRESS_CONTINUE;
+   }
+
+   ///<summary> copy with CopyFileEx (a regular file copied whole, by the system).</summary>
+   ///<returns> true if the copy completed, false if the method does not apply (a device, or a partial copy), or the error.</returns>
+   static error::expected<bool> copy_with_copy_file(const std::string& source_path, const std::string& target_path, transfer& a_transfer) noexcept
+   {
+      LARGE_INTEGER size {};
+      if ((GetFileType(a_transfer.hSource) != FILE_TYPE_DISK) || !GetFileSizeEx(a_transfer.hSource, &size) || (static_cast<std::uint64_t>(size.QuadPart) != a_transfer.cbySize))
+      {
+         return false;
+      }
+
+      if (!CopyFileExW(utf8::convert::to_small_utf16(source_path).c_str(), utf8::convert::to_small_utf16(target_path).c_str(), copy_progress, &a_transfer.progress, nullptr, 0))
+      {
+         return error_code_context("CopyFileEx failed");
+      }
+      a_transfer.cbyCopied = a_transfer.cbySize;
+      return true;
+   }
+#endif
+
+   ///<summary> copy through a (reused, aligned) user space buffer.</summary>
+   ///<returns> true when the copy completed, or the error.</returns>
+   static error::expected<bool> copy_buffered(transfer& a_transfer) noexcept
+   {
+      AlignedBufferPool::buffer buffer;
+      try
+      {
+         buffer = AlignedBufferPool(buffered_chunk_size, buffered_chunk_alignment, 1).acquire();
+      }
+      catch (...)
+      {
+         return error_code_context("couldn't allocate the copy buffer");
+      }
+
+      while (a_transfer.cbyCopied < a_transfer.cbySize)
+      {
+         const auto nBytesToRead = static_cast<std::uint32_t>(std::min<std::uint64_t>(buffered_chunk_size, a_transfer.cbySize - a_transfer.cbyCopied));
+         const auto read = read_at(a_transfer.hSource, a_transfer.cbyCopied, buffer.get(), nBytesToRead);
+         if (!read)
+         {
+            return read.error();
+         }
+         if (read.value() == 0)
+         {
+            return unexpected_end();
+         }
+
+         std::uint32_t nBytesWritten = 0;
+         while (nBytesWritten < read.value())
+         {
+            const auto written = write_at(a_transfer.hTarget, a_transfer.cbyCopied + nBytesWritten, buffer.get() + nBytesWritten, read.value() - nBytesWritten);
+            if (!written)
+            {
+               return written.error();
+            }
+            nBytesWritten += written.value();
+         }
+         a_transfer.copied(read.value());
+      }
+      return true;
+   }
+
+   ///<summary> a synchronous read, at an offset.</summary>
+   static error::expected<std::uint32_t> read_at(native_handle hFile, std::uint64_t cbyOffset, unsigned char* lpBuffer, std::uint32_t nBytes) noexcept
+   {
+#ifdef _WIN32
+      OVERLAPPED overlapped {};
+      overlapped.Offset = static_cast<DWORD>(cbyOffset);
+      overlapped.OffsetHigh = static_cast<DWORD>(cbyOffset >> 32);
+
+      DWORD numberOfBytesRead = 0;
+      if (!ReadFile(hFile, lpBuffer, nBytes, &numberOfBytesRead, &overlapped))
+      {
+         if (GetLastError() != ERROR_HANDLE_EOF)
+         {
+            return error_code_context("ReadFile failed");
+         }
+         numberOfBytesRead = 0;
+      }
+      return numberOfBytesRead;
+#else
+      ssize_t numberOfBytesRead = 0;
+      do
+      {
+         numberOfBytesRead = ::pread(hFile, lpBuffer, nBytes, static_cast<off_t>(cbyOffset));
+      } while ((numberOfBytesRead == -1) && (errno == EINTR));
+
+      if (numberOfBytesRead == -1)
+      {
+         return error_code_context("pread failed");
+      }
+      return static_cast<std::uint32_t>(numberOfBytesRead);
+#endif
+   }
+
+   ///<summary> a synchronous write, at an offset.</summary>
+   static error::expected<std::uint32_t> write_at(native_handle hFile, std::uint64_t cbyOffset, const unsigned char* lpBuffer, std::uint32_t nBytes) noexcept
+   {
+#ifdef _WIN32
+      OVERLAPPED overlapped {};
+      overlapped.Offset = static_cast<DWORD>(cbyOffset);
+      overlapped.OffsetHigh = static_cast<DWORD>(cbyOffset >> 32);
+
+      DWORD numberOfBytesWritten = 0;
+      if (!WriteFile(hFile, lpBuffer, nBytes, &numberOfBytesWritten, &overlapped))
+      {
+         return error_code_context("WriteFile failed");
+      }
+      return numberOfBytesWritten;
+#else
+      ssize_t numberOfBytesWritten = 0;
+      do
+      {
+         numberOfBytesWritten = ::pwrite(hFile, lpBuffer, nBytes, static_cast<off_t>(cbyOffset));
+      } while ((numberOfBytesWritten == -1) && (errno == EINTR));
+
+      if (numberOfBytesWritten == -1)
+      {
+         return error_code_context("pwrite failed");
+      }
+      return static_cast<std::uint32_t>(numberOfBytesWritten);
+#endif
+   }
+
+   ///<summary> create the target file (replacing any file of the same name).</summary>
+   static error::expected<native_handle> create_target(const std::string& target_path) noexcept
+   {
+#ifdef _WIN32
+      HANDLE hTarget = CreateFile(utf8::convert::to_small_utf16(target_path).c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+      const int hTarget = ::open(target_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+#endif
+      if (hTarget == invalid_native_handle)
+      {
+         return error_code_context("couldn't create the target file");
+      }
+      return hTarget;
+   }
+
+   ///<summary> close the target file (unless it is already closed), and delete it unless the copy completed.</summary>
+   static void close_target(native_handle hTarget, const std::string& target_path, bool completed) noexcept
+   {
+#ifdef _WIN32
+      if (hTarget != invalid_native_handle)
+      {
+         CloseHandle(hTarget);
+      }
+      if (!completed)
+      {
+         DeleteFileW(utf8::convert::to_small_utf16(target_path).c_str());
+      }
+#else
+      if (hTarget != invalid_native_handle)
+      {
+         ::close(hTarget);
+      }
+      if (!completed)
+      {
+         ::unlink(target_path.c_str());
+      }
+#endif
+   }
+
+public:
+   static error::expected<std::uint64_t> get_size(const std::string& source_path) noexcept
+   {
+      const auto shared_handle = acquire_source(source_path);
+      if (!shared_handle)
+      {
+         return shared_handle.error();
+      }
+      const native_handle hSource = get_native_handle(shared_handle.value());
+
+#ifdef _WIN32
+      // a file has a size, a disk (or the media in a drive) has a length
+      LARGE_INTEGER size {};
+      if (GetFileSizeEx(hSource, &size))
+      {
+         return static_cast<std::uint64_t>(size.QuadPart);
+      }
+
+      GET_LENGTH_INFORMATION length {};
+      DWORD nBytesReturned = 0;
+      if (!DeviceIoControl(hSource, IOCTL_DISK_GET_LENGTH_INFO, nullptr, 0, &length, sizeof(length), &nBytesReturned, nullptr))
+      {
+         return error_code_context("couldn't get the size of the source");
+      }
+      return static_cast<std::uint64_t>(length.Length.QuadPart);
+#else
+      // (the end of a block device is its size, as for a file)
+      const off_t end = ::lseek(hSource, 0, SEEK_END);
+      if (end == -1)
+      {
+         return error_code_context("couldn't get the size of the source");
+      }
+      return static_cast<std::uint64_t>(end);
+#endif
+   }
+
+   static error::expected<method> copy(const std::string& source_path, const std::string& target_path, std::uint64_t cbySize, std::atomic<int>& a_progress, fallback a_fallback) noexcept
+   {
+      a_progress = 0;
+
+      const auto shared_handle = acquire_source(source_path);
+      if (!shared_handle)
+      {
+         return shared_handle.error();
+      }
+
+      const auto hTarget = create_target(target_path);
+      if (!hTarget)
+      {
+         return hTarget.error();
+      }
+
+      transfer a_transfer{ get_native_handle(shared_handle.value()), hTarget.value(), cbySize, 0, a_progress };
+      error::expected<method> result = run(source_path, target_path, a_transfer, a_fallback);
+
+      close_target(a_transfer.hTarget, target_path, result.has_value());
+      if (result)
+      {
+         a_progress = 100;
+      }
+      return result;
+   }
+
+private:
+   ///<summary> run the methods in turn, until one completes the copy (or fails).</summary>
+   static error::expected<method> run(const std::string& source_path, const std::string& target_path, transfer& a_transfer, fallback a_fallback) noexcept
+   {
+      if (a_transfer.cbySize == 0)
+      {
+         return method::buffered;   // (nothing to copy)
+      }
+
+#ifdef __linux__
+      for (const auto kernel_method : { method::copy_file_range, method::sendfile, method::splice })
+      {
+         const auto completed =
+            (kernel_method == method::copy_file_range) ? copy_with_copy_file_range(a_transfer) :
+            (kernel_method == method::sendfile) ? copy_with_sendfile(a_transfer) :
+            copy_with_splice(a_transfer);
+
+         if (!completed)
+         {
+            return completed.error();
+         }
+         if (completed.value())
+         {
+            return kernel_method;
+         }
+      }
+      (void)source_path;
+      (void)target_path;
+#elif defined(_WIN32)
+      // (CopyFileEx creates the target itself, so the target created for the other methods is closed first)
+      CloseHandle(a_transfer.hTarget);
+      a_transfer.hTarget = invalid_native_handle;      // (so close_target doesn't close it again, if it can't be reopened)
+      const auto completed = copy_with_copy_file(source_path, target_path, a_transfer);
+      const auto reopened = create_target_unless(completed, target_path);
+      if (!reopened)
+      {
+         return reopened.error();
+      }
+      a_transfer.hTarget = reopened.value();
+
+      if (!completed)
+      {
+         return completed.error();
+      }
+      if (completed.value())
+      {
+         return method::copy_file;
+      }
+#else
+      (void)source_path;
+      (void)target_path;
+#endif
+
+      if (a_fallback == fallback::none)
+      {
+#ifdef _WIN32
+         SetLastError(ERROR_NOT_SUPPORTED);
+#else
+         errno = ENOTSUP;
+#endif
+         return error_code_context("no kernel copy applies to the source");
+      }
+
+      const auto completed_buffered = copy_buffered(a_transfer);
+      if (!completed_buffered)
+      {
+         return completed_buffered.error();
+      }
+      return method::buffered;
+   }
+
+#ifdef _WIN32
+   ///<summary> get a handle to the target for the methods that follow CopyFileEx (and for close_target).</summary>
+   ///<returns> the target opened again (or created, if CopyFileEx did not apply), or the error.</returns>
+   static error::expected<native_handle> create_target_unless(const error::expected<bool>& copied, const std::string& target_path) noexcept
+   {
+      if (copied && copied.value())
+      {
+         HANDLE hTarget = CreateFile(utf8::convert::to_small_utf16(target_path).c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+         if (hTarget == invalid_native_handle)
+         {
+            return error_code_context("couldn't open the target file");
+         }
+         return hTarget;
+      }
+      return create_target(target_path);
+   }
+#endif
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for FileTransfer implementation
+* ***************************************************************************
+*/
+
+std::uint64_t FileTransfer::get_size(const std::string& source_path)
+{
+   return impl::get_size(source_path).value();
+}
+
+FileTransfer::method FileTransfer::copy(const std::string& source_path, const std::string& target_path, std::uint64_t cbySize, std::atomic<int>& a_progress, fallback a_fallback)
+{
+   return impl::copy(source_path, target_path, cbySize, a_progress, a_fallback).value();
+}
+
+error::expected<FileTransfer::method> FileTransfer::copy(std::nothrow_t, const std::string& source_path, const std::string& target_path, std::uint64_t cbySize,
+   std::atomic<int>& a_progress, fallback a_fallback) noexcept
+{
+   return impl::copy(source_path, target_path, cbySize, a_progress, a_fallback);
+}
+
+const char* FileTransfer::to_string(method a_method) noexcept
+{
+   switch (a_method)
+   {
+   case method::copy_file_range:
+      return "copy_file_range";
+   case method::sendfile:
+      return "sendfile";
+   case method::splice:
+      return "splice";
+   case method::copy_file:
+      return "CopyFileEx";
+   case method::buffered:
+   default:
+      return "buffered";
+   }
+}
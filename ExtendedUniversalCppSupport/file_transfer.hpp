@@ -0,0 +1,105 @@
+//
+// file_transfer.hpp : copies a device or image file to a file, inside the kernel where possible
+//
+// A plain copy (with nothing to transform) needs no user space buffer at all: copy_file_range, sendfile and
+// splice move the data between the files inside the kernel, and CopyFileEx does the same for regular files on
+// Windows. Each is tried in turn (as each has its restrictions, E.g. copy_file_range wants regular files, on
+// one file system), and where none applies the data is read and written through a buffer.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __FILE_TRANSFER_HPP__
+#define __FILE_TRANSFER_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <string>
+
+#include <expected.hpp>
+
+///<summary> copies the content of a device (or an image file) to a new file, without it entering user space where possible.</summary>
+///<remarks> safe to call concurrently from any thread (each copy has its own target file).</remarks>
+class EXTENDEDUNIVERSALCPPSUPPORT_API FileTransfer {
+
+public:
+   ///<summary> how a copy was made (in the order the methods are tried).</summary>
+   enum class method
+   {
+      copy_file_range,     // in the kernel, file to file (Linux, where the file system supports it)
+      sendfile,            // in the kernel, from the page cache of the source (Linux)
+      splice,              // in the kernel, through a pipe (Linux)
+      copy_file,           // in the kernel, a regular file copied whole (Windows CopyFileEx)
+      buffered             // read and written through a (reused, aligned) user space buffer
+   };
+
+   ///<summary> what a copy does when no kernel method applies.</summary>
+   enum class fallback
+   {
+      buffered,            // copy through a buffer
+      none                 // fail (so the caller can use a path of its own)
+   };
+
+   ///<summary> get the size of a device or image file.</summary>
+   ///<param name='source_path'> the system name of the device, or the utf8 path name of the file.</param>
+   ///<returns> the size in bytes.</returns>
+   ///<exception cref='std::exception'> if the size could not be found.</exception>
+   static std::uint64_t get_size(const std::string& source_path);
+
+   ///<summary> copy the start of a device (or image file) to a new file (replacing any file of the same name).</summary>
+   ///<remarks> if a kernel method stops working part way (E.g. copy_file_range across file systems), the next method
+   /// carries on from where it stopped.</remarks>
+   ///<param name='source_path'> the system name of the device, or the utf8 path name of the file.</param>
+   ///<param name='target_path'> the utf8 path name of the file to create.</param>
+   ///<param name='cbySize'> the number of bytes to copy.</param>
+   ///<param name='a_progress'> reference to where percentage progress will be maintained.</param>
+   ///<param name='a_fallback'> what to do when no kernel method applies.</param>
+   ///<returns> the method that completed the copy.</returns>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   static method copy(const std::string& source_path, const std::string& target_path, std::uint64_t cbySize, std::atomic<int>& a_progress,
+      fallback a_fallback = fallback::buffered);
+
+   ///<summary> copy the start of a device (or image file) to a new file, without throwing on failure.</summary>
+   ///<param name='source_path'> the system name of the device, or the utf8 path name of the file.</param>
+   ///<param name='target_path'> the utf8 path name of the file to create.</param>
+   ///<param name='cbySize'> the number of bytes to copy.</param>
+   ///<param name='a_progress'> reference to where percentage progress will be maintained.</param>
+   ///<param name='a_fallback'> what to do when no kernel method applies.</param>
+   ///<returns> the method that completed the copy, or the error (ERROR_NOT_SUPPORTED, or ENOTSUP, when no kernel method
+   /// applies and a_fallback is fallback::none).</returns>
+   static error::expected<method> copy(std::nothrow_t, const std::string& source_path, const std::string& target_path, std::uint64_t cbySize,
+      std::atomic<int>& a_progress, fallback a_fallback = fallback::buffered) noexcept;
+
+   ///<summary> get the name of a method (E.g. for logging).</summary>
+   static const char* to_string(method a_method) noexcept;
+
+private:
+   ///<summary> not constructed (all members are static).</summary>
+   FileTransfer() = default;
+
+   ///<summary> forward reference to the private implementation.</summary>
+   class impl;
+};
+
+#endif // __FILE_TRANSFER_HPP__
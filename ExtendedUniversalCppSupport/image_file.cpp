@@ -0,0 +1,363 @@
+//
+// image_file.cpp : implements an image file written at explicit offsets
+//
+// Unbuffered, a write must be a whole number of aligned blocks, so the last (partial) block of an image is
+// copied into a block sized bounce buffer and written whole, and the padding is cut off when the file is closed.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#endif
+
+#include "image_file.hpp"
+
+///<summary> the alignment assumed for unbuffered writes when the file system reports none.</summary>
+constexpr std::uint32_t default_unbuffered_alignment = 4096;
+
+#ifdef _WIN32
+///<summary> the system handle of an open file.</summary>
+using native_handle = HANDLE;
+
+///<summary> the system handle value of no file.</summary>
+static const native_handle invalid_native_handle = INVALID_HANDLE_VALUE;
+#else
+///<summary> the system handle of an open file (a file descriptor).</summary>
+using native_handle = int;
+
+///<summary> the system handle value of no file.</summary>
+static constexpr native_handle invalid_native_handle = -1;
+#endif
+
+
+///<summary> releases a block allocated with an alignment (the bounce buffer).</summary>
+struct aligned_block_delete
+{
+   std::uint32_t cbyAlignment;
+
+   void operator()(unsigned char* lpBlock) const noexcept
+   {
+      ::operator delete[](lpBlock, std::align_val_t(cbyAlignment));
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - private implementation of ImageFile class
+* ***************************************************************************
+*/
+
+///<summary> the private implementation of ImageFile.</summary>
+class ImageFile::impl
+{
+private:
+   std::string file_path;
+   caching caching_mode;
+   native_handle hFile;
+   std::uint32_t alignment;
+
+   ///<summary> one aligned block, for the last (partial) block of an unbuffered image.</summary>
+   std::unique_ptr<unsigned char[], aligned_block_delete> bounce_block;
+
+   ///<summary> the end of the furthest write (the size the file is cut to).</summary>
+   std::uint64_t cbySize;
+
+public:
+   impl(const std::string& a_file_path, caching a_caching) :
+      file_path(a_file_path),
+      caching_mode(a_caching),
+      hFile(invalid_native_handle),
+      alignment(1),
+      bounce_block(nullptr, aligned_block_delete{ 1 }),
+      cbySize(0)
+   {
+#ifdef _WIN32
+      const DWORD dwFlagsAndAttributes = FILE_ATTRIBUTE_NORMAL | ((caching_mode == caching::unbuffered) ? FILE_FLAG_NO_BUFFERING : 0);
+      hFile = CreateFile(utf8::convert::to_small_utf16(file_path).c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, dwFlagsAndAttributes, NULL);
+#else
+      constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+      if (caching_mode == caching::unbuffered)
+      {
+         hFile = ::open(file_path.c_str(), flags | O_DIRECT, 0666);
+      }
+      if ((hFile == invalid_native_handle) && ((caching_mode == caching::buffered) || (errno == EINVAL)))
+      {
+         caching_mode = caching::buffered;   // (the file system does not support direct i/o, E.g. tmpfs)
+         hFile = ::open(file_path.c_str(), flags, 0666);
+      }
+#else
+      caching_mode = caching::buffered;
+      hFile = ::open(file_path.c_str(), flags, 0666);
+#endif
+#endif
+
+      if (hFile == invalid_native_handle)
+      {
+         std::stringstream create_failed; create_failed << "couldn't create image file \"" << file_path << "\"";
+         throw error_context(create_failed.str().c_str());
+      }
+
+      if (caching_mode == caching::unbuffered)
+      {
+         alignment = query_alignment();
+         bounce_block = std::unique_ptr<unsigned char[], aligned_block_delete>(
+            static_cast<unsigned char*>(::operator new[](alignment, std::align_val_t(alignment))), aligned_block_delete{ alignment });
+      }
+   }
+
+   impl(const impl& other) = delete;
+   impl& operator=(const impl& other) = delete;
+
+   ~impl()
+   {
+      close();    // (errors are ignored, as in any destructor)
+   }
+
+   const std::string& get_file_path() const noexcept
+   {
+      return file_path;
+   }
+
+   caching get_caching() const noexcept
+   {
+      return caching_mode;
+   }
+
+   std::uint32_t get_alignment() const noexcept
+   {
+      return alignment;
+   }
+
+   error::expected<void> write(std::uint64_t cbyOffset, const void* lpData, std::uint32_t nBytes) noexcept
+   {
+      if (hFile == invalid_native_handle)
+      {
+#ifdef _WIN32
+         SetLastError(ERROR_INVALID_HANDLE);
+#else
+         errno = EBADF;
+#endif
+         return error_code_context("image file is closed");
+      }
+
+      if (((cbyOffset % alignment) != 0) || ((reinterpret_cast<std::uintptr_t>(lpData) % alignment) != 0))
+      {
+#ifdef _WIN32
+         SetLastError(ERROR_INVALID_PARAMETER);
+#else
+         errno = EINVAL;
+#endif
+         return error_code_context("unaligned offset or buffer for an unbuffered image file");
+      }
+
+      // whole blocks are written from the caller's buffer, the partial block that may follow goes through the bounce buffer
+      const std::uint32_t cbyWhole = nBytes - (nBytes % alignment);
+      const auto* lpabyData = static_cast<const unsigned char*>(lpData);
+
+      const auto whole = write_all(cbyOffset, lpabyData, cbyWhole);
+      if (!whole)
+      {
+         return whole.error();
+      }
+
+      if (cbyWhole < nBytes)
+      {
+         std::memcpy(bounce_block.get(), lpabyData + cbyWhole, nBytes - cbyWhole);
+         std::memset(bounce_block.get() + (nBytes - cbyWhole), 0, alignment - (nBytes - cbyWhole));
+
+         const auto tail = write_all(cbyOffset + cbyWhole, bounce_block.get(), alignment);
+         if (!tail)
+         {
+            return tail.error();
+         }
+      }
+
+      cbySize = std::max(cbySize, cbyOffset + nBytes);   // (the padding of a partial block is cut off at close)
+      return {};
+   }
+
+   error::expected<void> close() noexcept
+   {
+      if (hFile == invalid_native_handle)
+      {
+         return {};
+      }
+
+      error::expected<void> result;
+#ifdef _WIN32
+      FILE_END_OF_FILE_INFO end_of_file {};
+      end_of_file.EndOfFile.QuadPart = static_cast<LONGLONG>(cbySize);
+      if (!SetFileInformationByHandle(hFile, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+      {
+         result = error_code_context("SetFileInformationByHandle failed");
+      }
+      CloseHandle(hFile);
+#else
+      if (::ftruncate(hFile, static_cast<off_t>(cbySize)) == -1)
+      {
+         result = error_code_context("ftruncate failed");
+      }
+      ::close(hFile);
+#endif
+      hFile = invalid_native_handle;
+      return result;
+   }
+
+private:
+   ///<summary> get the alignment the file system needs for unbuffered writes.</summary>
+   std::uint32_t query_alignment() const noexcept
+   {
+#ifdef _WIN32
+      FILE_STORAGE_INFO storage {};
+      if (GetFileInformationByHandleEx(hFile, FileStorageInfo, &storage, sizeof(storage)))
+      {
+         return std::max<std::uint32_t>({ storage.LogicalBytesPerSector, storage.PhysicalBytesPerSectorForPerformance, 1 });
+      }
+#else
+#ifdef STATX_DIOALIGN
+      struct statx extended {};
+      if ((::statx(hFile, "", AT_EMPTY_PATH, STATX_DIOALIGN, &extended) == 0) && ((extended.stx_mask & STATX_DIOALIGN) != 0) && (extended.stx_dio_offset_align > 0))
+      {
+         return std::max<std::uint32_t>({ extended.stx_dio_offset_align, extended.stx_dio_mem_align, 1 });
+      }
+#endif
+#ifdef BLKSSZGET
+      struct stat status {};
+      int logical_block_size = 0;
+      if ((::fstat(hFile, &status) == 0) && S_ISBLK(status.st_mode) && (::ioctl(hFile, BLKSSZGET, &logical_block_size) == 0) && (logical_block_size > 0))
+      {
+         return static_cast<std::uint32_t>(logical_block_size);
+      }
+#endif
+#endif
+      return default_unbuffered_alignment;
+   }
+
+   ///<summary> a synchronous write of all the bytes given, at an offset.</summary>
+   error::expected<void> write_all(std::uint64_t cbyOffset, const unsigned char* lpData, std::uint32_t nBytes) const noexcept
+   {
+      std::uint32_t cbyWritten = 0;
+      while (cbyWritten < nBytes)
+      {
+         const auto written = write_at(cbyOffset + cbyWritten, lpData + cbyWritten, nBytes - cbyWritten);
+         if (!written)
+         {
+            return written.error();
+         }
+         if (written.value() == 0)
+         {
+#ifdef _WIN32
+            SetLastError(ERROR_WRITE_FAULT);
+#else
+            errno = EIO;
+#endif
+            return error_code_context("image file write made no progress");
+         }
+         cbyWritten += written.value();
+      }
+      return {};
+   }
+
+   ///<summary> a synchronous write, at an offset.</summary>
+   ///<returns> the bytes written, or the error.</returns>
+   error::expected<std::uint32_t> write_at(std::uint64_t cbyOffset, const unsigned char* lpData, std::uint32_t nBytes) const noexcept
+   {
+#ifdef _WIN32
+      OVERLAPPED overlapped {};
+      overlapped.Offset = static_cast<DWORD>(cbyOffset);
+      overlapped.OffsetHigh = static_cast<DWORD>(cbyOffset >> 32);
+
+      DWORD numberOfBytesWritten = 0;
+      if (!WriteFile(hFile, lpData, nBytes, &numberOfBytesWritten, &overlapped))
+      {
+         return error_code_context("WriteFile failed");
+      }
+      return numberOfBytesWritten;
+#else
+      ssize_t numberOfBytesWritten = 0;
+      do
+      {
+         numberOfBytesWritten = ::pwrite(hFile, lpData, nBytes, static_cast<off_t>(cbyOffset));
+      } while ((numberOfBytesWritten == -1) && (errno == EINTR));
+
+      if (numberOfBytesWritten == -1)
+      {
+         return error_code_context("pwrite failed");
+      }
+      return static_cast<std::uint32_t>(numberOfBytesWritten);
+#endif
+   }
+};
+
+
+/*
+* ***************************************************************************
+* PIMPL idiom - public interface for ImageFile implementation
+* ***************************************************************************
+*/
+
+ImageFile::ImageFile(const std::string& file_path, caching a_caching) :
+   pimpl(spimpl::make_unique_impl<impl>(file_path, a_caching))
+{
+}
+
+ImageFile::~ImageFile() = default;
+
+const std::string& ImageFile::get_file_path() const noexcept
+{
+   return pimpl->get_file_path();
+}
+
+ImageFile::caching ImageFile::get_caching() const noexcept
+{
+   return pimpl->get_caching();
+}
+
+std::uint32_t ImageFile::get_alignment() const noexcept
+{
+   return pimpl->get_alignment();
+}
+
+void ImageFile::write(std::uint64_t cbyOffset, const void* lpData, std::uint32_t nBytes)
+{
+   pimpl->write(cbyOffset, lpData, nBytes).value();
+}
+
+error::expected<void> ImageFile::write(std::nothrow_t, std::uint64_t cbyOffset, const void* lpData, std::uint32_t nBytes) noexcept
+{
+   return pimpl->write(cbyOffset, lpData, nBytes);
+}
+
+void ImageFile::close()
+{
+   pimpl->close().value();
+}
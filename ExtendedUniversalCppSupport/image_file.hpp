@@ -0,0 +1,99 @@
+//
+// image_file.hpp : implements an image file written at explicit offsets
+//
+// A MemoryMappedFile is filled through the system cache, so a ripped image is held in memory twice (as it is
+// read, and as it is written) and evicts data other programs are using. An ImageFile can instead be written
+// unbuffered (FILE_FLAG_NO_BUFFERING, or O_DIRECT), straight from the caller's (aligned) buffers to disk.
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#ifndef __IMAGE_FILE_HPP__
+#define __IMAGE_FILE_HPP__
+
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
+#else
+#define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
+#endif
+
+#include <cstdint>
+#include <new>
+#include <string>
+
+#include <expected.hpp>
+#include <spimpl.hpp>
+
+#include "device_handle_pool.hpp"
+
+///<summary> an image file (created empty), written at explicit offsets, with or without the system cache.</summary>
+///<remarks> unbuffered, offsets and buffer addresses must be aligned to get_alignment (or the write fails). A write
+/// that ends part way through a block writes that block through a bounce buffer, padded, and the file is cut to the
+/// size written when it is closed, so only the last write of an image should end unaligned. Not copyable, but movable.</remarks>
+class ImageFile
+{
+public:
+   ///<summary> whether writes go through the system cache (see DeviceHandlePool::caching).</summary>
+   using caching = DeviceHandlePool::caching;
+
+   ///<summary> create an image file (replacing any file of the same name).</summary>
+   ///<remarks> where the file system refuses unbuffered i/o (E.g. tmpfs), the file is written buffered (see get_caching).</remarks>
+   ///<param name='file_path'> the utf8 path name of the file.</param>
+   ///<param name='a_caching'> whether writes go through the system cache.</param>
+   ///<exception cref='std::exception'> if the file could not be created.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API ImageFile(const std::string& file_path, caching a_caching = caching::buffered);
+
+   ///<summary> destructor closes the file (see close), ignoring errors.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API ~ImageFile();
+
+   ///<summary> get the path name of the file.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API const std::string& get_file_path() const noexcept;
+
+   ///<summary> get whether writes go through the system cache.</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API caching get_caching() const noexcept;
+
+   ///<summary> get the alignment writes need (1 when buffered).</summary>
+   EXTENDEDUNIVERSALCPPSUPPORT_API std::uint32_t get_alignment() const noexcept;
+
+   ///<summary> write data at an offset.</summary>
+   ///<param name='cbyOffset'> the byte offset to write at.</param>
+   ///<param name='lpData'> the data to write.</param>
+   ///<param name='nBytes'> the number of bytes to write.</param>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API void write(std::uint64_t cbyOffset, const void* lpData, std::uint32_t nBytes);
+
+   ///<summary> write data at an offset, without throwing on failure.</summary>
+   ///<param name='cbyOffset'> the byte offset to write at.</param>
+   ///<param name='lpData'> the data to write.</param>
+   ///<param name='nBytes'> the number of bytes to write.</param>
+   ///<returns> success, or the error.</returns>
+   EXTENDEDUNIVERSALCPPSUPPORT_API error::expected<void> write(std::nothrow_t, std::uint64_t cbyOffset, const void* lpData, std::uint32_t nBytes) noexcept;
+
+   ///<summary> cut the file to the size written (the end of the furthest write), and close it.</summary>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   EXTENDEDUNIVERSALCPPSUPPORT_API void close();
+
+private:
+   ///<summary> forward reference to private implementation.</summary>
+   class impl;
+
+   ///<summary> smart unique pointer to private implementation.</summary>
+   ///<remarks> with default move support.</remarks>
+   spimpl::unique_impl_ptr<impl> pimpl;
+};
+
+#endif // __IMAGE_FILE_HPP__
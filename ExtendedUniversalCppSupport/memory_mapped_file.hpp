@@ -25,7 +25,9 @@
 #ifndef __MEMORY_MAPPED_FILE_HPP__
 #define __MEMORY_MAPPED_FILE_HPP__
 
-#ifdef EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS
+#ifndef _WIN32
+#define EXTENDEDUNIVERSALCPPSUPPORT_API    // (a static library on other platforms)
+#elif defined(EXTENDEDUNIVERSALCPPSUPPORT_EXPORTS)
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllexport)
 #else
 #define EXTENDEDUNIVERSALCPPSUPPORT_API __declspec(dllimport)
@@ -8,12 +8,14 @@
 // add check for tools limitations (clang support) with impact on build preferences
 #include "toolsver.h"
 
+#ifdef _WIN32
 #include "targetver.h"
 
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 // Windows Header Files:
 #define NOMINMAX
 #include <windows.h>
+#endif
 
 #include <vector>
 #include <sstream>
@@ -21,6 +23,8 @@
 // Additional headers this dll requires are here...
 
 #include "error_context.hpp"
+#include "expected.hpp"
+#include "fast_pimpl.hpp"
 #include "file_logger.hpp"
 #include "gsl.hpp"
 #include "logger.hpp"
@@ -0,0 +1,59 @@
+﻿//
+// main.cpp : Defines the entry point for the LogMerge console application.
+//
+// Merges log files written by shared_file_logger (possibly from several processes)
+// into a single log, with records in timestamp order.
+//
+// Usage: LogMerge <output> <input> [<input>...]
+//
+// Copyright (c) 2017-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+///<summary> *** PROGRAM ENTRYPOINT ***.</summary>
+///<param name = "argc"> number of command line parameters (expected 3 or more).</param>
+///<param name = "argv"> array of supplied command line parameters (program path, output path, then one or more input paths).</param>
+///<returns> exit code EXIT_SUCCESS if the logs were merged, or exit code EXIT_FAILURE if an error occurred.</returns>
+int main(int argc, char* argv[])
+{
+   if (argc < 3)
+   {
+      std::cerr << "Usage: LogMerge <output> <input> [<input>...]" << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   try
+   {
+      utf8::console::configure_codepage();
+
+      const std::string output_path(argv[1]);
+      const std::vector<std::string> input_paths(&argv[2], &argv[argc]);
+
+      const auto merged = shared_file_logger::merge(input_paths, output_path);
+
+      std::cout << "Merged " << merged << " records from " << input_paths.size() << " log file(s) into " << output_path << std::endl;
+      return EXIT_SUCCESS;
+   }
+   catch (const error::context& e)
+   {
+      std::cerr << "LogMerge failed. " << e.full_what() << std::endl;
+   }
+   catch (const std::exception& e)
+   {
+      std::cerr << "LogMerge failed. " << e.what() << std::endl;
+   }
+   return EXIT_FAILURE;
+}
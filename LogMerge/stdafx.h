@@ -0,0 +1,28 @@
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+#ifndef __STDAFX_H__
+#define __STDAFX_H__
+
+// add check for tools limitations (clang support) with impact on build preferences
+#include "toolsver.h"
+
+#include "targetver.h"
+
+#include <stdio.h>
+#include <tchar.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Additional headers program requires are here...
+
+#include "error_context.hpp"
+#include "logger.hpp"
+#include "shared_file_logger.hpp"
+#include "utf8_console.hpp"
+#include "utf8_convert.hpp"
+
+#endif // __STDAFX_H__
@@ -0,0 +1,13 @@
+#ifndef __TARGETVER_H__
+#define __TARGETVER_H__
+
+// Including SDKDDKVer.h defines the highest available Windows platform.
+
+// If you wish to build your application for a previous Windows platform, include WinSDKVer.h and
+// set the _WIN32_WINNT macro to the platform you wish to support before including SDKDDKVer.h.
+
+#include <WinSDKVer.h>
+#define _WIN32_WINNT _WIN32_WINNT_WIN7 
+#include <SDKDDKVer.h>
+
+#endif // __TARGETVER_H__
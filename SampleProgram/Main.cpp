@@ -44,7 +44,7 @@ void signal_handler(int signum);
 int main(int argc, char* argv[])
 {
    ///<summary> create a file logger (available everywhere, including dll code).</summary>
-   CREATE_LOGGER(logger_factory::logger_type::file_logger, "ripper.log", DEFAULT_LOG_FILTER);
+   CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, "ripper.log", DEFAULT_LOG_FILTER);
 
    ///<summary>atomic int used to track progress.</summary>
    static std::atomic<int> progress = 0;
@@ -70,22 +70,31 @@ int main(int argc, char* argv[])
 
       LOG_INFO("Sample test program starting.");
       
+      LOG_INFO("Monitor optical readers (and their media) as they come and go.");
+      DeviceMonitor monitor(DeviceTypeDirectory::DeviceType::CDROM_DEVICES);
+
       LOG_INFO("Check if at least one optical reader is available (built-in, or currently attached to the system).");
-      while (DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get().empty())
+      if (monitor.get_devices().empty())
       {
          std::cout << "Please attach a suitable (e.g. usb) optical disk reader to the system. Press CTRL-BREAK to abort." << std::endl;
-         std::system("pause");
+         while (monitor.get_devices().empty())
+         {
+            monitor.wait_for_event();
+         }
       }
 
       LOG_INFO("Select the first such device, and check if an optical disk is loaded.");
-      while (!CdromDevice::check_for_media((DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0])))
+      const std::string deviceName = monitor.get_devices().front();
+      if (!monitor.has_media(deviceName))
       {
          std::cout << "Please insert an optical disk into the (first) drive.  Press CTRL-BREAK to abort." << std::endl;
-         std::system("pause");
+         while (!monitor.has_media(deviceName))
+         {
+            monitor.wait_for_event();
+         }
       }
 
       LOG_INFO("A viable optical disk is now confirmed present in the (first) attached optical drive...");
-      const std::string deviceName = DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0];
 
       ///<summary>choose filename for ripped image</summary>
       const std::string fileName("cdrom_image.iso");
@@ -126,7 +135,7 @@ int main(int argc, char* argv[])
       std::string error_text = "Unhandled Error/Exception: "; error_text.append(f.full_what()); // fancy what (root cause and locus of error)
       std::cout << std::endl << error_text << std::endl;
       std::system("pause");
-      LOG_ERROR(error_text);
+      LOG_EXCEPTION(LogLevel::Error, f);   // logs full_what() with the stack trace (symbols are only resolved here)
       exit(EXIT_FAILURE);
    }
 
@@ -168,10 +177,14 @@ void signal_handler(int signum)
 {
    try
    {
-      std::string reason("Program was interrupted (by user action)! Code ");
-      reason.append(std::to_string(signum));
-      LOG_WARNING(reason);
-      CdromDevice(DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0]).unlock();
+      LOG_WARNING_FMT("Program was interrupted (by user action)! Code {}", signum);
+
+      // use the devices the monitor last saw (don't enumerate devices while the process is being torn down)
+      const auto devices = DeviceDiscoveryCache::peek_device_paths(DeviceTypeDirectory::DeviceType::CDROM_DEVICES);
+      if (devices && !devices->empty())
+      {
+         CdromDevice(devices->begin()->second).unlock();
+      }
    }
    catch (...)
    {
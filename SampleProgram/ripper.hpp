@@ -19,8 +19,13 @@
 #ifndef __RIPPER_HPP__
 #define __RIPPER_HPP__
 
+#include <algorithm>
 #include <atomic>
 
+#include "aligned_buffer_pool.hpp"
+#include "block_source.hpp"
+#include "file_transfer.hpp"
+#include "image_file.hpp"
 #include "logger.hpp"
 #include "RAII_cd_physical_lock.hpp"
 #include "RAII_cd_exclusive_access_lock.hpp"
@@ -32,13 +37,73 @@ private:
    ///<summary> the cdrom to be ripped.</summary>
    CdromDevice m_cdr;
 
+   ///<summary> the size of each (unbuffered) transfer, before rounding to the device limits.</summary>
+   static constexpr std::uint64_t unbuffered_transfer_size = MemoryMappedFile::megabytes(1);
+
+   ///<summary> copy an image to an image file, bypassing the system cache (on both sides).</summary>
+   ///<remarks> each transfer is read into an aligned buffer (reused from a pool), and written from it. The buffers are
+   /// aligned for the source and the file both, and sized in whole source sectors and file blocks (no larger than the
+   /// source's largest transfer). As CdromDevice::get_image does, reads the system can't resource are retried smaller.</remarks>
+   ///<param name='source'> the image to copy (E.g. the media in a cd drive, see CdromBlockSource).</param>
+   ///<param name='filePath'> the utf8 name of a file to receive the image.</param>
+   ///<param name='a_progress'> reference to where percentage read progress will be maintained.</param>
+   static void rip_unbuffered(const BlockSource& source, const std::string& filePath, std::atomic<int>& a_progress)
+   {
+      a_progress = 0;
+      const uint64_t cbyImageSize = source.get_size();
+      ImageFile image(filePath, ImageFile::caching::unbuffered);
+
+      DeviceCapabilities capabilities = source.get_capabilities();
+      capabilities.buffer_alignment = std::max(capabilities.buffer_alignment, image.get_alignment());
+      capabilities.physical_sector_size = std::max(capabilities.physical_sector_size, image.get_alignment());  // (whole file blocks too)
+
+      // whole (raised) sectors, rounded down so that a transfer never exceeds the source's limit (the pool rounds up)
+      const uint64_t cbySectorSize = std::max<uint64_t>(capabilities.physical_sector_size, 1);
+      const uint64_t cSectorsPerTransfer = std::max<uint64_t>(std::min<uint64_t>(unbuffered_transfer_size, capabilities.max_transfer_size) / cbySectorSize, 1);
+      AlignedBufferPool pool(capabilities, gsl::narrow<std::size_t>(cSectorsPerTransfer * cbySectorSize));
+
+      uint64_t cbyReadSize = pool.get_buffer_size();
+      uint64_t cbyRead = 0;
+      while (cbyRead < cbyImageSize)
+      {
+         const auto buffer = pool.acquire();
+         const auto cbyToRead = gsl::narrow<std::size_t>(std::min<uint64_t>(cbyReadSize, cbyImageSize - cbyRead));
+         const auto read = source.read_at(std::nothrow, cbyRead, gsl::span<unsigned char>(buffer.get(), cbyToRead));
+         if (!read && (read.error().get_error_code() == ERROR_NO_SYSTEM_RESOURCES) && (cbyReadSize > cbySectorSize))
+         {
+            cbyReadSize = std::max<uint64_t>(cbyReadSize / cbySectorSize / 2, 1) * cbySectorSize;   // (retry in smaller reads)
+            LOG_WARNING_FMT("Read of {} bytes could not be resourced, retrying in reads of {} bytes", cbyToRead, cbyReadSize);
+            continue;
+         }
+
+         const uint32_t cbyThisRead = read.value();
+         if (cbyThisRead == 0)
+         {
+            throw error_context("Unexpected end of media");
+         }
+         if (cbyThisRead < cbyToRead)
+         {
+            // (the read is clamped to the image, so it ended early, and the next offset would no longer be aligned)
+            throw error_context("Short read before the end of the image");
+         }
+
+         image.write(cbyRead, buffer.get(), cbyThisRead);
+         cbyRead += cbyThisRead;
+         a_progress = gsl::narrow<int>((100 * cbyRead) / cbyImageSize);
+      }
+      image.close();
+      a_progress = 100;
+   }
+
 public:
    ///<summary> construct a ripper.</summary>
    ///<param name='devicePath'> the utf8 name of a raw system cdrom device containing media.</param>
-   Ripper(const std::string& devicePath) :
-      m_cdr(devicePath)
+   ///<param name='a_caching'> whether the rip goes through the system cache. Unbuffered, the image is copied through a
+   /// few reused aligned buffers (rather than a memory mapped file), so ripping doesn't evict data other programs use.</param>
+   Ripper(const std::string& devicePath, Device::caching a_caching = Device::caching::buffered) :
+      m_cdr(devicePath, a_caching)
    {
-      LOG_INFO(std::string("Ripper Device ").append(devicePath));
+      LOG_INFO_FMT("Ripper Device {}", devicePath);
    }
 
    ///<summary> functor to perform the rip operation. This copies the cdrom image to a disk file.</summary>
@@ -56,10 +121,57 @@ public:
       RAII_cd_physical_lock lock(m_cdr);                                      // disables the cd eject button
       RAII_cd_exclusive_access_lock ea_lock(m_cdr, "Rip_" + utc_timestamp()); // disallow other instances/programs (potential simultaneous writes)
 
-      LOG_INFO(std::string("Ripping to ").append(filePath));
+      LOG_INFO_FMT("Ripping to {}", filePath);
+
+      if (m_cdr.get_caching() == Device::caching::unbuffered)
+      {
+         rip(CdromBlockSource(m_cdr), filePath, a_progress, Device::caching::unbuffered);
+         return;
+      }
+
+      rip(CdromBlockSource(m_cdr), filePath, a_progress);
+   }
+
+   ///<summary> copy an image from any source (a cdrom, an image file, memory, or a view of others) to a disk file.</summary>
+   ///<remarks> the same pipeline the functor uses for a cdrom, so it can be measured (and tested) without a drive, and
+   /// reused to convert one image to another (E.g. to cut a session out of an image, see OffsetBlockSource). Buffered, a
+   /// whole image file is copied with copy_image instead (in the kernel where possible, with no buffer of ours).</remarks>
+   ///<param name='source'> the image to copy.</param>
+   ///<param name='filePath'> the utf8 name of a file to receive the image.</param>
+   ///<param name='a_progress'> reference to where percentage read progress will be maintained.</param>
+   ///<param name='a_caching'> whether the file is written through the system cache (unbuffered, through a few reused
+   /// aligned buffers rather than a memory mapped file).</param>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   static void rip(const BlockSource& source, const std::string& filePath, std::atomic<int>& a_progress, Device::caching a_caching = Device::caching::buffered)
+   {
+      if (a_caching == Device::caching::unbuffered)
+      {
+         rip_unbuffered(source, filePath, a_progress);
+         return;
+      }
+
+      if (const auto image_file = dynamic_cast<const ImageFileBlockSource*>(&source))
+      {
+         copy_image(image_file->get_file_path(), filePath, a_progress);
+         return;
+      }
 
       // get image into the buffer of a suitably named memory mapped file, (and keep track of progress)
-      m_cdr.get_image(MemoryMappedFile(filePath, "", m_cdr.get_image_size()).get_span(), a_progress);
+      source.read_image(MemoryMappedFile(filePath, "", source.get_size()).get_span(), a_progress);
+   }
+
+   ///<summary> copy an image file (or the whole of any device) to a new file.</summary>
+   ///<remarks> the copy is made in the kernel where possible (E.g. a reflink, on a file system that supports them), and
+   /// otherwise through a buffer.</remarks>
+   ///<param name='sourcePath'> the utf8 name of the image file (or the system name of the device) to copy.</param>
+   ///<param name='filePath'> the utf8 name of a file to receive the copy.</param>
+   ///<param name='a_progress'> reference to where percentage progress will be maintained.</param>
+   ///<exception cref='std::exception'> if the operation could not be completed.</exception>
+   static void copy_image(const std::string& sourcePath, const std::string& filePath, std::atomic<int>& a_progress)
+   {
+      LOG_INFO_FMT("Copying {} to {}", sourcePath, filePath);
+      const auto method = FileTransfer::copy(sourcePath, filePath, FileTransfer::get_size(sourcePath), a_progress);
+      LOG_INFO_FMT("Copied with {}", FileTransfer::to_string(method));
    }
 };
 
@@ -30,8 +30,16 @@
 #include "utf8_console.hpp"
 #include "utf8_convert.hpp"
 
+#include "aligned_buffer_pool.hpp"
+#include "block_source.hpp"
 #include "cd_rom_device.hpp"
 #include "device_discoverer.hpp"
+#include "device_discovery_cache.hpp"
+#include "device_handle_pool.hpp"
+#include "device_monitor.hpp"
+#include "device_read_queue.hpp"
+#include "file_transfer.hpp"
+#include "image_file.hpp"
 #include "memory_mapped_file.hpp"
 #include "RAII_cd_exclusive_access_lock.hpp"
 #include "RAII_cd_physical_lock.hpp"
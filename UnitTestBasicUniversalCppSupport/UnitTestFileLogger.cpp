@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <crtdbg.h>
 #include <iomanip>
 #include <thread>
 #include <sstream>
@@ -29,9 +30,11 @@ using namespace utf8;
 
 using namespace std::chrono_literals;
 
+// allocations made by this module are counted in release builds too
+ALLOCATION_COUNTER_REPLACE_OPERATOR_NEW()
+
 namespace UnitTestBasicUniversalCppSupport
 {
-
    TEST_CLASS(UnitTestFileLogger)
    {
 
@@ -137,6 +140,22 @@ namespace UnitTestBasicUniversalCppSupport
          utf8::Assert::AreEqual(U8("φιλε_λ.εχτ"), get_short_file(U8("\\\\\\\\\\\\\\\\φιλε_λ.εχτ")));
       }
 
+      TEST_METHOD(TestLogSiteDecoration)
+      {
+         // the decoration is built at compile time (a static_assert proves this)...
+         static constexpr logging::log_site site("file_a.ext", 42);
+         static_assert(site.prefix().substr(0, 14) == "file_a.ext(42)", "log_site decoration is not compile time");
+
+         // and is laid out as file(line), left aligned in FILE_DETAIL_WIDTH, followed by ": "...
+         std::string expected("file_a.ext(42)");
+         expected.append(FILE_DETAIL_WIDTH - expected.size(), ' ').append(": ");
+         utf8::Assert::AreEqual(expected, std::string(site.prefix()), "unexpected log site decoration");
+
+         // details wider than FILE_DETAIL_WIDTH are not truncated (only aligned when they fit)...
+         static constexpr logging::log_site wide_site("a_long_file_name_that_is_wider_than_the_column.ext", 7);
+         utf8::Assert::AreEqual(std::string("a_long_file_name_that_is_wider_than_the_column.ext(7): "), std::string(wide_site.prefix()), "unexpected wide log site decoration");
+      }
+
       TEST_METHOD(TestErrorContext)
       {
          // Building 'line' prevents this test from breaking every time unit test changes affect the line number tested here
@@ -176,6 +195,99 @@ namespace UnitTestBasicUniversalCppSupport
       }
 
 
+      TEST_METHOD(TestFormattedLoggingDoesNotAllocate)
+      {
+         try
+         {
+            // prepare for test (a first call warms up the stream and the per thread format buffer)...
+            const std::string device_name("CdRom0");
+            const std::string run_stamp = utc_timestamp(); // unique every run
+            LOG_TRACE_FMT("formatted logging warm up {}", run_stamp);
+
+            allocation_counter::begin();
+
+            // perform the operation under test...
+            for (int i = 0; i < 100; i++)
+            {
+               LOG_TRACE_FMT("formatted {} read {} of {} blocks ({:.1f}%) {}", device_name, i, 100, i * 1.0, run_stamp);
+            }
+
+            const int allocations = allocation_counter::end();
+
+            // test succeeds if no formatted log call allocated...
+            utf8::Assert::AreEqual(0, allocations, "formatted logging allocated");
+
+            // and the formatted text is found in the log...
+            const std::string expected = "formatted CdRom0 read 99 of 100 blocks (99.0%) " + run_stamp;
+            utf8::Assert::IsFalse((LOG_FILE_CONTENTS.find(expected) == std::string::npos), "formatted text was not found in log");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestLogLimiterRules)
+      {
+         // each rule returns the count suppressed since the site last logged (or nothing when this occurrence is suppressed)...
+         logging::log_limiter every, first, rate;
+         int every_logged = 0, first_logged = 0, rate_logged = 0;
+         std::uint64_t every_suppressed = 0, first_suppressed = 0;
+
+         // perform the operation under test...
+         for (int i = 0; i < 1000; i++)
+         {
+            if (const auto suppressed = every.every_n(100)) { every_logged++; every_suppressed += *suppressed; }
+            if (const auto suppressed = first.first_n(10, 100)) { first_logged++; first_suppressed += *suppressed; }
+            if (rate.per_second(1000000)) { rate_logged++; }
+         }
+
+         // test succeeds if each rule passed the expected occurrences, and accounted for those it suppressed...
+         utf8::Assert::AreEqual(10, every_logged, "every_n logged unexpected number of occurrences");
+         utf8::Assert::IsTrue(every_suppressed == 9 * 99, "every_n reported unexpected suppressed count");
+         utf8::Assert::AreEqual(10 + 9, first_logged, "first_n logged unexpected number of occurrences");
+         utf8::Assert::IsTrue(first_suppressed == 9 * 99, "first_n reported unexpected suppressed count");
+         utf8::Assert::AreEqual(1000, rate_logged, "per_second suppressed occurrences below the rate");
+
+         // and a rate limit is enforced...
+         logging::log_limiter strict;
+         int strict_logged = 0;
+         for (int i = 0; i < 1000; i++)
+         {
+            if (strict.per_second(5)) { strict_logged++; }
+         }
+         utf8::Assert::IsTrue((strict_logged >= 5) && (strict_logged <= 10), "per_second did not limit occurrences");   // the loop may straddle one second boundary
+      }
+
+      TEST_METHOD(TestLogEveryN)
+      {
+         try
+         {
+            // prepare for test...
+            std::string log_text = "this is a sampled log entry "; log_text.append(utc_timestamp()); // unique every run
+
+            // perform the operation under test...
+            for (int i = 0; i < 250; i++)
+            {
+               LOG_EVERY_N(LogLevel::Trace, 100, log_text);
+            }
+
+            // test succeeds if only the 1st, 101st and 201st occurrences are logged, the later ones noting what was suppressed...
+            const std::string contents = LOG_FILE_CONTENTS;
+            int logged = 0;
+            for (auto pos = contents.find(log_text); pos != std::string::npos; pos = contents.find(log_text, pos + 1))
+            {
+               logged++;
+            }
+            utf8::Assert::AreEqual(3, logged, "unexpected number of sampled log entries");
+            utf8::Assert::IsFalse(contents.find(log_text + " (99 similar suppressed)") == std::string::npos, "suppressed count was not logged");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
       TEST_METHOD(TestFileLoggerFilteringBasic)
       {
          try
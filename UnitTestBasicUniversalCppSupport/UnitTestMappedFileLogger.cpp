@@ -0,0 +1,222 @@
+//
+// UnitTestMappedFileLogger.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2019-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestBasicUniversalCppSupport
+{
+   // the mapped file logger tests use their own log file (a mapped log file should have exactly one writer)
+   const std::string mapped_log_file_name("UnitTestMapped.log");
+
+   // small segments force the log to grow (map new segments) many times in each test
+   constexpr std::uint64_t small_segment_size = 64 * 1024;
+
+   TEST_CLASS(UnitTestMappedFileLogger)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitTestMappedFileLogger) noexcept   // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");     // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestMappedFileLoggerSimpleLogEntry)
+      {
+         try
+         {
+            // prepare for test...
+            std::remove(mapped_log_file_name.c_str());
+            mapped_file_logger logger(mapped_log_file_name, LogFilter::Full, small_segment_size);
+            std::string log_text = "this is a mapped log entry "; log_text.append(utc_timestamp()); // unique every run
+
+            // perform the operation under test...
+            logger.writeln(LogLevel::Trace, log_text);
+
+            // test succeeds if log_text with this unique timestamp attached, is found in the log...
+            utf8::Assert::IsFalse((logger.read_all().find(log_text) == std::string::npos), "logged text was not found in log");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestMappedFileLoggerAppendsAcrossSessions)
+      {
+         try
+         {
+            // prepare for test...
+            std::remove(mapped_log_file_name.c_str());
+            std::string first_text = "first session entry "; first_text.append(utc_timestamp());
+            std::string second_text = "second session entry "; second_text.append(utc_timestamp());
+
+            // perform the operation under test...
+            {
+               mapped_file_logger first_session(mapped_log_file_name, LogFilter::Full, small_segment_size);
+               first_session.writeln(LogLevel::Trace, first_text);
+            }
+
+            mapped_file_logger second_session(mapped_log_file_name, LogFilter::Full, small_segment_size);
+            second_session.writeln(LogLevel::Trace, second_text);
+
+            // test succeeds if both sessions are present in order (the second session appends to the trimmed first session)...
+            const std::string contents = second_session.read_all();
+            const auto first_position = contents.find(first_text);
+            const auto second_position = contents.find(second_text);
+            utf8::Assert::IsFalse(first_position == std::string::npos, "first session text was not found in log");
+            utf8::Assert::IsFalse(second_position == std::string::npos, "second session text was not found in log");
+            utf8::Assert::IsTrue(first_position < second_position, "sessions were not appended in order");
+            utf8::Assert::IsTrue(contents.find('\0') == std::string::npos, "log contains unwritten (preallocated) space");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestMappedFileLoggerRecoversUnclosedLog)
+      {
+         try
+         {
+            // prepare for test (the log a session leaves if its process dies before closing: the part written, the
+            // zero filled remainder of its last segment, and the whole next segment it mapped ahead of demand)...
+            std::remove(mapped_log_file_name.c_str());
+            std::string first_text = "unclosed session entry "; first_text.append(utc_timestamp());
+            const std::string first_record = first_text + "\r\n";
+            {
+               std::ofstream crashed_log(mapped_log_file_name, std::ios::binary);
+               crashed_log << first_record;
+               const std::string unwritten(gsl::narrow<std::size_t>(2 * small_segment_size) - first_record.size(), '\0');
+               crashed_log.write(unwritten.data(), gsl::narrow<std::streamsize>(unwritten.size()));
+            }
+            std::string second_text = "recovering session entry "; second_text.append(utc_timestamp());
+
+            // perform the operation under test...
+            {
+               mapped_file_logger recovering_session(mapped_log_file_name, LogFilter::Full, small_segment_size);
+               recovering_session.writeln(LogLevel::Trace, second_text);
+            }
+
+            // test succeeds if the second session appends right after the last record written (no zeros in between)...
+            std::ifstream log_file(mapped_log_file_name, std::ios::binary);
+            const std::string contents((std::istreambuf_iterator<char>(log_file)), std::istreambuf_iterator<char>());
+            utf8::Assert::IsTrue(contents.find('\0') == std::string::npos, "log contains unwritten (preallocated) space");
+            utf8::Assert::IsTrue(contents.find(first_record) == 0, "unclosed session text was not found at the start of the log");
+            utf8::Assert::IsTrue(contents.find(second_text) != std::string::npos, "recovering session text was not found in log");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestMappedFileLoggerDropsWhenFull)
+      {
+         try
+         {
+            // prepare for test (a record larger than all the segments a session may map)...
+            std::remove(mapped_log_file_name.c_str());
+            mapped_file_logger logger(mapped_log_file_name, LogFilter::Full, small_segment_size);
+            const std::string oversized(gsl::narrow<std::size_t>(1024 * small_segment_size), 'x');
+            std::string log_text = "entry after a dropped record "; log_text.append(utc_timestamp());
+
+            // perform the operation under test (neither call should throw)...
+            logger.writeln(LogLevel::Trace, oversized);
+            logger.writeln(LogLevel::Trace, log_text);
+
+            // test succeeds if only the oversized record is dropped, and the log still takes the next record...
+            utf8::Assert::IsTrue(logger.get_dropped_records() == 1, "the oversized record was not counted as dropped");
+            utf8::Assert::IsFalse((logger.read_all().find(log_text) == std::string::npos), "logged text was not found in log");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestMappedFileLoggerIsThreadsafe)
+      {
+         try
+         {
+            // prepare for test...
+            std::remove(mapped_log_file_name.c_str());
+            constexpr int thread_count = 8;
+            constexpr int records_per_thread = 2000;   // ~1MB in total, so the 64KB segments are grown (and retired) concurrently
+
+            {
+               mapped_file_logger logger(mapped_log_file_name, LogFilter::Full, small_segment_size);
+
+               // perform the operation under test...
+               std::vector<std::thread> writers;
+               for (int t = 0; t < thread_count; t++)
+               {
+                  writers.emplace_back([&logger, t]
+                  {
+                     for (int i = 0; i < records_per_thread; i++)
+                     {
+                        logger.writeln(LogLevel::Trace, "<thread " + std::to_string(t) + " record " + std::to_string(i) + ">");
+                     }
+                  });
+               }
+
+               for (auto& writer : writers)
+               {
+                  writer.join();
+               }
+            }  // logger closes (and trims the log file) here
+
+            // test succeeds if every record is found intact (no torn or overlapping records) and nothing unwritten remains...
+            std::ifstream log_file(mapped_log_file_name, std::ios::binary);
+            const std::string contents((std::istreambuf_iterator<char>(log_file)), std::istreambuf_iterator<char>());
+
+            utf8::Assert::IsTrue(contents.find('\0') == std::string::npos, "log contains unwritten (preallocated) space");
+            for (int t = 0; t < thread_count; t++)
+            {
+               for (int i = 0; i < records_per_thread; i++)
+               {
+                  const std::string record = "<thread " + std::to_string(t) + " record " + std::to_string(i) + ">\r\n";
+                  if (contents.find(record) == std::string::npos)
+                  {
+                     utf8::Assert::Fail(std::string("record not found in log: ").append(record).c_str());
+                  }
+               }
+            }
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+   };
+}
@@ -0,0 +1,212 @@
+﻿//
+// UnitTestSharedFileLogger.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2019-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestBasicUniversalCppSupport
+{
+   // the shared file logger tests use their own log files
+   const std::string shared_log_file_name("UnitTestShared.log");
+   const std::string merge_input_a("UnitTestMergeA.log");
+   const std::string merge_input_b("UnitTestMergeB.log");
+   const std::string merge_output("UnitTestMerged.log");
+
+   TEST_CLASS(UnitTestSharedFileLogger)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitTestSharedFileLogger) noexcept   // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");     // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestSharedFileLoggerSimpleLogEntry)
+      {
+         try
+         {
+            // prepare for test...
+            std::remove(shared_log_file_name.c_str());
+            shared_file_logger logger(shared_log_file_name, LogFilter::Full);
+            std::string log_text = "this is a shared log entry "; log_text.append(utc_timestamp()); // unique every run
+
+            // perform the operation under test...
+            logger.writeln(LogLevel::Trace, log_text);
+
+            // test succeeds if log_text is found in the log, tagged with this process id...
+            const std::string contents = logger.read_all();
+            const std::string process_tag = " [" + std::to_string(GetCurrentProcessId()) + ":";
+            utf8::Assert::IsFalse((contents.find(log_text) == std::string::npos), "logged text was not found in log");
+            utf8::Assert::IsFalse((contents.find(process_tag) == std::string::npos), "record was not tagged with [pid:seq]");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestSharedFileLoggerRecordsDoNotInterleave)
+      {
+         try
+         {
+            // prepare for test...
+            std::remove(shared_log_file_name.c_str());
+            constexpr int thread_count = 8;
+            constexpr int records_per_thread = 500;
+
+            {
+               // two independent loggers (two handles) on one file, as if opened by two processes
+               shared_file_logger first(shared_log_file_name, LogFilter::Full);
+               shared_file_logger second(shared_log_file_name, LogFilter::Full);
+
+               // perform the operation under test...
+               std::vector<std::thread> writers;
+               for (int t = 0; t < thread_count; t++)
+               {
+                  shared_file_logger& logger = (t % 2 == 0) ? first : second;
+                  writers.emplace_back([&logger, t]
+                  {
+                     for (int i = 0; i < records_per_thread; i++)
+                     {
+                        logger.writeln(LogLevel::Trace, "<thread " + std::to_string(t) + " record " + std::to_string(i) + ">");
+                     }
+                  });
+               }
+
+               for (auto& writer : writers)
+               {
+                  writer.join();
+               }
+            }
+
+            // test succeeds if every record is found intact, on a line of its own (no torn or overwritten records)...
+            std::ifstream log_file(shared_log_file_name, std::ios::binary);
+            const std::string contents((std::istreambuf_iterator<char>(log_file)), std::istreambuf_iterator<char>());
+
+            for (int t = 0; t < thread_count; t++)
+            {
+               for (int i = 0; i < records_per_thread; i++)
+               {
+                  const std::string record = "] <thread " + std::to_string(t) + " record " + std::to_string(i) + ">\r\n";
+                  if (contents.find(record) == std::string::npos)
+                  {
+                     utf8::Assert::Fail(std::string("record not found in log: ").append(record).c_str());
+                  }
+               }
+            }
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestSharedFileLoggerMergeOrdersRecords)
+      {
+         try
+         {
+            // prepare for test (two process logs, each in its own time order, with a multi-line record)...
+            {
+               std::ofstream a(merge_input_a, std::ofstream::trunc);
+               a << "Info    : 2020-01-01T10:00:00.0000001Z [100:1] first" << std::endl;
+               a << "Error   : 2020-01-01T10:00:00.0000003Z [100:2] third" << std::endl;
+               a << "   continuation of third" << std::endl;
+               a << "Info    : 2020-01-01T10:00:00.0000004Z [100:3] fourth" << std::endl;
+
+               std::ofstream b(merge_input_b, std::ofstream::trunc);
+               b << "Debug   : 2020-01-01T10:00:00.0000002Z [200:1] second" << std::endl;
+               b << "Trace   : 2020-01-01T10:00:00.0000004Z [200:2] fifth" << std::endl;
+            }
+
+            // perform the operation under test...
+            const auto merged = shared_file_logger::merge({ merge_input_a, merge_input_b }, merge_output);
+
+            // test succeeds if all records are merged in timestamp order (ties by process), continuation lines kept in place...
+            std::ifstream output(merge_output);
+            const std::string contents((std::istreambuf_iterator<char>(output)), std::istreambuf_iterator<char>());
+
+            utf8::Assert::IsTrue(merged == 5, "unexpected merged record count");
+            const auto first = contents.find("first");
+            const auto second = contents.find("second");
+            const auto third = contents.find("third\n   continuation of third");
+            const auto fourth = contents.find("fourth");
+            const auto fifth = contents.find("fifth");
+            utf8::Assert::IsFalse((first == std::string::npos) || (second == std::string::npos) || (third == std::string::npos)
+               || (fourth == std::string::npos) || (fifth == std::string::npos), "a merged record was not found");
+            utf8::Assert::IsTrue((first < second) && (second < third) && (third < fourth) && (fourth < fifth), "records were not merged in order");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestSharedFileLoggerMergeKeepsFilesApart)
+      {
+         const std::string utf8_merge_input(U8("UnitTestMergeΓειά.log"));
+         const std::string utf8_merge_output(U8("UnitTestMergedΚόσμε.log"));
+         try
+         {
+            // prepare for test (a second log that starts part way through a record, E.g. after rotation, with utf8 names)...
+            {
+               std::ofstream a(merge_input_a, std::ofstream::trunc);
+               a << "Info    : 2020-01-01T10:00:00.0000001Z [100:1] first" << std::endl;
+
+               std::ofstream b(utf8::convert::to_utf16(utf8_merge_input), std::ofstream::trunc);
+               b << "   orphan line one" << std::endl;
+               b << "   orphan line two" << std::endl;
+               b << "Debug   : 2020-01-01T10:00:00.0000002Z [200:1] second" << std::endl;
+            }
+
+            // perform the operation under test...
+            const auto merged = shared_file_logger::merge({ merge_input_a, utf8_merge_input }, utf8_merge_output);
+
+            // test succeeds if the orphan lines stay with the first record of their own file (not sorted apart from it)...
+            std::ifstream output(utf8::convert::to_utf16(utf8_merge_output));
+            const std::string contents((std::istreambuf_iterator<char>(output)), std::istreambuf_iterator<char>());
+
+            utf8::Assert::IsTrue(merged == 2, "unexpected merged record count");
+            const auto orphans = contents.find("   orphan line one\n   orphan line two\nDebug   : 2020-01-01T10:00:00.0000002Z [200:1] second");
+            const auto first = contents.find("first");
+            utf8::Assert::IsFalse((orphans == std::string::npos) || (first == std::string::npos), "a merged record was not found");
+            utf8::Assert::IsTrue(first < orphans, "the orphan lines should sort with the record they precede");
+         }
+         catch (const error::context& e)
+         {
+            utf8::Assert::Fail(e.full_what()); // something went wrong
+         }
+         _wremove(utf8::convert::to_utf16(utf8_merge_input).c_str());
+         _wremove(utf8::convert::to_utf16(utf8_merge_output).c_str());
+      }
+   };
+}
@@ -0,0 +1,135 @@
+//
+// UnitTestStackTrace.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2019-2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestBasicUniversalCppSupport
+{
+   ///<summary> a named (not inlined) function to throw from, so that it can be found in the stack trace.</summary>
+   __declspec(noinline) static void throw_from_known_function()
+   {
+      throw error_context("stack trace test failure");
+   }
+
+   ///<summary> a named (not inlined) function that raises an error::code, so that it can be found in the stack trace.</summary>
+   __declspec(noinline) static void raise_from_known_function()
+   {
+      error_code_context("stack trace test failure").raise();
+   }
+
+   TEST_CLASS(UnitTestStackTrace)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitTestStackTrace) noexcept   // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");     // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestStackTraceCapture)
+      {
+         try
+         {
+            // perform the operation under test (capture, then resolve)...
+            const auto trace = error::stack_trace::capture();
+            const std::string text = trace.to_string();
+
+            // test succeeds if frames were captured, and the innermost frame resolves to this test method...
+            utf8::Assert::IsFalse(trace.empty(), "no frames were captured");
+            utf8::Assert::IsTrue(trace.frame(trace.size()) == nullptr, "a frame beyond the captured frames was returned");
+            utf8::Assert::IsFalse((text.find("TestStackTraceCapture") == std::string::npos), "the calling function was not resolved");
+            utf8::Assert::IsTrue((error::stack_trace::resolve(trace.frame(0)) == error::stack_trace::resolve(trace.frame(0))), "resolving an address again gave a different result");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestErrorContextStackTrace)
+      {
+         try
+         {
+            // perform the operation under test (throw an error::context, and describe it for a log)...
+            try
+            {
+               throw_from_known_function();
+               utf8::Assert::Fail("no exception was thrown");
+            }
+            catch (const error::context& e)
+            {
+               const std::string description = error::describe(e);
+
+               // test succeeds if the description holds full_what() then the trace, which includes the throwing function...
+#ifdef ERROR_CONTEXT_STACK_TRACE
+               utf8::Assert::IsFalse(e.get_stack_trace().empty(), "no stack was captured at the throw");
+               utf8::Assert::IsTrue((description.find(e.full_what()) == 0), "the description does not start with full_what()");
+               utf8::Assert::IsFalse((description.find("throw_from_known_function") == std::string::npos), "the throwing function is not in the trace");
+#else
+               utf8::Assert::IsTrue(e.get_stack_trace().empty(), "a stack was captured when ERROR_CONTEXT_STACK_TRACE is not defined");
+               utf8::Assert::IsTrue((description == e.full_what()), "the description is not full_what()");
+#endif
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestErrorCodeRaiseStackTrace)
+      {
+         try
+         {
+            // perform the operation under test (raise an error::code as an error::context)...
+            try
+            {
+               raise_from_known_function();
+               utf8::Assert::Fail("no exception was thrown");
+            }
+            catch (const error::context& e)
+            {
+               // test succeeds if the trace starts at the caller of raise (raise itself is skipped)...
+#ifdef ERROR_CONTEXT_STACK_TRACE
+               utf8::Assert::IsFalse(e.get_stack_trace().empty(), "no stack was captured at the raise");
+               const std::string innermost = error::stack_trace::resolve(e.get_stack_trace().frame(0));
+               utf8::Assert::IsFalse((innermost.find("raise_from_known_function") == std::string::npos), "the trace does not start at the caller of raise");
+#else
+               utf8::Assert::IsTrue(e.get_stack_trace().empty(), "a stack was captured when ERROR_CONTEXT_STACK_TRACE is not defined");
+#endif
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
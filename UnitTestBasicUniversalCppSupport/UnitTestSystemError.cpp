@@ -18,6 +18,8 @@
 //
 #include "stdafx.h"
 
+#include <thread>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace utf8;
 
@@ -33,7 +35,7 @@ namespace UnitTestBasicUniversalCppSupport
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, DEFAULT_LOG_FILTER);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
          }
          catch (...)
          {
@@ -203,6 +205,97 @@ namespace UnitTestBasicUniversalCppSupport
          }
       }
 
+      TEST_METHOD(TestSystemErrorGetCachedErrorText)
+      {
+         try
+         {
+            // prepare for test...
+            constexpr int error_code = 5;
+            const std::string expected_value = SystemError(error_code).get_error_text();
+            SetLastError(ERROR_FILE_NOT_FOUND);
+
+            // perform the operation under test (twice, so that the second call is served from the cache)...
+            const std::string& first_value = SystemError::get_cached_error_text(error_code);
+            const std::string& second_value = SystemError::get_cached_error_text(error_code);
+
+            // test succeeds if the cached text matches the formatted text, is formatted once, and the last error is left unchanged...
+            utf8::Assert::IsTrue((first_value == expected_value), "SystemError returned unexpected cached error text");
+            utf8::Assert::IsTrue((&first_value == &second_value), "cached error text was formatted more than once");
+            utf8::Assert::AreEqual(SystemError::get_last_error_code(), static_cast<int>(ERROR_FILE_NOT_FOUND), "the last error was changed");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestErrorContextFullWhatIsBuiltLazily)
+      {
+         try
+         {
+            // prepare for test...
+            SetLastError(ERROR_ACCESS_DENIED);
+
+            // perform the operation under test (throw, then change the last error before asking for the full description)...
+            try
+            {
+               throw error_context("lazy test failure");
+            }
+            catch (const error::context& e)
+            {
+               SetLastError(ERROR_SUCCESS);
+               const std::string full_what = e.full_what();
+
+               // test succeeds if the error code captured at the throw (not the current one) is described...
+               utf8::Assert::AreEqual(e.get_error_code(), static_cast<int>(ERROR_ACCESS_DENIED), "the error code was not captured at construction");
+               utf8::Assert::IsFalse((full_what.find("lazy test failure") == std::string::npos), "the short description is missing from full_what");
+               utf8::Assert::IsFalse((full_what.find(SystemError(ERROR_ACCESS_DENIED).get_error_text()) == std::string::npos), "the system error text is missing from full_what");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestErrorContextFullWhatConcurrently)
+      {
+         try
+         {
+            // prepare for test (an exception shared by several threads, none of which has asked for the full description)
+            SetLastError(ERROR_ACCESS_DENIED);
+            const error::context shared = error_context("shared test failure");
+            const error::context copied(shared);
+            std::vector<const char*> descriptions(8, nullptr);
+
+            // perform the operation under test (every thread asks for the full description at once)...
+            {
+               std::vector<std::thread> threads;
+               for (auto& description : descriptions)
+               {
+                  threads.emplace_back([&shared, &description]() { description = shared.full_what(); });
+               }
+               for (auto& thread : threads)
+               {
+                  thread.join();
+               }
+            }
+
+            // test succeeds if every thread got the one (published) description, and a copy builds its own...
+            for (const auto description : descriptions)
+            {
+               utf8::Assert::IsTrue(description == descriptions[0], "the threads were given different descriptions");
+            }
+            utf8::Assert::IsFalse((std::string(descriptions[0]).find("shared test failure") == std::string::npos), "the short description is missing from full_what");
+            utf8::Assert::IsTrue(std::string(copied.full_what()) == descriptions[0], "a copy should describe the same failure");
+            utf8::Assert::IsTrue(copied.full_what() != descriptions[0], "a copy should not share the original's description");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
       TEST_METHOD(TestSystemErrorOutOfRangeValues)
       {
          try
@@ -18,6 +18,8 @@
 //
 #include "stdafx.h"
 
+#include <array>
+
 #include "utf8_guid.hpp" 
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -35,7 +37,7 @@ namespace UnitTestBasicUniversalCppSupport
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, DEFAULT_LOG_FILTER);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
          }
          catch (...)
          {
@@ -98,6 +100,241 @@ namespace UnitTestBasicUniversalCppSupport
          }
       }
 
+      TEST_METHOD(TestUtf8ConvertRoundTrip)
+      {
+         const utf8::simd_level supported = utf8::transcode::get_supported_simd_level();
+         try
+         {
+            // prepare for test (ASCII longer than any SIMD block, Greek, CJK and emoji, mixed so that ASCII runs start and end mid block)...
+            const std::string utf8_text(U8("Hello World! The quick brown fox jumps over the lazy dog. Γειά σας Κόσμε! 你好，世界 😀 end"));
+            const std::wstring utf16_text(L"Hello World! The quick brown fox jumps over the lazy dog. Γειά σας Κόσμε! 你好，世界 😀 end");
+
+            for (const auto level : { utf8::simd_level::scalar, utf8::simd_level::sse2, utf8::simd_level::avx2 })
+            {
+               utf8::transcode::set_simd_level(level);
+               SetLastError(ERROR_FILE_NOT_FOUND);
+
+               // perform the operations under test (with each supported instruction set)...
+               const std::wstring actual_utf16 = utf8::convert::to_utf16(utf8_text);
+               const std::string actual_utf8 = utf8::convert::from_utf16(utf16_text);
+
+               // test succeeds if both conversions match, and the last error is left unchanged...
+               utf8::Assert::IsTrue(actual_utf16 == utf16_text, "to_utf16 conversion does not match expected value");
+               utf8::Assert::AreEqual(utf8_text, actual_utf8, "from_utf16 conversion does not match expected value");
+               utf8::Assert::IsTrue(GetLastError() == ERROR_FILE_NOT_FOUND, "conversion changed the last error");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+         utf8::transcode::set_simd_level(supported);
+      }
+
+      TEST_METHOD(TestUtf8ConvertReportsErrorPosition)
+      {
+         // prepare for test (ill formed input: an overlong form, an encoded surrogate, a truncated sequence, an unpaired surrogate)...
+         const std::vector<std::pair<std::string, std::size_t>> invalid_utf8 =
+         {
+            { std::string("abc\xC0\x80" "def"), 3 },
+            { std::string("abcdefghijklmnopqrstuvwxyz0123456789\xED\xA0\x80"), 36 },
+            { std::string(U8("Γειά\xE4\xB8")), 8 }
+         };
+         const std::wstring invalid_utf16(L"abc\xDC00" L"def");
+
+         for (const auto& [text, position] : invalid_utf8)
+         {
+            try
+            {
+               // perform the operation under test...
+               utf8::convert::to_utf16(text);
+               utf8::Assert::Fail("ill formed utf8 was converted");
+            }
+            catch (const utf8::conversion_error& e)
+            {
+               // test succeeds if the error is found at the expected position...
+               utf8::Assert::IsTrue(e.position() == position, "ill formed utf8 was reported at an unexpected position");
+            }
+         }
+
+         try
+         {
+            utf8::convert::from_utf16(invalid_utf16);
+            utf8::Assert::Fail("ill formed utf16 was converted");
+         }
+         catch (const utf8::conversion_error& e)
+         {
+            utf8::Assert::IsTrue(e.position() == 3, "ill formed utf16 was reported at an unexpected position");
+         }
+      }
+
+      TEST_METHOD(TestUtf8ConvertIntoBuffer)
+      {
+         try
+         {
+            // prepare for test (a caller supplied buffer, and one that is too small)...
+            const std::string utf8_text(U8("Γειά σας Κόσμε!"));
+            std::array<wchar_t, 32> buffer{};
+            std::array<wchar_t, 4> small_buffer{};
+
+            // perform the operation under test...
+            const std::size_t written = utf8::convert::to_utf16(utf8_text, buffer);
+
+            // test succeeds if the buffer holds the conversion, and a buffer that is too small is reported...
+            utf8::Assert::IsTrue(std::wstring_view(buffer.data(), written) == L"Γειά σας Κόσμε!", "conversion into buffer does not match expected value");
+            try
+            {
+               utf8::convert::to_utf16(utf8_text, small_buffer);
+               utf8::Assert::Fail("a buffer that is too small was not reported");
+            }
+            catch (const std::length_error&)
+            {
+               // expected
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestUtf8ConvertSmallString)
+      {
+         try
+         {
+            // prepare for test (a typical device path, and a string too long for the inline buffer)...
+            const std::string device_path(U8("\\\\?\\scsi#cdrom&ven_hl-dt-st#Κόσμε"));
+            const std::string long_text(utf8::small_path_length, 'x');
+
+            // perform the operation under test...
+            const utf8::small_wstring<> short_path = utf8::convert::to_small_utf16(device_path);
+            const utf8::small_wstring<> long_path = utf8::convert::to_small_utf16(long_text);
+
+            // test succeeds if both convert (zero terminated), the short one held inline and the long one on the heap...
+            utf8::Assert::IsTrue(short_path == utf8::convert::to_utf16(device_path), "short small_wstring does not match expected value");
+            utf8::Assert::IsTrue(short_path.is_inline(), "short small_wstring was not held inline");
+            utf8::Assert::IsTrue(long_path == utf8::convert::to_utf16(long_text), "long small_wstring does not match expected value");
+            utf8::Assert::IsFalse(long_path.is_inline(), "long small_wstring was held inline");
+            utf8::Assert::IsTrue(long_path.c_str()[long_path.size()] == L'\0', "long small_wstring is not zero terminated");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestUtf8StreamConvertChunkBoundaries)
+      {
+         try
+         {
+            // prepare for test (text with 1, 2, 3 and 4 byte sequences, so that some chunk boundaries split a sequence)...
+            const std::string utf8_text(U8("Hello Γειά σας 你好，世界 😀 end"));
+            const std::wstring expected = utf8::convert::to_utf16(utf8_text);
+
+            for (std::size_t chunk_length = 1; chunk_length <= utf8_text.size(); chunk_length++)
+            {
+               // perform the operation under test (convert a chunk at a time, in both directions)...
+               utf8::to_utf16_stream to_utf16;
+               std::wstring utf16;
+               for (std::size_t offset = 0; offset < utf8_text.size(); offset += chunk_length)
+               {
+                  const std::string_view chunk = std::string_view(utf8_text).substr(offset, chunk_length);
+                  std::vector<wchar_t> converted(utf8::to_utf16_stream::max_output_length(chunk.size()));
+                  utf16.append(converted.data(), to_utf16.convert(chunk, converted));
+               }
+               to_utf16.finish();
+
+               utf8::from_utf16_stream from_utf16;
+               std::string round_trip;
+               for (std::size_t offset = 0; offset < utf16.size(); offset += chunk_length)
+               {
+                  const std::wstring_view chunk = std::wstring_view(utf16).substr(offset, chunk_length);
+                  std::vector<char> converted(utf8::from_utf16_stream::max_output_length(chunk.size()));
+                  round_trip.append(converted.data(), from_utf16.convert(chunk, converted));
+               }
+               from_utf16.finish();
+
+               // test succeeds if chunked conversion matches whole string conversion...
+               utf8::Assert::IsTrue(utf16 == expected, "chunked utf8 to utf16 conversion does not match expected value");
+               utf8::Assert::AreEqual(utf8_text, round_trip, "chunked utf16 to utf8 conversion does not match expected value");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestUtf8ScanAtAllSimdLevels)
+      {
+         const utf8::simd_level supported = utf8::transcode::get_supported_simd_level();
+         try
+         {
+            // prepare for test (long enough for many SIMD blocks, with sequences that straddle block boundaries)...
+            std::string utf8_text;
+            for (int i = 0; i < 64; i++)
+            {
+               utf8_text.append(U8("Hello World! Γειά σας Κόσμε! 你好，世界 😀 "));
+            }
+            std::vector<std::size_t> lead_offsets;
+            for (std::size_t offset = 0; offset < utf8_text.size(); offset++)
+            {
+               if ((utf8_text[offset] & 0xC0) != 0x80) lead_offsets.push_back(offset);
+            }
+            const std::size_t invalid_position = utf8::scan::truncate(utf8_text.data(), utf8_text.size(), 1000);
+            const std::string invalid_text = utf8_text.substr(0, invalid_position) + "\xC0\x80" + utf8_text;
+
+            for (const auto level : { utf8::simd_level::scalar, utf8::simd_level::sse2, utf8::simd_level::avx2 })
+            {
+               utf8::transcode::set_simd_level(level);
+
+               // perform the operations under test (with each supported instruction set)...
+               const std::size_t count = utf8::count_codepoints(utf8_text);
+               const utf8::scan_result valid = utf8::scan::validate(utf8_text.data(), utf8_text.size());
+               const utf8::scan_result invalid = utf8::scan::validate(invalid_text.data(), invalid_text.size());
+
+               // test succeeds if the scans agree with a byte at a time scan...
+               utf8::Assert::IsTrue(count == lead_offsets.size(), "unexpected codepoint count");
+               utf8::Assert::IsTrue(valid.status == utf8::transcode_status::ok, "well formed utf8 failed validation");
+               utf8::Assert::IsTrue(valid.code_points == count, "validation counted unexpected number of codepoints");
+               utf8::Assert::IsTrue(invalid.status == utf8::transcode_status::invalid, "ill formed utf8 passed validation");
+               utf8::Assert::IsTrue(invalid.length == invalid_position, "validation reported unexpected error position");
+               for (std::size_t index = 0; index < lead_offsets.size(); index += 7)
+               {
+                  utf8::Assert::IsTrue(utf8::scan::offset_of_codepoint(utf8_text.data(), utf8_text.size(), index) == lead_offsets[index], "unexpected codepoint offset");
+               }
+               utf8::Assert::IsTrue(utf8::scan::offset_of_codepoint(utf8_text.data(), utf8_text.size(), count) == utf8_text.size(), "unexpected offset past the last codepoint");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+         utf8::transcode::set_simd_level(supported);
+      }
+
+      TEST_METHOD(TestUtf8Truncate)
+      {
+         try
+         {
+            // prepare for test (2 byte Greek, 3 byte CJK and a 4 byte emoji)...
+            const std::string s(U8("Γειά 你好 😀"));
+
+            // perform the operations under test, and test succeeds if no code point is split...
+            utf8::Assert::AreEqual(std::string(U8("Γει")), std::string(utf8::truncate_codepoints(s, 3)), "unexpected truncation to 3 codepoints");
+            utf8::Assert::AreEqual(s, std::string(utf8::truncate_codepoints(s, 100)), "truncation of a short string changed it");
+            utf8::Assert::AreEqual(std::string(U8("Γε")), std::string(utf8::truncate_bytes(s, 5)), "unexpected truncation to 5 bytes");
+            utf8::Assert::AreEqual(std::string(U8("Γειά 你")), std::string(utf8::truncate_bytes(s, 13)), "unexpected truncation to 13 bytes");
+            utf8::Assert::AreEqual(std::string(U8("Γειά 你好 ")), std::string(utf8::truncate_bytes(s, s.size() - 1)), "unexpected truncation of the emoji");
+            utf8::Assert::IsTrue(utf8::is_valid(utf8::truncate_bytes(s, 7)), "truncated string is not well formed");
+            utf8::Assert::IsFalse(utf8::is_valid(s.substr(0, 7)), "split string is well formed");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
       TEST_METHOD(TestUtf8ConvertFromGuid)
       {
          try
@@ -214,5 +451,39 @@ namespace UnitTestBasicUniversalCppSupport
             utf8::Assert::Fail(e.what()); // something went wrong
          }
       }
+
+      TEST_METHOD(TestGuidLiteral)
+      {
+         using namespace utf8::literals;
+
+         // prepare for test (a literal is parsed at compile time, in registry form or DEFINE_GUID text style)...
+         constexpr utf8::guid cdrom = "53f56308-b6bf-11d0-94f2-00a0c91efb8b"_guid;
+         static_assert(cdrom == "0x53F56308L, 0xB6BF, 0x11D0, 0x94, 0xF2, 0x00, 0xA0, 0xC9, 0x1E, 0xFB, 0x8B"_guid, "GUID text styles differ");
+         static_assert(cdrom == utf8::guid::parse(std::string_view(cdrom.to_chars().data())), "GUID formatting does not round trip");
+
+         try
+         {
+            // perform the operations under test, and test succeeds if the literal matches the system definition in both text forms...
+            utf8::Assert::AreEqual(GUID_DEVINTERFACE_CDROM, utf8::guid_convert::to_guid(cdrom), "GUID literal does not match expected value");
+            utf8::Assert::AreEqual(std::string("0x53f56308L, 0xb6bf, 0x11d0, 0x94, 0xf2, 0x00, 0xa0, 0xc9, 0x1e, 0xfb, 0x8b"), cdrom.to_string(), "unexpected GUID text");
+            utf8::Assert::AreEqual(std::string("53f56308-b6bf-11d0-94f2-00a0c91efb8b"), cdrom.to_registry_string(), "unexpected GUID registry text");
+            utf8::Assert::AreEqual(GUID_DEVINTERFACE_CDROM, utf8::guid_convert::to_guid(std::string("{53F56308-B6BF-11D0-94F2-00A0C91EFB8B}")), "GUID registry text does not convert");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+
+         try
+         {
+            // a string that is not a GUID is rejected (no longer converted to an arbitrary GUID)...
+            utf8::guid_convert::to_guid(std::string("0x53f56308L, 0xb6bf, 0x11d0, 0x94"));
+            utf8::Assert::Fail("an incomplete GUID string was accepted");
+         }
+         catch (const std::invalid_argument&)
+         {
+            // expected
+         }
+      }
    };
 }
\ No newline at end of file
@@ -24,18 +24,26 @@
 #include <sstream>
 #include <vector>
 
+#include "allocation_counter.hpp"
 #include "error_context.hpp" 
 #include "file_logger.hpp"
 #include "gsl.hpp"
 #include "logger.hpp"           
 #include "logger_interface.hpp"
 #include "logger_factory.hpp"
+#include "mapped_file_logger.hpp"
 #include "null_logger.hpp"
 #include "RAII_thread.hpp"
+#include "shared_file_logger.hpp"
 #include "spimpl.hpp"
+#include "stack_trace.hpp"
 #include "system_error.hpp"
 #include "utf8_assert.hpp"
 #include "utf8_convert.hpp"
+#include "utf8_scan.hpp"
+#include "utf8_stream_convert.hpp"
+#include "utf8_transcode.hpp"
+#include "guid.hpp"
 #include "utf8_guid.hpp"
 #include "utc_timestamp.hpp"
 
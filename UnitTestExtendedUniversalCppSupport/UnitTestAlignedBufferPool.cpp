@@ -0,0 +1,107 @@
+//
+// UnitTestAlignedBufferPool.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <cstdint>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestAlignedBufferPool)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitAlignedBufferPool) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestAlignedBufferPoolReuse)
+      {
+         try
+         {
+            // prepare for test
+            AlignedBufferPool pool(1000, 512, 2);
+            utf8::Assert::IsTrue(pool.get_buffer_size() == 1024, "the buffer size should be rounded up to the alignment");
+
+            // perform the operation under test (release three buffers into a pool that keeps two)...
+            {
+               const auto first = pool.acquire();
+               const auto second = pool.acquire();
+               const auto third = pool.acquire();
+               utf8::Assert::IsTrue((reinterpret_cast<std::uintptr_t>(first.get()) % 512) == 0, "a buffer should be aligned");
+               utf8::Assert::IsTrue((reinterpret_cast<std::uintptr_t>(third.get()) % 512) == 0, "a buffer should be aligned");
+               utf8::Assert::IsTrue(second.get() != first.get(), "buffers in use should be distinct");
+            }
+
+            // check results (two are kept, and are handed out again)
+            utf8::Assert::IsTrue(pool.get_idle_count() == 2, "the pool should keep max_idle released buffers");
+            const auto reused = pool.acquire();
+            utf8::Assert::IsTrue(pool.get_idle_count() == 1, "acquire should reuse a released buffer");
+            utf8::Assert::IsTrue(reused.get() != nullptr, "acquire returned no buffer");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestAlignedBufferPoolForDevice)
+      {
+         try
+         {
+            // prepare for test (a device with 2048 byte sectors, that accepts any buffer address)
+            DeviceCapabilities capabilities {};
+            capabilities.max_transfer_size = 65536;
+            capabilities.buffer_alignment = 1;
+            capabilities.physical_sector_size = 2048;
+
+            // perform the operation under test...
+            AlignedBufferPool pool(capabilities, 5000);
+
+            // check results (aligned and sized in whole sectors)
+            utf8::Assert::IsTrue(pool.get_alignment() == 2048, "buffers should be aligned to the physical sector size");
+            utf8::Assert::IsTrue(pool.get_buffer_size() == 6144, "buffers should be sized in whole sectors");
+
+            // a buffer outlives its pool
+            AlignedBufferPool::buffer outlives;
+            {
+               AlignedBufferPool short_lived(capabilities, 2048);
+               outlives = short_lived.acquire();
+            }
+            outlives.reset();
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
@@ -0,0 +1,169 @@
+//
+// UnitTestBlockSource.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestBlockSource)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitBlockSource) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestBlockSourceImageFile)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file image("UnitTestBlockSource.iso", BlockSource::default_transfer_size + 5 * BlockSource::default_sector_size);
+            const ImageFileBlockSource source(image.path);
+            std::vector<unsigned char> whole(image.content.size());
+            std::vector<unsigned char> tail(4 * BlockSource::default_sector_size);
+            std::atomic<int> progress = 0;
+
+            // perform the operations under test...
+            const std::uint64_t cbySize = source.get_size();
+            source.read_image(whole, progress);
+            const std::uint32_t cbyTail = source.read_at(cbySize - BlockSource::default_sector_size, tail);
+            const std::uint32_t cbyPastEnd = source.read_at(cbySize, tail);
+
+            // check results (a read is cut short only by the end of the image)
+            utf8::Assert::IsTrue(cbySize == image.content.size(), "unexpected image size");
+            utf8::Assert::IsTrue(whole == std::vector<unsigned char>(image.content.begin(), image.content.end()), "the image has unexpected content");
+            utf8::Assert::IsTrue(progress == 100, "progress should be 100%");
+            utf8::Assert::IsTrue(cbyTail == BlockSource::default_sector_size, "a read at the end should return the last sector");
+            utf8::Assert::IsTrue(cbyPastEnd == 0, "a read past the end should return nothing");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestBlockSourceReadOnlyImageFile)
+      {
+         try
+         {
+            // prepare for test (a read only image, with a read handle already pooled, so that opening the image
+            // for reading shares it, where opening it for writing would not)
+            const temporary_file image("UnitTestBlockSourceReadOnly.iso", 3 * BlockSource::default_sector_size);
+            const std::filesystem::path image_path(std::u8string(image.path.begin(), image.path.end()));
+            std::filesystem::permissions(image_path, std::filesystem::perms::owner_read, std::filesystem::perm_options::replace);
+            const auto pooled = DeviceHandlePool::acquire(image.path, DeviceHandlePool::access::read);
+            DeviceHandlePool::close_idle();
+            const std::size_t cOpen = DeviceHandlePool::get_open_count();
+            std::vector<unsigned char> whole(image.content.size());
+            std::atomic<int> progress = 0;
+
+            // perform the operations under test...
+            {
+               const ImageFileBlockSource source(image.path);
+               utf8::Assert::IsTrue(DeviceHandlePool::get_open_count() == cOpen, "the image file should be opened for reading only");
+               source.read_image(whole, progress);
+            }
+            std::filesystem::permissions(image_path, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write, std::filesystem::perm_options::replace);
+
+            // check results
+            utf8::Assert::IsTrue(whole == std::vector<unsigned char>(image.content.begin(), image.content.end()), "the image has unexpected content");
+            utf8::Assert::IsTrue(progress == 100, "progress should be 100%");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestBlockSourceViews)
+      {
+         try
+         {
+            // prepare for test (an image file, a range of it, and a memory buffer, end to end)
+            const temporary_file image("UnitTestBlockSource.iso", BlockSource::default_transfer_size + 5 * BlockSource::default_sector_size);
+            const ImageFileBlockSource file(image.path);
+            const OffsetBlockSource range(file, BlockSource::default_sector_size, 3 * BlockSource::default_sector_size);
+            const std::vector<unsigned char> memory(BlockSource::default_sector_size, 0x5a);
+            const MemoryBlockSource buffer(memory);
+            const CompositeBlockSource composite({ buffer, range, file });
+
+            std::vector<unsigned char> expected(memory);
+            expected.insert(expected.end(), image.content.begin() + BlockSource::default_sector_size, image.content.begin() + 4 * BlockSource::default_sector_size);
+            expected.insert(expected.end(), image.content.begin(), image.content.end());
+
+            // perform the operations under test (a whole read, and a read that spans the parts)...
+            std::vector<unsigned char> whole(composite.get_size());
+            std::atomic<int> progress = 0;
+            composite.read_image(whole, progress);
+
+            std::vector<unsigned char> spanning(2 * BlockSource::default_sector_size);
+            const std::uint32_t cbySpanning = composite.read_at(BlockSource::default_sector_size / 2, spanning);
+
+            // check results
+            utf8::Assert::IsTrue(range.get_size() == 3 * BlockSource::default_sector_size, "unexpected range size");
+            utf8::Assert::IsTrue(whole == expected, "the composite has unexpected content");
+            utf8::Assert::IsTrue(cbySpanning == spanning.size(), "a read that spans parts should be whole");
+            utf8::Assert::IsTrue(std::equal(spanning.begin(), spanning.end(), expected.begin() + BlockSource::default_sector_size / 2), "a read that spans parts has unexpected content");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestBlockSourceShortImage)
+      {
+         try
+         {
+            // prepare for test
+            const std::vector<unsigned char> memory(3 * BlockSource::default_sector_size);
+            const MemoryBlockSource source(memory);
+            std::vector<unsigned char> larger(memory.size() + BlockSource::default_sector_size);
+            std::atomic<int> progress = 0;
+
+            // perform the operation under test (read more than the source holds)...
+            const auto result = source.read_image(std::nothrow, larger, progress);
+
+            // check results
+            utf8::Assert::IsFalse(result.has_value(), "reading past the end of a source should fail");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
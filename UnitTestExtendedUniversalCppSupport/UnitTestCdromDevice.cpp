@@ -18,8 +18,11 @@
 //
 #include "stdafx.h"
 
+#include <condition_variable>
 #include <fstream>
 #include <future>
+#include <memory>
+#include <mutex>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std::chrono_literals;
@@ -37,7 +40,7 @@ namespace UnitTestExtendedUniversalCppSupport
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, DEFAULT_LOG_FILTER);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
          }
          catch (...)
          {
@@ -402,6 +405,226 @@ namespace UnitTestExtendedUniversalCppSupport
          }
       }
 
+      TEST_METHOD(TestCdromGetImageSizeNoThrow)
+      {
+         try
+         {
+            // prepare for test (construct a device for the system's first enumerated cdrom)...
+            CdromDevice cdrom(DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0]);
+
+            int retries = 10;                          // cdrom drive may not be in ready state
+            while (--retries > 0)
+            {
+               // perform the operation under test (the not ready conditions are returned, not thrown)...
+               const auto image_size = cdrom.get_image_size(std::nothrow);
+               const auto media_present = cdrom.check_for_media_present(std::nothrow);
+
+               if (image_size)
+               {
+                  // test succeeds if a size is returned, and media is reported present when the size is non-zero...
+                  utf8::Assert::IsTrue(media_present.has_value(), "check_for_media_present failed when get_image_size succeeded");
+                  utf8::Assert::IsTrue(media_present.value() == (image_size.value() != 0), "check_for_media_present disagrees with get_image_size");
+                  break;
+               }
+
+               switch (image_size.error().get_error_code())
+               {
+               case ERROR_NOT_READY:
+                  utf8::Assert::IsTrue(media_present.has_value() && !media_present.value(), "no media was not reported as absent media");
+                  [[fallthrough]];
+               case ERROR_MEDIA_CHANGED:
+               case ERROR_IO_DEVICE:
+                  std::this_thread::sleep_for(1s); // not ready conditions, expected in some test sequences
+                  break;
+
+               default: 
+                  utf8::Assert::Fail(image_size.error().to_context().full_what());
+               }
+            };
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestCdromDeviceProbeAll)
+      {
+         try
+         {
+            // perform the operation under test (probe every cdrom drive on the system)...
+            const auto devices = DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get();
+            const auto results = CdromDevice::probe_all(DeviceTypeDirectory::DeviceType::CDROM_DEVICES);
+
+            // check results (one result per drive, in enumeration order, and each consistent with its status)
+            utf8::Assert::AreEqual(devices.size(), results.size(), "expected one result per drive");
+            std::size_t index = 0;
+            for (const auto& device : devices)
+            {
+               const auto& result = results.at(index++);
+               utf8::Assert::IsTrue(device.second == result.device_path, "results are not in enumeration order");
+               switch (result.status)
+               {
+               case CdromDevice::probe_status::ready:
+                  utf8::Assert::IsTrue(result.media_size != 0, "a ready drive should report the media size");
+                  break;
+
+               case CdromDevice::probe_status::no_media:
+               case CdromDevice::probe_status::busy:
+                  utf8::Assert::IsTrue(result.media_size == 0, "only a ready drive should report a media size");
+                  break;
+
+               default:
+                  utf8::Assert::Fail(("unexpected probe error (error code " + std::to_string(result.error_code) + ")").c_str());
+               }
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestCdromDeviceProbeAllTimeout)
+      {
+         try
+         {
+            // prepare for test (one drive answers at once, the other's probe waits for the test, not in cancellable I/O).
+            // The probe may outlive probe_all, so it shares its state rather than referring to the test's.
+            struct slow_drive
+            {
+               std::mutex mutex;
+               std::condition_variable changed;
+               bool released = false;
+               bool returned = false;
+            };
+            const auto slow = std::make_shared<slow_drive>();
+            const auto stand_in_probe = [slow](const std::string& path) -> CdromDevice::probe_result
+            {
+               if (path == "slow")
+               {
+                  std::unique_lock<std::mutex> lock(slow->mutex);
+                  slow->changed.wait(lock, [&slow]() { return slow->released; });
+                  slow->returned = true;
+                  slow->changed.notify_all();
+                  return { path, CdromDevice::probe_status::ready, 2048, 0, 0ms };   // (too late, so discarded)
+               }
+               return { path, CdromDevice::probe_status::no_media, 0, 0, 0ms };
+            };
+
+            // perform the operation under test...
+            const auto started = std::chrono::steady_clock::now();
+            const auto results = CdromDevice::probe_all({ "fast", "slow" }, 200ms, stand_in_probe);
+            const auto elapsed = std::chrono::steady_clock::now() - started;
+
+            // ...then let the slow probe finish (its thread is joined later, by probe_all's owner of late probes)
+            bool returned_early = false;
+            bool finished_later = false;
+            {
+               std::unique_lock<std::mutex> lock(slow->mutex);
+               returned_early = !slow->returned;
+               slow->released = true;
+               slow->changed.notify_all();
+               finished_later = slow->changed.wait_for(lock, 5s, [&slow]() { return slow->returned; });
+            }
+
+            // check results (probe_all returned at the deadline, with the slow drive reported busy)
+            utf8::Assert::AreEqual(std::size_t(2), results.size(), "expected one result per drive");
+            utf8::Assert::IsTrue(results[0].status == CdromDevice::probe_status::no_media, "the fast drive's result was lost");
+            utf8::Assert::IsTrue((results[1].status == CdromDevice::probe_status::busy) && (results[1].error_code == ERROR_TIMEOUT), "the slow drive should be reported busy");
+            utf8::Assert::IsTrue(returned_early, "probe_all waited for the slow probe");
+            utf8::Assert::IsTrue(elapsed < 2s, "probe_all did not return at the deadline");
+            utf8::Assert::IsTrue(finished_later, "the slow probe did not finish once released");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestCdromDeviceProbeErrors)
+      {
+         try
+         {
+            // perform the operation under test (probe a drive that doesn't exist)...
+            const auto result = CdromDevice::probe("\\\\.\\NoSuchCdromDevice");
+
+            // check results (the error is reported, not thrown)
+            utf8::Assert::IsTrue(result.status == CdromDevice::probe_status::error, "a missing drive should report an error");
+            utf8::Assert::AreNotEqual(0, result.error_code, "a missing drive should report the error code");
+
+            // ...and a device type without drives has nothing to probe
+            const auto results = CdromDevice::probe_all(DeviceTypeDirectory::DeviceType::FLOPPY_DEVICES, std::chrono::milliseconds(100));
+            const auto devices = DeviceDiscoverer(DeviceTypeDirectory::DeviceType::FLOPPY_DEVICES).device_path_map.get();
+            utf8::Assert::AreEqual(devices.size(), results.size(), "expected one result per floppy drive");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestCdromDeviceCapabilities)
+      {
+         try
+         {
+            // prepare for test (construct a device for the system's first enumerated cdrom)...
+            CdromDevice cdrom(DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0]);
+
+            // perform the operation under test...
+            const auto capabilities = cdrom.get_capabilities(std::nothrow);
+            utf8::Assert::IsTrue(capabilities.has_value(), "the cdrom capabilities could not be queried");
+
+            // check results (when there is media, reads sized in physical sectors fit the image exactly)
+            const auto image_size = cdrom.get_image_size(std::nothrow);
+            if (image_size && (image_size.value() != 0))
+            {
+               utf8::Assert::IsTrue(image_size.value() % capabilities.value().physical_sector_size == 0, "the image is not a whole number of physical sectors");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestCdromDeviceMediaCache)
+      {
+         try
+         {
+            // prepare for test (construct a device for the system's first enumerated cdrom)...
+            CdromDevice cdrom(DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0]);
+
+            // perform the operation under test (read the media data, then again from the cache, then again after refresh)...
+            const auto image_size = cdrom.get_image_size(std::nothrow);
+            const auto tracks = cdrom.get_tracks(std::nothrow);
+
+            if (!image_size)
+            {
+               // no media (or not ready) is reported the same way, by both queries
+               utf8::Assert::IsFalse(tracks.has_value(), "tracks were reported without media");
+               return;
+            }
+
+            utf8::Assert::IsTrue(tracks.has_value(), "the table of contents could not be read");
+            utf8::Assert::IsFalse(tracks.value().empty(), "the media has no tracks");
+            for (std::size_t index = 1; index < tracks.value().size(); index++)
+            {
+               utf8::Assert::IsTrue(tracks.value().at(index).first_sector > tracks.value().at(index - 1).first_sector, "tracks are not in order");
+            }
+
+            utf8::Assert::IsTrue(cdrom.get_image_size(std::nothrow).value() == image_size.value(), "the cached image size differs");
+
+            cdrom.refresh();
+            utf8::Assert::IsTrue(cdrom.get_image_size(std::nothrow).value() == image_size.value(), "the refreshed image size differs");
+            utf8::Assert::AreEqual(tracks.value().size(), cdrom.get_tracks().size(), "the refreshed track count differs");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
 #pragma warning(disable: 26485)
       BEGIN_TEST_METHOD_ATTRIBUTE(TestCdromDeviceReadImage)
          TEST_IGNORE()        // TestFunctor takes too long to run every time...
@@ -37,7 +37,7 @@ namespace UnitTestExtendedUniversalCppSupport
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, DEFAULT_LOG_FILTER);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
          }
          catch (...)
          {
@@ -148,6 +148,65 @@ namespace UnitTestExtendedUniversalCppSupport
          }
       }
 
+      TEST_METHOD(TestDeviceIoCtlNoThrow)
+      {
+         try
+         {
+            // prepare for test (construct a device for the system's first enumerated cdrom)...
+            Device cdrom(DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0]);
+
+            // perform the operation under test (issue a bad ioctl to the device, without throwing)...
+            const auto result = cdrom.ioctl(std::nothrow, IOCTL_STORAGE_BAD_IOCTL, nullptr, 0, nullptr, 0);
+
+            // test succeeds if the failure is returned (with the same error codes as the throwing exception path test)...
+            utf8::Assert::IsFalse(result.has_value(), "ioctl didn't reject a foreign ctl_code");
+            switch (result.error().get_error_code())
+            {
+            case ERROR_SUCCESS:                 // since Win10 1803
+            case ERROR_INVALID_FUNCTION:
+            case ERROR_NOT_SUPPORTED:
+               break;
+
+            default:
+               utf8::Assert::Fail((std::string(result.error().what()).append(" was not expected.")).c_str());
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceCapabilities)
+      {
+         try
+         {
+            // prepare for test (construct a device for the system's first enumerated cdrom)...
+            Device cdrom(DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get()[0]);
+
+            // perform the operation under test (the storage adapter answers, with or without media)...
+            const DeviceCapabilities capabilities = cdrom.get_capabilities();
+
+            // check results (the limits are usable for sizing and aligning reads)
+            utf8::Assert::IsTrue(capabilities.max_transfer_size != 0, "the maximum transfer size should be known");
+            utf8::Assert::IsTrue(capabilities.buffer_alignment != 0, "the buffer alignment should be known");
+            utf8::Assert::IsTrue((capabilities.buffer_alignment & (capabilities.buffer_alignment - 1)) == 0, "the buffer alignment should be a power of 2");
+            utf8::Assert::IsTrue(capabilities.physical_sector_size != 0, "the physical sector size should be known");
+
+            // ...and a repeat query (cached, when there is media) gives the same answer
+            const auto again = cdrom.get_capabilities(std::nothrow);
+            utf8::Assert::IsTrue(again.has_value(), "a repeat query failed");
+            utf8::Assert::IsTrue((again.value().max_transfer_size == capabilities.max_transfer_size) &&
+               (again.value().buffer_alignment == capabilities.buffer_alignment) &&
+               (again.value().physical_sector_size == capabilities.physical_sector_size) &&
+               (again.value().concurrent_requests == capabilities.concurrent_requests), "a repeat query gave a different answer");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
       TEST_METHOD(TestDeviceRead)
       {
          try
@@ -18,11 +18,50 @@
 //
 #include "stdafx.h"
 
+#include <filesystem>
+#include <fstream>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace utf8;
 
 namespace UnitTestExtendedUniversalCppSupport
 {
+   ///<summary> a fake sysfs tree (in the temp directory), for DeviceDiscoverer to enumerate.</summary>
+   class fake_sysfs_tree
+   {
+   public:
+      fake_sysfs_tree()
+      {
+         root = std::filesystem::temp_directory_path() / "UnitTestDeviceDiscovererSysfs";
+         std::filesystem::remove_all(root);
+         std::filesystem::create_directories(root / "block");
+      }
+
+      ~fake_sysfs_tree()
+      {
+         std::error_code ec;
+         std::filesystem::remove_all(root, ec);
+      }
+
+      ///<summary> add an attribute (E.g. "block/sr0/device/type") to the tree.</summary>
+      void add(const std::string& attribute, const std::string& value) const
+      {
+         const auto path = root / std::filesystem::path(std::u8string(attribute.begin(), attribute.end()));
+         std::filesystem::create_directories(path.parent_path());
+         std::ofstream(path) << value << "\n";
+      }
+
+      ///<summary> get the (utf8) root of the tree.</summary>
+      std::string get_root() const
+      {
+         const std::u8string utf8_root = root.u8string();
+         return std::string(utf8_root.begin(), utf8_root.end());
+      }
+
+   private:
+      std::filesystem::path root;
+   };
+
    TEST_CLASS(UnitTestDeviceDiscoverer)
 	{
 	public:
@@ -33,7 +72,7 @@ namespace UnitTestExtendedUniversalCppSupport
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, DEFAULT_LOG_FILTER);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
          }
          catch (...)
          {
@@ -41,6 +80,8 @@ namespace UnitTestExtendedUniversalCppSupport
          }
       }
 
+#ifdef _WIN32
+      // (these tests need a CD ROM drive)
       TEST_METHOD(TestDeviceDiscovererConstructor)
       {
          try
@@ -216,5 +257,58 @@ namespace UnitTestExtendedUniversalCppSupport
             utf8::Assert::IsTrue(false, e.what()); // something went wrong
          }
       }
+#endif // _WIN32
+
+      TEST_METHOD(TestDeviceDiscovererSysfsTree)
+      {
+         try
+         {
+            // prepare the test (a SCSI disk with two partitions, two optical drives, an nvme disk and an unbound loop device)
+            fake_sysfs_tree tree;
+            tree.add("block/sda/device/type", "0");
+            tree.add("block/sda/size", "1000");
+            tree.add("block/sda/sda1/partition", "1");
+            tree.add("block/sda/sda2/partition", "2");
+            tree.add("block/sr1/device/type", "5");
+            tree.add("block/sr0/device/type", "5");
+            tree.add("block/sr0/size", "0");
+            tree.add("block/nvme0n1/size", "2000");
+            tree.add("block/loop0/size", "0");
+            tree.add("block/loop0/removable", "0");
+
+            // perform the test...
+            DeviceDiscoverer disks(DeviceTypeDirectory::DeviceType::DISK_DEVICES, tree.get_root());
+            DeviceDiscoverer cdroms(DeviceTypeDirectory::DeviceType::CDROM_DEVICES, tree.get_root());
+            DeviceDiscoverer partitions(DeviceTypeDirectory::DeviceType::PARTITION_DEVICES, tree.get_root());
+            DeviceDiscoverer tapes(DeviceTypeDirectory::DeviceType::TAPE_DEVICES, tree.get_root());
+
+            // check results (devices are numbered in name order, and named by their device node)
+            const std::map<int, std::string> expected_disks{ { 0, "/dev/nvme0n1" }, { 1, "/dev/sda" } };
+            const std::map<int, std::string> expected_cdroms{ { 0, "/dev/sr0" }, { 1, "/dev/sr1" } };
+            const std::map<int, std::string> expected_partitions{ { 0, "/dev/sda1" }, { 1, "/dev/sda2" } };
+            utf8::Assert::IsTrue(disks.device_path_map.get() == expected_disks, "unexpected disk devices");
+            utf8::Assert::IsTrue(cdroms.device_path_map.get() == expected_cdroms, "unexpected CDROM devices");
+            utf8::Assert::IsTrue(partitions.device_path_map.get() == expected_partitions, "unexpected partition devices");
+            utf8::Assert::IsTrue(tapes.device_path_map.get().empty(), "tapes are not block devices");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceDiscovererSysfsTreeMissing)
+      {
+         // perform the test (a root that is not a sysfs tree is an error, not a system without devices)...
+         try
+         {
+            DeviceDiscoverer disks(DeviceTypeDirectory::DeviceType::DISK_DEVICES, "no such sysfs tree");
+         }
+         catch (const std::exception&)
+         {
+            return;   // expected
+         }
+         utf8::Assert::Fail("an exception was expected");
+      }
 	};
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+//
+// UnitTestDeviceDiscoveryCache.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestDeviceDiscoveryCache)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitDeviceDiscoveryCache) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestDeviceDiscoveryCacheSnapshots)
+      {
+         try
+         {
+            // prepare for test (a long max age, so that snapshots only go stale when invalidated)
+            constexpr std::chrono::milliseconds long_max_age(60000);
+            const auto first = DeviceDiscoveryCache::get_device_paths(DeviceTypeDirectory::DeviceType::CDROM_DEVICES, long_max_age);
+
+            // check result (the cached paths are the paths DeviceDiscoverer enumerates)
+            utf8::Assert::IsTrue(first != nullptr, "no snapshot was returned");
+            utf8::Assert::IsTrue(*first == DeviceDiscoverer(DeviceTypeDirectory::DeviceType::CDROM_DEVICES).device_path_map.get(), "cached paths differ from the enumerated paths");
+
+            // perform the operation under test (a repeat lookup shares the snapshot)...
+            const auto second = DeviceDiscoveryCache::get_device_paths(DeviceTypeDirectory::DeviceType::CDROM_DEVICES, long_max_age);
+            utf8::Assert::IsTrue(first == second, "a repeat lookup should share the snapshot");
+
+            // ...and invalidation makes the next lookup enumerate again
+            const std::uint64_t generation = DeviceDiscoveryCache::get_generation();
+            DeviceDiscoveryCache::invalidate();
+            utf8::Assert::IsTrue(DeviceDiscoveryCache::get_generation() > generation, "invalidate should advance the generation");
+
+            const auto third = DeviceDiscoveryCache::get_device_paths(DeviceTypeDirectory::DeviceType::CDROM_DEVICES, long_max_age);
+            utf8::Assert::IsTrue(first != third, "an invalidated snapshot should not be returned");
+            utf8::Assert::IsTrue(*first == *third, "device paths changed unexpectedly");
+
+            // a zero max age always enumerates
+            const auto fourth = DeviceDiscoveryCache::get_device_paths(DeviceTypeDirectory::DeviceType::CDROM_DEVICES, std::chrono::milliseconds(0));
+            utf8::Assert::IsTrue(third != fourth, "a zero max age should enumerate");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceDiscoveryCachePeek)
+      {
+         try
+         {
+            // perform the operation under test (a device type never enumerated has nothing to peek at)...
+            const auto unknown = DeviceDiscoveryCache::peek_device_paths(static_cast<DeviceTypeDirectory::DeviceType>(-1));
+            utf8::Assert::IsTrue(unknown == nullptr, "an unknown device type cannot be cached");
+
+            // ...but once enumerated, peek returns the last snapshot, even when it is stale
+            const auto enumerated = DeviceDiscoveryCache::get_device_paths(DeviceTypeDirectory::DeviceType::DISK_DEVICES);
+            DeviceDiscoveryCache::invalidate();
+            const auto peeked = DeviceDiscoveryCache::peek_device_paths(DeviceTypeDirectory::DeviceType::DISK_DEVICES);
+            utf8::Assert::IsTrue(enumerated == peeked, "peek should return the last snapshot");
+            utf8::Assert::IsFalse(peeked->empty(), "unexpected that there are no disk devices on this system");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
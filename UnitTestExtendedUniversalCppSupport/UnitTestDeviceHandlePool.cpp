@@ -0,0 +1,176 @@
+//
+// UnitTestDeviceHandlePool.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <fstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestDeviceHandlePool)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitDeviceHandlePool) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestDeviceHandlePoolSharing)
+      {
+         try
+         {
+            // prepare for test (no idle handles)
+            const temporary_file device("UnitTestDeviceHandlePool.bin", "0123456789");
+            DeviceHandlePool::close_idle();
+            const std::size_t open_count = DeviceHandlePool::get_open_count();
+
+            {
+               // perform the operation under test (two Devices of one path share one handle)...
+               Device first(device.path);
+               Device second(device.path);
+               utf8::Assert::AreEqual(open_count + 1, DeviceHandlePool::get_open_count(), "Devices of the same path should share a handle");
+
+               // ...but each has its own file position
+               char buffer[4] = {};
+               first.seek(2);
+               utf8::Assert::IsTrue(first.read(buffer, 3) == 3, "read returned an unexpected byte count");
+               utf8::Assert::IsTrue(std::string(buffer, 3) == "234", "read at an unexpected position");
+               utf8::Assert::IsTrue(second.read(buffer, 3) == 3, "read returned an unexpected byte count");
+               utf8::Assert::IsTrue(std::string(buffer, 3) == "012", "the file position should not be shared");
+               utf8::Assert::IsTrue(first.read(buffer, 3) == 3, "read returned an unexpected byte count");
+               utf8::Assert::IsTrue(std::string(buffer, 3) == "567", "the file position should advance");
+            }
+
+            // check results (the released handle stays pooled until it has been idle for a while, or is closed)
+            utf8::Assert::AreEqual(open_count + 1, DeviceHandlePool::get_open_count(), "a released handle should stay pooled");
+            DeviceHandlePool::close_idle();
+            utf8::Assert::AreEqual(open_count, DeviceHandlePool::get_open_count(), "close_idle should close the idle handle");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceHandlePoolIdleTimeout)
+      {
+         try
+         {
+            // prepare for test (a short idle timeout)
+            const temporary_file device("UnitTestDeviceHandlePool.bin", "0123456789");
+            DeviceHandlePool::close_idle();
+            const std::size_t open_count = DeviceHandlePool::get_open_count();
+            DeviceHandlePool::set_idle_timeout(50ms);
+
+            // perform the operation under test (release a handle, and wait for it to be closed)...
+            {
+               Device released(device.path);
+            }
+            utf8::Assert::AreEqual(open_count + 1, DeviceHandlePool::get_open_count(), "a released handle should stay pooled");
+
+            int retries = 100;
+            while ((DeviceHandlePool::get_open_count() != open_count) && (--retries > 0))
+            {
+               std::this_thread::sleep_for(20ms);
+            }
+            DeviceHandlePool::set_idle_timeout(DeviceHandlePool::default_idle_timeout);
+
+            // check results
+            utf8::Assert::AreEqual(open_count, DeviceHandlePool::get_open_count(), "an idle handle should be closed after the idle timeout");
+         }
+         catch (const std::exception& e)
+         {
+            DeviceHandlePool::set_idle_timeout(DeviceHandlePool::default_idle_timeout);
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+#ifdef __linux__
+      TEST_METHOD(TestDeviceHandlePoolUnbufferedDowngrade)
+      {
+         if (!std::filesystem::is_directory("/dev/shm"))
+         {
+            return;     // (no tmpfs to refuse direct i/o)
+         }
+
+         try
+         {
+            // prepare for test (a file on tmpfs, which refuses direct i/o before Linux 6.6)
+            const temporary_file device("/dev/shm/UnitTestDeviceHandlePool.bin", "0123456789");
+
+            // perform the operation under test (ask for unbuffered, then buffered, access)...
+            const auto unbuffered = DeviceHandlePool::acquire(device.path, DeviceHandlePool::access::read, DeviceHandlePool::caching::unbuffered);
+            const auto buffered = DeviceHandlePool::acquire(device.path, DeviceHandlePool::access::read, DeviceHandlePool::caching::buffered);
+
+            // check results (each handle is pooled under the caching it really has, so a downgraded handle is shared
+            // with the buffered user, and a direct i/o handle is not)
+            const bool direct = (::fcntl(*static_cast<int*>(unbuffered.get()), F_GETFL) & O_DIRECT) != 0;
+            utf8::Assert::IsTrue((unbuffered.get() == buffered.get()) == !direct, "a handle was pooled under the wrong caching");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+#endif
+
+      TEST_METHOD(TestDeviceHandlePoolReset)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file device("UnitTestDeviceHandlePool.bin", "0123456789");
+            Device first(device.path);
+            Device second(device.path);
+            const auto handle = DeviceHandlePool::acquire(device.path);
+
+            // perform the operation under test (reset opens the device again, while the other users keep their handle)...
+            first.reset();
+            const auto reopened = DeviceHandlePool::acquire(device.path);
+
+            // check results
+            utf8::Assert::IsTrue(handle.get() != reopened.get(), "reset should open the device again");
+            char buffer[3] = {};
+            utf8::Assert::IsTrue(first.read(buffer, 3) == 3, "the reset device should be readable");
+            utf8::Assert::IsTrue(second.read(buffer, 3) == 3, "the other device should still be readable");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
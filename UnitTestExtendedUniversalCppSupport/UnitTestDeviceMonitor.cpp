@@ -0,0 +1,229 @@
+//
+// UnitTestDeviceMonitor.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   ///<summary> short polling intervals (so that tests run quickly).</summary>
+   const DeviceMonitor::Polling test_polling{ std::chrono::milliseconds(5), std::chrono::milliseconds(50) };
+
+   ///<summary> the longest time a test waits for an event.</summary>
+   constexpr std::chrono::milliseconds event_timeout(5000);
+
+   TEST_CLASS(UnitTestDeviceMonitor)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitDeviceMonitor) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestDeviceMonitorDirectorySource)
+      {
+         try
+         {
+            // prepare for test (an empty directory, where each file stands in for a device, and file content for media)
+            wchar_t temp_path[MAX_PATH + 1] = {};
+            utf8::Assert::IsTrue(GetTempPathW(MAX_PATH + 1, temp_path) != 0, "couldn't get the temporary directory");
+            const std::string directory = utf8::convert::from_utf16(temp_path) + "UnitTestDeviceMonitor";
+            const std::string device = directory + "\\drive0";
+            CreateDirectoryW(utf8::convert::to_utf16(directory).c_str(), nullptr);
+            DeleteFileW(utf8::convert::to_utf16(device).c_str());
+
+            DeviceMonitor monitor(DeviceMonitor::directory_source(directory), test_polling);
+            utf8::Assert::IsTrue(monitor.get_devices().empty(), "unexpected device in an empty directory");
+
+            // perform the operations under test, and check each is reported (in order)
+            std::ofstream(utf8::convert::to_utf16(device), std::ios::binary).close();
+            auto event = monitor.wait_for_event(event_timeout);
+            utf8::Assert::IsTrue(event.has_value() && (event->type == DeviceMonitor::EventType::device_attached) && (event->device_path == device), "device attach was not reported");
+            utf8::Assert::IsFalse(monitor.has_media(device), "an empty device should hold no media");
+
+            std::ofstream(utf8::convert::to_utf16(device), std::ios::binary) << "CD001";
+            event = monitor.wait_for_event(event_timeout);
+            utf8::Assert::IsTrue(event.has_value() && (event->type == DeviceMonitor::EventType::media_inserted), "media insertion was not reported");
+            utf8::Assert::IsTrue(monitor.has_media(device), "the device should hold media");
+
+            std::ofstream(utf8::convert::to_utf16(device), std::ios::binary | std::ios::trunc).close();
+            event = monitor.wait_for_event(event_timeout);
+            utf8::Assert::IsTrue(event.has_value() && (event->type == DeviceMonitor::EventType::media_removed), "media removal was not reported");
+
+            DeleteFileW(utf8::convert::to_utf16(device).c_str());
+            event = monitor.wait_for_event(event_timeout);
+            utf8::Assert::IsTrue(event.has_value() && (event->type == DeviceMonitor::EventType::device_detached), "device detach was not reported");
+            utf8::Assert::IsTrue(monitor.get_devices().empty(), "unexpected device after detach");
+
+            // nothing else happened
+            utf8::Assert::IsFalse(monitor.wait_for_event(std::chrono::milliseconds(100)).has_value(), "unexpected event");
+            RemoveDirectoryW(utf8::convert::to_utf16(directory).c_str());
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceMonitorSubscribe)
+      {
+         try
+         {
+            // prepare for test (a fake device directory, changed by the test, and woken on demand)
+            std::mutex devices_mutex;
+            std::vector<std::string> devices = { "fake0" };
+            std::vector<std::string> loaded = { };
+
+            DeviceMonitor::Source source;
+            source.enumerate = [&]() { std::lock_guard<std::mutex> lock(devices_mutex); return devices; };
+            source.check_for_media = [&](const std::string& path) -> error::expected<bool>
+            {
+               std::lock_guard<std::mutex> lock(devices_mutex);
+               return std::find(loaded.begin(), loaded.end(), path) != loaded.end();
+            };
+
+            // (the subscriber's state is declared first, so that it outlives the monitor)
+            std::mutex events_mutex;
+            std::condition_variable events_changed;
+            std::vector<DeviceMonitor::Event> events;
+
+            // polling is too slow to notice changes during the test, so they are only seen when the monitor is woken
+            const DeviceMonitor::Polling slow_polling{ std::chrono::milliseconds(60000), std::chrono::milliseconds(60000) };
+            DeviceMonitor monitor(source, slow_polling);
+
+            const int subscription = monitor.subscribe([&](const DeviceMonitor::Event& event)
+            {
+               std::lock_guard<std::mutex> lock(events_mutex);
+               events.push_back(event);
+               events_changed.notify_all();
+            });
+
+            // perform the operation under test (attach a device holding media, and detach the first)
+            {
+               std::lock_guard<std::mutex> lock(devices_mutex);
+               devices = { "fake1" };
+               loaded = { "fake1" };
+            }
+            monitor.refresh();
+
+            // check result (the subscriber is told of each change, in order)
+            std::unique_lock<std::mutex> lock(events_mutex);
+            utf8::Assert::IsTrue(events_changed.wait_for(lock, event_timeout, [&]() { return events.size() >= 3; }), "the subscriber was not told of each change");
+            utf8::Assert::IsTrue((events[0].type == DeviceMonitor::EventType::device_detached) && (events[0].device_path == "fake0"), "unexpected first event");
+            utf8::Assert::IsTrue((events[1].type == DeviceMonitor::EventType::device_attached) && (events[1].device_path == "fake1"), "unexpected second event");
+            utf8::Assert::IsTrue((events[2].type == DeviceMonitor::EventType::media_inserted) && (events[2].device_path == "fake1"), "unexpected third event");
+            lock.unlock();
+
+            utf8::Assert::IsTrue(monitor.has_media("fake1"), "the attached device should hold media");
+            monitor.unsubscribe(subscription);
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceMonitorWatchedSourceChecksMediaSlowly)
+      {
+         try
+         {
+            // prepare for test (a fake device that counts enumerations and media checks, and a source that can be woken)
+            std::mutex source_mutex;
+            bool loaded = false;
+            int enumerations = 0;
+            int checks = 0;
+            std::function<void()> wake;
+
+            DeviceMonitor::Source source;
+            source.enumerate = [&]()
+            {
+               std::lock_guard<std::mutex> lock(source_mutex);
+               ++enumerations;
+               return std::vector<std::string>{ "fake0" };
+            };
+            source.check_for_media = [&](const std::string&) -> error::expected<bool>
+            {
+               std::lock_guard<std::mutex> lock(source_mutex);
+               ++checks;
+               return loaded;
+            };
+            source.watch = [&](std::function<void()> aWake) -> std::shared_ptr<void>
+            {
+               std::lock_guard<std::mutex> lock(source_mutex);
+               wake = std::move(aWake);
+               return std::make_shared<int>(0);
+            };
+
+            DeviceMonitor::Polling polling = test_polling;
+            polling.media_interval = std::chrono::milliseconds(1000);
+            DeviceMonitor monitor(source, polling);
+
+            // perform the operations under test (let many polling intervals pass, then insert media without a notification)...
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            int checks_while_idle = 0;
+            {
+               std::lock_guard<std::mutex> lock(source_mutex);
+               checks_while_idle = checks;
+               loaded = true;
+            }
+            const auto inserted = monitor.wait_for_event(event_timeout);
+
+            // ...then remove it, with a notification
+            int enumerations_unnotified = 0;
+            {
+               std::lock_guard<std::mutex> lock(source_mutex);
+               enumerations_unnotified = enumerations;
+               loaded = false;
+            }
+            const auto started = std::chrono::steady_clock::now();
+            wake();
+            const auto removed = monitor.wait_for_event(event_timeout);
+            const auto elapsed = std::chrono::steady_clock::now() - started;
+
+            // check results (no fast polling, the slow media check finds the unnotified insertion without reading the
+            // device list, and a notification is acted on at once)
+            utf8::Assert::AreEqual(1, checks_while_idle, "the devices were polled at the adaptive interval although notifications were registered");
+            utf8::Assert::IsTrue(inserted.has_value() && (inserted->type == DeviceMonitor::EventType::media_inserted), "media insertion was not found by the media check");
+            utf8::Assert::AreEqual(1, enumerations_unnotified, "the device list was read without a notification");
+            utf8::Assert::IsTrue(removed.has_value() && (removed->type == DeviceMonitor::EventType::media_removed), "media removal was not reported");
+            utf8::Assert::IsTrue(elapsed < polling.media_interval, "the notification was not acted on at once");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
@@ -0,0 +1,146 @@
+//
+// UnitTestDeviceReadQueue.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestDeviceReadQueue)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitDeviceReadQueue) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestDeviceReadQueueBackendsAgree)
+      {
+         try
+         {
+            // prepare for test (an image that ends part way through a read)
+            const temporary_file image("UnitTestDeviceReadQueue.bin", 1000003);
+
+            for (const auto backend : { DeviceReadQueue::Backend::io_uring, DeviceReadQueue::Backend::synchronous })
+            {
+               // perform the operation under test (read past the end, with several reads in flight)...
+               DeviceReadQueue queue(image.path, 65536, 4, backend);
+               std::vector<char> data(image.content.size() + 100);
+               const auto cbyRead = queue.read_into(0, data.data(), data.size());
+
+               // check results (every backend reads the same bytes)
+               utf8::Assert::IsTrue(cbyRead == image.content.size(), "read should stop at the end of the image");
+               utf8::Assert::IsTrue(std::equal(image.content.begin(), image.content.end(), data.begin()), "read returned unexpected content");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceReadQueueSinkInOrder)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file image("UnitTestDeviceReadQueue.bin", 300000);
+
+            for (const auto backend : { DeviceReadQueue::Backend::io_uring, DeviceReadQueue::Backend::synchronous })
+            {
+               DeviceReadQueue queue(image.path, 4096, DeviceReadQueue::default_depth, backend);
+
+               // perform the operation under test (read from an offset into the queue's buffers)...
+               std::vector<char> data;
+               const auto cbyRead = queue.read(10, image.content.size(), [&data](const void* lpData, std::uint32_t nBytes)
+                  {
+                     data.insert(data.end(), static_cast<const char*>(lpData), static_cast<const char*>(lpData) + nBytes);
+                  });
+
+               // check results (handed over in order, by every backend)
+               utf8::Assert::IsTrue(cbyRead == image.content.size() - 10, "read returned an unexpected byte count");
+               utf8::Assert::IsTrue(std::equal(image.content.begin() + 10, image.content.end(), data.begin(), data.end()), "the sink received unexpected content");
+               utf8::Assert::IsTrue(queue.read_into(std::nothrow, image.content.size(), data.data(), 10).value() == 0, "a read at the end should read nothing");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceReadQueueSinkThrows)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file image("UnitTestDeviceReadQueue.bin", 300000);
+
+            for (const auto backend : { DeviceReadQueue::Backend::io_uring, DeviceReadQueue::Backend::synchronous })
+            {
+               DeviceReadQueue queue(image.path, 4096, DeviceReadQueue::default_depth, backend);
+
+               // perform the operation under test (the sink stops the read)...
+               int calls = 0;
+               try
+               {
+                  queue.read(0, image.content.size(), [&calls](const void*, std::uint32_t)
+                     {
+                        if (++calls == 3)
+                        {
+                           throw std::runtime_error("stop");
+                        }
+                     });
+                  utf8::Assert::Fail("the sink exception should be passed on");
+               }
+               catch (const std::runtime_error& e)
+               {
+                  utf8::Assert::IsTrue(std::string(e.what()) == "stop", "an unexpected exception was passed on");
+               }
+
+               // check results (the queue is still usable, with every backend)
+               char buffer[8] = {};
+               utf8::Assert::IsTrue(queue.read_into(16, buffer, sizeof(buffer)) == sizeof(buffer), "the queue should be usable after a sink exception");
+               utf8::Assert::IsTrue(std::equal(buffer, buffer + sizeof(buffer), image.content.begin() + 16), "read returned unexpected content");
+               utf8::Assert::AreEqual(3, calls, "the sink should not be called after it throws");
+            }
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
@@ -33,7 +33,7 @@ namespace UnitTestExtendedUniversalCppSupport
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, LogFilter::Full);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, LogFilter::Full);
          }
          catch (...)
          {
@@ -67,5 +67,76 @@ namespace UnitTestExtendedUniversalCppSupport
             utf8::Assert::Fail(e.what()); // something went wrong
          }
       }
+
+      TEST_METHOD(TestDeviceTypeDirectoryStandardGuids)
+      {
+         using namespace utf8::literals;
+         using DeviceType = DeviceTypeDirectory::DeviceType;
+
+         // the standard table is available (and checked) at compile time...
+         static_assert(DeviceTypeDirectory::get_standard_device_type_guid(DeviceType::CDROM_DEVICES) == "{53F56308-B6BF-11D0-94F2-00A0C91EFB8B}"_guid, "unexpected CDROM_DEVICES guid");
+
+         try
+         {
+            // prepare for test (the system definitions, in DeviceType order)...
+            const GUID expected[] =
+            {
+               GUID_DEVINTERFACE_DISK, GUID_DEVINTERFACE_CDROM, GUID_DEVINTERFACE_PARTITION, GUID_DEVINTERFACE_TAPE,
+               GUID_DEVINTERFACE_WRITEONCEDISK, GUID_DEVINTERFACE_VOLUME, GUID_DEVINTERFACE_MEDIUMCHANGER, GUID_DEVINTERFACE_FLOPPY,
+               GUID_DEVINTERFACE_CDCHANGER, GUID_DEVINTERFACE_STORAGEPORT, GUID_DEVINTERFACE_VMLUN, GUID_DEVINTERFACE_SES
+            };
+            utf8::Assert::IsTrue(std::size(expected) == DeviceTypeDirectory::standard_device_type_count, "standard device type count is unexpected");
+
+            for (std::size_t i = 0; i < std::size(expected); i++)
+            {
+               // perform the operations under test, and test succeeds if the tables match the system definitions...
+               const DeviceType device_type = static_cast<DeviceType>(i);
+               utf8::Assert::IsTrue(expected[i] == utf8::guid_convert::to_guid(DeviceTypeDirectory::get_device_type_guid(device_type)), "standard device type guid does not match winioctl.h");
+               utf8::Assert::IsTrue(DeviceTypeDirectory::find_device_type(utf8::guid_convert::to_portable_guid(expected[i])) == device_type, "standard device type not found by guid");
+            }
+         }
+         catch (const std::exception & e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestDeviceTypeDirectoryRegisterCustomDeviceType)
+      {
+         using namespace utf8::literals;
+         using DeviceType = DeviceTypeDirectory::DeviceType;
+
+         try
+         {
+            // prepare for test (a made up vendor specific interface class)...
+            constexpr utf8::guid custom_guid = "6a1f3b2e-5c4d-4e8f-9a0b-1c2d3e4f5a6b"_guid;
+
+            // perform the operations under test...
+            const DeviceType custom = DeviceTypeDirectory::register_device_type(custom_guid);
+            const DeviceType again = DeviceTypeDirectory::register_device_type(custom_guid);
+
+            // test succeeds if the custom device type is found both ways, and registering it again has no effect...
+            utf8::Assert::IsTrue(static_cast<int>(custom) >= DeviceTypeDirectory::first_custom_device_type, "custom device type overlaps standard device types");
+            utf8::Assert::IsTrue(custom == again, "registering the same guid again gave a different device type");
+            utf8::Assert::IsTrue(DeviceTypeDirectory::get_device_type_guid(custom) == custom_guid, "custom device type guid was not found");
+            utf8::Assert::IsTrue(DeviceTypeDirectory::find_device_type(custom_guid) == custom, "custom device type was not found by guid");
+            utf8::Assert::IsTrue(DeviceTypeDirectory::register_device_type(DeviceTypeDirectory::standard_device_type_guids[1]) == DeviceType::CDROM_DEVICES, "registering a standard guid gave a new device type");
+            utf8::Assert::IsFalse(DeviceTypeDirectory::find_device_type("00000000-0000-0000-0000-000000000001"_guid).has_value(), "unknown guid was found");
+         }
+         catch (const std::exception & e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+
+         try
+         {
+            DeviceTypeDirectory::get_device_type_guid(static_cast<DeviceType>(DeviceTypeDirectory::first_custom_device_type + static_cast<int>(DeviceTypeDirectory::max_custom_device_types)));
+            utf8::Assert::Fail("an unknown device type was accepted");
+         }
+         catch (const error::context&)
+         {
+            // expected
+         }
+      }
    };
 }
\ No newline at end of file
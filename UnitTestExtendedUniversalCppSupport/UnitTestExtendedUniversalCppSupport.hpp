@@ -19,7 +19,12 @@
 #ifndef __UNIT_TEST_EXTENDED_UNIVERSAL_CPP_SUPPORT_HPP__
 #define __UNIT_TEST_EXTENDED_UNIVERSAL_CPP_SUPPORT_HPP__
 
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <system_error>
+#include <vector>
 
 // TODO: We can't control the  test sequence, so there is a race to name the (single) logfile (as used by default logger macros).
 // The Current logger_factory implementation doesn't even indicate who won, so unit tests can fail simply because they hard code 
@@ -29,6 +34,104 @@
 namespace UnitTestExtendedUniversalCppSupport
 {
    const std::string log_file_name("UnitTest.log");
+
+   ///<summary> a file in the temporary directory (E.g. an image standing in for a device), deleted on destruction.</summary>
+   ///<remarks> the file may be read through pooled device handles, so those are closed before it is deleted.</remarks>
+   class temporary_file
+   {
+   public:
+      ///<summary> reserve the path of a temporary file (E.g. the target of a copy), without creating the file.</summary>
+      ///<param name='name'> the (utf8 encoded) file name.</param>
+      explicit temporary_file(const std::string& name) :
+         path(to_utf8(std::filesystem::temp_directory_path() / to_path(name)))
+      {
+         remove();
+      }
+
+      ///<summary> create a temporary file of known content.</summary>
+      ///<param name='name'> the (utf8 encoded) file name.</param>
+      ///<param name='a_content'> the file content.</param>
+      temporary_file(const std::string& name, std::vector<char> a_content) :
+         temporary_file(name)
+      {
+         content = std::move(a_content);
+         std::ofstream(to_path(path), std::ios::binary | std::ios::trunc).write(content.data(), content.size());
+      }
+
+      ///<summary> create a temporary file of known text.</summary>
+      ///<param name='name'> the (utf8 encoded) file name.</param>
+      ///<param name='text'> the file content.</param>
+      temporary_file(const std::string& name, const std::string& text) :
+         temporary_file(name, std::vector<char>(text.begin(), text.end()))
+      {
+      }
+
+      ///<summary> create a temporary file of patterned content (so that misplaced data is noticed).</summary>
+      ///<param name='name'> the (utf8 encoded) file name.</param>
+      ///<param name='size'> the file size in bytes.</param>
+      temporary_file(const std::string& name, std::size_t size) :
+         temporary_file(name, patterned(size))
+      {
+      }
+
+      temporary_file(const temporary_file& other) = delete;
+      temporary_file& operator=(const temporary_file& other) = delete;
+
+      ~temporary_file()
+      {
+         DeviceHandlePool::retire(path);
+         DeviceHandlePool::close_idle();
+         remove();
+      }
+
+      ///<summary> read the whole file (empty if it doesn't exist).</summary>
+      std::vector<char> read() const
+      {
+         std::ifstream file(to_path(path), std::ios::binary);
+         return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      }
+
+      ///<summary> check whether the file exists.</summary>
+      bool exists() const
+      {
+         std::error_code error;
+         return std::filesystem::exists(to_path(path), error);
+      }
+
+      ///<summary> the (utf8 encoded) path of the file.</summary>
+      std::string path;
+
+      ///<summary> the content the file was created with.</summary>
+      std::vector<char> content;
+
+   private:
+      static std::filesystem::path to_path(const std::string& utf8_path)
+      {
+         return std::filesystem::path(std::u8string(utf8_path.begin(), utf8_path.end()));
+      }
+
+      static std::string to_utf8(const std::filesystem::path& a_path)
+      {
+         const std::u8string utf8_path = a_path.u8string();
+         return std::string(utf8_path.begin(), utf8_path.end());
+      }
+
+      static std::vector<char> patterned(std::size_t size)
+      {
+         std::vector<char> data(size);
+         for (std::size_t index = 0; index < size; index++)
+         {
+            data[index] = static_cast<char>(index * 31 + 7);
+         }
+         return data;
+      }
+
+      void remove() const noexcept
+      {
+         std::error_code error;
+         std::filesystem::remove(to_path(path), error);
+      }
+   };
 };
 
 // useful macro conversions for use in unit tests@END
@@ -38,7 +141,7 @@ namespace UnitTestExtendedUniversalCppSupport
 #endif
 
 
-
+#ifdef _WIN32
 /// <summary>
 /// RAII impersonation helper available for use in various tests.
 /// </summary>
@@ -71,5 +174,6 @@ public:
       RevertToSelf();
    }
 };
+#endif // _WIN32
 
 #endif // __UNIT_TEST_EXTENDED_UNIVERAL_CPP_SUPPORT_HPP__
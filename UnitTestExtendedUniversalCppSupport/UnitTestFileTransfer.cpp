@@ -0,0 +1,141 @@
+//
+// UnitTestFileTransfer.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestFileTransfer)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitFileTransfer) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestFileTransferWholeFile)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file source("UnitTestFileTransferSource.iso", 3 * 1024 * 1024 + 2048);
+            const temporary_file target("UnitTestFileTransferTarget.iso");
+            std::atomic<int> progress = 0;
+
+            // perform the operation under test...
+            utf8::Assert::IsTrue(FileTransfer::get_size(source.path) == source.content.size(), "unexpected source size");
+            const auto method = FileTransfer::copy(source.path, target.path, source.content.size(), progress);
+
+            // check results (a regular file can always be copied in the kernel)
+            utf8::Assert::IsTrue(method != FileTransfer::method::buffered, "a regular file should be copied in the kernel");
+            utf8::Assert::IsTrue(progress == 100, "progress should be 100%");
+            utf8::Assert::IsTrue(target.read() == source.content, "the copy has unexpected content");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestFileTransferPartial)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file source("UnitTestFileTransferPartialSource.iso", 3 * 1024 * 1024 + 2048);
+            const temporary_file target("UnitTestFileTransferPartialTarget.iso");
+            const std::vector<char> expected(source.content.begin(), source.content.begin() + 1024 * 1024 + 512);
+            std::atomic<int> progress = 0;
+
+            // perform the operation under test (the start of the source, as an image is copied from the start of a device)...
+            FileTransfer::copy(source.path, target.path, expected.size(), progress);
+
+            // check results
+            utf8::Assert::IsTrue(target.read() == expected, "the copy has unexpected content");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestFileTransferPastEnd)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file source("UnitTestFileTransferPastEndSource.iso", 3 * 1024 * 1024 + 2048);
+            const temporary_file target("UnitTestFileTransferPastEndTarget.iso");
+            std::atomic<int> progress = 0;
+
+            // perform the operation under test (ask for more than the source holds)...
+            const auto copied = FileTransfer::copy(std::nothrow, source.path, target.path, source.content.size() + 4096, progress);
+
+            // check results (the copy fails, and leaves no partial target behind)
+            utf8::Assert::IsFalse(copied.has_value(), "a copy past the end of the source should fail");
+            utf8::Assert::IsTrue(!target.exists(), "a failed copy should delete the target");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestFileTransferMissingSource)
+      {
+         try
+         {
+            // prepare for test
+            const temporary_file target("UnitTestFileTransferMissingTarget.iso");
+            std::atomic<int> progress = 0;
+
+            // perform the operation under test (copy from a source that does not exist)...
+            const auto copied = FileTransfer::copy(std::nothrow, "UnitTestFileTransferMissingSource.iso", target.path, 4096, progress);
+
+            // check results (the error is the one the open failed with)
+            utf8::Assert::IsFalse(copied.has_value(), "a copy from a missing source should fail");
+#ifdef _WIN32
+            utf8::Assert::AreEqual(static_cast<int>(ERROR_FILE_NOT_FOUND), copied.error().get_error_code(), "unexpected error code");
+#else
+            utf8::Assert::AreEqual(static_cast<int>(ENOENT), copied.error().get_error_code(), "unexpected error code");
+#endif
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
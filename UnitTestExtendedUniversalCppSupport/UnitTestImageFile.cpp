@@ -0,0 +1,135 @@
+//
+// UnitTestImageFile.cpp : a utf8 everywhere component unit test
+//
+// Copyright (c) 2020 Jack Heeley, all rights reserved. https://github.com/JackHeeley/App3Dev
+//
+//    This program is free software : you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.If not, see < http://www.gnu.org/licenses/ >.
+//
+#include "stdafx.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace utf8;
+
+namespace UnitTestExtendedUniversalCppSupport
+{
+   TEST_CLASS(UnitTestImageFile)
+   {
+   public:
+
+#pragma warning(disable: 26440)
+      TEST_CLASS_INITIALIZE(InitializeUnitImageFile) noexcept // NOLINT(clang-diagnostic-missing-braces)
+#pragma warning(default: 26440)
+      {
+         try
+         {
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
+         }
+         catch (...)
+         {
+            LOG_ERROR("Couldn't create logger.");       // No logger? This will emit on std::cerr
+         }
+      }
+
+      TEST_METHOD(TestImageFileUnbufferedTail)
+      {
+         const temporary_file image_file("UnitTestImageFileUnbuffered.iso");
+         try
+         {
+            // prepare for test (an image that ends part way through a file system block)
+            ImageFile image(image_file.path, ImageFile::caching::unbuffered);
+            AlignedBufferPool pool(8192, image.get_alignment());
+            const std::uint32_t cbyImageSize = 8192 + 2048;
+
+            std::vector<char> expected(cbyImageSize);
+            for (std::size_t index = 0; index < expected.size(); index++)
+            {
+               expected[index] = static_cast<char>(index * 13);
+            }
+
+            // perform the operation under test (write from aligned buffers, the last partially filled)...
+            const auto buffer = pool.acquire();
+            std::copy(expected.begin(), expected.begin() + 8192, buffer.get());
+            image.write(0, buffer.get(), 8192);
+            std::copy(expected.begin() + 8192, expected.end(), buffer.get());
+            image.write(8192, buffer.get(), cbyImageSize - 8192);
+            image.close();
+
+            // check results (the excess of the last block is cut off)
+            utf8::Assert::IsTrue(image_file.read() == expected, "the image file has unexpected content");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestImageFileUnbufferedExactTail)
+      {
+         const temporary_file image_file("UnitTestImageFileExactTail.iso");
+         try
+         {
+            // prepare for test (the last block comes from an aligned buffer holding only the data, nothing after it)
+            ImageFile image(image_file.path, ImageFile::caching::unbuffered);
+            const std::uint32_t alignment = image.get_alignment();
+            const std::uint32_t cbyTail = 1000;
+            const auto release = [alignment](unsigned char* lpBuffer) { ::operator delete[](lpBuffer, std::align_val_t(alignment)); };
+            const std::unique_ptr<unsigned char[], decltype(release)> tail(
+               static_cast<unsigned char*>(::operator new[](cbyTail, std::align_val_t(alignment))), release);
+            std::fill(tail.get(), tail.get() + cbyTail, static_cast<unsigned char>('t'));
+
+            // perform the operation under test (write the tail, then try an unaligned offset)...
+            image.write(0, tail.get(), cbyTail);
+            const auto unaligned = image.write(std::nothrow, 1, tail.get(), cbyTail);
+            image.close();
+
+            // check results (only the tail is in the file, and unbuffered, the unaligned write is refused)
+            const auto content = image_file.read();
+            utf8::Assert::IsTrue(content == std::vector<char>(cbyTail, 't'), "the image file has unexpected content");
+            utf8::Assert::IsTrue((alignment == 1) || !unaligned, "an unaligned unbuffered write should fail");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+
+      TEST_METHOD(TestImageFileBuffered)
+      {
+         const temporary_file image_file("UnitTestImageFileBuffered.iso");
+         try
+         {
+            // perform the operation under test (buffered writes need no alignment, and may be out of order)...
+            {
+               ImageFile image(image_file.path);
+               utf8::Assert::IsTrue(image.get_alignment() == 1, "buffered writes should need no alignment");
+               image.write(3, "defg", 4);
+               image.write(0, "abc", 3);
+            }  // (closed by the destructor)
+
+            // check results
+            const auto content = image_file.read();
+            utf8::Assert::IsTrue(std::string(content.begin(), content.end()) == "abcdefg", "the image file has unexpected content");
+         }
+         catch (const std::exception& e)
+         {
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+      }
+   };
+}
@@ -8,14 +8,18 @@
 // add check for tools limitations (clang support) with impact on build preferences
 #include "toolsver.h"
 
+#ifdef _WIN32
 #include "targetver.h"
+#endif
 
 // Headers for CppUnitTest
 #include <CppUnitTest.hpp>
 
 // TODO: reference additional headers your program requires here
+#ifdef _WIN32
 #define NOMINMAX
 #include <windows.h>
+#endif
 
 #include <chrono>
 #include <iostream>
@@ -25,6 +29,8 @@
 #include <vector>
 
 #include "error_context.hpp"
+#include "expected.hpp"
+#include "fast_pimpl.hpp"
 #include "file_logger.hpp"
 #include "gsl.hpp"
 #include "logger.hpp"
@@ -33,16 +39,33 @@
 #include "system_error.hpp"
 #include "utf8_assert.hpp"
 #include "utf8_convert.hpp"
+#include "guid.hpp"
+#ifdef _WIN32
 #include "utf8_guid.hpp"
+#endif
 #include "utc_timestamp.hpp"
 
+#include "aligned_buffer_pool.hpp"
+#include "block_source.hpp"
+#ifdef _WIN32
 #include "cd_rom_device.hpp"
+#endif
 #include "device.hpp"
 #include "device_discoverer.hpp"
+#include "device_discovery_cache.hpp"
+#include "device_handle_pool.hpp"
+#ifdef _WIN32
+#include "device_monitor.hpp"
+#endif
+#include "device_read_queue.hpp"
 #include "device_type_directory.hpp"
+#include "file_transfer.hpp"
+#include "image_file.hpp"
+#ifdef _WIN32
 #include "memory_mapped_file.hpp"
 #include "RAII_cd_exclusive_access_lock.hpp"
 #include "RAII_cd_physical_lock.hpp"
+#endif
 
 #include "UnitTestExtendedUniversalCppSupport.hpp"
 
@@ -18,6 +18,10 @@
 //
 #include "stdafx.h"
 
+#include <fstream>
+#include <iterator>
+#include <vector>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std::chrono_literals;
 using namespace utf8;
@@ -35,7 +39,7 @@ namespace UnitTestSampleProgram
       {
          try
          {
-            CREATE_LOGGER(logger_factory::logger_type::file_logger, log_file_name, DEFAULT_LOG_FILTER);
+            CREATE_LOGGER(logger_factory::logger_type::shared_file_logger, log_file_name, DEFAULT_LOG_FILTER);
          }
          catch (...)
          {
@@ -103,5 +107,37 @@ namespace UnitTestSampleProgram
             utf8::Assert::Fail(e.what()); // something went wrong
          }
       }
+
+      TEST_METHOD(TestRipBlockSource)
+      {
+         const static std::string fileName("block_source_image.iso");
+         try
+         {
+            // prepare test (an image in memory, so no cdrom is needed)
+            std::vector<unsigned char> image(BlockSource::default_transfer_size + 3 * BlockSource::default_sector_size);
+            for (std::size_t index = 0; index < image.size(); index++)
+            {
+               image[index] = static_cast<unsigned char>(index * 13 + 5);
+            }
+            const MemoryBlockSource source(image);
+            std::atomic<int> progress;
+
+            //perform operation under test (the pipeline the functor uses for a cdrom)
+            Ripper::rip(source, fileName, progress);
+
+            // check results
+            std::ifstream file(utf8::convert::to_utf16(fileName), std::ios::binary);
+            const std::vector<unsigned char> ripped((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            file.close();
+            utf8::Assert::IsTrue(ripped == image, "the ripped image has unexpected content");
+            utf8::Assert::IsTrue(progress == 100, "progress should be 100%");
+         }
+         catch (const std::exception& e)
+         {
+            DeleteFileW(utf8::convert::to_utf16(fileName).c_str());
+            utf8::Assert::Fail(e.what()); // something went wrong
+         }
+         DeleteFileW(utf8::convert::to_utf16(fileName).c_str());
+      }
    };
 }
\ No newline at end of file